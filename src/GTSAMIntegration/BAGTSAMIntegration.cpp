@@ -35,6 +35,7 @@
 
 #include "FullSystem/HessianBlocks.h"
 #include "dso/util/FrameShell.h"
+#include "dso/util/settings.h"
 #include "GTSAMIntegration/ExtUtils.h"
 #include "GTSAMUtils.h"
 
@@ -186,7 +187,26 @@ BAGTSAMIntegration::computeBAUpdate(const dso::MatXX& inputH, const VecX& inputB
     gtsam::Matrix H_scaled = SVecI.asDiagonal() * HFull * SVecI.asDiagonal();
 
     dmvio::TimeMeasurement matrixInversionMeasurement("baMatrixInversion");
-    gtsam::Vector inc = SVecI.asDiagonal() * H_scaled.ldlt().solve(SVecI.asDiagonal() * bFull);
+    gtsam::Vector inc;
+    bool solved = false;
+    if(dso::setting_solverMode & SOLVER_SPARSE_BLOCK_LDLT)
+    {
+        // One block per key. IMU factors only connect consecutive keyframes, so the system is mostly banded.
+        std::vector<int> blockSizes;
+        for(const gtsam::Key& key : baOrdering)
+        {
+            blockSizes.push_back(baDimMap.at(key));
+        }
+        solved = sparseSolver.solve(H_scaled, SVecI.asDiagonal() * bFull, blockSizes, inc);
+        if(solved)
+        {
+            inc = SVecI.asDiagonal() * inc;
+        }
+    }
+    if(!solved)
+    {
+        inc = SVecI.asDiagonal() * H_scaled.ldlt().solve(SVecI.asDiagonal() * bFull);
+    }
     matrixInversionMeasurement.end();
 
     // Update values based on the computed increment.
@@ -34,6 +34,7 @@
 
 #include "PoseTransformation.h"
 #include "AugmentedScatter.hpp"
+#include "OptimizationBackend/SparseBlockLDLT.h"
 
 
 // This source file, and in particular the class BAGTSAMIntegration is responsible for integrating the Bundle Adjustment for DSO into GTSAM.
@@ -222,6 +223,9 @@ private:
     gtsam::Ordering baOrdering, baOrderingSmall; // baOrdering contains all keys and baOrderingSmall only the ones known by DSO (only poses).
     std::map<gtsam::Key, size_t> baDimMap;
 
+    // Used if dso::setting_solverMode contains SOLVER_SPARSE_BLOCK_LDLT, keeps the symbolic factorization between iterations.
+    dso::SparseBlockLDLT sparseSolver;
+
     bool canBreakOptimization = false;
 
     dso::CalibHessian* HCalib;
@@ -26,30 +26,59 @@
 #include "GTSAMUtils.h"
 #include <gtsam/nonlinear/NonlinearFactorGraph.h>
 #include <gtsam/linear/GaussianFactorGraph.h>
+#include <iostream>
 
 using namespace dmvio;
 
-DelayedMarginalizationGraphs::DelayedMarginalizationGraphs(int mainGraphDelay, int maxGroupInMainGraph)
+DelayedMarginalizationGraphs::DelayedMarginalizationGraphs(int mainGraphDelay, int maxGroupInMainGraph,
+                                                           double relinearizeThreshold)
+        : linearizationCache(relinearizeThreshold), marginalizationPool("DelayedMarginalization")
 {
     addMainGraph(std::make_shared<DelayedGraph>(mainGraphDelay, maxGroupInMainGraph));
 }
 
+DelayedMarginalizationGraphs::~DelayedMarginalizationGraphs()
+{
+    try
+    {
+        waitForPendingMarginalization();
+    }catch(const std::exception& exc)
+    {
+        std::cerr << "ERROR: Background marginalization failed: " << exc.what() << std::endl;
+    }catch(...)
+    {
+        std::cerr << "ERROR: Background marginalization failed." << std::endl;
+    }
+}
+
 std::shared_ptr<DelayedGraph> dmvio::DelayedMarginalizationGraphs::addDelayedGraph(int delayN, int maxGroupInGraph)
 {
+    waitForPendingMarginalization();
     delayedGraphs.emplace_back(new DelayedGraph(delayN, maxGroupInGraph));
     return delayedGraphs.back();
 }
 
 void DelayedMarginalizationGraphs::addDelayedGraph(std::shared_ptr<DelayedGraph> graph)
 {
+    waitForPendingMarginalization();
     delayedGraphs.emplace_back(std::move(graph));
 }
 
 void dmvio::DelayedMarginalizationGraphs::addFactor(gtsam::NonlinearFactor::shared_ptr factor, int group)
 {
-    for(auto&& graph : delayedGraphs)
+    waitForPendingMarginalization();
+    // Factors handling FEJ store the FEJValues to use, so graphs which are marginalized in the background get their
+    // own copy of them. All other factors are not modified by the linearization and can be shared.
+    bool handlesFEJ = dynamic_cast<FactorHandlingFEJ*>(factor.get()) != nullptr;
+    for(size_t i = 0; i < delayedGraphs.size(); ++i)
     {
-        graph->addFactor(factor, group);
+        if(handlesFEJ && (int) i != mainGraphInd && group <= delayedGraphs[i]->getMaxGroupInGraph())
+        {
+            delayedGraphs[i]->addFactor(factor->clone(), group);
+        }else
+        {
+            delayedGraphs[i]->addFactor(factor, group);
+        }
     }
     for(auto&& graph : disconnectedGraphs)
     {
@@ -66,12 +95,13 @@ dmvio::DelayedMarginalizationGraphs::getHAndB(const gtsam::Values& values, const
 
     // Make sure that the GTSAM factors use the FEJValues.
     getMainGraph()->setFEJValuesForFactors(true);
-    // Lienarize the graph
-    gtsam::GaussianFactorGraph::shared_ptr gfg = graph->linearize(values);
+    // Lienarize the graph. Factors whose variables did not change since the last call are not relinearized.
+    gtsam::GaussianFactorGraph::shared_ptr gfg = linearizationCache.linearize(*graph, values,
+                                                                              getMainGraph()->fejValues.get());
     getMainGraph()->setFEJValuesForFactors(false);
 
     // Compute the Hessian and gradient vector. We use the AugmentedScatter which also works for keys which don't exist in the graph.
-    AugmentedScatter scatter(*gfg, ordering, keyDimMap);
+    const AugmentedScatter& scatter = linearizationCache.getScatter(*gfg, ordering, keyDimMap);
     if(fillAdditionalKeys)
     {
         fillAdditionalKeysFromScatter(ordering, *fillAdditionalKeys, scatter);
@@ -86,27 +116,67 @@ void dmvio::DelayedMarginalizationGraphs::marginalizeFrame(const gtsam::FastVect
                                                            gtsam::Values::shared_ptr currValues)
 {
     dmvio::TimeMeasurement meas("DelayedMarginalization");
+    waitForPendingMarginalization();
 
-    // First only marginalize the main graph so that we have separate time measurements.
-    dmvio::TimeMeasurement mainMeas(
-            "MarginalizeMainGraph"); // This saves only the time necessary for marginalizing the main graph.
+    // The other graphs are marginalized in the background, so they need their own copy of the values (which the
+    // caller continues to modify). Only the readvancing is expensive, the bookkeeping is done here.
     auto* mainGraph = getMainGraph().get();
-    mainGraph->marginalize(keysToMarginalize, values, currValues);
-    mainMeas.end();
-
-    dmvio::TimeMeasurement measDelayed("DelayedMarginalizationOnly");
     for(auto&& graph : delayedGraphs)
     {
         if(graph.get() == mainGraph) continue;
-        graph->marginalize(keysToMarginalize, values, currValues);
+        graph->addMarginalization(keysToMarginalize, *values, currValues.get());
+        pendingMarginalizations.push_back(marginalizationPool.addTask([graph]()
+                                                                      {
+                                                                          dmvio::TimeMeasurement measDelayed(
+                                                                                  "DelayedMarginalizationOnly");
+                                                                          graph->readvanceUntilDelay();
+                                                                      }));
     }
     for(auto&& graph : disconnectedGraphs)
     {
         graph->marginalize(keysToMarginalize, values, currValues);
     }
+
+    // Only the marginalization of the main graph is needed for the next BA, so we only wait for it.
+    dmvio::TimeMeasurement mainMeas(
+            "MarginalizeMainGraph"); // This saves only the time necessary for marginalizing the main graph.
+    mainGraph->marginalize(keysToMarginalize, values, currValues);
+    mainMeas.end();
     meas.end();
 }
 
+void DelayedMarginalizationGraphs::waitForPendingMarginalization()
+{
+    if(pendingMarginalizations.empty()) return;
+    dmvio::TimeMeasurement meas("WaitForDelayedMarginalization");
+    // Move the futures out first, so that they are not waited for again if one of them has thrown an exception.
+    std::vector<std::future<void>> futures;
+    futures.swap(pendingMarginalizations);
+    std::exception_ptr exception;
+    for(auto&& future : futures)
+    {
+        try
+        {
+            future.get();
+        }catch(...)
+        {
+            if(!exception) exception = std::current_exception();
+        }
+    }
+
+    if(!pendingEvalValues.empty())
+    {
+        updateEvalValues(pendingEvalValues);
+        pendingEvalValues.clear();
+    }
+
+    // Rethrow the first exception thrown by the background marginalization.
+    if(exception)
+    {
+        std::rethrow_exception(exception);
+    }
+}
+
 double dmvio::DelayedMarginalizationGraphs::getError(const gtsam::Values& values)
 {
     return getMainGraph()->getGraph()->error(values);
@@ -114,6 +184,7 @@ double dmvio::DelayedMarginalizationGraphs::getError(const gtsam::Values& values
 
 void DelayedMarginalizationGraphs::addMainGraph(std::shared_ptr<DelayedGraph> delayedGraph)
 {
+    waitForPendingMarginalization();
     mainGraphInd = delayedGraphs.size();
     delayedGraphs.emplace_back(std::move(delayedGraph));
     for(auto&& callback : mainGraphCallbacks)
@@ -124,6 +195,7 @@ void DelayedMarginalizationGraphs::addMainGraph(std::shared_ptr<DelayedGraph> de
 
 void DelayedMarginalizationGraphs::replaceMainGraph(std::shared_ptr<DelayedGraph> delayedGraph)
 {
+    waitForPendingMarginalization();
     delayedGraphs[mainGraphInd] = std::move(delayedGraph);
     for(auto&& callback : mainGraphCallbacks)
     {
@@ -138,6 +210,7 @@ std::shared_ptr<DelayedGraph> DelayedMarginalizationGraphs::getMainGraph()
 
 void DelayedMarginalizationGraphs::removeDelayedGraph(const DelayedGraph* graph)
 {
+    waitForPendingMarginalization();
     auto it = std::find_if(delayedGraphs.begin(), delayedGraphs.end(),
                            [graph](const std::shared_ptr<DelayedGraph>& comp)
                            { return comp.get() == graph; });
@@ -152,9 +225,21 @@ void DelayedMarginalizationGraphs::registerMainGraphReplacementCallback(
 
 void DelayedMarginalizationGraphs::updateEvalValues(const gtsam::Values& evalValues)
 {
-    for(auto&& graph : delayedGraphs)
+    if(pendingMarginalizations.empty())
     {
-        graph->fejValues->insertConnectedKeys(gtsam::Ordering(), evalValues);
+        for(auto&& graph : delayedGraphs)
+        {
+            graph->fejValues->insertConnectedKeys(gtsam::Ordering(), evalValues);
+        }
+        return;
+    }
+
+    // Don't block the BA: Only update the main graph now and the others once their marginalization has finished.
+    // As later values overwrite earlier ones, merging them gives the same result as inserting them one by one.
+    getMainGraph()->fejValues->insertConnectedKeys(gtsam::Ordering(), evalValues);
+    for(auto&& val : evalValues)
+    {
+        eraseAndInsert(pendingEvalValues, val.key, val.value);
     }
 }
 
@@ -190,11 +275,18 @@ void dmvio::DelayedGraph::addFactor(gtsam::NonlinearFactor::shared_ptr factor, i
 void
 dmvio::DelayedGraph::marginalize(const gtsam::FastVector<gtsam::Key>& keysToMarginalize,
                                  gtsam::Values::shared_ptr values, gtsam::Values::shared_ptr currValues)
+{
+    addMarginalization(keysToMarginalize, *values, currValues.get());
+    readvanceUntilDelay();
+}
+
+void DelayedGraph::addMarginalization(const gtsam::FastVector<gtsam::Key>& keysToMarginalize,
+                                      const gtsam::Values& values, const gtsam::Values* currValues)
 {
     marginalizationOrder.push_back(keysToMarginalize);
 
     // update values
-    for(auto&& val : *values)
+    for(auto&& val : values)
     {
         eraseAndInsert(delayedValues, val.key, val.value);
     }
@@ -205,8 +297,6 @@ dmvio::DelayedGraph::marginalize(const gtsam::FastVector<gtsam::Key>& keysToMarg
             eraseAndInsert(delayedCurrValues, val.key, val.value);
         }
     }
-
-    readvanceUntilDelay();
 }
 
 void dmvio::DelayedGraph::readvanceUntilDelay()
@@ -306,7 +396,7 @@ DelayedGraph::DelayedGraph(int delayN, int maxGroupInGraph, const gtsam::Nonline
 
 DelayedGraph::DelayedGraph(const DelayedGraph& other)
         : delayN(other.delayN), maxGroupInGraph(other.maxGroupInGraph),
-          graph(boost::make_shared<gtsam::NonlinearFactorGraph>(other.graph->clone())),
+          graph(copyGraphForFEJ(*other.graph)),
           marginalizationOrder(other.marginalizationOrder), delayedValues(other.delayedValues),
           delayedCurrValues(other.delayedCurrValues), fejValues(new FEJValues(*(other.fejValues)))
 {}
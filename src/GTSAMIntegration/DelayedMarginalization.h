@@ -26,6 +26,8 @@
 #include "GTSAMIntegration/BAGTSAMIntegration.h"
 #include "GTSAMIntegration/PoseTransformation.h"
 #include "GTSAMIntegration/FEJValues.h"
+#include "GTSAMIntegration/LinearizationCache.h"
+#include "util/TaskPool.h"
 
 namespace dmvio
 {
@@ -42,7 +44,7 @@ public:
                  std::deque<gtsam::FastVector<gtsam::Key>> marginalizationOrder,
                  gtsam::Values delayedValues, gtsam::Values delayedCurrValues, std::shared_ptr<FEJValues> fejValues);
 
-    DelayedGraph(const DelayedGraph& other); // copy constructor.
+    DelayedGraph(const DelayedGraph& other); // copy constructor. Shares all factors which don't handle FEJ with other.
 
     // changes the delay, but doesn't readvance.
     void setDelayN(int delayN);
@@ -56,6 +58,13 @@ public:
     void marginalize(const gtsam::FastVector<gtsam::Key>& keysToMarginalize, gtsam::Values::shared_ptr values,
                      gtsam::Values::shared_ptr currValues);
 
+    // Like marginalize, but the (expensive) readvancing is not performed. Call readvanceUntilDelay afterwards.
+    void addMarginalization(const gtsam::FastVector<gtsam::Key>& keysToMarginalize, const gtsam::Values& values,
+                            const gtsam::Values* currValues);
+
+    // perform marginalization until we match the wanted delay.
+    void readvanceUntilDelay();
+
     void setMaxGroupInGraph(int maxGroupInGraph);
 
     void setMarginalizationPaused(bool marginalizationPausedPassed);
@@ -73,9 +82,6 @@ public:
 
     friend class PoseGraphBundleAdjustment;
 protected:
-    // perform marginalization until we match the wanted delay.
-    void readvanceUntilDelay();
-
     int delayN;
 
     // Only add factors with group <= maxGroupInGraph
@@ -116,7 +122,12 @@ class DelayedMarginalizationGraphs : public BAGraphs
 {
 public:
     // Constructor, pass arguments for the main DelayedGraph (usually has delay 0).
-    DelayedMarginalizationGraphs(int mainGraphDelay, int maxGroupInMainGraph);
+    // Factors of the main graph are only relinearized in getHAndB if their variables changed by more than
+    // relinearizeThreshold (see LinearizationCache).
+    DelayedMarginalizationGraphs(int mainGraphDelay, int maxGroupInMainGraph, double relinearizeThreshold = 0.0);
+
+    // Waits for the background marginalization. Exceptions thrown by it are only printed here.
+    ~DelayedMarginalizationGraphs() override;
 
     // Should usually be called before operation starts.
     // Returns shared_ptr to the created graph.
@@ -151,6 +162,15 @@ public:
 
     void updateEvalValues(const gtsam::Values& evalValues) override;
 
+    // marginalizeFrame only marginalizes the main graph synchronously, all other delayed graphs are marginalized
+    // in the background. This waits until they are finished. It is called by all methods of this class which modify
+    // the delayed graphs, but has to be called manually before using a graph returned by addDelayedGraph.
+    // Must be called from the thread calling marginalizeFrame.
+    // If the background marginalization of a graph threw an exception, it is rethrown here, i.e. by the first method
+    // called after marginalizeFrame which needs the delayed graphs (usually the addFactor of the next keyframe).
+    // The pending marginalizations are cleared nonetheless, so later calls don't throw again.
+    void waitForPendingMarginalization();
+
 private:
     // Delayed graphs to use. (doesn't contain main graph).
     std::vector<std::shared_ptr<DelayedGraph>> delayedGraphs;
@@ -160,6 +180,15 @@ private:
 
     std::vector<GraphReplacementCallback> mainGraphCallbacks;
 
+    // Linearization of the main graph from the last getHAndB.
+    LinearizationCache linearizationCache;
+
+    // Executes the marginalization of the delayed graphs (one task per graph).
+    TaskPool marginalizationPool;
+    std::vector<std::future<void>> pendingMarginalizations;
+    // Merged evalValues passed to updateEvalValues while the background marginalization was running. They are
+    // inserted into the FEJValues of the delayed graphs once it has finished.
+    gtsam::Values pendingEvalValues;
 };
 
 }
@@ -22,6 +22,7 @@
 
 #include <gtsam/nonlinear/NonlinearFactorGraph.h>
 #include "FEJValues.h"
+#include <boost/make_shared.hpp>
 
 void dmvio::setFEJMapForGraph(gtsam::NonlinearFactorGraph& graph, const std::shared_ptr<FEJValues>& fejValues)
 {
@@ -34,3 +35,20 @@ void dmvio::setFEJMapForGraph(gtsam::NonlinearFactorGraph& graph, const std::sha
         }
     }
 }
+
+gtsam::NonlinearFactorGraph::shared_ptr dmvio::copyGraphForFEJ(const gtsam::NonlinearFactorGraph& graph)
+{
+    auto copy = boost::make_shared<gtsam::NonlinearFactorGraph>();
+    copy->reserve(graph.size());
+    for(auto&& factor : graph)
+    {
+        if(factor && dynamic_cast<const FactorHandlingFEJ*>(factor.get()))
+        {
+            copy->push_back(factor->clone());
+        }else
+        {
+            copy->push_back(factor);
+        }
+    }
+    return copy;
+}
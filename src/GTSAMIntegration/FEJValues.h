@@ -101,6 +101,11 @@ public:
 // calls setFEJValues for all factors in graph which implement FactorHandlingFEJ.
 void setFEJMapForGraph(gtsam::NonlinearFactorGraph& graph, const std::shared_ptr<FEJValues>& fejValues);
 
+// Copies the graph for use with different FEJValues (e.g. in another thread).
+// Factors implementing FactorHandlingFEJ are cloned, as they store the FEJValues (and PoseTransformationFactor also
+// temporary state). All other factors are not modified after creation, so they are shared with the original graph.
+gtsam::NonlinearFactorGraph::shared_ptr copyGraphForFEJ(const gtsam::NonlinearFactorGraph& graph);
+
 }
 
 #endif //DMVIO_FEJVALUES_H
@@ -0,0 +1,155 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LinearizationCache.h"
+
+using namespace dmvio;
+
+LinearizationCache::LinearizationCache(double relinearizeThreshold)
+        : relinearizeThreshold(relinearizeThreshold)
+{}
+
+gtsam::GaussianFactorGraph::shared_ptr
+LinearizationCache::linearize(const gtsam::NonlinearFactorGraph& graph, const gtsam::Values& values,
+                              const FEJValues* fejValues)
+{
+    generation++;
+    numRelinearized = 0;
+    numReused = 0;
+
+    gtsam::GaussianFactorGraph::shared_ptr gfg(new gtsam::GaussianFactorGraph());
+    gfg->reserve(graph.size());
+
+    std::vector<const gtsam::NonlinearFactor*> factors;
+    factors.reserve(graph.size());
+    for(auto&& factor : graph)
+    {
+        if(!factor)
+        {
+            factors.push_back(nullptr);
+            gfg->push_back(gtsam::GaussianFactor::shared_ptr());
+            continue;
+        }
+
+        Entry& entry = entries[factor.get()];
+        if(!entry.factor || needsRelinearization(entry, *factor, values, fejValues))
+        {
+            entry.factor = factor;
+            entry.linearizationPoint.clear();
+            entry.fejPoint.clear();
+            bool handlesFEJ = fejValues && dynamic_cast<const FactorHandlingFEJ*>(factor.get());
+            for(gtsam::Key key : factor->keys())
+            {
+                entry.linearizationPoint.insert(key, values.at(key));
+                if(handlesFEJ && fejValues->fejValues.exists(key))
+                {
+                    entry.fejPoint.insert(key, fejValues->fejValues.at(key));
+                }
+            }
+            entry.linearFactor = factor->linearize(values);
+            numRelinearized++;
+        }else
+        {
+            numReused++;
+        }
+        entry.generation = generation;
+        // Inactive factors (linearized to nullptr) don't contribute to the scatter.
+        factors.push_back(entry.linearFactor ? factor.get() : nullptr);
+        gfg->push_back(entry.linearFactor);
+    }
+
+    // Remove entries of factors which are not in the graph anymore.
+    for(auto it = entries.begin(); it != entries.end();)
+    {
+        if(it->second.generation != generation)
+        {
+            it = entries.erase(it);
+        }else
+        {
+            ++it;
+        }
+    }
+
+    factorsChanged = factorsChanged || factors != lastFactors;
+    lastFactors = std::move(factors);
+    return gfg;
+}
+
+bool LinearizationCache::needsRelinearization(const Entry& entry, const gtsam::NonlinearFactor& factor,
+                                              const gtsam::Values& values, const FEJValues* fejValues) const
+{
+    // An inactive factor linearizes to nullptr, so its state has to be evaluated again.
+    if(!entry.linearFactor) return true;
+
+    bool handlesFEJ = fejValues && dynamic_cast<const FactorHandlingFEJ*>(&factor);
+    size_t numFEJ = 0;
+    for(gtsam::Key key : factor.keys())
+    {
+        if(!entry.linearizationPoint.at(key).equals_(values.at(key), relinearizeThreshold)) return true;
+        bool fejExists = handlesFEJ && fejValues->fejValues.exists(key);
+        if(fejExists != entry.fejPoint.exists(key)) return true;
+        if(fejExists)
+        {
+            if(!entry.fejPoint.at(key).equals_(fejValues->fejValues.at(key), relinearizeThreshold)) return true;
+            numFEJ++;
+        }
+    }
+    return numFEJ != entry.fejPoint.size();
+}
+
+const AugmentedScatter& LinearizationCache::getScatter(const gtsam::GaussianFactorGraph& gfg,
+                                                       const gtsam::Ordering& ordering,
+                                                       const std::map<gtsam::Key, size_t>& keyDimMap)
+{
+    if(!scatter || factorsChanged || !(ordering == scatterOrdering) || keyDimMap != scatterKeyDimMap)
+    {
+        scatter.reset(new AugmentedScatter(gfg, ordering, keyDimMap));
+        scatterOrdering = ordering;
+        scatterKeyDimMap = keyDimMap;
+        factorsChanged = false;
+    }
+    return *scatter;
+}
+
+void LinearizationCache::clear()
+{
+    entries.clear();
+    lastFactors.clear();
+    scatter.reset();
+    factorsChanged = true;
+}
+
+void LinearizationCache::setRelinearizeThreshold(double threshold)
+{
+    relinearizeThreshold = threshold;
+    clear();
+}
+
+int LinearizationCache::getNumRelinearized() const
+{
+    return numRelinearized;
+}
+
+int LinearizationCache::getNumReused() const
+{
+    return numReused;
+}
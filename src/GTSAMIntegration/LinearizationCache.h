@@ -0,0 +1,92 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DMVIO_LINEARIZATIONCACHE_H
+#define DMVIO_LINEARIZATIONCACHE_H
+
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/inference/Ordering.h>
+#include <unordered_map>
+#include <memory>
+#include "AugmentedScatter.hpp"
+#include "FEJValues.h"
+
+namespace dmvio
+{
+
+// Caches the linearization of the factors of a graph between subsequent calls (e.g. the iterations of the BA).
+// A factor is only relinearized if it is new, or if one of its variables changed by more than relinearizeThreshold
+// (compared with gtsam::Value::equals_). For factors handling FEJ also the FEJ values of its variables are compared.
+// With the default threshold of 0 the result is identical to linearizing the full graph.
+// Entries for factors which are not part of the graph anymore (e.g. after marginalization) are removed automatically.
+class LinearizationCache
+{
+public:
+    explicit LinearizationCache(double relinearizeThreshold = 0.0);
+
+    // Linearizes the graph at values. fejValues are the values used by factors handling FEJ (can be nullptr).
+    gtsam::GaussianFactorGraph::shared_ptr
+    linearize(const gtsam::NonlinearFactorGraph& graph, const gtsam::Values& values, const FEJValues* fejValues);
+
+    // Returns the scatter for the graph returned by the last call to linearize.
+    // It is only recomputed if the factors, the ordering or the dimensions have changed.
+    const AugmentedScatter& getScatter(const gtsam::GaussianFactorGraph& gfg, const gtsam::Ordering& ordering,
+                                       const std::map<gtsam::Key, size_t>& keyDimMap);
+
+    void clear();
+
+    void setRelinearizeThreshold(double threshold);
+
+    // Statistics of the last call to linearize.
+    int getNumRelinearized() const;
+    int getNumReused() const;
+
+private:
+    struct Entry
+    {
+        gtsam::NonlinearFactor::shared_ptr factor; // keeps the factor alive, so that the address is not reused.
+        gtsam::Values linearizationPoint;
+        gtsam::Values fejPoint;
+        gtsam::GaussianFactor::shared_ptr linearFactor;
+        int generation = 0;
+    };
+
+    bool needsRelinearization(const Entry& entry, const gtsam::NonlinearFactor& factor, const gtsam::Values& values,
+                              const FEJValues* fejValues) const;
+
+    double relinearizeThreshold;
+    std::unordered_map<const gtsam::NonlinearFactor*, Entry> entries;
+    int generation = 0;
+    int numRelinearized = 0, numReused = 0;
+
+    // Factors of the last linearize call (nullptr for inactive ones), used to decide if the scatter can be reused.
+    std::vector<const gtsam::NonlinearFactor*> lastFactors;
+    bool factorsChanged = true;
+    std::unique_ptr<AugmentedScatter> scatter;
+    gtsam::Ordering scatterOrdering;
+    std::map<gtsam::Key, size_t> scatterKeyDimMap;
+};
+
+}
+
+#endif //DMVIO_LINEARIZATIONCACHE_H
@@ -26,6 +26,34 @@
 #include <gtsam/linear/GaussianFactorGraph.h>
 #include "Marginalization.h"
 #include "GTSAMUtils.h"
+#include "util/TimeMeasurement.h"
+
+namespace
+{
+// Pivot ratio below which Hmm is treated as rank-deficient.
+constexpr double minLDLTConditioning = 1e-10;
+
+// Solves Hmm * result = rhs with an LDLT. Returns false if Hmm is not (numerically) positive definite.
+template<int Dim>
+bool solveWithLDLT(const gtsam::Matrix& Hmm, const gtsam::Matrix& rhs, gtsam::Matrix& result, double& conditioning)
+{
+    conditioning = 0.0;
+    if(Hmm.rows() == 0)
+    {
+        result = rhs;
+        return true;
+    }
+    Eigen::LDLT<Eigen::Matrix<double, Dim, Dim>> ldlt(Hmm);
+    if(ldlt.info() != Eigen::Success) return false;
+    auto D = ldlt.vectorD();
+    double maxPivot = D.maxCoeff();
+    if(!(maxPivot > 0)) return false;
+    conditioning = std::max(D.minCoeff(), 0.0) / maxPivot;
+    if(!(conditioning > minLDLTConditioning)) return false;
+    result = ldlt.solve(rhs);
+    return true;
+}
+}
 
 gtsam::NonlinearFactorGraph::shared_ptr
 dmvio::marginalizeOut(const gtsam::NonlinearFactorGraph& graph, const gtsam::Values& values,
@@ -137,44 +165,77 @@ void dmvio::extractKeysToMarginalize(const gtsam::NonlinearFactorGraph& graph, g
     }
 }
 
-gtsam::Matrix dmvio::computeSchurComplement(const gtsam::Matrix& augmentedHessian, int mSize, int aSize)
+gtsam::Matrix dmvio::computeSchurComplement(const gtsam::Matrix& augmentedHessian, int mSize, int aSize,
+                                            SchurComplementInfo* info, bool forcePseudoInverse)
 {
-    auto pair = dmvio::pairFromAugmentedHessian(augmentedHessian);
+    dmvio::TimeMeasurement timeMeasurement("SchurComplement");
+    int n = mSize + aSize;
+    auto H = augmentedHessian.topLeftCorner(n, n);
+    auto b = augmentedHessian.topRightCorner(n, 1);
 
     // Preconditioning like in DSO code.
-    gtsam::Vector SVec = (pair.first.diagonal().cwiseAbs() +
-                          gtsam::Vector::Constant(pair.first.cols(), 10)).cwiseSqrt();
+    gtsam::Vector SVec = (H.diagonal().cwiseAbs() + gtsam::Vector::Constant(n, 10)).cwiseSqrt();
     gtsam::Vector SVecI = SVec.cwiseInverse();
 
-    gtsam::Matrix hessianScaled = SVecI.asDiagonal() * pair.first * SVecI.asDiagonal();
-    gtsam::Vector bScaled = SVecI.asDiagonal() * pair.second;
-
-    gtsam::Matrix Hmm = hessianScaled.block(0, 0, mSize, mSize);
-    gtsam::Matrix Hma = hessianScaled.block(0, mSize, mSize, aSize);
-    gtsam::Matrix Haa = hessianScaled.block(mSize, mSize, aSize, aSize);
-
-    gtsam::Vector bm = bScaled.segment(0, mSize);
-    gtsam::Vector ba = bScaled.segment(mSize, aSize);
-
-    // Compute inverse.
-    gtsam::Matrix HmmInv = Hmm.completeOrthogonalDecomposition().pseudoInverse();
+    // Only the blocks are scaled, the full scaled Hessian is never needed.
+    auto SmI = SVecI.head(mSize).asDiagonal();
+    auto SaI = SVecI.tail(aSize).asDiagonal();
+    gtsam::Matrix Hmm = SmI * H.topLeftCorner(mSize, mSize) * SmI;
+    gtsam::Matrix Hma = SmI * H.topRightCorner(mSize, aSize) * SaI;
+    gtsam::Matrix Haa = SaI * H.bottomRightCorner(aSize, aSize) * SaI;
+
+    gtsam::Vector bm = SmI * b.topRows(mSize);
+    gtsam::Vector ba = SaI * b.bottomRows(aSize);
+
+    // Compute HmmInv * [Hma, bm].
+    gtsam::Matrix rhs(mSize, aSize + 1);
+    rhs.leftCols(aSize) = Hma;
+    rhs.rightCols(1) = bm;
+    gtsam::Matrix HmmInvRhs;
+    double conditioning = 0.0;
+    bool solved = false;
+    if(!forcePseudoInverse)
+    {
+        if(mSize == 15)
+        {
+            solved = solveWithLDLT<15>(Hmm, rhs, HmmInvRhs, conditioning);
+        }else
+        {
+            solved = solveWithLDLT<Eigen::Dynamic>(Hmm, rhs, HmmInvRhs, conditioning);
+        }
+    }
+    if(!solved)
+    {
+        HmmInvRhs = Hmm.completeOrthogonalDecomposition().pseudoInverse() * rhs;
+    }
+    if(info)
+    {
+        info->conditioning = conditioning;
+        info->usedPseudoInverse = !solved;
+    }
+    dmvio::TimeMeasurement::recordCounter("schurConditioning", conditioning);
 
-    gtsam::Matrix HaaNew = Haa - Hma.transpose() * HmmInv * Hma;
-    gtsam::Vector baNew = ba - Hma.transpose() * HmmInv * bm;
+    Haa.noalias() -= Hma.transpose() * HmmInvRhs.leftCols(aSize);
+    ba.noalias() -= Hma.transpose() * HmmInvRhs.rightCols(1);
 
     // Unscale
-    gtsam::Vector SVecUpdated = SVec.segment(mSize, aSize);
-    gtsam::Matrix HNewUnscaled = SVecUpdated.asDiagonal() * HaaNew * SVecUpdated.asDiagonal();
-    gtsam::Matrix bNewUnscaled = SVecUpdated.asDiagonal() * baNew;
+    auto Sa = SVec.tail(aSize).asDiagonal();
+    gtsam::Matrix augmentedHRes(aSize + 1, aSize + 1);
+    augmentedHRes.topLeftCorner(aSize, aSize) = Sa * Haa * Sa;
+    augmentedHRes.topRightCorner(aSize, 1) = Sa * ba;
+    augmentedHRes.bottomLeftCorner(1, aSize) = augmentedHRes.topRightCorner(aSize, 1).transpose();
+    augmentedHRes(aSize, aSize) = 0;
 
     // Make Hessian symmetric for numeric reasons.
-    HNewUnscaled = 0.5 * (HNewUnscaled.transpose() + HNewUnscaled).eval();
-
-    gtsam::Matrix augmentedHRes(aSize + 1, aSize + 1);
-    augmentedHRes.setZero();
-    augmentedHRes.topLeftCorner(aSize, aSize) = HNewUnscaled;
-    augmentedHRes.topRightCorner(aSize, 1) = bNewUnscaled;
-    augmentedHRes.bottomLeftCorner(1, aSize) = bNewUnscaled.transpose();
+    for(int i = 0; i < aSize; i++)
+    {
+        for(int j = 0; j < i; j++)
+        {
+            double mean = 0.5 * (augmentedHRes(i, j) + augmentedHRes(j, i));
+            augmentedHRes(i, j) = mean;
+            augmentedHRes(j, i) = mean;
+        }
+    }
 
     return augmentedHRes;
 }
@@ -50,8 +50,20 @@ void extractKeysToMarginalize(const gtsam::NonlinearFactorGraph& graph, gtsam::N
                               gtsam::FastSet<gtsam::Key>& setOfKeysToMarginalize,
                               gtsam::FastSet<gtsam::Key>& connectedKeys);
 
+// Information about how a Schur complement was computed.
+struct SchurComplementInfo
+{
+    // Ratio between the smallest and largest pivot of the LDLT of the (preconditioned) Hmm. 0 if it is not positive definite.
+    double conditioning = 0.0;
+    // True if Hmm was (numerically) rank-deficient, so that the pseudo-inverse was used instead of the LDLT.
+    bool usedPseudoInverse = false;
+};
+
 // Compute the Schur complement with the given dimension of marginalized factors and other factors.
-gtsam::Matrix computeSchurComplement(const gtsam::Matrix& augmentedHessian, int mSize, int aSize);
+// Hmm is inverted with an LDLT (fixed-size for the 15-dimensional pose, velocity and bias block of a keyframe).
+// Only if it is rank-deficient (or forcePseudoInverse is set) the slower pseudo-inverse is used.
+gtsam::Matrix computeSchurComplement(const gtsam::Matrix& augmentedHessian, int mSize, int aSize,
+                                     SchurComplementInfo* info = nullptr, bool forcePseudoInverse = false);
 
 }
 
@@ -263,7 +263,7 @@ dmvio::buildRelativeJacobian(int n, const gtsam::FastVector<gtsam::Key>& orderin
     return bigJ;
 }
 
-std::pair<gtsam::Matrix, gtsam::Vector>
+std::pair<dso::Mat1414, dso::Vec14>
 dmvio::convertCoarseHToGTSAM(PoseTransformation& transform, const dso::Mat88& HInput, const dso::Vec8& bInput,
                              const gtsam::Pose3& currentPose)
 {
@@ -292,20 +292,16 @@ dmvio::convertCoarseHToGTSAM(PoseTransformation& transform, const dso::Mat88& HI
     b.segment(0, 2) = bInput.segment(6, 2);
 
     // Compute Jacobian of frame and reference pose with respect to T_f_r
-    gtsam::Matrix J(6, 12);
+    // This is called in every coarse tracking iteration, so all matrices are fixed-size.
     std::vector<gtsam::Matrix> derivatives = transform.getAllDerivatives(currentPose.matrix(),
                                                                          DerivativeDirection::RIGHT_TO_LEFT);
 
-    J.block(0, 6, 6, 6) = derivatives[0]; // J with respect to T_w_f
-    J.block(0, 0, 6, 6) = derivatives[1]; // J with respect to T_w_r
-
-    gtsam::Matrix JReal(8, 14);
-    JReal.block(2, 2, 6, 12) = J;
-    JReal.block(0, 2, 2, 12) = gtsam::Matrix::Zero(2, 12);
-    JReal.block(0, 0, 2, 2) = gtsam::Matrix::Identity(2, 2);
-    JReal.block(2, 0, 6, 2) = gtsam::Matrix::Zero(6, 2);
+    Eigen::Matrix<double, 8, 14> JReal = Eigen::Matrix<double, 8, 14>::Zero();
+    JReal.block<2, 2>(0, 0).setIdentity();
+    JReal.block<6, 6>(2, 8) = derivatives[0]; // J with respect to T_w_f
+    JReal.block<6, 6>(2, 2) = derivatives[1]; // J with respect to T_w_r
 
-    gtsam::Matrix H_full = JReal.transpose() * H * JReal;
-    gtsam::Vector b_full = JReal.transpose() * b;
+    dso::Mat1414 H_full = JReal.transpose() * H * JReal;
+    dso::Vec14 b_full = JReal.transpose() * b;
     return std::make_pair(H_full, b_full);
 }
\ No newline at end of file
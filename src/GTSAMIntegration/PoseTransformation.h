@@ -189,7 +189,8 @@ buildRelativeJacobian(int n, const gtsam::FastVector<gtsam::Key>& ordering, cons
 
 // Converts the DSO coarse tracking Hessian to GTSAM, transforming it with the PoseTransformation.
 // The passed transformIMUToCoarse needs to provide derivatives for frameToWorld and for referenceToWorld (see TransformIMUToDSOForCoarse as an example).
-std::pair<gtsam::Matrix, gtsam::Vector>
+// The result is ordered as: affine parameters, reference pose, current pose.
+std::pair<dso::Mat1414, dso::Vec14>
 convertCoarseHToGTSAM(PoseTransformation& transformIMUToCoarse, const dso::Mat88& HInput, const dso::Vec8& bInput,
                       const gtsam::Pose3& currentPose);
 
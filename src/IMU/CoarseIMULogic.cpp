@@ -204,6 +204,13 @@ Sophus::SE3d dmvio::CoarseIMULogic::addIMUData(const dmvio::IMUData& imuData, in
         }
     }
 
+    coarseKeyDimMap.clear();
+    for(const gtsam::Key& k : coarseOrdering)
+    {
+        coarseKeyDimMap[k] = coarseValues->at(k).dim();
+    }
+    coarseHessianValid = false;
+
     // The returned prediction will be used as an initialization for the coarse direct image alignment.
     return referenceToFrame;
 }
@@ -227,6 +234,8 @@ dmvio::CoarseIMULogic::initCoarseGraph(int keyframeId, std::unique_ptr<Informati
 
     coarseGraph.reset(new gtsam::NonlinearFactorGraph());
     coarseValues.reset(new gtsam::Values);
+    coarseLinearizationCache.clear();
+    coarseHessianValid = false;
 
     currentKeyframeId = keyframeId;
 
@@ -304,42 +313,50 @@ dmvio::CoarseIMULogic::computeCoarseUpdate(const dso::Mat88& H_in, const dso::Ve
                                           b_in * imuSettings.setting_weightDSOCoarse,
                                           coarseValues->at<gtsam::Pose3>(currentPoseKey));
 
-    // Linearize factor graph.
-    gtsam::GaussianFactorGraph::shared_ptr gfg = coarseGraph->linearize(*coarseValues);
-    std::map<gtsam::Key, size_t> keyDimMap = gfg->getKeyDimMap();
-    // actually we only use gtsam to get jacobian and hessian
-    std::pair<gtsam::Matrix, gtsam::Vector> gtsamHAndB = gfg->hessian(coarseOrdering);
+    // Linearize factor graph (only factors whose variables changed since the last call).
+    gtsam::GaussianFactorGraph::shared_ptr gfg = coarseLinearizationCache.linearize(*coarseGraph, *coarseValues,
+                                                                                    nullptr);
+    if(!coarseHessianValid || coarseLinearizationCache.getNumRelinearized() > 0)
+    {
+        // actually we only use gtsam to get jacobian and hessian
+        std::pair<gtsam::Matrix, gtsam::Vector> gtsamHAndB = coarseLinearizationCache.getScatter(
+                *gfg, coarseOrdering, coarseKeyDimMap).computeHessian(*gfg);
+        coarseGraphH = std::move(gtsamHAndB.first);
+        coarseGraphB = std::move(gtsamHAndB.second);
+        coarseHessianValid = true;
+    }
 
-    int nrowsGT = gtsamHAndB.first.rows();
-    gtsam::Matrix HComplete(nrowsGT + 2, nrowsGT + 2); //add 2 photometric params
-    gtsam::Vector bComplete(nrowsGT + 2);
+    int nrowsGT = coarseGraphH.rows();
+    HComplete.resize(nrowsGT + 2, nrowsGT + 2); //add 2 photometric params (no reallocation if the size is unchanged).
+    bComplete.resize(nrowsGT + 2);
 
-    HComplete.block(2, 2, nrowsGT, nrowsGT) = gtsamHAndB.first; // Fill correct part with the matrix from GTSAM
-    HComplete.block(0, 0, nrowsGT + 2, 2) = gtsam::Matrix::Zero(nrowsGT + 2, 2); // Fill the rest with
-    // zeros.
-    HComplete.block(0, 2, 2, nrowsGT) = gtsam::Matrix::Zero(2, nrowsGT);
+    HComplete.bottomRightCorner(nrowsGT, nrowsGT) = coarseGraphH; // Fill correct part with the matrix from GTSAM
+    HComplete.leftCols<2>().setZero(); // Fill the rest with zeros.
+    HComplete.topRows<2>().setZero();
 
     // Add DSO part of the Hessian.
-    HComplete.block(0, 0, 14, 14) += dsoHAndB.first;
+    HComplete.topLeftCorner<14, 14>() += dsoHAndB.first;
 
-    bComplete.segment(0, 2) = gtsam::Matrix::Zero(2, 1);
-    bComplete.segment(2, nrowsGT) = -gtsamHAndB.second; // The b in GTSAM resembles -b in DSO!
-    bComplete.segment(0, 14) += dsoHAndB.second;
+    bComplete.head<2>().setZero();
+    bComplete.tail(nrowsGT) = -coarseGraphB; // The b in GTSAM resembles -b in DSO!
+    bComplete.head<14>() += dsoHAndB.second;
 
     // Use lambda multiplication...
-    for(int i = 0; i < nrowsGT + 2; i++) HComplete(i, i) *= (1 + lambda); // add damping in optimization
+    HComplete.diagonal() *= (1 + lambda); // add damping in optimization
 
     // --------------------------------------------------
     // Compute update step
     // --------------------------------------------------
-    gtsam::Vector inc = HComplete.ldlt().solve(-bComplete); // simply eigen cholesky decomposation to do coarse frame tracking
+    coarseLDLT.compute(HComplete); // simply eigen cholesky decomposation to do coarse frame tracking
+    gtsam::Vector& inc = coarseInc;
+    inc = coarseLDLT.solve(-bComplete);
 
     inc *= extrapFac;
 
     if(imuSettings.fixKeyframeDuringCoarseTracking)
     {
         // GTSAM Pose contains first rotation, then translation -> only remove the translational part.
-        inc.segment(5, 3) = gtsam::Matrix::Zero(3, 1);
+        inc.segment<3>(5).setZero();
     }
 
     // Apply update.
@@ -348,7 +365,7 @@ dmvio::CoarseIMULogic::computeCoarseUpdate(const dso::Mat88& H_in, const dso::Ve
     for(size_t i = 0; i < coarseOrdering.size(); i++)
     {
         gtsam::Key k = coarseOrdering[i];
-        size_t s = keyDimMap[k];
+        size_t s = coarseKeyDimMap.at(k);
         newCoarseValues->insert(k, *(coarseValues->at(k).retract_(inc.segment(current_pos, s))));
         current_pos += s;
     }
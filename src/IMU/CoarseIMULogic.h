@@ -27,6 +27,7 @@
 #include "IMUTypes.h"
 #include "IMUSettings.h"
 #include "BAIMULogic.h"
+#include "GTSAMIntegration/LinearizationCache.h"
 
 #include <sophus/sophus.hpp>
 #include <sophus/se3.hpp>
@@ -106,8 +107,18 @@ private:
     gtsam::Key currentPoseKey, refPoseKey;
 
     gtsam::Ordering coarseOrdering;
+    std::map<gtsam::Key, size_t> coarseKeyDimMap; // dimensions of the variables in coarseOrdering.
     gtsam::Values::shared_ptr newCoarseValues;
 
+    // computeCoarseUpdate is called in every coarse tracking iteration. Factors are only relinearized if their
+    // variables changed, and the Hessian of the graph is only recomputed if any factor was relinearized (e.g. it is
+    // reused after an iteration was rejected). The matrices for the system are reused to avoid reallocations.
+    LinearizationCache coarseLinearizationCache;
+    bool coarseHessianValid = false;
+    gtsam::Matrix coarseGraphH, HComplete;
+    gtsam::Vector coarseGraphB, bComplete, coarseInc;
+    Eigen::LDLT<gtsam::Matrix> coarseLDLT;
+
     int currentKeyframeId = -1;
     double currCoarseTimestamp;
     bool firstCoarseInit = true;
@@ -57,7 +57,8 @@ IMUIntegration::IMUIntegration(dso::CalibHessian* HCalib, const IMUCalibration&
 
     // Create Delayed Marginalization Graphs.
     std::unique_ptr<BAGraphs> baGraphs;
-    DelayedMarginalizationGraphs* delayedGraphs = new DelayedMarginalizationGraphs(0, BAIMULogic::METRIC_GROUP);
+    DelayedMarginalizationGraphs* delayedGraphs = new DelayedMarginalizationGraphs(0, BAIMULogic::METRIC_GROUP,
+                                                                                   imuSettings.baRelinearizeThreshold);
     baGraphs.reset(delayedGraphs);
 
     // Create BAGTSAMIntegration.
@@ -223,6 +224,11 @@ void IMUIntegration::setGTData(dmvio::GTData* gtData, int frameId)
 
 IMUIntegration::~IMUIntegration() = default;
 
+void IMUIntegration::releaseInitializer()
+{
+    imuInitializer.reset();
+}
+
 // Called in the coarse tracking thread.
 // This contains code relevant for both, CoarseTracking and BA. Mainly to make it work in realtime mode.
 void IMUIntegration::prepareKeyframe(int frameId)
@@ -73,6 +73,10 @@ public:
 
     ~IMUIntegration();
 
+    // Destroys the IMU initializer, which releases the frame shells referenced by it. Must be called before the
+    // frame shells are deleted.
+    void releaseInitializer();
+
     // Return true if the CoarseTracking logic is initialized.
     bool isCoarseInitialized();
 
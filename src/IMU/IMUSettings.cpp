@@ -153,6 +153,7 @@ void IMUSettings::registerArgs(dmvio::SettingsUtil& set)
     set.registerArg("alwaysCanBreakIMU", alwaysCanBreakIMU);
 
     set.registerArg("useScaleDiagonalHack", useScaleDiagonalHack);
+    set.registerArg("baRelinearizeThreshold", baRelinearizeThreshold);
 
     set.registerArg("fixKeyframeDuringCoarseTracking", fixKeyframeDuringCoarseTracking);
     set.registerArg("addVisualToCoarseGraphIfTrackingBad", addVisualToCoarseGraphIfTrackingBad);
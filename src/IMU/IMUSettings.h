@@ -87,6 +87,10 @@ public:
 
     bool useScaleDiagonalHack = false; // This can be used to improve performance when the initial scale is very far from optimum.
 
+    // GTSAM factors are only relinearized between BA iterations if one of their variables changed by more than this.
+    // 0 means that factors are only reused if their variables did not change at all (which gives identical results).
+    double baRelinearizeThreshold = 0.0;
+
     // ----------- Settings for Coarse Tracking -----------
     bool fixKeyframeDuringCoarseTracking = true;
     bool addVisualToCoarseGraphIfTrackingBad = false; // Add visual factor even if tracking is bad.
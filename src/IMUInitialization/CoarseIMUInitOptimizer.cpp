@@ -50,6 +50,11 @@ dmvio::CoarseIMUInitOptimizer::CoarseIMUInitOptimizer(std::shared_ptr<PoseTransf
     params.lambdaLowerBound = settings.lambdaLowerBound;
 }
 
+dmvio::CoarseIMUInitOptimizer::~CoarseIMUInitOptimizer()
+{
+    releaseShells();
+}
+
 void CoarseIMUInitOptimizer::handleFirstFrame(int frameId)
 {
     // Note: the owner of this class is responsible for adding initial values and priors for the variables optimized
@@ -243,8 +248,26 @@ void CoarseIMUInitOptimizer::addPose(const dso::FrameShell& shell, const gtsam::
     if(settings.updatePoses)
     {
         activeShells[shell.id] = &shell;
+        shell.numExternalRefs++;
     }
     addPose(shell.id, shell.camToWorld, imuData);
+
+    // Release shells whose pose has been removed from the graph, so that DSO can free them.
+    while(!activeShells.empty() && !poseIds.empty() && activeShells.begin()->first < poseIds.front())
+    {
+        activeShells.begin()->second->numExternalRefs--;
+        activeShells.erase(activeShells.begin());
+    }
+}
+
+void CoarseIMUInitOptimizer::releaseShells()
+{
+    boost::unique_lock<boost::mutex> lock(dso::FrameShell::shellPoseMutex);
+    for(auto&& pair : activeShells)
+    {
+        pair.second->numExternalRefs--;
+    }
+    activeShells.clear();
 }
 
 
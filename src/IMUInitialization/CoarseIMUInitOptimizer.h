@@ -56,10 +56,17 @@ public:
                                     const IMUCalibration& imuCalibration,
                                     const CoarseIMUInitOptimizerSettings& settingsPassed);
 
+    // Releases the remaining shells, so they need to outlive the optimizer.
+    ~CoarseIMUInitOptimizer();
+
     // Add frame to the optimizer.
     void addPose(int frameId, const Sophus::SE3d& camToWorld, const gtsam::PreintegratedImuMeasurements* imuData);
     void addPose(const dso::FrameShell& shell, const gtsam::PreintegratedImuMeasurements* imuData);
 
+    // Release all shells passed to addPose so that DSO can free them. Called once the optimizer is not used anymore
+    // (afterwards optimize must not be called until new poses are added).
+    void releaseShells();
+
     struct OptimizationResult
     {
         OptimizationResult(int numIterations, double error, double normalizedError, bool good);
@@ -102,7 +109,8 @@ private:
     // For implementing maxNumPoses:
     std::deque<int> poseIds; // pose ids currently in the graph.
 
-    // used to get updated poses from DSO before optimizing.
+    // used to get updated poses from DSO before optimizing. Shells in here are kept alive by DSO (see
+    // FrameShell::numExternalRefs) until their pose is removed from the graph or releaseShells is called.
     std::map<int, const dso::FrameShell*> activeShells;
 
 };
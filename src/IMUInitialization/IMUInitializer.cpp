@@ -102,6 +102,11 @@ void dmvio::IMUInitializer::setState(std::unique_ptr<IMUInitializerState>&& newS
         // Change state, the caller is responsible for making sure we have a lock.
         currentState = std::move(newState);
         std::cout << "Switching to initializer state: " << *currentState << std::endl;
+        if(!currentState->isActive())
+        {
+            // Let DSO free the frame shells still referenced by the coarse IMU initializer.
+            logic->coarseIMUOptimizer->releaseShells();
+        }
     }
 }
 
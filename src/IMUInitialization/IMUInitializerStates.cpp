@@ -121,7 +121,11 @@ dmvio::RealtimeCoarseIMUInitState::addPose(const dso::FrameShell& shell, bool wi
             }
             break;
         case RUNNING:
-            // Save data coming in while the thread is running.
+            // Save data coming in while the thread is running. The shell is kept alive until it has been added.
+            {
+                boost::unique_lock<boost::mutex> lock(dso::FrameShell::shellPoseMutex);
+                shell.numExternalRefs++;
+            }
             cachedData.emplace_back(&shell, willBecomeKeyframe, *imuData);
             break;
     }
@@ -130,6 +134,7 @@ dmvio::RealtimeCoarseIMUInitState::addPose(const dso::FrameShell& shell, bool wi
 
 void dmvio::RealtimeCoarseIMUInitState::threadRun()
 {
+    dmvio::TimeMeasurement::setThreadName("RealtimeCoarseIMUInit");
     dmvio::TimeMeasurement timeMeasurement("RealtimeCoarseIMUInitState::threadRun");
     IMUInitVariances variances = logic.performCoarseIMUInit(optimizingTimestamp);
 
@@ -156,6 +161,13 @@ void dmvio::RealtimeCoarseIMUInitState::threadRun()
     {
         DefaultActiveIMUInitializerState::addPose(*std::get<0>(data), std::get<1>(data), &std::get<2>(data));
     }
+    {
+        boost::unique_lock<boost::mutex> shellLock(dso::FrameShell::shellPoseMutex);
+        for(auto&& data : cachedData)
+        {
+            std::get<0>(data)->numExternalRefs--;
+        }
+    }
     cachedData.clear();
     if(!newState) status = NOT_RUNNING;
     logic.stateChanger.setState(std::move(newState));
@@ -339,6 +351,7 @@ dmvio::RealtimePGBAState::postBAInit(int keyframeId, gtsam::NonlinearFactor::sha
 
 void RealtimePGBAState::threadRun()
 {
+    dmvio::TimeMeasurement::setThreadName("RealtimePGBA");
     dmvio::TimeMeasurement meas("RealtimePGBAState::threadRun");
     std::pair<bool, IMUInitializerState::unique_ptr> newStatePair;
     std::unique_ptr<gtsam::Values> optimizedValues;
@@ -61,6 +61,10 @@ public:
     // initialized (if the initialized values are ready). Returns true if an initialization is performed.
     virtual std::pair<std::unique_ptr<IMUInitializerState>, bool> initializeIfReady() = 0;
 
+    // Returns false if the initializer is finished and will not use any poses anymore.
+    virtual bool isActive() const
+    { return true; }
+
     friend std::ostream& operator<<(std::ostream& str, IMUInitializerState const& data)
     {
         data.print(str);
@@ -92,6 +96,9 @@ public:
         return std::make_pair(nullptr, false);
     }
 
+    bool isActive() const override
+    { return false; }
+
     void print(std::ostream& str) const override
     {
         str << "InactiveIMUInitializerState";
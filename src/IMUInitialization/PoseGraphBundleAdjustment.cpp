@@ -55,7 +55,8 @@ PoseGraphBundleAdjustment::PoseGraphBundleAdjustment(DelayedMarginalizationGraph
 
 void PoseGraphBundleAdjustment::prepareOptimization()
 {
-    // clone DelayedGraph
+    // clone DelayedGraph (after its marginalization running in the background has finished).
+    delayedMarginalization->waitForPendingMarginalization();
     delayedGraph = std::make_unique<DelayedGraph>(*inputDelayedGraph);
     disconnectedGraph = delayedMarginalization->addDisconnectedGraph(delayedGraph->getMaxGroupInGraph());
 }
@@ -578,6 +579,7 @@ int PoseGraphBundleAdjustment::getLatestInd() const
 
 std::shared_ptr<DelayedGraph> PoseGraphBundleAdjustment::getInputDelayedGraph() const
 {
+    delayedMarginalization->waitForPendingMarginalization();
     return inputDelayedGraph;
 }
 
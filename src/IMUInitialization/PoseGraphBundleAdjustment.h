@@ -97,6 +97,7 @@ public:
 
     int getFirstIdWithIMUData() const;
 
+    // Waits for the background marginalization of the graph, so it can be accessed afterwards.
     std::shared_ptr<DelayedGraph> getInputDelayedGraph() const;
 
     bool isAllPosesUsed() const;
@@ -0,0 +1,183 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "FullSystem/CoarseDistanceTransform.h"
+#include <algorithm>
+#include <assert.h>
+
+namespace dso
+{
+
+constexpr int CoarseDistanceTransform::MaxDistance;
+constexpr float CoarseDistanceTransform::NotReached;
+
+namespace
+{
+constexpr int Far = CoarseDistanceTransform::MaxDistance + 1;
+}
+
+CoarseDistanceTransform::CoarseDistanceTransform(int w, int h)
+        : w(w), h(h), isSeed(w * h, 0), rowDistances(w * h, Far)
+{
+    assert(w >= 3 && h >= 3);
+}
+
+void CoarseDistanceTransform::clearSeeds()
+{
+    for(int idx : seeds)
+    {
+        isSeed[idx] = 0;
+    }
+    seeds.clear();
+}
+
+void CoarseDistanceTransform::addSeed(int u, int v)
+{
+    assert(u > 0 && v > 0 && u < w && v < h);
+    int idx = u + v * w;
+    if(!isSeed[idx])
+    {
+        isSeed[idx] = 1;
+        seeds.push_back(idx);
+    }
+}
+
+void CoarseDistanceTransform::computeRowDistances(int yMin, int yMax)
+{
+    // Border rows and columns are never a source of the BFS, so they stay at Far.
+    for(int y = std::max(yMin, 1); y < std::min(yMax, h - 1); y++)
+    {
+        const uint8_t* seedRow = isSeed.data() + y * w;
+        uint8_t* row = rowDistances.data() + y * w;
+
+        int dist = Far;
+        for(int x = 1; x < w - 1; x++)
+        {
+            dist = seedRow[x] ? 0 : std::min(dist + 1, Far);
+            row[x] = dist;
+        }
+        dist = Far;
+        for(int x = w - 2; x > 0; x--)
+        {
+            dist = seedRow[x] ? 0 : std::min(dist + 1, Far);
+            row[x] = std::min<int>(row[x], dist);
+        }
+    }
+}
+
+void CoarseDistanceTransform::computeDistances(float* out, int yMin, int yMax) const
+{
+    // The rows are processed in blocks of columns, so that a single far away pixel does not require checking all
+    // rows up to MaxDistance for the whole row.
+    const int blockSize = 32;
+    int16_t best[blockSize];
+    for(int y = std::max(yMin, 1); y < std::min(yMax, h - 1); y++)
+    {
+        // interior columns only, the border columns are no source and are filled in computeBorder.
+        for(int x0 = 1; x0 < w - 1; x0 += blockSize)
+        {
+            const int n = std::min(blockSize, w - 1 - x0);
+            const uint8_t* row = rowDistances.data() + y * w + x0;
+            int maxBest = 0;
+            for(int x = 0; x < n; x++)
+            {
+                best[x] = row[x];
+                maxBest = std::max<int>(maxBest, best[x]);
+            }
+
+            // rows which are dy away can only improve pixels where the distance is still larger than dy.
+            for(int dy = 1; dy < maxBest; dy++)
+            {
+                bool anyRow = false;
+                for(int otherY : {y - dy, y + dy})
+                {
+                    if(otherY < 1 || otherY >= h - 1) continue;
+                    anyRow = true;
+                    const uint8_t* other = rowDistances.data() + otherY * w + x0;
+                    for(int x = 0; x < n; x++)
+                    {
+                        int16_t dx = other[x];
+                        int16_t dist = std::max<int16_t>(std::max<int16_t>(dx, dy), (2 * (dx + dy) + 1) / 3);
+                        best[x] = std::min(best[x], dist);
+                    }
+                }
+                if(!anyRow) break;
+
+                maxBest = 0;
+                for(int x = 0; x < n; x++)
+                {
+                    maxBest = std::max<int>(maxBest, best[x]);
+                }
+            }
+
+            float* outRow = out + y * w + x0;
+            for(int x = 0; x < n; x++)
+            {
+                outRow[x] = best[x] <= MaxDistance ? (float) best[x] : NotReached;
+            }
+        }
+    }
+}
+
+void CoarseDistanceTransform::computeBorder(float* out) const
+{
+    auto borderValue = [&](int x, int y)
+    {
+        if(isSeed[x + y * w]) return 0.0f;
+        // reached in the step after an interior neighbour, diagonally only in odd steps.
+        float value = NotReached;
+        for(int ny = std::max(y - 1, 1); ny <= std::min(y + 1, h - 2); ny++)
+        {
+            for(int nx = std::max(x - 1, 1); nx <= std::min(x + 1, w - 2); nx++)
+            {
+                float dist = out[nx + ny * w];
+                if(dist >= MaxDistance) continue;
+                bool diagonal = nx != x && ny != y;
+                if(diagonal && ((int) dist) % 2 != 0) continue;
+                value = std::min(value, dist + 1);
+            }
+        }
+        return value;
+    };
+
+    // only interior neighbours are read, so the border can be written in place.
+    for(int x = 0; x < w; x++)
+    {
+        out[x] = borderValue(x, 0);
+        out[x + (h - 1) * w] = borderValue(x, h - 1);
+    }
+    for(int y = 1; y < h - 1; y++)
+    {
+        out[y * w] = borderValue(0, y);
+        out[w - 1 + y * w] = borderValue(w - 1, y);
+    }
+}
+
+void CoarseDistanceTransform::compute(float* out)
+{
+    computeRowDistances(0, h);
+    computeDistances(out, 0, h);
+    computeBorder(out);
+}
+
+}
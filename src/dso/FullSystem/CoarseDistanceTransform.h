@@ -0,0 +1,71 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef DMVIO_COARSEDISTANCETRANSFORM_H
+#define DMVIO_COARSEDISTANCETRANSFORM_H
+
+#include <cstdint>
+#include <vector>
+
+namespace dso
+{
+
+// Distance transform of CoarseDistanceMap. Computes the same distances as a BFS from the seeds which alternates
+// between the 8-neighbourhood (odd steps) and the 4-neighbourhood (even steps) and stops after MaxDistance steps,
+// where border pixels can be reached but do not propagate further.
+// This is the octagonal distance max(max(|dx|,|dy|), (2*(|dx|+|dy|)+1)/3), which for a fixed |dy| only grows with |dx|.
+// Therefore it is computed in two passes, both independent per row: first the horizontal distance to the nearest
+// seed within each row, then for every pixel the minimum over the rows at most MaxDistance away.
+class CoarseDistanceTransform
+{
+public:
+    static constexpr int MaxDistance = 39;
+    static constexpr float NotReached = 1000;
+
+    CoarseDistanceTransform(int w, int h);
+
+    void clearSeeds();
+    // seeds must satisfy u > 0 && v > 0 && u < w && v < h.
+    void addSeed(int u, int v);
+
+    // Horizontal pass for rows [yMin, yMax).
+    void computeRowDistances(int yMin, int yMax);
+    // Vertical pass for rows [yMin, yMax), needs the horizontal pass of all rows.
+    void computeDistances(float* out, int yMin, int yMax) const;
+    // Border pixels, needs the vertical pass of all rows.
+    void computeBorder(float* out) const;
+
+    // All passes single-threaded.
+    void compute(float* out);
+
+    const int w, h;
+
+private:
+    std::vector<uint8_t> isSeed;
+    std::vector<int> seeds;
+    std::vector<uint8_t> rowDistances; // horizontal distance to the nearest interior seed, capped at MaxDistance + 1.
+};
+
+}
+
+#endif //DMVIO_COARSEDISTANCETRANSFORM_H
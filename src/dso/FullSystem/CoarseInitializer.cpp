@@ -60,6 +60,9 @@ CoarseInitializer::CoarseInitializer(int ww, int hh)
 	JbBuffer = new Vec10f[ww*hh];
 	JbBuffer_new = new Vec10f[ww*hh];
 
+	accE.resize(reduce.getNumThreads());
+	acc9s.resize(reduce.getNumThreads());
+
 
 	frameID=-1;
 	fixAffine=true;
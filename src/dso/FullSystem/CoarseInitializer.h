@@ -128,8 +128,8 @@ private:
 	Vec10f* JbBuffer;			// 0-7: sum(dd * dp). 8: sum(res*dd). 9: 1/(1+sum(dd*dd))=inverse hessian entry.
 	Vec10f* JbBuffer_new;
 
-    std::array<Accumulator11, NUM_THREADS> accE;
-	std::array<Accumulator9, NUM_THREADS> acc9s; // one acc for each worker thread.
+    std::vector<Accumulator11, Eigen::aligned_allocator<Accumulator11>> accE;
+	std::vector<Accumulator9, Eigen::aligned_allocator<Accumulator9>> acc9s; // one acc for each worker thread.
 	Accumulator9 acc9SC;
 
     IndexThreadReduce<double> reduce;
@@ -39,6 +39,7 @@
 #include "IOWrapper/ImageRW.h"
 #include <algorithm>
 #include "util/TimeMeasurement.h"
+#include "FullSystem/CoarseTrackerKernels.h"
 
 #if !defined(__SSE3__) && !defined(__SSE2__) && !defined(__SSE1__)
 #include "SSE2NEON.h"
@@ -78,15 +79,7 @@ CoarseTracker::CoarseTracker(int ww, int hh, dmvio::IMUIntegration &imuIntegrati
 
 	}
 
-	// warped buffers
-    buf_warped_idepth = allocAligned<4,float>(ww*hh, ptrToDelete);
-    buf_warped_u = allocAligned<4,float>(ww*hh, ptrToDelete);
-    buf_warped_v = allocAligned<4,float>(ww*hh, ptrToDelete);
-    buf_warped_dx = allocAligned<4,float>(ww*hh, ptrToDelete);
-    buf_warped_dy = allocAligned<4,float>(ww*hh, ptrToDelete);
-    buf_warped_residual = allocAligned<4,float>(ww*hh, ptrToDelete);
-    buf_warped_weight = allocAligned<4,float>(ww*hh, ptrToDelete);
-    buf_warped_refColor = allocAligned<4,float>(ww*hh, ptrToDelete);
+	mainWorkspace.reset(new CoarseTrackingWorkspace(ww, hh));
 
 
 	newFrame = 0;
@@ -94,6 +87,7 @@ CoarseTracker::CoarseTracker(int ww, int hh, dmvio::IMUIntegration &imuIntegrati
 	debugPlot = debugPrint = true;
 	w[0]=h[0]=0;
 	refFrameID=-1;
+	simdLevel = getSimdLevel();
 }
 CoarseTracker::~CoarseTracker()
 {
@@ -102,6 +96,27 @@ CoarseTracker::~CoarseTracker()
     ptrToDelete.clear();
 }
 
+CoarseTrackingWorkspace::CoarseTrackingWorkspace(int ww, int hh)
+{
+    buf_warped_idepth = allocAligned<4,float>(ww*hh, ptrToDelete);
+    buf_warped_u = allocAligned<4,float>(ww*hh, ptrToDelete);
+    buf_warped_v = allocAligned<4,float>(ww*hh, ptrToDelete);
+    buf_warped_dx = allocAligned<4,float>(ww*hh, ptrToDelete);
+    buf_warped_dy = allocAligned<4,float>(ww*hh, ptrToDelete);
+    buf_warped_residual = allocAligned<4,float>(ww*hh, ptrToDelete);
+    buf_warped_weight = allocAligned<4,float>(ww*hh, ptrToDelete);
+    buf_warped_refColor = allocAligned<4,float>(ww*hh, ptrToDelete);
+    firstResiduals.setConstant(NAN);
+    lastResiduals.setConstant(NAN);
+    lastFlowIndicators.setConstant(1000);
+}
+CoarseTrackingWorkspace::~CoarseTrackingWorkspace()
+{
+    for(float* ptr : ptrToDelete)
+        delete[] ptr;
+    ptrToDelete.clear();
+}
+
 void CoarseTracker::makeK(CalibHessian* HCalib)
 {
 	w[0] = wG[0];
@@ -296,61 +311,22 @@ void CoarseTracker::makeCoarseDepthL0(std::vector<FrameHessian*> frameHessians)
 
 
 
-void CoarseTracker::calcGSSSE(int lvl, Mat88 &H_out, Vec8 &b_out, const SE3d &refToNew, AffLight aff_g2l)
+CoarseWarpedBuffers CoarseTrackingWorkspace::warpedBuffers()
 {
-	acc.initialize();
-
-	__m128 fxl = _mm_set1_ps(fx[lvl]);
-	__m128 fyl = _mm_set1_ps(fy[lvl]);
-	__m128 b0 = _mm_set1_ps(lastRef_aff_g2l.b);
-	__m128 a = _mm_set1_ps((float)(AffLight::fromToVecExposure(lastRef->ab_exposure, newFrame->ab_exposure, lastRef_aff_g2l, aff_g2l)[0]));
-
-	__m128 one = _mm_set1_ps(1);
-	__m128 minusOne = _mm_set1_ps(-1);
-	__m128 zero = _mm_set1_ps(0);
+	return CoarseWarpedBuffers{buf_warped_idepth, buf_warped_u, buf_warped_v, buf_warped_dx, buf_warped_dy,
+							   buf_warped_residual, buf_warped_weight, buf_warped_refColor, buf_warped_n};
+}
 
-	int n = buf_warped_n;
-	assert(n%4==0); //valid points number should be 
-	for(int i=0;i<n;i+=4) //4 points eacha time to accelerate
-	{
-		__m128 dx = _mm_mul_ps(_mm_load_ps(buf_warped_dx+i), fxl); // image x gradient * fx. gradient in normalized plane
-		__m128 dy = _mm_mul_ps(_mm_load_ps(buf_warped_dy+i), fyl); // image y gradient * fy. gradient in normalized plane
-		__m128 u = _mm_load_ps(buf_warped_u+i);
-		__m128 v = _mm_load_ps(buf_warped_v+i);
-		__m128 id = _mm_load_ps(buf_warped_idepth+i);
-
-		/**
-		 * 1.0 / depth * di / dx * fx
-		 * 1.0 / depth * di / dy * fy
-		 * -1.0 / depth * (u * di / dx * fx + v * di / dy * fy)
-		 * -(u * v * di / dx * fx + di / dy * fy * (1.0 + v^2))
-		 * -(u * v * di / dy * fy + di / dx * fx * (1.0 + u^2))
-		 * u * di / dy * fy - v * di / dx * fx
-		 * a * (b0 - i[x, y])
-		 * -1
-		 * residual
-		 * huber_weight
-		 */
-		acc.updateSSE_weighted(
-				_mm_mul_ps(id,dx), // 1.0 / depth * di / dx * fx
-				_mm_mul_ps(id,dy), // 1.0 / depth * di / dy * fy
-				_mm_sub_ps(zero, _mm_mul_ps(id,_mm_add_ps(_mm_mul_ps(u,dx), _mm_mul_ps(v,dy)))), // -1.0 / depth * (u * di / dx * fx + v * di / dy * fy)
-				_mm_sub_ps(zero, _mm_add_ps(
-						_mm_mul_ps(_mm_mul_ps(u,v),dx),
-						_mm_mul_ps(dy,_mm_add_ps(one, _mm_mul_ps(v,v))))), // -(u * v * di / dx * fx + di / dy * fy * (1.0 + v^2))
-				_mm_add_ps(
-						_mm_mul_ps(_mm_mul_ps(u,v),dy),
-						_mm_mul_ps(dx,_mm_add_ps(one, _mm_mul_ps(u,u)))), // -(u * v * di / dy * fy + di / dx * fx * (1.0 + u^2))
-				_mm_sub_ps(_mm_mul_ps(u,dy), _mm_mul_ps(v,dx)), // u * di / dy * fy - v * di / dx * fx
-				_mm_mul_ps(a,_mm_sub_ps(b0, _mm_load_ps(buf_warped_refColor+i))), // a * (b0 - i[x, y])
-				minusOne, // -1
-				_mm_load_ps(buf_warped_residual+i), // residual
-				_mm_load_ps(buf_warped_weight+i)); // huber_weight
-	}
+void CoarseTracker::calcGSSSE(CoarseTrackingWorkspace& ws, int lvl, Mat88 &H_out, Vec8 &b_out, const SE3d &refToNew, AffLight aff_g2l)
+{
+	float a = (float)(AffLight::fromToVecExposure(lastRef->ab_exposure, ws.newFrame->ab_exposure, lastRef_aff_g2l, aff_g2l)[0]);
+	int n = ws.buf_warped_n;
 
-	acc.finish();
-	H_out = acc.H.topLeftCorner<8,8>().cast<double>() * (1.0f/n);
-	b_out = acc.H.topRightCorner<8,1>().cast<double>() * (1.0f/n);
+	// the Jacobians (see Accumulator9::updateSSE_weighted) are computed and accumulated in calcGSKernel,
+	// 4, 8 or 16 points at a time depending on simdLevel.
+	calcGSKernel(simdLevel, ws.warpedBuffers(), fx[lvl], fy[lvl], a, lastRef_aff_g2l.b, ws.acc);
+	H_out = ws.acc.H.topLeftCorner<8,8>().cast<double>() * (1.0f/n);
+	b_out = ws.acc.H.topRightCorner<8,1>().cast<double>() * (1.0f/n);
 
 	// taking relative weight into consideration
 	// 8 elements:
@@ -372,16 +348,11 @@ void CoarseTracker::calcGSSSE(int lvl, Mat88 &H_out, Vec8 &b_out, const SE3d &re
 
 
 
-Vec6 CoarseTracker::calcRes(int lvl, const SE3d &refToNew, AffLight aff_g2l, float cutoffTH)
+Vec6 CoarseTracker::calcRes(CoarseTrackingWorkspace& ws, int lvl, const SE3d &refToNew, AffLight aff_g2l, float cutoffTH)
 {
-	float E = 0;
-	int numTermsInE = 0; // number of points use to compute energy
-	int numTermsInWarped = 0; // number of points that have less residual  that cutoff threshold
-	int numSaturated=0; // number of points that have larger residual than cutoff threhold
-
 	int wl = w[lvl];
 	int hl = h[lvl];
-	Eigen::Vector3f* dINewl = newFrame->dIp[lvl]; // color and image gradient of new frame
+	Eigen::Vector3f* dINewl = ws.newFrame->dIp[lvl]; // color and image gradient of new frame
 	float fxl = fx[lvl];
 	float fyl = fy[lvl];
 	float cxl = cx[lvl];
@@ -390,7 +361,7 @@ Vec6 CoarseTracker::calcRes(int lvl, const SE3d &refToNew, AffLight aff_g2l, flo
 
 	Mat33f RKi = (refToNew.rotationMatrix().cast<float>() * Ki[lvl]);
 	Vec3f t = (refToNew.translation()).cast<float>();
-	Vec2f affLL = AffLight::fromToVecExposure(lastRef->ab_exposure, newFrame->ab_exposure, lastRef_aff_g2l, aff_g2l).cast<float>();
+	Vec2f affLL = AffLight::fromToVecExposure(lastRef->ab_exposure, ws.newFrame->ab_exposure, lastRef_aff_g2l, aff_g2l).cast<float>();
 
 
 	float sumSquaredShiftT=0;
@@ -401,7 +372,7 @@ Vec6 CoarseTracker::calcRes(int lvl, const SE3d &refToNew, AffLight aff_g2l, flo
 
 
     MinimalImageB3* resImage = 0;
-	if(debugPlot)
+	if(ws.debugPlot)
 	{
 		resImage = new MinimalImageB3(wl,hl);
 		resImage->setConst(Vec3b(255,255,255));
@@ -415,7 +386,7 @@ Vec6 CoarseTracker::calcRes(int lvl, const SE3d &refToNew, AffLight aff_g2l, flo
 	float* lpc_color = pc_color[lvl];
 
 
-	for(int i=0;i<nl;i++)
+	for(int i=0;lvl==0 && i<nl;i+=32) // every 32 points. sum the pixel shift.
 	{
 		float id = lpc_idepth[i]; // inverse depth
 		float x = lpc_u[i];
@@ -426,96 +397,69 @@ Vec6 CoarseTracker::calcRes(int lvl, const SE3d &refToNew, AffLight aff_g2l, flo
 		float v = pt[1] / pt[2];
 		float Ku = fxl * u + cxl; // coord in new image
 		float Kv = fyl * v + cyl;
-		float new_idepth = id/pt[2]; // inverse in new image frame
 
-		if(lvl==0 && i%32==0) // every 32 points. sum the pixel shift.
-		{
-			// translation only (positive)
-			Vec3f ptT = Ki[lvl] * Vec3f(x, y, 1) + t*id;
-			float uT = ptT[0] / ptT[2];
-			float vT = ptT[1] / ptT[2];
-			float KuT = fxl * uT + cxl;
-			float KvT = fyl * vT + cyl;
-
-			// translation only (negative)
-			Vec3f ptT2 = Ki[lvl] * Vec3f(x, y, 1) - t*id;
-			float uT2 = ptT2[0] / ptT2[2];
-			float vT2 = ptT2[1] / ptT2[2];
-			float KuT2 = fxl * uT2 + cxl;
-			float KvT2 = fyl * vT2 + cyl;
-
-			//translation and rotation (negative)
-			Vec3f pt3 = RKi * Vec3f(x, y, 1) - t*id;
-			float u3 = pt3[0] / pt3[2];
-			float v3 = pt3[1] / pt3[2];
-			float Ku3 = fxl * u3 + cxl;
-			float Kv3 = fyl * v3 + cyl;
-
-			//translation and rotation (positive)
-			//already have it.
-
-			sumSquaredShiftT += (KuT-x)*(KuT-x) + (KvT-y)*(KvT-y);
-			sumSquaredShiftT += (KuT2-x)*(KuT2-x) + (KvT2-y)*(KvT2-y);
-			sumSquaredShiftRT += (Ku-x)*(Ku-x) + (Kv-y)*(Kv-y);
-			sumSquaredShiftRT += (Ku3-x)*(Ku3-x) + (Kv3-y)*(Kv3-y);
-			sumSquaredShiftNum+=2;
-		}
-
-		if(!(Ku > 2 && Kv > 2 && Ku < wl-3 && Kv < hl-3 && new_idepth > 0)) continue; //away from border. check the residual patch shape in the paper
-
-
-
-		float refColor = lpc_color[i]; // color from ref frame
-        Vec3f hitColor = getInterpolatedElement33(dINewl, Ku, Kv, wl); // get the interpolated color and image gradients
-        if(!std::isfinite((float)hitColor[0])) continue;
-		// photometric residual. we can see how the photometric calibration make effect
-        float residual = hitColor[0] - (float)(affLL[0] * refColor + affLL[1]);
-		// robust reisual staff
-        float huber_weight = fabs(residual) < setting_huberTH ? 1 : setting_huberTH / fabs(residual);
-
-
-		if(fabs(residual) > cutoffTH)
-		{
-			if(debugPlot) resImage->setPixel4(lpc_u[i], lpc_v[i], Vec3b(0,0,255)); // set to red in debugging image
-			E += maxEnergy;
-			numTermsInE++;
-			numSaturated++;
-		}
-		else
-		{
-			if(debugPlot) resImage->setPixel4(lpc_u[i], lpc_v[i], Vec3b(residual+128,residual+128,residual+128)); // set to gray corespond to resudal quantity
-
-			E += huber_weight *residual*residual*(2-huber_weight); // robust residual use huber loss
-			numTermsInE++;
-
-			buf_warped_idepth[numTermsInWarped] = new_idepth;
-			buf_warped_u[numTermsInWarped] = u;
-			buf_warped_v[numTermsInWarped] = v;
-			buf_warped_dx[numTermsInWarped] = hitColor[1];
-			buf_warped_dy[numTermsInWarped] = hitColor[2];
-			buf_warped_residual[numTermsInWarped] = residual;
-			buf_warped_weight[numTermsInWarped] = huber_weight;
-			buf_warped_refColor[numTermsInWarped] = lpc_color[i];
-			numTermsInWarped++;
-		}
-	}
-
-	while(numTermsInWarped%4!=0)
-	{
-		buf_warped_idepth[numTermsInWarped] = 0;
-		buf_warped_u[numTermsInWarped] = 0;
-		buf_warped_v[numTermsInWarped] = 0;
-		buf_warped_dx[numTermsInWarped] = 0;
-		buf_warped_dy[numTermsInWarped] = 0;
-		buf_warped_residual[numTermsInWarped] = 0;
-		buf_warped_weight[numTermsInWarped] = 0;
-		buf_warped_refColor[numTermsInWarped] = 0;
-		numTermsInWarped++;
+		// translation only (positive)
+		Vec3f ptT = Ki[lvl] * Vec3f(x, y, 1) + t*id;
+		float uT = ptT[0] / ptT[2];
+		float vT = ptT[1] / ptT[2];
+		float KuT = fxl * uT + cxl;
+		float KvT = fyl * vT + cyl;
+
+		// translation only (negative)
+		Vec3f ptT2 = Ki[lvl] * Vec3f(x, y, 1) - t*id;
+		float uT2 = ptT2[0] / ptT2[2];
+		float vT2 = ptT2[1] / ptT2[2];
+		float KuT2 = fxl * uT2 + cxl;
+		float KvT2 = fyl * vT2 + cyl;
+
+		//translation and rotation (negative)
+		Vec3f pt3 = RKi * Vec3f(x, y, 1) - t*id;
+		float u3 = pt3[0] / pt3[2];
+		float v3 = pt3[1] / pt3[2];
+		float Ku3 = fxl * u3 + cxl;
+		float Kv3 = fyl * v3 + cyl;
+
+		//translation and rotation (positive)
+		//already have it.
+
+		sumSquaredShiftT += (KuT-x)*(KuT-x) + (KvT-y)*(KvT-y);
+		sumSquaredShiftT += (KuT2-x)*(KuT2-x) + (KvT2-y)*(KvT2-y);
+		sumSquaredShiftRT += (Ku-x)*(Ku-x) + (Kv-y)*(Kv-y);
+		sumSquaredShiftRT += (Ku3-x)*(Ku3-x) + (Kv3-y)*(Kv3-y);
+		sumSquaredShiftNum+=2;
 	}
-	buf_warped_n = numTermsInWarped;
 
 
-	if(debugPlot)
+	CoarseResInput in;
+	in.pcU = lpc_u;
+	in.pcV = lpc_v;
+	in.pcIdepth = lpc_idepth;
+	in.pcColor = lpc_color;
+	in.numPoints = nl;
+	in.dINew = dINewl;
+	in.w = wl;
+	in.h = hl;
+	in.RKi = RKi;
+	in.t = t;
+	in.fx = fxl;
+	in.fy = fyl;
+	in.cx = cxl;
+	in.cy = cyl;
+	in.affLL = affLL;
+	in.huberTH = setting_huberTH;
+	in.cutoffTH = cutoffTH;
+	in.maxEnergy = maxEnergy;
+
+	// projects all points, computes the robust residuals and fills the warped buffers (padded to a multiple of 4).
+	CoarseWarpedBuffers warped = ws.warpedBuffers();
+	CoarseResOutput out = calcResKernel(simdLevel, in, warped, resImage);
+	float E = out.E;
+	int numTermsInE = out.numTermsInE;
+	int numSaturated = out.numSaturated;
+	ws.buf_warped_n = warped.n;
+
+
+	if(ws.debugPlot)
 	{
 		IOWrap::displayImage("RES", resImage, false);
 		IOWrap::waitKey(0);
@@ -570,14 +514,89 @@ bool CoarseTracker::trackNewestCoarse(
 {
 	debugPlot = setting_render_displayCoarseTrackingFull;
 	debugPrint = !setting_debugout_runquiet;
+	newFrame = newFrameHessian;
 
-	assert(coarsestLvl < 5 && coarsestLvl < pyrLevelsUsed);
+	CoarseTrackingWorkspace& ws = *mainWorkspace;
+	ws.debugPlot = debugPlot;
+	ws.debugPrint = debugPrint;
+	ws.newFrame = newFrameHessian;
+
+	bool trackingGood = trackWithWorkspace(ws, lastToNew_out, aff_g2l_out, coarsestLvl, minResForAbort);
 
-	lastResiduals.setConstant(NAN);
-	lastFlowIndicators.setConstant(1000);
+	lastResiduals = ws.lastResiduals;
+	lastFlowIndicators = ws.lastFlowIndicators;
+	return trackingGood;
+}
 
+void CoarseTracker::trackNewestCoarseBatch(
+		FrameHessian* newFrameHessian,
+		const std::vector<SE3d, Eigen::aligned_allocator<SE3d>>& lastToNew, AffLight aff_g2l,
+		int first, int end,
+		int coarsestLvl, Vec5 minResForAbort,
+		std::vector<CoarseTrackingResult, Eigen::aligned_allocator<CoarseTrackingResult>>& results,
+		IndexThreadReduce<Vec10>& threadReduce)
+{
+	assert(!(dso::setting_useIMU && imuIntegration.isCoarseInitialized()));
+	assert(first >= 0 && end <= (int)lastToNew.size());
 
 	newFrame = newFrameHessian;
+	while((int)batchWorkspaces.size() < threadReduce.getNumThreads())
+		batchWorkspaces.emplace_back(new CoarseTrackingWorkspace(w[0], h[0]));
+
+	results.resize(std::max(end - first, 0));
+
+	auto trackRange = [&](int min, int max, Vec10* stats, int tid)
+	{
+		CoarseTrackingWorkspace& ws = *batchWorkspaces[tid];
+		ws.debugPlot = false;
+		ws.debugPrint = false;
+		ws.newFrame = newFrameHessian;
+		for(int i = min; i < max; i++)
+		{
+			CoarseTrackingResult& result = results[i - first];
+			result.lastToNew = lastToNew[i];
+			result.aff_g2l = aff_g2l;
+			result.trackingGood = trackWithWorkspace(ws, result.lastToNew, result.aff_g2l, coarsestLvl, minResForAbort);
+			result.residuals = ws.lastResiduals;
+			result.firstResiduals = ws.firstResiduals;
+			result.flowIndicators = ws.lastFlowIndicators;
+		}
+	};
+	threadReduce.reduce(trackRange, first, end, 1);
+}
+
+bool CoarseTracker::applyAbortThreshold(CoarseTrackingResult& result, int coarsestLvl, const Vec5& minResForAbort)
+{
+	// Same order of checks as in trackWithWorkspace: a repeated level is checked after both passes.
+	for(int lvl = coarsestLvl; lvl >= 0; lvl--)
+	{
+		for(double res : {result.firstResiduals[lvl], result.residuals[lvl]})
+		{
+			if(std::isnan(res) || res > 1.5*minResForAbort[lvl])
+			{
+				result.residuals[lvl] = res;
+				for(int finer = lvl - 1; finer >= 0; finer--)
+					result.residuals[finer] = NAN;
+				result.trackingGood = false;
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool CoarseTracker::trackWithWorkspace(
+		CoarseTrackingWorkspace& ws,
+		SE3d &lastToNew_out, AffLight &aff_g2l_out,
+		int coarsestLvl,
+		Vec5 minResForAbort)
+{
+	assert(coarsestLvl < 5 && coarsestLvl < pyrLevelsUsed);
+
+	ws.firstResiduals.setConstant(NAN);
+	ws.lastResiduals.setConstant(NAN);
+	ws.lastFlowIndicators.setConstant(1000);
+
 	int maxIterations[] = {10,20,50,50,50};
 	float lambdaExtrapolationLimit = 0.001;
 
@@ -592,23 +611,23 @@ bool CoarseTracker::trackNewestCoarse(
 	for(int lvl=coarsestLvl; lvl>=0; lvl--) // do tracking on different level of pyr. from coarse to fine to original image
 	{
 		float levelCutoffRepeat=1;
-		Vec6 resOld = calcRes(lvl, refToNew_current, aff_g2l_current, setting_coarseCutoffTH*levelCutoffRepeat);
+		Vec6 resOld = calcRes(ws, lvl, refToNew_current, aff_g2l_current, setting_coarseCutoffTH*levelCutoffRepeat);
 		while(resOld[5] > 0.6 && (levelCutoffRepeat < 50 || resOld[5] > 0.99) ) // make softer cutoff photometric threshold until we got valid point ratio larger than 0.6
 		{
 			levelCutoffRepeat*=2; 
-			resOld = calcRes(lvl, refToNew_current, aff_g2l_current, setting_coarseCutoffTH*levelCutoffRepeat);
+			resOld = calcRes(ws, lvl, refToNew_current, aff_g2l_current, setting_coarseCutoffTH*levelCutoffRepeat);
 
             if(!setting_debugout_runquiet)
                 printf("INCREASING cutoff to %f (ratio is %f)!\n", setting_coarseCutoffTH*levelCutoffRepeat, resOld[5]);
 		}
 
-		calcGSSSE(lvl, H, b, refToNew_current, aff_g2l_current);
+		calcGSSSE(ws, lvl, H, b, refToNew_current, aff_g2l_current);
 
 		float lambda = 0.01;
 
-		if(debugPrint)
+		if(ws.debugPrint)
 		{
-			Vec2f relAff = AffLight::fromToVecExposure(lastRef->ab_exposure, newFrame->ab_exposure, lastRef_aff_g2l, aff_g2l_current).cast<float>();
+			Vec2f relAff = AffLight::fromToVecExposure(lastRef->ab_exposure, ws.newFrame->ab_exposure, lastRef_aff_g2l, aff_g2l_current).cast<float>();
 			printf("lvl%d, it %d (l=%f / %f) %s: %.3f->%.3f (%d -> %d) (|inc| = %f)! \t",
 					lvl, -1, lambda, 1.0f,
 					"INITIA",
@@ -706,14 +725,14 @@ bool CoarseTracker::trackNewestCoarse(
 
                 incNorm = inc.norm();
             }
-			Vec6 resNew = calcRes(lvl, refToNew_new, aff_g2l_new, setting_coarseCutoffTH*levelCutoffRepeat);
+			Vec6 resNew = calcRes(ws, lvl, refToNew_new, aff_g2l_new, setting_coarseCutoffTH*levelCutoffRepeat);
 
 			// accept or not depend on mean photometric residual
 			bool accept = (resNew[0] / resNew[1]) < (resOld[0] / resOld[1]);
 
-			if(debugPrint)
+			if(ws.debugPrint)
 			{
-				Vec2f relAff = AffLight::fromToVecExposure(lastRef->ab_exposure, newFrame->ab_exposure, lastRef_aff_g2l, aff_g2l_new).cast<float>();
+				Vec2f relAff = AffLight::fromToVecExposure(lastRef->ab_exposure, ws.newFrame->ab_exposure, lastRef_aff_g2l, aff_g2l_new).cast<float>();
 				printf("lvl %d, it %d (l=%f / %f) %s: %.3f->%.3f (%d -> %d) (|inc| = %f)! \t",
 						lvl, iteration, lambda,
 						extrapFac,
@@ -726,7 +745,7 @@ bool CoarseTracker::trackNewestCoarse(
 			}
 			if(accept)
 			{
-				calcGSSSE(lvl, H, b, refToNew_new, aff_g2l_new);
+				calcGSSSE(ws, lvl, H, b, refToNew_new, aff_g2l_new);
 				resOld = resNew;
 				aff_g2l_current = aff_g2l_new;
 				refToNew_current = refToNew_new;
@@ -744,17 +763,18 @@ bool CoarseTracker::trackNewestCoarse(
 
 			if(!(incNorm > 1e-3))
 			{
-				if(debugPrint)
+				if(ws.debugPrint)
 					printf("inc too small, break!\n");
 				break; // update norm is small then we think problem is converged
 			}
 		}
 
 		// set last residual for that level, as well as flow indicators.
-		lastResiduals[lvl] = sqrtf((float)(resOld[0] / resOld[1]));
-		lastFlowIndicators = resOld.segment<3>(2);
-		if(std::isnan(lastResiduals[lvl])) return false;
-		if(lastResiduals[lvl] > 1.5*minResForAbort[lvl]) return false;
+		ws.lastResiduals[lvl] = sqrtf((float)(resOld[0] / resOld[1]));
+		ws.lastFlowIndicators = resOld.segment<3>(2);
+		if(std::isnan(ws.firstResiduals[lvl])) ws.firstResiduals[lvl] = ws.lastResiduals[lvl];
+		if(std::isnan(ws.lastResiduals[lvl])) return false;
+		if(ws.lastResiduals[lvl] > 1.5*minResForAbort[lvl]) return false;
 
 
 		if(levelCutoffRepeat > 1 && !haveRepeated)
@@ -776,7 +796,7 @@ bool CoarseTracker::trackNewestCoarse(
 	|| (setting_affineOptModeB != 0 && (fabsf(aff_g2l_out.b) > 200)))
 		trackingGood = false;
 
-	Vec2f relAff = AffLight::fromToVecExposure(lastRef->ab_exposure, newFrame->ab_exposure, lastRef_aff_g2l, aff_g2l_out).cast<float>();
+	Vec2f relAff = AffLight::fromToVecExposure(lastRef->ab_exposure, ws.newFrame->ab_exposure, lastRef_aff_g2l, aff_g2l_out).cast<float>();
 
 	if((setting_affineOptModeA == 0 && (fabsf(logf((float)relAff[0])) > 1.5))
 	|| (setting_affineOptModeB == 0 && (fabsf((float)relAff[1]) > 200)))
@@ -938,6 +958,8 @@ CoarseDistanceMap::CoarseDistanceMap(int ww, int hh)
 	coarseProjectionGrid = new PointFrameResidual*[2048*(ww*hh/(fac*fac))];
 	coarseProjectionGridNum = new int[ww*hh/(fac*fac)];
 
+	distanceTransform = new CoarseDistanceTransform(ww>>1, hh>>1);
+
 	w[0]=h[0]=0;
 }
 CoarseDistanceMap::~CoarseDistanceMap()
@@ -947,6 +969,7 @@ CoarseDistanceMap::~CoarseDistanceMap()
 	delete[] bfsList2;
 	delete[] coarseProjectionGrid;
 	delete[] coarseProjectionGridNum;
+	delete distanceTransform;
 }
 
 
@@ -955,17 +978,11 @@ CoarseDistanceMap::~CoarseDistanceMap()
 // fwdWarpedIDDistFinal is the distance map to points
 void CoarseDistanceMap::makeDistanceMap(
 		std::vector<FrameHessian*> frameHessians,
-		FrameHessian* frame)
+		FrameHessian* frame,
+		IndexThreadReduce<Vec10>* threadReduce)
 {
-	int w1 = w[1];
-	int h1 = h[1];
-	int wh1 = w1*h1;
-	for(int i=0;i<wh1;i++)
-		fwdWarpedIDDistFinal[i] = 1000; // not visited
-
-
-	// make coarse tracking templates for latstRef.
-	int numItems = 0;
+	assert(w[1] == distanceTransform->w && h[1] == distanceTransform->h);
+	distanceTransform->clearSeeds();
 
 	for(FrameHessian* fh : frameHessians)
 	{
@@ -982,13 +999,27 @@ void CoarseDistanceMap::makeDistanceMap(
 			int u = ptp[0] / ptp[2] + 0.5f;
 			int v = ptp[1] / ptp[2] + 0.5f;
 			if(!(u > 0 && v > 0 && u < w[1] && v < h[1])) continue;
-			fwdWarpedIDDistFinal[u+w1*v]=0; // feature point
-			bfsList1[numItems] = Eigen::Vector2i(u,v); // predicted point position in current frame
-			numItems++;
+			distanceTransform->addSeed(u, v); // predicted point position in current frame
 		}
 	}
 
-	growDistBFS(numItems);
+	// same result as growDistBFS from all projected points, but row-wise.
+	if(threadReduce != nullptr)
+	{
+		threadReduce->reduce([&](int min, int max, Vec10* stats, int tid)
+							 {
+								 distanceTransform->computeRowDistances(min, max);
+							 }, 0, h[1], 0);
+		threadReduce->reduce([&](int min, int max, Vec10* stats, int tid)
+							 {
+								 distanceTransform->computeDistances(fwdWarpedIDDistFinal, min, max);
+							 }, 0, h[1], 0);
+		distanceTransform->computeBorder(fwdWarpedIDDistFinal);
+	}
+	else
+	{
+		distanceTransform->compute(fwdWarpedIDDistFinal);
+	}
 }
 
 
@@ -32,7 +32,11 @@
 #include <math.h>
 #include "util/settings.h"
 #include "OptimizationBackend/MatrixAccumulators.h"
+#include "util/SimdDispatch.h"
+#include "util/IndexThreadReduce.h"
+#include "FullSystem/CoarseDistanceTransform.h"
 #include "IOWrapper/Output3DWrapper.h"
+#include <memory>
 
 #include "IMU/IMUIntegration.hpp"
 
@@ -42,6 +46,57 @@ namespace dso
 struct CalibHessian;
 struct FrameHessian;
 struct PointFrameResidual;
+struct CoarseWarpedBuffers;
+
+// Per-thread scratch state of a single coarse tracking run (warped point buffers, accumulator and outputs).
+// Each thread tracking against the same reference needs its own workspace.
+struct CoarseTrackingWorkspace
+{
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
+
+	CoarseTrackingWorkspace(int w, int h);
+	~CoarseTrackingWorkspace();
+	CoarseTrackingWorkspace(const CoarseTrackingWorkspace&) = delete;
+	CoarseTrackingWorkspace& operator=(const CoarseTrackingWorkspace&) = delete;
+
+	CoarseWarpedBuffers warpedBuffers();
+
+	// warped buffers
+	float* buf_warped_idepth;
+	float* buf_warped_u;
+	float* buf_warped_v;
+	float* buf_warped_dx;
+	float* buf_warped_dy;
+	float* buf_warped_residual;
+	float* buf_warped_weight;
+	float* buf_warped_refColor;
+	int buf_warped_n = 0;
+
+	Accumulator9 acc;
+	FrameHessian* newFrame = nullptr;
+	bool debugPlot = false, debugPrint = false;
+
+	// residual of each level when it was first finished (differs from lastResiduals only for a repeated level).
+	Vec5 firstResiduals;
+	Vec5 lastResiduals;
+	Vec3 lastFlowIndicators;
+
+private:
+	std::vector<float*> ptrToDelete;
+};
+
+// Result of tracking one initialization hypothesis, see CoarseTracker::trackNewestCoarseBatch.
+struct CoarseTrackingResult
+{
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
+
+	SE3d lastToNew;
+	AffLight aff_g2l;
+	Vec5 residuals;
+	Vec5 firstResiduals;
+	Vec3 flowIndicators;
+	bool trackingGood = false;
+};
 
 class CoarseTracker {
 public:
@@ -68,6 +123,26 @@ public:
 			int coarsestLvl, Vec5 minResForAbort,
 			IOWrap::Output3DWrapper* wrap=0);
 
+	/**
+	 * @brief tracks the new frame from all initializations lastToNew[first..end) in parallel.
+	 *
+	 * Each hypothesis is tracked exactly as by trackNewestCoarse (without debug output), aborting against
+	 * minResForAbort. The results can afterwards be checked against a tighter threshold with applyAbortThreshold,
+	 * which gives the same result as if the hypothesis had been tracked with that threshold in the first place.
+	 * Must not be used while the IMU coarse graph is active, as that is shared between all hypotheses.
+	 */
+	void trackNewestCoarseBatch(
+			FrameHessian* newFrameHessian,
+			const std::vector<SE3d, Eigen::aligned_allocator<SE3d>>& lastToNew, AffLight aff_g2l,
+			int first, int end,
+			int coarsestLvl, Vec5 minResForAbort,
+			std::vector<CoarseTrackingResult, Eigen::aligned_allocator<CoarseTrackingResult>>& results,
+			IndexThreadReduce<Vec10>& threadReduce);
+
+	// Checks result against minResForAbort the same way trackNewestCoarse does after each level.
+	// If it would have aborted, the residuals are truncated accordingly and false is returned.
+	static bool applyAbortThreshold(CoarseTrackingResult& result, int coarsestLvl, const Vec5& minResForAbort);
+
 	void setCoarseTrackingRef(
 			std::vector<FrameHessian*> frameHessians);
 
@@ -110,7 +185,11 @@ private:
 	float* weightSums_bak[PYR_LEVELS];
 
 
-	Vec6 calcResAndGS(int lvl, Mat88 &H_out, Vec8 &b_out, const SE3d &refToNew, AffLight aff_g2l, float cutoffTH);
+	bool trackWithWorkspace(
+			CoarseTrackingWorkspace& ws,
+			SE3d &lastToNew_out, AffLight &aff_g2l_out,
+			int coarsestLvl, Vec5 minResForAbort);
+
 	/**
 	 * 0. total loss
 	 * 1. valid points that is inside current frame
@@ -119,7 +198,7 @@ private:
 	 * 4. mean pixel shift by rotation and +- translation
 	 * 5. ratio of points that exceed the residual cutoff threshold
 	 */
-	Vec6 calcRes(int lvl, const SE3d &refToNew, AffLight aff_g2l, float cutoffTH);
+	Vec6 calcRes(CoarseTrackingWorkspace& ws, int lvl, const SE3d &refToNew, AffLight aff_g2l, float cutoffTH);
 
 	/**
 	 * @brief formulate the JtJ and Jtb matrix. states to be solved include rotation, translation and 2 photometric parameters
@@ -130,9 +209,7 @@ private:
 	 * @param refToNew 
 	 * @param aff_g2l 
 	 */
-	void calcGSSSE(int lvl, Mat88 &H_out, Vec8 &b_out, const SE3d &refToNew, AffLight aff_g2l);
-
-	void calcGS(int lvl, Mat88 &H_out, Vec8 &b_out, const SE3d &refToNew, AffLight aff_g2l);
+	void calcGSSSE(CoarseTrackingWorkspace& ws, int lvl, Mat88 &H_out, Vec8 &b_out, const SE3d &refToNew, AffLight aff_g2l);
 
 	// pc buffers
 	float* pc_u[PYR_LEVELS];
@@ -141,19 +218,12 @@ private:
 	float* pc_color[PYR_LEVELS];
 	int pc_n[PYR_LEVELS];
 
-	// warped buffers
-	float* buf_warped_idepth;
-	float* buf_warped_u;
-	float* buf_warped_v;
-	float* buf_warped_dx;
-	float* buf_warped_dy;
-	float* buf_warped_residual;
-	float* buf_warped_weight;
-	float* buf_warped_refColor;
-	int buf_warped_n;
+	// workspace used by trackNewestCoarse, and one per thread for trackNewestCoarseBatch (created lazily).
+	std::unique_ptr<CoarseTrackingWorkspace> mainWorkspace;
+	std::vector<std::unique_ptr<CoarseTrackingWorkspace>> batchWorkspaces;
 
     std::vector<float*> ptrToDelete;
-	Accumulator9 acc;
+	SimdLevel simdLevel; // kernels used in calcRes and calcGSSSE, see CoarseTrackerKernels.h.
 
     dmvio::IMUIntegration &imuIntegration;
 
@@ -167,9 +237,11 @@ public:
 	CoarseDistanceMap(int w, int h);
 	~CoarseDistanceMap();
 
+	// if threadReduce is set the distance transform is computed in parallel over the rows.
 	void makeDistanceMap(
 			std::vector<FrameHessian*> frameHessians,
-			FrameHessian* frame);
+			FrameHessian* frame,
+			IndexThreadReduce<Vec10>* threadReduce = nullptr);
 
 	void makeInlierVotes(
 			std::vector<FrameHessian*> frameHessians);
@@ -201,7 +273,9 @@ private:
 	int* coarseProjectionGridNum;
 	Eigen::Vector2i* bfsList1;
 	Eigen::Vector2i* bfsList2;
+	CoarseDistanceTransform* distanceTransform;
 
+	// only used by addIntoDistFinal, makeDistanceMap uses distanceTransform.
 	void growDistBFS(int bfsNum);
 };
 
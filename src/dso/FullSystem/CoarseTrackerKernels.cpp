@@ -0,0 +1,553 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "CoarseTrackerKernels.h"
+#include "util/globalFuncs.h"
+#include "util/settings.h"
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+#if DSO_WIDE_SIMD
+#include <immintrin.h>
+#endif
+
+namespace dso
+{
+
+namespace
+{
+
+void padWarpedBuffers(CoarseWarpedBuffers& out, int numWarped)
+{
+    while(numWarped % 4 != 0)
+    {
+        out.idepth[numWarped] = 0;
+        out.u[numWarped] = 0;
+        out.v[numWarped] = 0;
+        out.dx[numWarped] = 0;
+        out.dy[numWarped] = 0;
+        out.residual[numWarped] = 0;
+        out.weight[numWarped] = 0;
+        out.refColor[numWarped] = 0;
+        numWarped++;
+    }
+    out.n = numWarped;
+}
+
+CoarseResOutput calcResSSE(const CoarseResInput& in, CoarseWarpedBuffers& out, MinimalImageB3* resImage)
+{
+    // numTermsInE: number of points used to compute the energy.
+    // numSaturated: number of points that have a larger residual than the cutoff threshold.
+    // numWarped: number of points that have a smaller residual than the cutoff threshold (written to out).
+    CoarseResOutput ret{0, 0, 0};
+    int numWarped = 0;
+    for(int i = 0; i < in.numPoints; i++)
+    {
+        float id = in.pcIdepth[i]; // inverse depth
+        float x = in.pcU[i];
+        float y = in.pcV[i];
+
+        Vec3f pt = in.RKi * Vec3f(x, y, 1) + in.t * id;
+        float u = pt[0] / pt[2];
+        float v = pt[1] / pt[2];
+        float Ku = in.fx * u + in.cx; // coord in new image
+        float Kv = in.fy * v + in.cy;
+        float new_idepth = id / pt[2]; // inverse depth in new image frame
+
+        if(!(Ku > 2 && Kv > 2 && Ku < in.w - 3 && Kv < in.h - 3 && new_idepth > 0)) continue; // away from border. check the residual patch shape in the paper
+
+        float refColor = in.pcColor[i]; // color from ref frame
+        Vec3f hitColor = getInterpolatedElement33(in.dINew, Ku, Kv, in.w); // get the interpolated color and image gradients
+        if(!std::isfinite((float) hitColor[0])) continue;
+        // photometric residual. we can see how the photometric calibration make effect
+        float residual = hitColor[0] - (float) (in.affLL[0] * refColor + in.affLL[1]);
+        // robust residual stuff
+        float huber_weight = fabs(residual) < in.huberTH ? 1 : in.huberTH / fabs(residual);
+
+        if(fabs(residual) > in.cutoffTH)
+        {
+            if(resImage) resImage->setPixel4(x, y, Vec3b(0, 0, 255)); // set to red in debugging image
+            ret.E += in.maxEnergy;
+            ret.numTermsInE++;
+            ret.numSaturated++;
+        }
+        else
+        {
+            if(resImage) resImage->setPixel4(x, y, Vec3b(residual + 128, residual + 128, residual + 128)); // set to gray corresponding to residual quantity
+
+            ret.E += huber_weight * residual * residual * (2 - huber_weight); // robust residual uses huber loss
+            ret.numTermsInE++;
+
+            out.idepth[numWarped] = new_idepth;
+            out.u[numWarped] = u;
+            out.v[numWarped] = v;
+            out.dx[numWarped] = hitColor[1];
+            out.dy[numWarped] = hitColor[2];
+            out.residual[numWarped] = residual;
+            out.weight[numWarped] = huber_weight;
+            out.refColor[numWarped] = refColor;
+            numWarped++;
+        }
+    }
+    padWarpedBuffers(out, numWarped);
+    return ret;
+}
+
+void calcGSSSE(const CoarseWarpedBuffers& buf, float fx, float fy, float aIn, float b0In, Accumulator9& acc)
+{
+    acc.initialize();
+
+    __m128 fxl = _mm_set1_ps(fx);
+    __m128 fyl = _mm_set1_ps(fy);
+    __m128 b0 = _mm_set1_ps(b0In);
+    __m128 a = _mm_set1_ps(aIn);
+
+    __m128 one = _mm_set1_ps(1);
+    __m128 minusOne = _mm_set1_ps(-1);
+    __m128 zero = _mm_set1_ps(0);
+
+    assert(buf.n % 4 == 0); // valid points number should be a multiple of 4 (padded by calcResKernel)
+    for(int i = 0; i < buf.n; i += 4) // 4 points each time to accelerate
+    {
+        __m128 dx = _mm_mul_ps(_mm_load_ps(buf.dx + i), fxl); // image x gradient * fx. gradient in normalized plane
+        __m128 dy = _mm_mul_ps(_mm_load_ps(buf.dy + i), fyl); // image y gradient * fy. gradient in normalized plane
+        __m128 u = _mm_load_ps(buf.u + i);
+        __m128 v = _mm_load_ps(buf.v + i);
+        __m128 id = _mm_load_ps(buf.idepth + i);
+
+        /**
+         * 1.0 / depth * di / dx * fx
+         * 1.0 / depth * di / dy * fy
+         * -1.0 / depth * (u * di / dx * fx + v * di / dy * fy)
+         * -(u * v * di / dx * fx + di / dy * fy * (1.0 + v^2))
+         * -(u * v * di / dy * fy + di / dx * fx * (1.0 + u^2))
+         * u * di / dy * fy - v * di / dx * fx
+         * a * (b0 - i[x, y])
+         * -1
+         * residual
+         * huber_weight
+         */
+        acc.updateSSE_weighted(
+                _mm_mul_ps(id, dx), // 1.0 / depth * di / dx * fx
+                _mm_mul_ps(id, dy), // 1.0 / depth * di / dy * fy
+                _mm_sub_ps(zero, _mm_mul_ps(id, _mm_add_ps(_mm_mul_ps(u, dx), _mm_mul_ps(v, dy)))), // -1.0 / depth * (u * di / dx * fx + v * di / dy * fy)
+                _mm_sub_ps(zero, _mm_add_ps(
+                        _mm_mul_ps(_mm_mul_ps(u, v), dx),
+                        _mm_mul_ps(dy, _mm_add_ps(one, _mm_mul_ps(v, v))))), // -(u * v * di / dx * fx + di / dy * fy * (1.0 + v^2))
+                _mm_add_ps(
+                        _mm_mul_ps(_mm_mul_ps(u, v), dy),
+                        _mm_mul_ps(dx, _mm_add_ps(one, _mm_mul_ps(u, u)))), // -(u * v * di / dy * fy + di / dx * fx * (1.0 + u^2))
+                _mm_sub_ps(_mm_mul_ps(u, dy), _mm_mul_ps(v, dx)), // u * di / dy * fy - v * di / dx * fx
+                _mm_mul_ps(a, _mm_sub_ps(b0, _mm_load_ps(buf.refColor + i))), // a * (b0 - i[x, y])
+                minusOne, // -1
+                _mm_load_ps(buf.residual + i), // residual
+                _mm_load_ps(buf.weight + i)); // huber_weight
+    }
+    acc.finish();
+}
+
+#if DSO_WIDE_SIMD
+
+// For every 8 bit mask the permutation which moves the selected lanes to the front (AVX2 has no compress).
+struct CompressTable8
+{
+    CompressTable8()
+    {
+        for(int mask = 0; mask < 256; mask++)
+        {
+            int k = 0;
+            for(int j = 0; j < 8; j++)
+            {
+                if(mask & (1 << j)) idx[mask][k++] = j;
+            }
+            for(; k < 8; k++) idx[mask][k] = 0;
+        }
+    }
+
+    int32_t idx[256][8];
+};
+
+const CompressTable8 compressTable8;
+
+DSO_TARGET_AVX2 inline __m256i firstLanesAVX2(int num)
+{
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(num), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+DSO_TARGET_AVX2 CoarseResOutput calcResAVX2(const CoarseResInput& in, CoarseWarpedBuffers& out)
+{
+    const __m256 r00 = _mm256_set1_ps(in.RKi(0, 0)), r01 = _mm256_set1_ps(in.RKi(0, 1)), r02 = _mm256_set1_ps(in.RKi(0, 2));
+    const __m256 r10 = _mm256_set1_ps(in.RKi(1, 0)), r11 = _mm256_set1_ps(in.RKi(1, 1)), r12 = _mm256_set1_ps(in.RKi(1, 2));
+    const __m256 r20 = _mm256_set1_ps(in.RKi(2, 0)), r21 = _mm256_set1_ps(in.RKi(2, 1)), r22 = _mm256_set1_ps(in.RKi(2, 2));
+    const __m256 t0 = _mm256_set1_ps(in.t[0]), t1 = _mm256_set1_ps(in.t[1]), t2 = _mm256_set1_ps(in.t[2]);
+    const __m256 fx = _mm256_set1_ps(in.fx), fy = _mm256_set1_ps(in.fy);
+    const __m256 cx = _mm256_set1_ps(in.cx), cy = _mm256_set1_ps(in.cy);
+    const __m256 uMax = _mm256_set1_ps(in.w - 3), vMax = _mm256_set1_ps(in.h - 3);
+    const __m256 aff0 = _mm256_set1_ps(in.affLL[0]), aff1 = _mm256_set1_ps(in.affLL[1]);
+    const __m256 huberTH = _mm256_set1_ps(in.huberTH), cutoffTH = _mm256_set1_ps(in.cutoffTH);
+    const __m256 maxEnergy = _mm256_set1_ps(in.maxEnergy);
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1), two = _mm256_set1_ps(2);
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 inf = _mm256_set1_ps(INFINITY);
+    const __m256i width = _mm256_set1_epi32(in.w), three = _mm256_set1_epi32(3), rowStride = _mm256_set1_epi32(3 * in.w);
+    const float* dI = in.dINew->data();
+
+    CoarseResOutput ret{0, 0, 0};
+    __m256 E = zero;
+    int numWarped = 0;
+    for(int i = 0; i < in.numPoints; i += 8)
+    {
+        __m256i active = firstLanesAVX2(std::min(8, in.numPoints - i));
+        __m256 x = _mm256_maskload_ps(in.pcU + i, active);
+        __m256 y = _mm256_maskload_ps(in.pcV + i, active);
+        __m256 id = _mm256_maskload_ps(in.pcIdepth + i, active);
+
+        __m256 ptx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r00, x), _mm256_mul_ps(r01, y)), r02), _mm256_mul_ps(t0, id));
+        __m256 pty = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r10, x), _mm256_mul_ps(r11, y)), r12), _mm256_mul_ps(t1, id));
+        __m256 ptz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r20, x), _mm256_mul_ps(r21, y)), r22), _mm256_mul_ps(t2, id));
+        __m256 u = _mm256_div_ps(ptx, ptz);
+        __m256 v = _mm256_div_ps(pty, ptz);
+        __m256 Ku = _mm256_add_ps(_mm256_mul_ps(fx, u), cx); // coord in new image
+        __m256 Kv = _mm256_add_ps(_mm256_mul_ps(fy, v), cy);
+        __m256 newIdepth = _mm256_div_ps(id, ptz); // inverse depth in new image frame
+
+        // away from border (check the residual patch shape in the paper) and in front of the camera.
+        __m256 valid = _mm256_and_ps(_mm256_castsi256_ps(active), _mm256_cmp_ps(Ku, two, _CMP_GT_OQ));
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(Kv, two, _CMP_GT_OQ));
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(Ku, uMax, _CMP_LT_OQ));
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(Kv, vMax, _CMP_LT_OQ));
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(newIdepth, zero, _CMP_GT_OQ));
+        if(_mm256_movemask_ps(valid) == 0) continue;
+
+        // Bilinear interpolation of color and gradients, see getInterpolatedElement33.
+        __m256i ix = _mm256_and_si256(_mm256_cvttps_epi32(Ku), _mm256_castps_si256(valid));
+        __m256i iy = _mm256_and_si256(_mm256_cvttps_epi32(Kv), _mm256_castps_si256(valid));
+        __m256 dx = _mm256_sub_ps(Ku, _mm256_cvtepi32_ps(ix));
+        __m256 dy = _mm256_sub_ps(Kv, _mm256_cvtepi32_ps(iy));
+        __m256 dxdy = _mm256_mul_ps(dx, dy);
+        __m256 w01 = _mm256_sub_ps(dy, dxdy);
+        __m256 w10 = _mm256_sub_ps(dx, dxdy);
+        __m256 w00 = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(one, dx), dy), dxdy);
+        __m256i idx00 = _mm256_mullo_epi32(_mm256_add_epi32(ix, _mm256_mullo_epi32(iy, width)), three);
+        __m256i idx10 = _mm256_add_epi32(idx00, three);
+        __m256i idx01 = _mm256_add_epi32(idx00, rowStride);
+        __m256i idx11 = _mm256_add_epi32(idx01, three);
+        __m256 hit[3];
+        for(int c = 0; c < 3; c++)
+        {
+            __m256 h11 = _mm256_mask_i32gather_ps(zero, dI + c, idx11, valid, 4);
+            __m256 h01 = _mm256_mask_i32gather_ps(zero, dI + c, idx01, valid, 4);
+            __m256 h10 = _mm256_mask_i32gather_ps(zero, dI + c, idx10, valid, 4);
+            __m256 h00 = _mm256_mask_i32gather_ps(zero, dI + c, idx00, valid, 4);
+            hit[c] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dxdy, h11), _mm256_mul_ps(w01, h01)),
+                                                 _mm256_mul_ps(w10, h10)), _mm256_mul_ps(w00, h00));
+        }
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(_mm256_and_ps(hit[0], absMask), inf, _CMP_LT_OQ));
+
+        __m256 refColor = _mm256_maskload_ps(in.pcColor + i, active);
+        // photometric residual and robust (huber) weight, residuals above the cutoff add maxEnergy instead.
+        __m256 residual = _mm256_sub_ps(hit[0], _mm256_add_ps(_mm256_mul_ps(aff0, refColor), aff1));
+        __m256 absRes = _mm256_and_ps(residual, absMask);
+        __m256 huberWeight = _mm256_blendv_ps(_mm256_div_ps(huberTH, absRes), one,
+                                              _mm256_cmp_ps(absRes, huberTH, _CMP_LT_OQ));
+        __m256 saturated = _mm256_and_ps(valid, _mm256_cmp_ps(absRes, cutoffTH, _CMP_GT_OQ));
+        __m256 inlier = _mm256_andnot_ps(saturated, valid);
+
+        E = _mm256_add_ps(E, _mm256_and_ps(saturated, maxEnergy));
+        E = _mm256_add_ps(E, _mm256_and_ps(inlier, _mm256_mul_ps(
+                _mm256_mul_ps(_mm256_mul_ps(huberWeight, residual), residual), _mm256_sub_ps(two, huberWeight))));
+        ret.numTermsInE += __builtin_popcount(_mm256_movemask_ps(valid));
+        ret.numSaturated += __builtin_popcount(_mm256_movemask_ps(saturated));
+
+        int inlierBits = _mm256_movemask_ps(inlier);
+        if(inlierBits == 0) continue;
+        __m256i perm = _mm256_loadu_si256((const __m256i*) compressTable8.idx[inlierBits]);
+        int numInliers = __builtin_popcount(inlierBits);
+        __m256i store = firstLanesAVX2(numInliers);
+        _mm256_maskstore_ps(out.idepth + numWarped, store, _mm256_permutevar8x32_ps(newIdepth, perm));
+        _mm256_maskstore_ps(out.u + numWarped, store, _mm256_permutevar8x32_ps(u, perm));
+        _mm256_maskstore_ps(out.v + numWarped, store, _mm256_permutevar8x32_ps(v, perm));
+        _mm256_maskstore_ps(out.dx + numWarped, store, _mm256_permutevar8x32_ps(hit[1], perm));
+        _mm256_maskstore_ps(out.dy + numWarped, store, _mm256_permutevar8x32_ps(hit[2], perm));
+        _mm256_maskstore_ps(out.residual + numWarped, store, _mm256_permutevar8x32_ps(residual, perm));
+        _mm256_maskstore_ps(out.weight + numWarped, store, _mm256_permutevar8x32_ps(huberWeight, perm));
+        _mm256_maskstore_ps(out.refColor + numWarped, store, _mm256_permutevar8x32_ps(refColor, perm));
+        numWarped += numInliers;
+    }
+
+    EIGEN_ALIGN32 float ESum[8];
+    _mm256_store_ps(ESum, E);
+    for(float e : ESum) ret.E += e;
+    padWarpedBuffers(out, numWarped);
+    return ret;
+}
+
+DSO_TARGET_AVX2 void calcGSAVX2(const CoarseWarpedBuffers& buf, float fxIn, float fyIn, float aIn, float b0In,
+                                Accumulator9& acc)
+{
+    acc.initialize(8);
+    float* data = acc.laneData();
+
+    const __m256 fx = _mm256_set1_ps(fxIn), fy = _mm256_set1_ps(fyIn);
+    const __m256 b0 = _mm256_set1_ps(b0In), a = _mm256_set1_ps(aIn);
+    const __m256 one = _mm256_set1_ps(1), minusOne = _mm256_set1_ps(-1), zero = _mm256_setzero_ps();
+
+    for(int i = 0; i < buf.n; i += 8)
+    {
+        // The last block may only be 4 wide, masked lanes have zero weight.
+        __m256i active = firstLanesAVX2(std::min(8, buf.n - i));
+        __m256 dx = _mm256_mul_ps(_mm256_maskload_ps(buf.dx + i, active), fx); // image x gradient * fx. gradient in normalized plane
+        __m256 dy = _mm256_mul_ps(_mm256_maskload_ps(buf.dy + i, active), fy); // image y gradient * fy. gradient in normalized plane
+        __m256 u = _mm256_maskload_ps(buf.u + i, active);
+        __m256 v = _mm256_maskload_ps(buf.v + i, active);
+        __m256 id = _mm256_maskload_ps(buf.idepth + i, active);
+
+        __m256 J[9];
+        // Same Jacobians as in calcGSSSE (dx, dy are the image gradients times fx, fy, i.e. in the normalized plane).
+        J[0] = _mm256_mul_ps(id, dx); // 1.0 / depth * di / dx * fx
+        J[1] = _mm256_mul_ps(id, dy); // 1.0 / depth * di / dy * fy
+        // -1.0 / depth * (u * di / dx * fx + v * di / dy * fy)
+        J[2] = _mm256_sub_ps(zero, _mm256_mul_ps(id, _mm256_add_ps(_mm256_mul_ps(u, dx), _mm256_mul_ps(v, dy))));
+        // -(u * v * di / dx * fx + di / dy * fy * (1.0 + v^2))
+        J[3] = _mm256_sub_ps(zero, _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(u, v), dx),
+                                                 _mm256_mul_ps(dy, _mm256_add_ps(one, _mm256_mul_ps(v, v)))));
+        // -(u * v * di / dy * fy + di / dx * fx * (1.0 + u^2))
+        J[4] = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(u, v), dy),
+                             _mm256_mul_ps(dx, _mm256_add_ps(one, _mm256_mul_ps(u, u))));
+        J[5] = _mm256_sub_ps(_mm256_mul_ps(u, dy), _mm256_mul_ps(v, dx)); // u * di / dy * fy - v * di / dx * fx
+        // a * (b0 - i[x, y])
+        J[6] = _mm256_mul_ps(a, _mm256_sub_ps(b0, _mm256_maskload_ps(buf.refColor + i, active)));
+        J[7] = minusOne; // -1
+        J[8] = _mm256_maskload_ps(buf.residual + i, active);
+        __m256 w = _mm256_maskload_ps(buf.weight + i, active); // huber_weight
+
+        float* pt = data;
+        for(int r = 0; r < 9; r++)
+        {
+            __m256 Jw = _mm256_mul_ps(J[r], w);
+            for(int c = r; c < 9; c++)
+            {
+                _mm256_storeu_ps(pt, _mm256_add_ps(_mm256_loadu_ps(pt), _mm256_mul_ps(Jw, J[c])));
+                pt += 8;
+            }
+        }
+        acc.laneUpdateDone();
+    }
+    acc.finish();
+}
+
+DSO_TARGET_AVX512 inline __mmask16 firstLanesAVX512(int num)
+{
+    return num >= 16 ? (__mmask16) 0xffff : (__mmask16) ((1u << num) - 1);
+}
+
+DSO_TARGET_AVX512 inline __m512 absAVX512(__m512 x)
+{
+    return _mm512_castsi512_ps(_mm512_and_epi32(_mm512_castps_si512(x), _mm512_set1_epi32(0x7fffffff)));
+}
+
+DSO_TARGET_AVX512 CoarseResOutput calcResAVX512(const CoarseResInput& in, CoarseWarpedBuffers& out)
+{
+    const __m512 r00 = _mm512_set1_ps(in.RKi(0, 0)), r01 = _mm512_set1_ps(in.RKi(0, 1)), r02 = _mm512_set1_ps(in.RKi(0, 2));
+    const __m512 r10 = _mm512_set1_ps(in.RKi(1, 0)), r11 = _mm512_set1_ps(in.RKi(1, 1)), r12 = _mm512_set1_ps(in.RKi(1, 2));
+    const __m512 r20 = _mm512_set1_ps(in.RKi(2, 0)), r21 = _mm512_set1_ps(in.RKi(2, 1)), r22 = _mm512_set1_ps(in.RKi(2, 2));
+    const __m512 t0 = _mm512_set1_ps(in.t[0]), t1 = _mm512_set1_ps(in.t[1]), t2 = _mm512_set1_ps(in.t[2]);
+    const __m512 fx = _mm512_set1_ps(in.fx), fy = _mm512_set1_ps(in.fy);
+    const __m512 cx = _mm512_set1_ps(in.cx), cy = _mm512_set1_ps(in.cy);
+    const __m512 uMax = _mm512_set1_ps(in.w - 3), vMax = _mm512_set1_ps(in.h - 3);
+    const __m512 aff0 = _mm512_set1_ps(in.affLL[0]), aff1 = _mm512_set1_ps(in.affLL[1]);
+    const __m512 huberTH = _mm512_set1_ps(in.huberTH), cutoffTH = _mm512_set1_ps(in.cutoffTH);
+    const __m512 maxEnergy = _mm512_set1_ps(in.maxEnergy);
+    const __m512 zero = _mm512_setzero_ps(), one = _mm512_set1_ps(1), two = _mm512_set1_ps(2);
+    const __m512 inf = _mm512_set1_ps(INFINITY);
+    const __m512i width = _mm512_set1_epi32(in.w), three = _mm512_set1_epi32(3), rowStride = _mm512_set1_epi32(3 * in.w);
+    const float* dI = in.dINew->data();
+
+    CoarseResOutput ret{0, 0, 0};
+    __m512 E = zero;
+    int numWarped = 0;
+    for(int i = 0; i < in.numPoints; i += 16)
+    {
+        __mmask16 active = firstLanesAVX512(in.numPoints - i);
+        __m512 x = _mm512_maskz_loadu_ps(active, in.pcU + i);
+        __m512 y = _mm512_maskz_loadu_ps(active, in.pcV + i);
+        __m512 id = _mm512_maskz_loadu_ps(active, in.pcIdepth + i);
+
+        __m512 ptx = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(r00, x), _mm512_mul_ps(r01, y)), r02), _mm512_mul_ps(t0, id));
+        __m512 pty = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(r10, x), _mm512_mul_ps(r11, y)), r12), _mm512_mul_ps(t1, id));
+        __m512 ptz = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(r20, x), _mm512_mul_ps(r21, y)), r22), _mm512_mul_ps(t2, id));
+        __m512 u = _mm512_div_ps(ptx, ptz);
+        __m512 v = _mm512_div_ps(pty, ptz);
+        __m512 Ku = _mm512_add_ps(_mm512_mul_ps(fx, u), cx); // coord in new image
+        __m512 Kv = _mm512_add_ps(_mm512_mul_ps(fy, v), cy);
+        __m512 newIdepth = _mm512_div_ps(id, ptz); // inverse depth in new image frame
+
+        // away from border (check the residual patch shape in the paper) and in front of the camera.
+        __mmask16 valid = _mm512_mask_cmp_ps_mask(active, Ku, two, _CMP_GT_OQ);
+        valid = _mm512_mask_cmp_ps_mask(valid, Kv, two, _CMP_GT_OQ);
+        valid = _mm512_mask_cmp_ps_mask(valid, Ku, uMax, _CMP_LT_OQ);
+        valid = _mm512_mask_cmp_ps_mask(valid, Kv, vMax, _CMP_LT_OQ);
+        valid = _mm512_mask_cmp_ps_mask(valid, newIdepth, zero, _CMP_GT_OQ);
+        if(valid == 0) continue;
+
+        // Bilinear interpolation of color and gradients, see getInterpolatedElement33.
+        __m512i ix = _mm512_maskz_cvttps_epi32(valid, Ku);
+        __m512i iy = _mm512_maskz_cvttps_epi32(valid, Kv);
+        __m512 dx = _mm512_sub_ps(Ku, _mm512_cvtepi32_ps(ix));
+        __m512 dy = _mm512_sub_ps(Kv, _mm512_cvtepi32_ps(iy));
+        __m512 dxdy = _mm512_mul_ps(dx, dy);
+        __m512 w01 = _mm512_sub_ps(dy, dxdy);
+        __m512 w10 = _mm512_sub_ps(dx, dxdy);
+        __m512 w00 = _mm512_add_ps(_mm512_sub_ps(_mm512_sub_ps(one, dx), dy), dxdy);
+        __m512i idx00 = _mm512_mullo_epi32(_mm512_add_epi32(ix, _mm512_mullo_epi32(iy, width)), three);
+        __m512i idx10 = _mm512_add_epi32(idx00, three);
+        __m512i idx01 = _mm512_add_epi32(idx00, rowStride);
+        __m512i idx11 = _mm512_add_epi32(idx01, three);
+        __m512 hit[3];
+        for(int c = 0; c < 3; c++)
+        {
+            __m512 h11 = _mm512_mask_i32gather_ps(zero, valid, idx11, dI + c, 4);
+            __m512 h01 = _mm512_mask_i32gather_ps(zero, valid, idx01, dI + c, 4);
+            __m512 h10 = _mm512_mask_i32gather_ps(zero, valid, idx10, dI + c, 4);
+            __m512 h00 = _mm512_mask_i32gather_ps(zero, valid, idx00, dI + c, 4);
+            hit[c] = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dxdy, h11), _mm512_mul_ps(w01, h01)),
+                                                 _mm512_mul_ps(w10, h10)), _mm512_mul_ps(w00, h00));
+        }
+        valid = _mm512_mask_cmp_ps_mask(valid, absAVX512(hit[0]), inf, _CMP_LT_OQ);
+
+        __m512 refColor = _mm512_maskz_loadu_ps(active, in.pcColor + i);
+        // photometric residual and robust (huber) weight, residuals above the cutoff add maxEnergy instead.
+        __m512 residual = _mm512_sub_ps(hit[0], _mm512_add_ps(_mm512_mul_ps(aff0, refColor), aff1));
+        __m512 absRes = absAVX512(residual);
+        __m512 huberWeight = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(absRes, huberTH, _CMP_LT_OQ),
+                                                  _mm512_div_ps(huberTH, absRes), one);
+        __mmask16 saturated = _mm512_mask_cmp_ps_mask(valid, absRes, cutoffTH, _CMP_GT_OQ);
+        __mmask16 inlier = valid & ~saturated;
+
+        E = _mm512_mask_add_ps(E, saturated, E, maxEnergy);
+        E = _mm512_mask_add_ps(E, inlier, E, _mm512_mul_ps(
+                _mm512_mul_ps(_mm512_mul_ps(huberWeight, residual), residual), _mm512_sub_ps(two, huberWeight)));
+        ret.numTermsInE += __builtin_popcount(valid);
+        ret.numSaturated += __builtin_popcount(saturated);
+
+        if(inlier == 0) continue;
+        _mm512_mask_compressstoreu_ps(out.idepth + numWarped, inlier, newIdepth);
+        _mm512_mask_compressstoreu_ps(out.u + numWarped, inlier, u);
+        _mm512_mask_compressstoreu_ps(out.v + numWarped, inlier, v);
+        _mm512_mask_compressstoreu_ps(out.dx + numWarped, inlier, hit[1]);
+        _mm512_mask_compressstoreu_ps(out.dy + numWarped, inlier, hit[2]);
+        _mm512_mask_compressstoreu_ps(out.residual + numWarped, inlier, residual);
+        _mm512_mask_compressstoreu_ps(out.weight + numWarped, inlier, huberWeight);
+        _mm512_mask_compressstoreu_ps(out.refColor + numWarped, inlier, refColor);
+        numWarped += __builtin_popcount(inlier);
+    }
+
+    ret.E = _mm512_reduce_add_ps(E);
+    padWarpedBuffers(out, numWarped);
+    return ret;
+}
+
+DSO_TARGET_AVX512 void calcGSAVX512(const CoarseWarpedBuffers& buf, float fxIn, float fyIn, float aIn, float b0In,
+                                    Accumulator9& acc)
+{
+    acc.initialize(16);
+    float* data = acc.laneData();
+
+    const __m512 fx = _mm512_set1_ps(fxIn), fy = _mm512_set1_ps(fyIn);
+    const __m512 b0 = _mm512_set1_ps(b0In), a = _mm512_set1_ps(aIn);
+    const __m512 one = _mm512_set1_ps(1), minusOne = _mm512_set1_ps(-1), zero = _mm512_setzero_ps();
+
+    for(int i = 0; i < buf.n; i += 16)
+    {
+        // Masked lanes of the last block are loaded as zero and have zero weight.
+        __mmask16 active = firstLanesAVX512(buf.n - i);
+        __m512 dx = _mm512_mul_ps(_mm512_maskz_loadu_ps(active, buf.dx + i), fx); // image x gradient * fx. gradient in normalized plane
+        __m512 dy = _mm512_mul_ps(_mm512_maskz_loadu_ps(active, buf.dy + i), fy); // image y gradient * fy. gradient in normalized plane
+        __m512 u = _mm512_maskz_loadu_ps(active, buf.u + i);
+        __m512 v = _mm512_maskz_loadu_ps(active, buf.v + i);
+        __m512 id = _mm512_maskz_loadu_ps(active, buf.idepth + i);
+
+        __m512 J[9];
+        // Same Jacobians as in calcGSSSE (dx, dy are the image gradients times fx, fy, i.e. in the normalized plane).
+        J[0] = _mm512_mul_ps(id, dx); // 1.0 / depth * di / dx * fx
+        J[1] = _mm512_mul_ps(id, dy); // 1.0 / depth * di / dy * fy
+        // -1.0 / depth * (u * di / dx * fx + v * di / dy * fy)
+        J[2] = _mm512_sub_ps(zero, _mm512_mul_ps(id, _mm512_add_ps(_mm512_mul_ps(u, dx), _mm512_mul_ps(v, dy))));
+        // -(u * v * di / dx * fx + di / dy * fy * (1.0 + v^2))
+        J[3] = _mm512_sub_ps(zero, _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(u, v), dx),
+                                                 _mm512_mul_ps(dy, _mm512_add_ps(one, _mm512_mul_ps(v, v)))));
+        // -(u * v * di / dy * fy + di / dx * fx * (1.0 + u^2))
+        J[4] = _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(u, v), dy),
+                             _mm512_mul_ps(dx, _mm512_add_ps(one, _mm512_mul_ps(u, u))));
+        J[5] = _mm512_sub_ps(_mm512_mul_ps(u, dy), _mm512_mul_ps(v, dx)); // u * di / dy * fy - v * di / dx * fx
+        // a * (b0 - i[x, y])
+        J[6] = _mm512_mul_ps(a, _mm512_sub_ps(b0, _mm512_maskz_loadu_ps(active, buf.refColor + i)));
+        J[7] = minusOne; // -1
+        J[8] = _mm512_maskz_loadu_ps(active, buf.residual + i);
+        __m512 w = _mm512_maskz_loadu_ps(active, buf.weight + i); // huber_weight
+
+        float* pt = data;
+        for(int r = 0; r < 9; r++)
+        {
+            __m512 Jw = _mm512_mul_ps(J[r], w);
+            for(int c = r; c < 9; c++)
+            {
+                _mm512_storeu_ps(pt, _mm512_add_ps(_mm512_loadu_ps(pt), _mm512_mul_ps(Jw, J[c])));
+                pt += 16;
+            }
+        }
+        acc.laneUpdateDone();
+    }
+    acc.finish();
+}
+
+#endif
+
+}
+
+CoarseResOutput calcResKernel(SimdLevel level, const CoarseResInput& in, CoarseWarpedBuffers& out,
+                              MinimalImageB3* resImage)
+{
+#if DSO_WIDE_SIMD
+    if(!resImage)
+    {
+        if(level == SimdLevel::AVX512) return calcResAVX512(in, out);
+        if(level == SimdLevel::AVX2) return calcResAVX2(in, out);
+    }
+#endif
+    return calcResSSE(in, out, resImage);
+}
+
+void calcGSKernel(SimdLevel level, const CoarseWarpedBuffers& buf, float fx, float fy, float a, float b0,
+                  Accumulator9& acc)
+{
+#if DSO_WIDE_SIMD
+    if(level == SimdLevel::AVX512) return calcGSAVX512(buf, fx, fy, a, b0, acc);
+    if(level == SimdLevel::AVX2) return calcGSAVX2(buf, fx, fy, a, b0, acc);
+#endif
+    calcGSSSE(buf, fx, fy, a, b0, acc);
+}
+
+}
@@ -0,0 +1,96 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef DMVIO_COARSETRACKERKERNELS_H
+#define DMVIO_COARSETRACKERKERNELS_H
+
+#include "util/NumType.h"
+#include "util/MinimalImage.h"
+#include "util/SimdDispatch.h"
+#include "OptimizationBackend/MatrixAccumulators.h"
+
+namespace dso
+{
+
+// Inner loops of CoarseTracker::calcRes and CoarseTracker::calcGSSSE, with one implementation per SimdLevel.
+// The SSE versions are the reference, the wide versions only differ in the summation order.
+
+// Warped points which are below the cutoff threshold. Filled by calcResKernel and padded with zeros to a
+// multiple of 4, consumed by calcGSKernel.
+struct CoarseWarpedBuffers
+{
+    float* idepth;
+    float* u;
+    float* v;
+    float* dx;
+    float* dy;
+    float* residual;
+    float* weight;
+    float* refColor;
+    int n;
+};
+
+struct CoarseResInput
+{
+    // Points of the reference frame.
+    const float* pcU;
+    const float* pcV;
+    const float* pcIdepth;
+    const float* pcColor;
+    int numPoints;
+
+    // Color and gradients of the new frame.
+    const Eigen::Vector3f* dINew;
+    int w, h;
+
+    Mat33f RKi;
+    Vec3f t;
+    float fx, fy, cx, cy;
+    Vec2f affLL;
+
+    float huberTH;
+    float cutoffTH;
+    float maxEnergy; // energy added for a residual above cutoffTH.
+};
+
+struct CoarseResOutput
+{
+    float E;
+    int numTermsInE;
+    int numSaturated;
+};
+
+// Projects all points into the new frame and computes the robust photometric energy, writes the points below the
+// cutoff to out. If resImage is set the residuals are also drawn into it (this always uses the SSE version).
+CoarseResOutput calcResKernel(SimdLevel level, const CoarseResInput& in, CoarseWarpedBuffers& out,
+                              MinimalImageB3* resImage = nullptr);
+
+// Accumulates the Gauss-Newton system of the buffers (not yet scaled) into acc.H, see Accumulator9::updateSSE_weighted
+// for the layout.
+void calcGSKernel(SimdLevel level, const CoarseWarpedBuffers& buf, float fx, float fy, float a, float b0,
+                  Accumulator9& acc);
+
+}
+
+#endif //DMVIO_COARSETRACKERKERNELS_H
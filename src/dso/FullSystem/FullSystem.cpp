@@ -75,7 +75,8 @@ FullSystem::FullSystem(bool linearizeOperationPassed, const dmvio::IMUCalibratio
     : linearizeOperation(linearizeOperationPassed), imuIntegration(&Hcalib, imuCalibration, imuSettings,
                                                                    linearizeOperation),
                      secondKeyframeDone(false), gravityInit(imuSettings.numMeasurementsGravityInit, imuCalibration),
-                     shellPoseMutex(FrameShell::shellPoseMutex)
+                     shellPoseMutex(FrameShell::shellPoseMutex),
+                     unmappedTrackedFrames(64)
 {
     setting_useGTSAMIntegration = setting_useIMU;
     baIntegration = imuIntegration.getBAGTSAMIntegration().get();
@@ -150,6 +151,7 @@ FullSystem::FullSystem(bool linearizeOperationPassed, const dmvio::IMUCalibratio
 	coarseTracker_forNewKF = new CoarseTracker(wG[0], hG[0], imuIntegration);
 	coarseInitializer = new CoarseInitializer(wG[0], hG[0]);
 	pixelSelector = new PixelSelector(wG[0], hG[0]);
+	imageBufferPool = std::make_shared<ImageBufferPool>();
 
 	statistics_lastNumOptIts=0;
 	statistics_numDroppedPoints=0;
@@ -206,10 +208,15 @@ FullSystem::~FullSystem()
 
 	delete[] selectionMap;
 
+	// the IMU initializer releases its frame shells when destroyed, so it has to go first.
+	imuIntegration.releaseInitializer();
 	for(FrameShell* s : allFrameHistory)
 		delete s;
-	for(FrameHessian* fh : unmappedTrackedFrames)
-		delete fh;
+	for(FrameShell* s : retiredKeyframeShells)
+		delete s;
+	FrameHessian* unmappedFrame;
+	while(unmappedTrackedFrames.tryPop(unmappedFrame))
+		delete unmappedFrame;
 
 	delete coarseDistanceMap;
 	delete coarseTracker;
@@ -217,6 +224,14 @@ FullSystem::~FullSystem()
 	delete coarseInitializer;
 	delete pixelSelector;
 	delete ef;
+
+	if(!setting_debugout_runquiet)
+	{
+		ImageBufferPool::Stats poolStats = imageBufferPool->getStats();
+		printf("Image buffer pool: %lld buffers allocated (%.1f MB), %lld reused, %lld released.\n",
+			   poolStats.numAllocated, poolStats.bytesAllocated / (1024.0 * 1024.0), poolStats.numReused,
+			   poolStats.numReleased);
+	}
 }
 
 void FullSystem::setOriginalCalib(const VecXf &originalCalib, int originalW, int originalH)
@@ -264,37 +279,124 @@ void FullSystem::printResult(std::string file, bool onlyLogKFPoses, bool saveMet
 
 	for(FrameShell* s : allFrameHistory)
 	{
-		if(!s->poseValid) continue;
+		writeResultLine(myfile, s, onlyLogKFPoses, saveMetricPoses, useCamToTrackingRef);
+	}
+	myfile.close();
+}
 
-		if(onlyLogKFPoses && s->marginalizedAt == s->id) continue;
+void FullSystem::writeResultLine(std::ostream& out, FrameShell* s, bool onlyLogKFPoses, bool saveMetricPoses,
+								 bool useCamToTrackingRef)
+{
+	if(!s->poseValid) return;
 
-        // firstPose is transformFirstToWorld. We actually want camToFirst here ->
-        Sophus::SE3d camToWorld = s->camToWorld;
+	if(onlyLogKFPoses && s->marginalizedAt == s->id) return;
 
-        // Use camToTrackingReference for nonKFs and the updated camToWorld for KFs.
-        if(useCamToTrackingRef && s->keyframeId == -1)
-        {
-            camToWorld = s->trackingRef->camToWorld * s->camToTrackingRef;
-        }
-        Sophus::SE3d camToFirst = firstPose.inverse() * camToWorld;
+	// firstPose is transformFirstToWorld. We actually want camToFirst here ->
+	Sophus::SE3d camToWorld = s->camToWorld;
 
-        if(saveMetricPoses)
-        {
-            // Transform pose to IMU frame.
-            // not actually camToFirst any more...
-            camToFirst = Sophus::SE3d(imuIntegration.getTransformDSOToIMU().transformPose(camToWorld.inverse().matrix()));
-        }
+	// Use camToTrackingReference for nonKFs and the updated camToWorld for KFs.
+	if(useCamToTrackingRef && s->keyframeId == -1)
+	{
+		camToWorld = s->trackingRef->camToWorld * s->camToTrackingRef;
+	}
+	Sophus::SE3d camToFirst = firstPose.inverse() * camToWorld;
 
-		myfile << s->timestamp <<
-			" " << camToFirst.translation().x() <<
-            " " << camToFirst.translation().y() <<
-            " " << camToFirst.translation().z() <<
-			" " << camToFirst.so3().unit_quaternion().x()<<
-			" " << camToFirst.so3().unit_quaternion().y()<<
-			" " << camToFirst.so3().unit_quaternion().z()<<
-			" " << camToFirst.unit_quaternion().w() << "\n";
+	if(saveMetricPoses)
+	{
+		// Transform pose to IMU frame.
+		// not actually camToFirst any more...
+		camToFirst = Sophus::SE3d(imuIntegration.getTransformDSOToIMU().transformPose(camToWorld.inverse().matrix()));
+	}
+
+	out << s->timestamp <<
+		" " << camToFirst.translation().x() <<
+		" " << camToFirst.translation().y() <<
+		" " << camToFirst.translation().z() <<
+		" " << camToFirst.so3().unit_quaternion().x()<<
+		" " << camToFirst.so3().unit_quaternion().y()<<
+		" " << camToFirst.so3().unit_quaternion().z()<<
+		" " << camToFirst.unit_quaternion().w() << "\n";
+}
+
+void FullSystem::addResultStream(std::string file, bool onlyLogKFPoses, bool useCamToTrackingRef)
+{
+	boost::unique_lock<boost::mutex> lock(trackMutex);
+	assert(allFrameHistory.empty());
+	std::unique_ptr<ResultStream> stream(new ResultStream());
+	stream->out.open(file.c_str());
+	stream->out << std::setprecision(15);
+	stream->onlyLogKFPoses = onlyLogKFPoses;
+	stream->useCamToTrackingRef = useCamToTrackingRef;
+	resultStreams.push_back(std::move(stream));
+}
+
+void FullSystem::finishResultStreams()
+{
+	boost::unique_lock<boost::mutex> lock(trackMutex);
+	boost::unique_lock<boost::mutex> crlock(shellPoseMutex);
+	for(auto&& stream : resultStreams)
+	{
+		for(FrameShell* s : allFrameHistory)
+			writeResultLine(stream->out, s, stream->onlyLogKFPoses, false, stream->useCamToTrackingRef);
+		stream->out.close();
+	}
+	resultStreams.clear();
+}
+
+// Writes and releases the oldest frames whose pose cannot change any more. Called by the tracking thread (with trackMutex).
+void FullSystem::spillFinalFrameShells()
+{
+	boost::unique_lock<boost::mutex> crlock(shellPoseMutex);
+	int mappedId = lastMappedFrameId;
+
+	auto isFinal = [&](FrameShell* s)
+	{
+		if(s->id > mappedId) return false;
+		// frames dropped during initialization are never written.
+		if(!s->poseValid) return true;
+		// KFs are final once marginalized (then marginalizedAt is set to a later frame), other frames once their reference is.
+		if(s->keyframeId != -1) return s->marginalizedAt != s->id;
+		return s->trackingRef != nullptr && s->trackingRef->marginalizedAt != s->trackingRef->id;
+	};
+
+	// always keep the last frames, which are used for the motion model in trackNewCoarse.
+	// Shells still referenced by the IMU initializer stop the release, which also keeps their tracking references alive.
+	while(allFrameHistory.size() > 3 && allFrameHistory.front()->numExternalRefs == 0 && isFinal(allFrameHistory.front()))
+	{
+		FrameShell* s = allFrameHistory.front();
+		for(auto&& stream : resultStreams)
+			writeResultLine(stream->out, s, stream->onlyLogKFPoses, false, stream->useCamToTrackingRef);
+		allFrameHistory.pop_front();
+		frameHistoryOffset++;
+
+		if(s->keyframeId != -1)
+			retiredKeyframeShells.push_back(s);
+		else
+			delete s;
+	}
+
+	// tracking references only increase with the frame id, so retired KFs older than the reference of the oldest
+	// remaining frame are not referenced any more.
+	FrameShell* oldestRef = allFrameHistory.front()->trackingRef;
+	while(!retiredKeyframeShells.empty() && oldestRef != nullptr && retiredKeyframeShells.front()->id < oldestRef->id)
+	{
+		delete retiredKeyframeShells.front();
+		retiredKeyframeShells.pop_front();
+	}
+}
+
+void FullSystem::addToKeyframeHistory(FrameShell* shell)
+{
+	allKeyFramesHistory.push_back(shell);
+	// with result streams older shells can be released, and only the latest KF is ever accessed.
+	if(!resultStreams.empty())
+	{
+		while(allKeyFramesHistory.size() > 1)
+		{
+			allKeyFramesHistory.pop_front();
+			keyframeHistoryOffset++;
+		}
 	}
-	myfile.close();
 }
 
 std::pair<Vec4, bool> FullSystem::trackNewCoarse(FrameHessian* frame_hessian, Sophus::SE3d *referenceToFrameHint)
@@ -331,7 +433,8 @@ std::pair<Vec4, bool> FullSystem::trackNewCoarse(FrameHessian* frame_hessian, So
                     aff_last_2_l = slast->aff_g2l; // init the photometri parameters??
                     break;
                 }
-                if(slast->trackingRef != lastF->shell)
+                // released frames (see spillFinalFrameShells) have a marginalized tracking ref, so they can't match.
+                if(slast->trackingRef != lastF->shell || (i == 0 && frameHistoryOffset > 0))
                 {
                     std::cout << "WARNING: No well tracked frame with the same tracking ref available!" << std::endl;
                     aff_last_2_l = lastF->aff_g2l();
@@ -343,7 +446,7 @@ std::pair<Vec4, bool> FullSystem::trackNewCoarse(FrameHessian* frame_hessian, So
 
     if(!referenceToFrameHint)
     {
-        if(allFrameHistory.size() == 2)
+        if(numFramesAdded() == 2)
             for(unsigned int i=0;i<lastF_2_fh_tries.size();i++) lastF_2_fh_tries.push_back(SE3d());
         else
         {
@@ -423,14 +526,52 @@ std::pair<Vec4, bool> FullSystem::trackNewCoarse(FrameHessian* frame_hessian, So
 	Vec5 achievedRes = Vec5::Constant(NAN);
 	bool haveOneGood = false;
 	int tryIterations=0;
+
+	// The hypotheses can be tracked in parallel, a batch at a time: They are tracked against the achievedRes at the
+	// start of the batch, and checked against the tighter achievedRes of their turn afterwards, which gives the same
+	// result as tracking them one after another. The IMU coarse graph is shared between tries, so it has to be sequential.
+	bool parallelTries = setting_coarseTrackingParallelTries && lastF_2_fh_tries.size() > 1 &&
+			!(setting_useIMU && imuIntegration.isCoarseInitialized());
+	if(parallelTries && !coarseTrackingThreadReduce)
+		coarseTrackingThreadReduce.reset(new IndexThreadReduce<Vec10>());
+	std::vector<CoarseTrackingResult, Eigen::aligned_allocator<CoarseTrackingResult>> batchResults;
+	int batchBegin = 0, batchEnd = 0;
+
 	for(unsigned int i=0;i<lastF_2_fh_tries.size();i++)
 	{
 		AffLight aff_g2l_this = aff_last_2_l;
 		SE3d lastF_2_fh_this = lastF_2_fh_tries[i];
-		bool trackingIsGood = coarseTracker->trackNewestCoarse(
-				frame_hessian, lastF_2_fh_this, aff_g2l_this,
-				pyrLevelsUsed-1,
-				achievedRes);	// in each level has to be at least as good as the last try.
+		bool trackingIsGood;
+		Vec5 lastResiduals;
+		Vec3 lastFlowIndicators;
+		if(parallelTries)
+		{
+			if((int)i >= batchEnd)
+			{
+				batchBegin = i;
+				batchEnd = std::min((int)lastF_2_fh_tries.size(), batchBegin + coarseTrackingThreadReduce->getNumThreads());
+				coarseTracker->trackNewestCoarseBatch(frame_hessian, lastF_2_fh_tries, aff_last_2_l, batchBegin, batchEnd,
+													  pyrLevelsUsed-1, achievedRes, batchResults, *coarseTrackingThreadReduce);
+			}
+			CoarseTrackingResult& result = batchResults[i - batchBegin];
+			bool notAborted = CoarseTracker::applyAbortThreshold(result, pyrLevelsUsed-1, achievedRes);
+			if(notAborted)
+			{
+				lastF_2_fh_this = result.lastToNew;
+				aff_g2l_this = result.aff_g2l;
+			}
+			trackingIsGood = notAborted && result.trackingGood;
+			lastResiduals = result.residuals;
+			lastFlowIndicators = result.flowIndicators;
+		}else
+		{
+			trackingIsGood = coarseTracker->trackNewestCoarse(
+					frame_hessian, lastF_2_fh_this, aff_g2l_this,
+					pyrLevelsUsed-1,
+					achievedRes);	// in each level has to be at least as good as the last try.
+			lastResiduals = coarseTracker->lastResiduals;
+			lastFlowIndicators = coarseTracker->lastFlowIndicators;
+		}
 		tryIterations++;
 
 		if(trackingIsGood)
@@ -455,18 +596,18 @@ std::pair<Vec4, bool> FullSystem::trackNewCoarse(FrameHessian* frame_hessian, So
 					achievedRes[2],
 					achievedRes[3],
 					achievedRes[4],
-					coarseTracker->lastResiduals[0],
-					coarseTracker->lastResiduals[1],
-					coarseTracker->lastResiduals[2],
-					coarseTracker->lastResiduals[3],
-					coarseTracker->lastResiduals[4]);
+					lastResiduals[0],
+					lastResiduals[1],
+					lastResiduals[2],
+					lastResiduals[3],
+					lastResiduals[4]);
 		}
 
 
 		// do we have a new winner?
-		if(trackingIsGood && std::isfinite((float)coarseTracker->lastResiduals[0]) && !(coarseTracker->lastResiduals[0] >=  achievedRes[0]))
+		if(trackingIsGood && std::isfinite((float)lastResiduals[0]) && !(lastResiduals[0] >=  achievedRes[0]))
 		{
-			flowVecs = coarseTracker->lastFlowIndicators;
+			flowVecs = lastFlowIndicators;
 			aff_g2l = aff_g2l_this;
 			lastF_2_fh = lastF_2_fh_this;
 			haveOneGood = true;
@@ -477,8 +618,8 @@ std::pair<Vec4, bool> FullSystem::trackNewCoarse(FrameHessian* frame_hessian, So
 		{
 			for(int i=0;i<5;i++)
 			{
-				if(!std::isfinite((float)achievedRes[i]) || achievedRes[i] > coarseTracker->lastResiduals[i])	// take over if achievedRes is either bigger or NAN.
-					achievedRes[i] = coarseTracker->lastResiduals[i];
+				if(!std::isfinite((float)achievedRes[i]) || achievedRes[i] > lastResiduals[i])	// take over if achievedRes is either bigger or NAN.
+					achievedRes[i] = lastResiduals[i];
 			}
 		}
 
@@ -551,28 +692,43 @@ void FullSystem::traceNewCoarse(FrameHessian* fh)
 	K(0,2) = Hcalib.cxl();
 	K(1,2) = Hcalib.cyl();
 
+	// the points are traced independently, so all points of all hosts are distributed over the threads.
+	std::vector<TraceHost> hosts;
+	hosts.reserve(frameHessians.size());
+	std::vector<std::pair<ImmaturePoint*, const TraceHost*>> toTrace;
 	for(FrameHessian* host : frameHessians)		// go through all active frames
 	{
 
 		SE3d hostToNew = fh->PRE_worldToCam * host->PRE_camToWorld;
-		Mat33f KRKi = K * hostToNew.rotationMatrix().cast<float>() * K.inverse();
-		Vec3f Kt = K * hostToNew.translation().cast<float>();
+		TraceHost traceHost;
+		traceHost.KRKi = K * hostToNew.rotationMatrix().cast<float>() * K.inverse();
+		traceHost.Kt = K * hostToNew.translation().cast<float>();
 
-		Vec2f aff = AffLight::fromToVecExposure(host->ab_exposure, fh->ab_exposure, host->aff_g2l(), fh->aff_g2l()).cast<float>();
+		traceHost.aff = AffLight::fromToVecExposure(host->ab_exposure, fh->ab_exposure, host->aff_g2l(), fh->aff_g2l()).cast<float>();
+		hosts.push_back(traceHost);
 
 		for(ImmaturePoint* ph : host->immaturePoints)
-		{
-			ph->traceOn(fh, KRKi, Kt, aff, &Hcalib, false );
-
-			if(ph->lastTraceStatus==ImmaturePointStatus::IPS_GOOD) trace_good++;
-			if(ph->lastTraceStatus==ImmaturePointStatus::IPS_BADCONDITION) trace_badcondition++;
-			if(ph->lastTraceStatus==ImmaturePointStatus::IPS_OOB) trace_oob++;
-			if(ph->lastTraceStatus==ImmaturePointStatus::IPS_OUTLIER) trace_out++;
-			if(ph->lastTraceStatus==ImmaturePointStatus::IPS_SKIPPED) trace_skip++;
-			if(ph->lastTraceStatus==ImmaturePointStatus::IPS_UNINITIALIZED) trace_uninitialized++;
-			trace_total++;
-		}
+			toTrace.push_back(std::make_pair(ph, &hosts.back()));
+	}
+
+	Vec10 stats;
+	if(multiThreading)
+	{
+		treadReduce.reduce(boost::bind(&FullSystem::traceNewCoarse_Reductor, this, fh, &toTrace, _1, _2, _3, _4), 0, toTrace.size(), 50);
+		stats = treadReduce.stats;
+	}
+	else
+	{
+		stats.setZero();
+		traceNewCoarse_Reductor(fh, &toTrace, 0, toTrace.size(), &stats, 0);
 	}
+	trace_good = stats[0];
+	trace_badcondition = stats[1];
+	trace_oob = stats[2];
+	trace_out = stats[3];
+	trace_skip = stats[4];
+	trace_uninitialized = stats[5];
+	trace_total = toTrace.size();
 //	printf("ADD: TRACE: %'d points. %'d (%.0f%%) good. %'d (%.0f%%) skip. %'d (%.0f%%) badcond. %'d (%.0f%%) oob. %'d (%.0f%%) out. %'d (%.0f%%) uninit.\n",
 //			trace_total,
 //			trace_good, 100*trace_good/(float)trace_total,
@@ -586,6 +742,24 @@ void FullSystem::traceNewCoarse(FrameHessian* fh)
 
 
 
+void FullSystem::traceNewCoarse_Reductor(FrameHessian* fh, std::vector<std::pair<ImmaturePoint*, const TraceHost*>>* toTrace, int min, int max, Vec10* stats, int tid)
+{
+	for(int k=min;k<max;k++)
+	{
+		ImmaturePoint* ph = (*toTrace)[k].first;
+		const TraceHost* host = (*toTrace)[k].second;
+		ph->traceOn(fh, host->KRKi, host->Kt, host->aff, &Hcalib, false );
+
+		if(ph->lastTraceStatus==ImmaturePointStatus::IPS_GOOD) (*stats)[0]++;
+		if(ph->lastTraceStatus==ImmaturePointStatus::IPS_BADCONDITION) (*stats)[1]++;
+		if(ph->lastTraceStatus==ImmaturePointStatus::IPS_OOB) (*stats)[2]++;
+		if(ph->lastTraceStatus==ImmaturePointStatus::IPS_OUTLIER) (*stats)[3]++;
+		if(ph->lastTraceStatus==ImmaturePointStatus::IPS_SKIPPED) (*stats)[4]++;
+		if(ph->lastTraceStatus==ImmaturePointStatus::IPS_UNINITIALIZED) (*stats)[5]++;
+	}
+}
+
+
 void FullSystem::activatePointsMT_Reductor(
 		std::vector<PointHessian*>* optimized,
 		std::vector<ImmaturePoint*>* toOptimize,
@@ -608,23 +782,24 @@ void FullSystem::activatePointsMT_Reductor(
 void FullSystem::activatePointsMT()
 {
     dmvio::TimeMeasurement timeMeasurement("activatePointsMT");
+	float desiredPointDensity = setting_desiredPointDensity * mappingBackpressure.pointDensityFactor();
 
-    if(ef->nPoints < setting_desiredPointDensity*0.66)
+    if(ef->nPoints < desiredPointDensity*0.66)
 		currentMinActDist -= 0.8;
-	if(ef->nPoints < setting_desiredPointDensity*0.8)
+	if(ef->nPoints < desiredPointDensity*0.8)
 		currentMinActDist -= 0.5;
-	else if(ef->nPoints < setting_desiredPointDensity*0.9)
+	else if(ef->nPoints < desiredPointDensity*0.9)
 		currentMinActDist -= 0.2;
-	else if(ef->nPoints < setting_desiredPointDensity)
+	else if(ef->nPoints < desiredPointDensity)
 		currentMinActDist -= 0.1;
 
-	if(ef->nPoints > setting_desiredPointDensity*1.5)
+	if(ef->nPoints > desiredPointDensity*1.5)
 		currentMinActDist += 0.8;
-	if(ef->nPoints > setting_desiredPointDensity*1.3)
+	if(ef->nPoints > desiredPointDensity*1.3)
 		currentMinActDist += 0.5;
-	if(ef->nPoints > setting_desiredPointDensity*1.15)
+	if(ef->nPoints > desiredPointDensity*1.15)
 		currentMinActDist += 0.2;
-	if(ef->nPoints > setting_desiredPointDensity)
+	if(ef->nPoints > desiredPointDensity)
 		currentMinActDist += 0.1;
 
 	if(currentMinActDist < 0) currentMinActDist = 0;
@@ -632,7 +807,7 @@ void FullSystem::activatePointsMT()
 
     if(!setting_debugout_runquiet)
         printf("SPARSITY:  MinActDist %f (need %d points, have %d points)!\n",
-                currentMinActDist, (int)(setting_desiredPointDensity), ef->nPoints);
+                currentMinActDist, (int)(desiredPointDensity), ef->nPoints);
 
 
 
@@ -640,7 +815,8 @@ void FullSystem::activatePointsMT()
 
 	// make dist map.
 	coarseDistanceMap->makeK(&Hcalib); // prepare some values for future calculation
-	coarseDistanceMap->makeDistanceMap(frameHessians, latest_frame_hessian); // get the distance map by BFS
+	coarseDistanceMap->makeDistanceMap(frameHessians, latest_frame_hessian,
+									   multiThreading ? &treadReduce : nullptr); // get the distance map
 
 	//coarseTracker->debugPlotDistMap("distMap");
 
@@ -900,17 +1076,20 @@ void FullSystem::addActiveFrame(ImageAndExposure* image, int id, dmvio::IMUData*
 	FrameShell* shell = new FrameShell();
 	shell->camToWorld = SE3d(); 		// no lock required, as frame_hessian is not used anywhere yet.
 	shell->aff_g2l = AffLight(0,0);
-    shell->marginalizedAt = allFrameHistory.size();
-	shell->id = allFrameHistory.size();
+    shell->marginalizedAt = numFramesAdded();
+	shell->id = numFramesAdded();
     shell->timestamp = image->timestamp;
     shell->incoming_id = id;
 	frame_hessian->shell = shell;
 	allFrameHistory.push_back(shell);
+	if(!resultStreams.empty())
+		spillFinalFrameShells();
+    dmvio::TimeMeasurement::setFrameId(shell->id);
 
 
     // =========================== make Images / derivatives etc. =========================
 	frame_hessian->ab_exposure = image->exposure_time;
-	frame_hessian->makeImages(image->image, &Hcalib); // create frame and get image gradient
+	frame_hessian->makeImages(image->image, &Hcalib, imageBufferPool); // create frame and get image gradient
 
     measureInit.end();
 
@@ -1049,7 +1228,7 @@ void FullSystem::addActiveFrame(ImageAndExposure* image, int id, dmvio::IMUData*
 		bool needToMakeKF = false;
 		if(setting_keyframesPerSecond > 0)
 		{
-			needToMakeKF = allFrameHistory.size()== 1 ||
+			needToMakeKF = numFramesAdded()== 1 ||
 					(frame_hessian->shell->timestamp - allKeyFramesHistory.back()->timestamp) > 0.95f/setting_keyframesPerSecond;
 		}
 		else
@@ -1058,7 +1237,7 @@ void FullSystem::addActiveFrame(ImageAndExposure* image, int id, dmvio::IMUData*
 					coarseTracker->lastRef_aff_g2l, frame_hessian->shell->aff_g2l);
 
 			// BRIGHTNESS CHECK
-			needToMakeKF = allFrameHistory.size()== 1 ||
+			needToMakeKF = numFramesAdded()== 1 ||
 					setting_kfGlobalWeight*setting_maxShiftWeightT *  sqrtf((double)tres[1]) / (wG[0]+hG[0]) +
 					setting_kfGlobalWeight*setting_maxShiftWeightR *  sqrtf((double)tres[2]) / (wG[0]+hG[0]) +
 					setting_kfGlobalWeight*setting_maxShiftWeightRT * sqrtf((double)tres[3]) / (wG[0]+hG[0]) +
@@ -1196,8 +1375,17 @@ void FullSystem::deliverTrackedFrame(FrameHessian* fh, bool needKF)
 	}
 	else
 	{
+		// Wait for space before taking trackMapSyncMutex, because the mapping thread needs it to finish a frame.
+		// As only this thread pushes, there is still space after locking.
+		unmappedTrackedFrames.waitForSpace();
 		boost::unique_lock<boost::mutex> lock(trackMapSyncMutex);
-		unmappedTrackedFrames.push_back(fh);
+		mappingBackpressure.frameDelivered(fh->shell->timestamp);
+		if(!unmappedTrackedFrames.tryPush(fh))
+		{
+			// Only possible if the mapping has already been stopped.
+			delete fh;
+			return;
+		}
 
 		// If the prepared KF is still in the queue right now the current frame will become a KF instead.
 		if(alreadyPreparedKF && !imuIntegration.isPreparedKFCreated())
@@ -1213,8 +1401,9 @@ void FullSystem::deliverTrackedFrame(FrameHessian* fh, bool needKF)
         {
              if(needKF) needNewKFAfter=fh->shell->trackingRef->id;
         }
-		trackedFrameSignal.notify_all();
+		dmvio::TimeMeasurement::recordCounter("mappingQueueDepth", unmappedTrackedFrames.size());
 
+		// only happens until the first KF is mapped.
 		while(coarseTracker_forNewKF->refFrameID == -1 && coarseTracker->refFrameID == -1 )
 		{
 			mappedFrameSignal.wait(lock);
@@ -1226,26 +1415,31 @@ void FullSystem::deliverTrackedFrame(FrameHessian* fh, bool needKF)
 
 void FullSystem::mappingLoop()
 {
-	boost::unique_lock<boost::mutex> lock(trackMapSyncMutex);
+    dmvio::TimeMeasurement::setThreadName("mapping");
 
+	FrameHessian* frame_hessian;
 	while(runMapping)
 	{
-		while(unmappedTrackedFrames.size()==0)
+		// returns false only if blockUntilMappingIsFinished was called.
+		if(!unmappedTrackedFrames.waitPop(frame_hessian)) break;
+		if(!runMapping)
 		{
-			trackedFrameSignal.wait(lock);
-			if(!runMapping) return;
+			delete frame_hessian;
+			break;
 		}
-
-		FrameHessian* frame_hessian = unmappedTrackedFrames.front();
-		unmappedTrackedFrames.pop_front();
+        dmvio::TimeMeasurement::setFrameId(frame_hessian->shell->id);
 
         if(!setting_debugout_runquiet)
         {
             std::cout << "Current mapping id: " << frame_hessian->shell->id << " create KF after: " << needNewKFAfter << std::endl;
         }
 
+		mappingBackpressure.update(frame_hessian->shell->timestamp, unmappedTrackedFrames.size());
+
+		boost::unique_lock<boost::mutex> lock(trackMapSyncMutex);
+
         // guaranteed to make a KF for the very first two tracked frames.
-		if(allKeyFramesHistory.size() <= 2)
+		if(numKeyframesAdded() <= 2)
 		{
             if(setting_useIMU)
             {
@@ -1253,77 +1447,66 @@ void FullSystem::mappingLoop()
             }
             lock.unlock();
 			makeKeyFrame(frame_hessian);
-			lock.lock();
-			mappedFrameSignal.notify_all();
+			notifyFrameMapped();
 			continue;
 		}
 
-		if(unmappedTrackedFrames.size() > 3)
+		size_t queuedFrames = unmappedTrackedFrames.size();
+		if(queuedFrames > 3 && setting_mappingBackpressure == 0)
 			needToKetchupMapping=true;
 
-
-		if(unmappedTrackedFrames.size() > 0) // if there are other frames to track, do that first.
+		// The IMU integration has already been prepared for this KF, so it is created even if newer frames are queued.
+		bool preparedKF = setting_useIMU && needNewKFAfter == frame_hessian->shell->id;
+		if(queuedFrames > 0 && preparedKF && !dso::setting_debugout_runquiet)
 		{
+			std::cout << "WARNING: Prepared keyframe is not the newest frame, creating it anyway." << std::endl;
+		}
 
-			if(setting_useIMU && needNewKFAfter == frame_hessian->shell->id)
+		bool requestedKF = setting_useIMU ? needNewKFAfter==frame_hessian->shell->id : needNewKFAfter >= frameHessians.back()->shell->id;
+		if(mappingBackpressure.makeKeyframe(queuedFrames, preparedKF, requestedKF))
+		{
+			if(setting_useIMU)
 			{
-                if(!dso::setting_debugout_runquiet)
-                {
-                    std::cout << "WARNING: Prepared keyframe got skipped!" << std::endl;
-                }
-                imuIntegration.skipPreparedKeyframe();
-				assert(false);
+				imuIntegration.keyframeCreated(frame_hessian->shell->id);
 			}
-
+			lock.unlock();
+			makeKeyFrame(frame_hessian);
+			needToKetchupMapping=false;
+		}
+		else
+		{
 			lock.unlock();
 			makeNonKeyFrame(frame_hessian);
-			lock.lock();
 
-			if(needToKetchupMapping && unmappedTrackedFrames.size() > 0)
+			if(queuedFrames > 0 && needToKetchupMapping && unmappedTrackedFrames.tryPop(frame_hessian))
 			{
-				FrameHessian* frame_hessian = unmappedTrackedFrames.front();
-				unmappedTrackedFrames.pop_front();
+                dmvio::TimeMeasurement::setFrameId(frame_hessian->shell->id);
 				{
 					boost::unique_lock<boost::mutex> crlock(shellPoseMutex);
 					assert(frame_hessian->shell->trackingRef != 0);
 					frame_hessian->shell->camToWorld = frame_hessian->shell->trackingRef->camToWorld * frame_hessian->shell->camToTrackingRef;
 					frame_hessian->setEvalPT_scaled(frame_hessian->shell->camToWorld.inverse(),frame_hessian->shell->aff_g2l);
 				}
+				lastMappedFrameId = frame_hessian->shell->id;
 				delete frame_hessian;
 			}
 		}
-		else
-		{
-		    bool createKF = setting_useIMU ? needNewKFAfter==frame_hessian->shell->id : needNewKFAfter >= frameHessians.back()->shell->id;
-			if(setting_realTimeMaxKF || createKF)
-			{
-                if(setting_useIMU)
-                {
-                    imuIntegration.keyframeCreated(frame_hessian->shell->id);
-                }
-                lock.unlock();
-				makeKeyFrame(frame_hessian);
-				needToKetchupMapping=false;
-				lock.lock();
-			}
-			else
-			{
-				lock.unlock();
-				makeNonKeyFrame(frame_hessian);
-				lock.lock();
-			}
-		}
-		mappedFrameSignal.notify_all();
+		notifyFrameMapped();
 	}
 	printf("MAPPING FINISHED!\n");
 }
 
-void FullSystem::blockUntilMappingIsFinished()
+void FullSystem::notifyFrameMapped()
 {
+	// the lock makes sure that the tracking thread is either waiting already or has not checked its condition yet.
 	boost::unique_lock<boost::mutex> lock(trackMapSyncMutex);
+	mappedFrameSignal.notify_all();
+}
+
+void FullSystem::blockUntilMappingIsFinished()
+{
 	runMapping = false;
-	trackedFrameSignal.notify_all();
-	lock.unlock();
+	unmappedTrackedFrames.interrupt();
 
 	mappingThread.join();
 
@@ -1340,8 +1523,11 @@ void FullSystem::makeNonKeyFrame( FrameHessian* fh)
 		fh->setEvalPT_scaled(fh->shell->camToWorld.inverse(),fh->shell->aff_g2l);
 	}
 
-	traceNewCoarse(fh);
+	int id = fh->shell->id;
+	if(mappingBackpressure.traceNonKeyframes())
+		traceNewCoarse(fh);
 	delete fh;
+	lastMappedFrameId = id;
 }
 
 void FullSystem::makeKeyFrame( FrameHessian* new_frame_hessian)
@@ -1373,9 +1559,9 @@ void FullSystem::makeKeyFrame( FrameHessian* new_frame_hessian)
     dmvio::TimeMeasurement timeMeasurementAddFrame("newFrameAndNewResidualsForOldPoints");
 	new_frame_hessian->idx = frameHessians.size();
 	frameHessians.push_back(new_frame_hessian);
-	new_frame_hessian->frameID = allKeyFramesHistory.size();
+	new_frame_hessian->frameID = numKeyframesAdded();
     new_frame_hessian->shell->keyframeId = new_frame_hessian->frameID;
-	allKeyFramesHistory.push_back(new_frame_hessian->shell);
+	addToKeyframeHistory(new_frame_hessian->shell);
 	ef->insertFrame(new_frame_hessian, &Hcalib); // insert key frame and prepare some matrix. but not the final matrix to solve
 
 	setPrecalcValues(); // pre calc some values including FEJ things
@@ -1389,7 +1575,7 @@ void FullSystem::makeKeyFrame( FrameHessian* new_frame_hessian)
 		if(frame_hessian == new_frame_hessian) continue;
 		for(PointHessian* point_hessian : frame_hessian->pointHessians) // all points in a frame
 		{
-			PointFrameResidual* r = new PointFrameResidual(point_hessian, frame_hessian, new_frame_hessian); // meta information about the residual. host, target and point
+			PointFrameResidual* r = new (residualAllocator) PointFrameResidual(point_hessian, frame_hessian, new_frame_hessian); // meta information about the residual. host, target and point
 			r->setState(ResState::IN);
 			point_hessian->residuals.push_back(r);
 			ef->insertResidual(r);	// add residual into system
@@ -1418,25 +1604,26 @@ void FullSystem::makeKeyFrame( FrameHessian* new_frame_hessian)
 	// =========================== OPTIMIZE ALL =========================
 
 	new_frame_hessian->frameEnergyTH = frameHessians.back()->frameEnergyTH;
-	float rmse = optimize(setting_maxOptIterations); //have to read carefully
+	float rmse = optimize(mappingBackpressure.maxOptIterations(setting_maxOptIterations),
+						  mappingBackpressure.optimizationBudgetMs()); //have to read carefully
 
 
 
 
 	// =========================== Figure Out if INITIALIZATION FAILED =========================
-	if(allKeyFramesHistory.size() <= 4)
+	if(numKeyframesAdded() <= 4)
 	{
-		if(allKeyFramesHistory.size()==2 && rmse > 20*benchmark_initializerSlackFactor)
+		if(numKeyframesAdded()==2 && rmse > 20*benchmark_initializerSlackFactor)
 		{
 			printf("I THINK INITIALIZATINO FAILED! Resetting.\n");
 			initFailed=true;
 		}
-		if(allKeyFramesHistory.size()==3 && rmse > 13*benchmark_initializerSlackFactor)
+		if(numKeyframesAdded()==3 && rmse > 13*benchmark_initializerSlackFactor)
 		{
 			printf("I THINK INITIALIZATINO FAILED! Resetting.\n");
 			initFailed=true;
 		}
-		if(allKeyFramesHistory.size()==4 && rmse > 9*benchmark_initializerSlackFactor)
+		if(numKeyframesAdded()==4 && rmse > 9*benchmark_initializerSlackFactor)
 		{
 			printf("I THINK INITIALIZATINO FAILED! Resetting.\n");
 			initFailed=true;
@@ -1547,6 +1734,8 @@ void FullSystem::makeKeyFrame( FrameHessian* new_frame_hessian)
     {
         imuIntegration.finishKeyframeOperations(new_frame_hessian->shell->id);
     }
+
+	lastMappedFrameId = new_frame_hessian->shell->id;
 }
 
 
@@ -1558,8 +1747,8 @@ void FullSystem::initializeFromInitializer(FrameHessian* newFrame)
 	FrameHessian* firstFrame = coarseInitializer->firstFrame;
 	firstFrame->idx = frameHessians.size();
 	frameHessians.push_back(firstFrame);
-	firstFrame->frameID = allKeyFramesHistory.size();
-	allKeyFramesHistory.push_back(firstFrame->shell);
+	firstFrame->frameID = numKeyframesAdded();
+	addToKeyframeHistory(firstFrame->shell);
 	ef->insertFrame(firstFrame, &Hcalib);
 	setPrecalcValues();
 
@@ -1651,8 +1840,10 @@ void FullSystem::makeNewPoints(FrameHessian* newFrame, float* gtDepth)
 {
     dmvio::TimeMeasurement timeMeasurement("makeNewPoints");
 	pixelSelector->allowFast = true;
+	pixelSelector->threadReduce = multiThreading ? &treadReduce : nullptr;
 	//int numPointsTotal = makePixelStatus(newFrame->dI, selectionMap, wG[0], hG[0], setting_desiredDensity);
-	int numPointsTotal = pixelSelector->makeMaps(newFrame, selectionMap,setting_desiredImmatureNum);
+	int numPointsTotal = pixelSelector->makeMaps(newFrame, selectionMap,
+												 setting_desiredImmatureNum * mappingBackpressure.pointDensityFactor());
 
 	newFrame->pointHessians.reserve(numPointsTotal*1.2f);
 	//fh->pointHessiansInactive.reserve(numPointsTotal*1.2f);
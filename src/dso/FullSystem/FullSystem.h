@@ -28,6 +28,8 @@
 #define MAX_ACTIVE_FRAMES 100
 
 #include <deque>
+#include <memory>
+#include <atomic>
 #include "util/NumType.h"
 #include "util/globalCalib.h"
 #include "vector"
@@ -36,9 +38,12 @@
 #include <fstream>
 #include "util/NumType.h"
 #include "FullSystem/Residuals.h"
+#include "FullSystem/ResidualBlockTable.h"
+#include "FullSystem/MappingBackpressure.h"
 #include "FullSystem/HessianBlocks.h"
 #include "util/FrameShell.h"
 #include "util/IndexThreadReduce.h"
+#include "util/SPSCQueue.h"
 #include "OptimizationBackend/EnergyFunctional.h"
 #include "FullSystem/PixelSelector2.h"
 #include "IMU/IMUIntegration.hpp"
@@ -155,10 +160,20 @@ public:
 	void marginalizeFrame(FrameHessian* frame);
 	void blockUntilMappingIsFinished();
 
-	float optimize(int mnumOptIts);
+	// budgetMs: time budget for the GN iterations (0 = unlimited). At least setting_minOptIterations are always done.
+	float optimize(int mnumOptIts, double budgetMs = 0);
 
 	void printResult(std::string file, bool onlyLogKFPoses, bool saveMetricPoses, bool useCamToTrackingRef);
 
+	// Bounded memory mode: the pose of each frame is appended to file (same format as printResult) as soon as it is
+	// final, i.e. once its tracking reference KF (or for KFs the frame itself) has been marginalized, and the FrameShell
+	// is released afterwards. printResult then only contains the frames that are still in memory.
+	// Metric poses are not supported, as the transformation to the IMU frame is only final at the end.
+	// Must be called before the first frame is added.
+	void addResultStream(std::string file, bool onlyLogKFPoses, bool useCamToTrackingRef);
+	// writes the remaining frames to all result streams and closes them (after blockUntilMappingIsFinished).
+	void finishResultStreams();
+
 	void debugPlot(std::string name);
 
 	void printFrameLifetimes();
@@ -230,6 +245,14 @@ private:
 	double calcMEnergy(bool useNewValues);
 	void linearizeAll_Reductor(bool fixLinearization, std::vector<PointFrameResidual*>* toRemove, int min, int max, Vec10* stats, int tid);
 	void activatePointsMT_Reductor(std::vector<PointHessian*>* optimized,std::vector<ImmaturePoint*>* toOptimize,int min, int max, Vec10* stats, int tid);
+	// projection from a host into the traced frame, shared by all immature points of the host.
+	struct TraceHost
+	{
+		Mat33f KRKi;
+		Vec3f Kt;
+		Vec2f aff;
+	};
+	void traceNewCoarse_Reductor(FrameHessian* fh, std::vector<std::pair<ImmaturePoint*, const TraceHost*>>* toTrace, int min, int max, Vec10* stats, int tid);
 	void applyRes_Reductor(bool copyJacobians, int min, int max, Vec10* stats, int tid);
 
 	void printOptRes(const Vec3 &res, double resL, double resM, double resPrior, double LExact, float a, float b);
@@ -279,25 +302,51 @@ private:
 
 	// =================== changed by tracker-thread. protected by trackMutex ============
 	boost::mutex trackMutex;
-	std::vector<FrameShell*> allFrameHistory;
+	// all frames, or with result streams only the ones not written yet (the frame with id i is at i-frameHistoryOffset).
+	std::deque<FrameShell*> allFrameHistory;
+	int frameHistoryOffset = 0;
+	inline int numFramesAdded() const {return frameHistoryOffset + (int)allFrameHistory.size();}
+
+	struct ResultStream
+	{
+		std::ofstream out;
+		bool onlyLogKFPoses;
+		bool useCamToTrackingRef;
+	};
+	std::vector<std::unique_ptr<ResultStream>> resultStreams;
+	// KF shells already removed from allFrameHistory which can still be the trackingRef of frames in it.
+	std::deque<FrameShell*> retiredKeyframeShells;
+	std::atomic<int> lastMappedFrameId{-1}; // all frames up to this id are completely processed by the mapping.
+	void writeResultLine(std::ostream& out, FrameShell* s, bool onlyLogKFPoses, bool saveMetricPoses, bool useCamToTrackingRef);
+	void spillFinalFrameShells();
 	std::vector<Sophus::SE3d> gtPoses;
 	CoarseInitializer* coarseInitializer;
 	Vec5 lastCoarseRMSE;
+	// threads for evaluating the initialization hypotheses of trackNewCoarse in parallel (separate from
+	// treadReduce, which is used by the mapping thread). Created lazily, see setting_coarseTrackingParallelTries.
+	std::unique_ptr<IndexThreadReduce<Vec10>> coarseTrackingThreadReduce;
 
 
 	// ================== changed by mapper-thread. protected by mapMutex ===============
 	boost::mutex mapMutex;
-	std::vector<FrameShell*> allKeyFramesHistory;
+	// with result streams only the latest KFs are kept (pointers only, the shells are owned by allFrameHistory).
+	std::deque<FrameShell*> allKeyFramesHistory;
+	int keyframeHistoryOffset = 0;
+	inline int numKeyframesAdded() const {return keyframeHistoryOffset + (int)allKeyFramesHistory.size();}
+	void addToKeyframeHistory(FrameShell* shell);
 
 	EnergyFunctional* ef;
 	IndexThreadReduce<Vec10> treadReduce;
+	SlabAllocator<PointFrameResidual> residualAllocator; // all PointFrameResiduals are allocated from here (also by treadReduce workers).
 
 	float* selectionMap;
 	PixelSelector* pixelSelector;
 	CoarseDistanceMap* coarseDistanceMap;
+	std::shared_ptr<ImageBufferPool> imageBufferPool; // image pyramids of all frames.
 
 	std::vector<FrameHessian*> frameHessians;	// ONLY changed in marginalizeFrame and addFrame.
 	std::vector<PointFrameResidual*> activeResiduals;
+	ResidualBlockTable activeResidualTable; // built from activeResiduals in optimize(), iterated by linearizeAll and applyRes.
 	float currentMinActDist;
 
 
@@ -334,16 +383,22 @@ private:
 	 * coarse tracking(front end) runs in make loop
 	 */
 	void mappingLoop();
-
-	// tracking / mapping synchronization. All protected by [trackMapSyncMutex].
+	void notifyFrameMapped();
+
+	// tracking / mapping synchronization.
+	// Tracked frames are handed to the mapping thread with a lock-free queue (tracking thread pushes, mapping thread pops).
+	// [trackMapSyncMutex] only makes the KF decision atomic: pushing a frame / preparing a KF in the tracking thread vs.
+	// deciding if the popped frame becomes a KF in the mapping thread. It is never held during mapping itself, and
+	// the tracking thread never waits for space in the queue while holding it (if the queue is full, tracking waits
+	// until the mapping thread has popped a frame).
+	SPSCQueue<FrameHessian*> unmappedTrackedFrames;
 	boost::mutex trackMapSyncMutex;
-	boost::condition_variable trackedFrameSignal;
 	boost::condition_variable mappedFrameSignal;
-	std::deque<FrameHessian*> unmappedTrackedFrames;
-	int needNewKFAfter;	// Otherwise, a new KF is *needed that has ID bigger than [needNewKFAfter]*.
+	int needNewKFAfter;	// Otherwise, a new KF is *needed that has ID bigger than [needNewKFAfter]*. [trackMapSyncMutex]
 	boost::thread mappingThread;
-	bool runMapping;
-	bool needToKetchupMapping;
+	std::atomic<bool> runMapping;
+	bool needToKetchupMapping; // only used by the mapping thread (and only if setting_mappingBackpressure == 0).
+	MappingBackpressure mappingBackpressure;
 
 	int lastRefStopID;
 
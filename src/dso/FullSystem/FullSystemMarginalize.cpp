@@ -209,8 +209,11 @@ void FullSystem::marginalizeFrame(FrameHessian* frame)
     }
 
 
-	frame->shell->marginalizedAt = frameHessians.back()->shell->id;
-	frame->shell->movedByOpt = frame->w2c_leftEps().norm();
+	{
+		boost::unique_lock<boost::mutex> crlock(shellPoseMutex);
+		frame->shell->marginalizedAt = frameHessians.back()->shell->id;
+		frame->shell->movedByOpt = frame->w2c_leftEps().norm();
+	}
 
 	auto frameID = frame->frameID;
 
@@ -180,7 +180,7 @@ PointHessian* FullSystem::optimizeImmaturePoint(
 	for(int i=0;i<nres;i++)
 		if(residuals[i].state_state == ResState::IN)
 		{
-			PointFrameResidual* r = new PointFrameResidual(point_hessian, point_hessian->host, residuals[i].target);
+			PointFrameResidual* r = new (residualAllocator) PointFrameResidual(point_hessian, point_hessian->host, residuals[i].target);
 			r->state_NewEnergy = r->state_energy = 0;
 			r->state_NewState = ResState::OUTLIER;
 			r->setState(ResState::IN);
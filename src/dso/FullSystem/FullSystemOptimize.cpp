@@ -42,6 +42,7 @@
 #include "util/TimeMeasurement.h"
 
 #include <cmath>
+#include <chrono>
 
 #include <algorithm>
 
@@ -54,10 +55,13 @@ namespace dso
 
 void FullSystem::linearizeAll_Reductor(bool fixLinearization, std::vector<PointFrameResidual*>* toRemove, int min, int max, Vec10* stats, int tid)
 {
+	// gather the depths first, then stream through the table in (host, target) order.
+	activeResidualTable.updateDepths(min, max);
+	(*stats)[0] += activeResidualTable.linearize(&Hcalib, min, max);
+
 	for(int k=min;k<max;k++)
 	{
-		PointFrameResidual* r = activeResiduals[k];
-		(*stats)[0] += r->linearize(&Hcalib);
+		PointFrameResidual* r = activeResidualTable.residual(k);
 
 		if(fixLinearization)
 		{
@@ -81,7 +85,7 @@ void FullSystem::linearizeAll_Reductor(bool fixLinearization, std::vector<PointF
 			}
 			else
 			{
-				toRemove[tid].push_back(activeResiduals[k]);
+				toRemove[tid].push_back(r);
 			}
 		}
 	}
@@ -91,7 +95,7 @@ void FullSystem::linearizeAll_Reductor(bool fixLinearization, std::vector<PointF
 void FullSystem::applyRes_Reductor(bool copyJacobians, int min, int max, Vec10* stats, int tid)
 {
 	for(int k=min;k<max;k++)
-		activeResiduals[k]->applyRes(true);
+		activeResidualTable.residual(k)->applyRes(true);
 }
 void FullSystem::setNewFrameEnergyTH()
 {
@@ -101,12 +105,17 @@ void FullSystem::setNewFrameEnergyTH()
 	allResVec.reserve(activeResiduals.size()*2);
 	FrameHessian* newFrame = frameHessians.back();
 
-	for(PointFrameResidual* r : activeResiduals)
-		if(r->state_NewEnergyWithOutlier >= 0 && r->target == newFrame)
+	// only the blocks targeting the new frame.
+	for(const ResidualBlockTable::Block& block : activeResidualTable.blocks)
+	{
+		if(block.target != newFrame) continue;
+		for(int k=block.begin;k<block.end;k++)
 		{
-			allResVec.push_back(r->state_NewEnergyWithOutlier);
-
+			PointFrameResidual* r = activeResidualTable.residual(k);
+			if(r->state_NewEnergyWithOutlier >= 0)
+				allResVec.push_back(r->state_NewEnergyWithOutlier);
 		}
+	}
 
 	if(allResVec.size()==0)
 	{
@@ -154,18 +163,18 @@ Vec3 FullSystem::linearizeAll(bool fixLinearization)
 	double num = 0;
 
 
-	std::vector<PointFrameResidual*> toRemove[NUM_THREADS];
-	for(int i=0;i<NUM_THREADS;i++) toRemove[i].clear();
+	std::vector<PointFrameResidual*> toRemove[MAX_NUM_THREADS];
+	for(int i=0;i<MAX_NUM_THREADS;i++) toRemove[i].clear();
 
 	if(multiThreading)
 	{
-		treadReduce.reduce(boost::bind(&FullSystem::linearizeAll_Reductor, this, fixLinearization, toRemove, _1, _2, _3, _4), 0, activeResiduals.size(), 0);
+		treadReduce.reduce(boost::bind(&FullSystem::linearizeAll_Reductor, this, fixLinearization, toRemove, _1, _2, _3, _4), 0, activeResidualTable.size(), 0);
 		lastEnergyP = treadReduce.stats[0];
 	}
 	else
 	{
 		Vec10 stats;
-		linearizeAll_Reductor(fixLinearization, toRemove, 0,activeResiduals.size(),&stats,0);
+		linearizeAll_Reductor(fixLinearization, toRemove, 0,activeResidualTable.size(),&stats,0);
 		lastEnergyP = stats[0];
 	}
 
@@ -189,7 +198,7 @@ Vec3 FullSystem::linearizeAll(bool fixLinearization)
 		}
 
 		int nResRemoved=0;
-		for(int i=0;i<NUM_THREADS;i++)
+		for(int i=0;i<treadReduce.getNumThreads();i++)
 		{
 			for(PointFrameResidual* r : toRemove[i])
 			{
@@ -419,7 +428,7 @@ void FullSystem::printOptRes(const Vec3 &res, double resL, double resM, double r
  * @param mnumOptIts 
  * @return float 
  */
-float FullSystem::optimize(int mnumOptIts)
+float FullSystem::optimize(int mnumOptIts, double budgetMs)
 {
     dmvio::TimeMeasurement timeMeasurement("FullSystemOptimize");
 	if(frameHessians.size() < 2) return 0;
@@ -447,6 +456,8 @@ float FullSystem::optimize(int mnumOptIts)
 			numPoints++;
 		}
 
+	activeResidualTable.build(activeResiduals, frameHessians.size());
+
     if(!setting_debugout_runquiet)
         printf("OPTIMIZE %d pts, %d active res, %d lin res!\n",ef->nPoints,(int)activeResiduals.size(), numLRes);
 
@@ -456,9 +467,9 @@ float FullSystem::optimize(int mnumOptIts)
 	double lastEnergyM = calcMEnergy(false);// imu residual?
 
 	if(multiThreading)
-		treadReduce.reduce(boost::bind(&FullSystem::applyRes_Reductor, this, true, _1, _2, _3, _4), 0, activeResiduals.size(), 50);
+		treadReduce.reduce(boost::bind(&FullSystem::applyRes_Reductor, this, true, _1, _2, _3, _4), 0, activeResidualTable.size(), 50);
 	else
-		applyRes_Reductor(true,0,activeResiduals.size(),0,0);
+		applyRes_Reductor(true,0,activeResidualTable.size(),0,0);
 
 
     if(!setting_debugout_runquiet)
@@ -478,9 +489,18 @@ float FullSystem::optimize(int mnumOptIts)
 	float stepsize=1;
 	VecX previousX = VecX::Constant(CPARS+ 8*frameHessians.size(), NAN);
 	int numIterations = 0;
+
+	// With a time budget the next iteration is only started if it is predicted to finish in time. The prediction is the
+	// slowest iteration of this optimization, or before the first one the recent history of all optimizations.
+	auto iterationsStart = std::chrono::steady_clock::now();
+	double predictedIterationMs = 0;
+	if(budgetMs > 0)
+		predictedIterationMs = dmvio::TimeMeasurement::getWindowStats("baIteration").p95 * 1000.0;
+
 	for(int iteration=0;iteration<mnumOptIts;iteration++) // running damped GN method to optimize slide window
 	{
 	    dmvio::TimeMeasurement timeMeasurement("baIteration");
+		bool energyConverged = false;
 		// solve!
 		backupState(iteration!=0);
 		//solveSystemNew(0);
@@ -551,9 +571,14 @@ float FullSystem::optimize(int mnumOptIts)
 		{
 
 			if(multiThreading)
-				treadReduce.reduce(boost::bind(&FullSystem::applyRes_Reductor, this, true, _1, _2, _3, _4), 0, activeResiduals.size(), 50);
+				treadReduce.reduce(boost::bind(&FullSystem::applyRes_Reductor, this, true, _1, _2, _3, _4), 0, activeResidualTable.size(), 50);
 			else
-				applyRes_Reductor(true,0,activeResiduals.size(),0,0);
+				applyRes_Reductor(true,0,activeResidualTable.size(),0,0);
+
+			double lastTotal = lastEnergy[0] + lastEnergy[1] + lastEnergyL + lastEnergyM / dynamicGTSAMWeight;
+			double newTotal = newEnergy[0] + newEnergy[1] + newEnergyL + newEnergyM / dynamicGTSAMWeight;
+			energyConverged = setting_optMinRelEnergyDecrease > 0 &&
+							  lastTotal - newTotal < setting_optMinRelEnergyDecrease * lastTotal;
 
 			lastEnergy = newEnergy;
 			lastEnergyL = newEnergyL;
@@ -579,6 +604,22 @@ float FullSystem::optimize(int mnumOptIts)
 
 
 		if(canbreak && iteration >= setting_minOptIterations) break;
+		if(energyConverged && iteration >= setting_minOptIterations) break;
+
+		if(budgetMs > 0)
+		{
+			predictedIterationMs = std::max(predictedIterationMs, timeMeasurement.end() * 1000.0);
+			double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - iterationsStart).count();
+			if(elapsedMs + predictedIterationMs > budgetMs && iteration >= setting_minOptIterations)
+			{
+				if(!setting_debugout_runquiet)
+				{
+					printf("BA time budget reached (%.1f of %.1f ms, next iteration ~%.1f ms)\n", elapsedMs, budgetMs,
+						   predictedIterationMs);
+				}
+				break;
+			}
+		}
 	}
 
     if(!setting_debugout_runquiet)
@@ -125,13 +125,21 @@ void FrameHessian::release()
 }
 
 
-void FrameHessian::makeImages(float* color, CalibHessian* HCalib)
+void FrameHessian::makeImages(float* color, CalibHessian* HCalib, std::shared_ptr<ImageBufferPool> pool)
 {
-
+	imagePool = std::move(pool);
 	for(int i=0;i<pyrLevelsUsed;i++)
 	{
-		dIp[i] = new Eigen::Vector3f[wG[i]*hG[i]];
-		absSquaredGrad[i] = new float[wG[i]*hG[i]];
+		if(imagePool)
+		{
+			dIp[i] = imagePool->get<Eigen::Vector3f>(wG[i]*hG[i]);
+			absSquaredGrad[i] = imagePool->get<float>(wG[i]*hG[i]);
+		}
+		else
+		{
+			dIp[i] = new Eigen::Vector3f[wG[i]*hG[i]];
+			absSquaredGrad[i] = new float[wG[i]*hG[i]];
+		}
 	}
 	dI = dIp[0];
 
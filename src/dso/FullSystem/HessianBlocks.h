@@ -36,6 +36,8 @@
 #include "util/NumType.h"
 #include "FullSystem/Residuals.h"
 #include "util/ImageAndExposure.h"
+#include "util/ImageBufferPool.h"
+#include <memory>
 
 
 namespace dso
@@ -128,6 +130,7 @@ struct FrameHessian
 	Eigen::Vector3f* dI;				 // dI = dIp[0] trace, fine tracking. Used for direction select (not for gradient histograms etc.)
 	Eigen::Vector3f* dIp[PYR_LEVELS];	 // coarse tracking / coarse initializer. NAN in [0] only.
 	float* absSquaredGrad[PYR_LEVELS];  // image gradient. only used for pixel select (histograms etc.). no NAN.
+	std::shared_ptr<ImageBufferPool> imagePool; // if set, dIp and absSquaredGrad are taken from and returned to it.
 
     bool addCamPrior;
 
@@ -240,9 +243,16 @@ struct FrameHessian
 		release(); instanceCounter--;
 		for(int i=0;i<pyrLevelsUsed;i++)
 		{
-			delete[] dIp[i];
-			delete[]  absSquaredGrad[i];
-
+			if(imagePool)
+			{
+				imagePool->release(dIp[i], wG[i]*hG[i]);
+				imagePool->release(absSquaredGrad[i], wG[i]*hG[i]);
+			}
+			else
+			{
+				delete[] dIp[i];
+				delete[]  absSquaredGrad[i];
+			}
 		}
 
 
@@ -265,7 +275,8 @@ struct FrameHessian
 	};
 
 
-    void makeImages(float* color, CalibHessian* HCalib);
+    // pool is optional, without it the pyramid is allocated with new[].
+    void makeImages(float* color, CalibHessian* HCalib, std::shared_ptr<ImageBufferPool> pool = nullptr);
 
 	inline Vec10 getPrior()
 	{
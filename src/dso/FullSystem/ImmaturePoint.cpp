@@ -29,8 +29,70 @@
 #include "util/FrameShell.h"
 #include "FullSystem/ResidualProjections.h"
 
+#if !defined(__SSE3__) && !defined(__SSE2__) && !defined(__SSE1__)
+#include "SSE2NEON.h"
+#else
+#include <emmintrin.h>
+#endif
+
 namespace dso
 {
+
+void computeTraceErrors(const Eigen::Vector3f* dI, int width, const float* posU, const float* posV, int numSteps,
+						const Vec2f* rotatedPattern, const float* refColor, float* errors)
+{
+	const __m128 one = _mm_set1_ps(1);
+	const __m128 two = _mm_set1_ps(2);
+	const __m128 huberTH = _mm_set1_ps(setting_huberTH);
+	const __m128 invalidEnergy = _mm_set1_ps(1e5);
+	const __m128 inf = _mm_set1_ps(INFINITY);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+	for(int i=0;i<numSteps;i+=4)
+	{
+		__m128 ptx = _mm_loadu_ps(posU+i);
+		__m128 pty = _mm_loadu_ps(posV+i);
+		__m128 energy = _mm_setzero_ps();
+		for(int idx=0;idx<patternNum;idx++)
+		{
+			__m128 x = _mm_add_ps(ptx, _mm_set1_ps(rotatedPattern[idx][0]));
+			__m128 y = _mm_add_ps(pty, _mm_set1_ps(rotatedPattern[idx][1]));
+			__m128i ix = _mm_cvttps_epi32(x);
+			__m128i iy = _mm_cvttps_epi32(y);
+			__m128 dx = _mm_sub_ps(x, _mm_cvtepi32_ps(ix));
+			__m128 dy = _mm_sub_ps(y, _mm_cvtepi32_ps(iy));
+			__m128 dxdy = _mm_mul_ps(dx, dy);
+
+			alignas(16) int ixs[4], iys[4];
+			_mm_store_si128((__m128i*)ixs, ix);
+			_mm_store_si128((__m128i*)iys, iy);
+			alignas(16) float c00[4], c10[4], c01[4], c11[4];
+			for(int k=0;k<4;k++)
+			{
+				const Eigen::Vector3f* bp = dI + ixs[k] + iys[k]*width;
+				c00[k] = bp[0][0];
+				c10[k] = bp[1][0];
+				c01[k] = bp[width][0];
+				c11[k] = bp[1+width][0];
+			}
+
+			__m128 hitColor = _mm_mul_ps(dxdy, _mm_load_ps(c11));
+			hitColor = _mm_add_ps(hitColor, _mm_mul_ps(_mm_sub_ps(dy, dxdy), _mm_load_ps(c01)));
+			hitColor = _mm_add_ps(hitColor, _mm_mul_ps(_mm_sub_ps(dx, dxdy), _mm_load_ps(c10)));
+			hitColor = _mm_add_ps(hitColor, _mm_mul_ps(_mm_add_ps(_mm_sub_ps(_mm_sub_ps(one, dx), dy), dxdy), _mm_load_ps(c00)));
+
+			__m128 isFinite = _mm_cmplt_ps(_mm_and_ps(hitColor, absMask), inf);
+			__m128 residual = _mm_sub_ps(hitColor, _mm_set1_ps(refColor[idx]));
+			__m128 absResidual = _mm_and_ps(residual, absMask);
+			__m128 isInlier = _mm_cmplt_ps(absResidual, huberTH);
+			__m128 huberWeight = _mm_or_ps(_mm_and_ps(isInlier, one), _mm_andnot_ps(isInlier, _mm_div_ps(huberTH, absResidual)));
+			__m128 e = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(huberWeight, residual), residual), _mm_sub_ps(two, huberWeight));
+			energy = _mm_add_ps(energy, _mm_or_ps(_mm_and_ps(isFinite, e), _mm_andnot_ps(isFinite, invalidEnergy)));
+		}
+		_mm_storeu_ps(errors+i, energy);
+	}
+}
+
 ImmaturePoint::ImmaturePoint(int u_, int v_, FrameHessian* host_, float type, CalibHessian* HCalib)
 : u(u_), v(v_), host(host_), point_type(type), idepth_min(0), idepth_max(NAN), lastTraceStatus(IPS_UNINITIALIZED)
 {
@@ -255,8 +317,6 @@ ImmaturePointStatus ImmaturePoint::traceOn(FrameHessian* frame,const Mat33f &hos
 	int numSteps = 1.9999f + dist / setting_trace_stepsize; // trace_stepsize is 1.0 by default. steps is 2.0 minimum. 99 maximum. see code below.
 
 	float randShift = uMin*1000-floorf(uMin*1000);
-	float ptx = uMin-randShift*dx;
-	float pty = vMin-randShift*dy;
 
 
 
@@ -272,40 +332,42 @@ ImmaturePointStatus ImmaturePoint::traceOn(FrameHessian* frame,const Mat33f &hos
 
 
 
-	float errors[100];
-	float bestU=0, bestV=0, bestEnergy=1e10;
-	int bestIdx=-1;
 	if(numSteps >= 100) numSteps = 99;
 
-	for(int i=0;i<numSteps;i++) // linear search to find best matching point
+	// search positions, padded for the batched evaluation.
+	float posU[100], posV[100];
+	float ptx = uMin-randShift*dx;
+	float pty = vMin-randShift*dy;
+	for(int i=0;i<100;i++)
 	{
-		float energy=0;
-		for(int idx=0;idx<patternNum;idx++)
+		posU[i] = ptx;
+		posV[i] = pty;
+		if(i+1<numSteps)
 		{
-			float hitColor = getInterpolatedElement31(frame->dI,
-										(float)(ptx+rotatetPattern[idx][0]),
-										(float)(pty+rotatetPattern[idx][1]),
-										wG[0]);
-
-			if(!std::isfinite(hitColor)) {energy+=1e5; continue;}
-			float residual = hitColor - (float)(hostToFrame_affine[0] * color[idx] + hostToFrame_affine[1]);
-			float huber_weight = fabs(residual) < setting_huberTH ? 1 : setting_huberTH / fabs(residual);
-			energy += huber_weight *residual*residual*(2-huber_weight); // total photometric loss w.r.t. huber loss
+			ptx+=dx;
+			pty+=dy;
 		}
+	}
+
+	float refColor[MAX_RES_PER_POINT];
+	for(int idx=0;idx<patternNum;idx++)
+		refColor[idx] = (float)(hostToFrame_affine[0] * color[idx] + hostToFrame_affine[1]);
 
+	float errors[100];
+	computeTraceErrors(frame->dI, wG[0], posU, posV, numSteps, rotatetPattern, refColor, errors);
+
+	float bestU=0, bestV=0, bestEnergy=1e10;
+	int bestIdx=-1;
+	for(int i=0;i<numSteps;i++) // linear search to find best matching point
+	{
 		if(debugPrint)
 			printf("step %.1f %.1f (id %f): energy = %f!\n",
-					ptx, pty, 0.0f, energy);
+					posU[i], posV[i], 0.0f, errors[i]);
 
-
-		errors[i] = energy;
-		if(energy < bestEnergy)
+		if(errors[i] < bestEnergy)
 		{
-			bestU = ptx; bestV = pty; bestEnergy = energy; bestIdx = i;
+			bestU = posU[i]; bestV = posV[i]; bestEnergy = errors[i]; bestIdx = i;
 		}
-
-		ptx+=dx;
-		pty+=dy;
 	}
 
 
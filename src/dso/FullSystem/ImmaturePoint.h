@@ -52,6 +52,14 @@ enum ImmaturePointStatus {
 	IPS_UNINITIALIZED};			// not even traced once.
 
 
+// energies of the discrete epipolar search of traceOn, for four search positions at once.
+// Every lane does exactly the operations of the scalar search (bilinear interpolation of getInterpolatedElement31,
+// then the huber energy), in the same order, so the errors are identical.
+// posU and posV need to be padded to a multiple of 4 with valid positions, errors is written up to that multiple.
+void computeTraceErrors(const Eigen::Vector3f* dI, int width, const float* posU, const float* posV, int numSteps,
+						const Vec2f* rotatedPattern, const float* refColor, float* errors);
+
+
 class ImmaturePoint
 {
 public:
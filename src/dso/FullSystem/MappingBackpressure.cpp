@@ -0,0 +1,119 @@
+/**
+* This file is part of DSO, written by Jakob Engel.
+* It has been modified by Lukas von Stumberg for the inclusion in DM-VIO (http://vision.in.tum.de/dm-vio).
+*
+* Copyright 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>
+* Copyright 2016 Technical University of Munich and Intel.
+* Developed by Jakob Engel <engelj at in dot tum dot de>,
+* for more information see <http://vision.in.tum.de/dso>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DSO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DSO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DSO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+
+#include "FullSystem/MappingBackpressure.h"
+#include "util/settings.h"
+#include "util/TimeMeasurement.h"
+#include <algorithm>
+#include <stdio.h>
+
+namespace dso
+{
+
+constexpr int MappingBackpressure::MaxLevel;
+
+void MappingBackpressure::frameDelivered(double timestamp)
+{
+	double previous = newestTimestamp.load(std::memory_order_relaxed);
+	if(previous > 0 && timestamp > previous)
+	{
+		// only written by the tracking thread.
+		double interval = (timestamp - previous) * 1000.0;
+		double smoothed = getFrameIntervalMs();
+		frameIntervalMs.store(smoothed == 0 ? interval : 0.9 * smoothed + 0.1 * interval, std::memory_order_relaxed);
+	}
+	newestTimestamp.store(timestamp, std::memory_order_relaxed);
+}
+
+int MappingBackpressure::update(double timestamp, size_t queuedFrames)
+{
+	lagMs = std::max(0.0, (newestTimestamp.load(std::memory_order_relaxed) - timestamp) * 1000.0);
+	if(setting_mappingBackpressure == 0) return 0;
+
+	int target = std::max((int) queuedFrames / std::max(setting_backpressureFramesPerLevel, 1),
+						  (int) (lagMs / std::max(setting_backpressureMsPerLevel, 1.0f)));
+	target = std::min(target, MaxLevel);
+
+	int oldLevel = getLevel();
+	int newLevel = oldLevel;
+	if(target > oldLevel) newLevel = target;
+	else if(target < oldLevel) newLevel = oldLevel - 1;
+
+	if(newLevel != oldLevel)
+	{
+		level.store(newLevel, std::memory_order_relaxed);
+		if(!setting_debugout_runquiet)
+			printf("MAPPING BACKPRESSURE: level %d -> %d (%d frames queued, lag %.1f ms)\n",
+				   oldLevel, newLevel, (int) queuedFrames, lagMs);
+	}
+	dmvio::TimeMeasurement::recordCounter("mappingBackpressureLevel", newLevel);
+	return newLevel;
+}
+
+double MappingBackpressure::optimizationBudgetMs() const
+{
+	if(setting_optBudgetMs >= 0) return setting_optBudgetMs;
+
+	// derived budget. Only possible in realtime mode, where frames are delivered to the mapping thread.
+	double interval = getFrameIntervalMs();
+	if(interval <= 0) return 0;
+	// the optimization should be done before the next frames pile up, the lag that already exists is subtracted.
+	// A budget of at least one frame interval is kept, as the first iterations matter most.
+	return std::max(interval, interval * setting_optBudgetFrames - lagMs);
+}
+
+int MappingBackpressure::maxOptIterations(int iterations) const
+{
+	if(getLevel() < 1) return iterations;
+	return std::max(1, (int) (iterations * setting_backpressureOptItsFactor + 0.5f));
+}
+
+bool MappingBackpressure::allowExtraKeyframes() const
+{
+	return getLevel() < 1;
+}
+
+bool MappingBackpressure::traceNonKeyframes() const
+{
+	return getLevel() < 2;
+}
+
+float MappingBackpressure::pointDensityFactor() const
+{
+	return getLevel() < 3 ? 1.0f : setting_backpressureDensityFactor;
+}
+
+bool MappingBackpressure::makeKeyframe(size_t queuedFrames, bool preparedKF, bool requestedKF) const
+{
+	// if there are other frames to track, do that first. The requested KF is coalesced to a newer frame.
+	if(queuedFrames > 0 && !preparedKF) return false;
+	return requestedKF || preparedKF || (setting_realTimeMaxKF && allowExtraKeyframes());
+}
+
+}
@@ -0,0 +1,84 @@
+/**
+* This file is part of DSO, written by Jakob Engel.
+* It has been modified by Lukas von Stumberg for the inclusion in DM-VIO (http://vision.in.tum.de/dm-vio).
+*
+* Copyright 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>
+* Copyright 2016 Technical University of Munich and Intel.
+* Developed by Jakob Engel <engelj at in dot tum dot de>,
+* for more information see <http://vision.in.tum.de/dso>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DSO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DSO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DSO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+namespace dso
+{
+
+// Decides how much work the mapping thread skips when it falls behind the tracking thread (only in realtime mode,
+// in linearizeOperation there is no lag).
+// The lag is measured in queued frames and in sensor time between the newest delivered and the currently mapped frame.
+// Each level includes the previous ones:
+// 1: fewer GN iterations per KF, and setting_realTimeMaxKF does not create additional KFs.
+// 2: non-KFs only get their pose updated and are not traced into the immature points.
+// 3: fewer new immature points and a lower active point density.
+// Requested KFs are always coalesced to the newest queued frame, as the mapper only creates a KF once the queue is empty.
+// The level rises as soon as the lag does, and falls by one per mapped frame, so it does not oscillate.
+class MappingBackpressure
+{
+public:
+	static constexpr int MaxLevel = 3;
+
+	// called by the tracking thread for each frame handed to the mapper.
+	void frameDelivered(double timestamp);
+	// called by the mapping thread for each frame it takes from the queue.
+	int update(double timestamp, size_t queuedFrames);
+
+	inline int getLevel() const {return level.load(std::memory_order_relaxed);}
+	inline double getLagMs() const {return lagMs;}
+	// smoothed time between delivered frames (0 before two frames were delivered).
+	inline double getFrameIntervalMs() const {return frameIntervalMs.load(std::memory_order_relaxed);}
+
+	// time budget for the GN iterations of the next KF (0 = unlimited), see setting_optBudgetMs.
+	double optimizationBudgetMs() const;
+
+	int maxOptIterations(int iterations) const;
+	bool allowExtraKeyframes() const;
+	bool traceNonKeyframes() const;
+	float pointDensityFactor() const;
+
+	// Decides if a frame taken from the queue becomes a KF (after the first two KFs).
+	// queuedFrames: number of frames still queued behind it. Other frames are mapped first, except if
+	// preparedKF is set (the IMU integration has already been prepared for this frame).
+	// requestedKF: the tracking thread requested a KF for this (or an older) frame.
+	bool makeKeyframe(size_t queuedFrames, bool preparedKF, bool requestedKF) const;
+
+private:
+	std::atomic<double> newestTimestamp{0};
+	std::atomic<double> frameIntervalMs{0};
+	std::atomic<int> level{0};
+	double lagMs = 0;
+};
+
+}
+
@@ -62,21 +62,25 @@ PixelSelector::PixelSelector(int w, int h)
 
     std::cout << "PixelSelector: Using block sizes: " << bW << ", " << bH << '\n';
 
-	gradHist = new int[100*(1+nbW)*(1+nbH)];
 	ths = new float[(nbW)*(nbH)+100];
 	thsSmoothed = new float[(nbW)*(nbH)+100];
 
 
+	candidateMask = new unsigned char[w*h];
+
 	allowFast=false;
+	threadReduce=0;
 	gradHistFrame=0;
+	candidateMaskFrame=0;
+	candidateMaskThFactor=0;
 }
 
 PixelSelector::~PixelSelector()
 {
 	delete[] randomPattern;
-	delete[] gradHist;
 	delete[] ths;
 	delete[] thsSmoothed;
+	delete[] candidateMask;
 }
 
 int computeHistQuantil(int* hist, float below)
@@ -94,20 +98,35 @@ int computeHistQuantil(int* hist, float below)
 void PixelSelector::makeHists(const FrameHessian* const fh)
 {
 	gradHistFrame = fh;
+	thsStep = nbW;
+
+	// the histograms of all blocks are independent, the smoothing needs all of them.
+	if(threadReduce)
+	{
+		threadReduce->reduce([&](int min, int max, Vec10* stats, int tid) { makeHistsRows(fh, min, max); }, 0, nbH, 0);
+		threadReduce->reduce([&](int min, int max, Vec10* stats, int tid) { smoothThsRows(min, max); }, 0, nbH, 0);
+	}
+	else
+	{
+		makeHistsRows(fh, 0, nbH);
+		smoothThsRows(0, nbH);
+	}
+}
+
+void PixelSelector::makeHistsRows(const FrameHessian* const fh, int yMin, int yMax)
+{
 	float * img_gradient_sqr = fh->absSquaredGrad[0];
 
 	int w = wG[0];
 	int h = hG[0];
 
 	int w32 = nbW;
-	int h32 = nbH;
-	thsStep = w32;
 
-	for(int y=0;y<h32;y++)
+	for(int y=yMin;y<yMax;y++)
 		for(int x=0;x<w32;x++)
 		{
 			float* map0 = img_gradient_sqr+bW*x+bH*y*w;
-			int* hist0 = gradHist;// + 50*(x+y*w32); // gradient histgram
+			int hist0[50]; // gradient histgram
 			memset(hist0,0,sizeof(int)*50);
 
 			for(int j=0;j<bH;j++) for(int i=0;i<bW;i++)
@@ -123,8 +142,14 @@ void PixelSelector::makeHists(const FrameHessian* const fh)
 
 			ths[x+y*w32] = computeHistQuantil(hist0,setting_minGradHistCut) + setting_minGradHistAdd; // deter image gradient threshold for pixel selector
 		}
+}
+
+void PixelSelector::smoothThsRows(int yMin, int yMax)
+{
+	int w32 = nbW;
+	int h32 = nbH;
 
-	for(int y=0;y<h32;y++)
+	for(int y=yMin;y<yMax;y++)
 		for(int x=0;x<w32;x++)
 		{
 			float sum=0,num=0;
@@ -149,11 +174,6 @@ void PixelSelector::makeHists(const FrameHessian* const fh)
 			thsSmoothed[x+y*w32] = (sum/num) * (sum/num);
 
 		}
-
-
-
-
-
 }
 int PixelSelector::makeMaps(
 		const FrameHessian* const fh,
@@ -271,6 +291,8 @@ int PixelSelector::makeMaps(
 //			idealPotential,
 //			100*numHaveSub/(float)(wG[0]*hG[0]));
 	currentPotential = idealPotential;
+	// the candidate mask is only reused for the re-selections of this call.
+	candidateMaskFrame = 0;
 
 
 	if(plot)
@@ -306,53 +328,189 @@ int PixelSelector::makeMaps(
 	return numHaveSub;
 }
 
-// check https://rancheng.github.io/gradient-pixel-selector/ for better understanding for this complex function!!
-
-Eigen::Vector3i PixelSelector::select(const FrameHessian* const fh,
-		float* map_out, int potential, float thFactor)
+namespace
 {
+const Vec2f directions[16] = {
+		 Vec2f(0,    1.0000),
+		 Vec2f(0.3827,    0.9239),
+		 Vec2f(0.1951,    0.9808),
+		 Vec2f(0.9239,    0.3827),
+		 Vec2f(0.7071,    0.7071),
+		 Vec2f(0.3827,   -0.9239),
+		 Vec2f(0.8315,    0.5556),
+		 Vec2f(0.8315,   -0.5556),
+		 Vec2f(0.5556,   -0.8315),
+		 Vec2f(0.9808,    0.1951),
+		 Vec2f(0.9239,   -0.3827),
+		 Vec2f(0.7071,   -0.7071),
+		 Vec2f(0.5556,    0.8315),
+		 Vec2f(0.9808,   -0.1951),
+		 Vec2f(1.0000,    0.0000),
+		 Vec2f(0.1951,   -0.9808)};
+}
 
-	Eigen::Vector3f const * const map0 = fh->dI;
-
+void PixelSelector::makeCandidateMaskRows(const FrameHessian* const fh, float thFactor, int yMin, int yMax)
+{
 	float * img_gradient_sqr = fh->absSquaredGrad[0];
 	float * img_gradient_sqr_1 = fh->absSquaredGrad[1];
 	float * img_gradient_sqr_2 = fh->absSquaredGrad[2];
 
-
 	int w = wG[0];
 	int w1 = wG[1];
 	int w2 = wG[2];
 	int h = hG[0];
 
+	float down_weight = setting_gradDownweightPerLevel;
+	float down_weight_sqr = down_weight*down_weight;
 
-	const Vec2f directions[16] = {
-	         Vec2f(0,    1.0000),
-	         Vec2f(0.3827,    0.9239),
-	         Vec2f(0.1951,    0.9808),
-	         Vec2f(0.9239,    0.3827),
-	         Vec2f(0.7071,    0.7071),
-	         Vec2f(0.3827,   -0.9239),
-	         Vec2f(0.8315,    0.5556),
-	         Vec2f(0.8315,   -0.5556),
-	         Vec2f(0.5556,   -0.8315),
-	         Vec2f(0.9808,    0.1951),
-	         Vec2f(0.9239,   -0.3827),
-	         Vec2f(0.7071,   -0.7071),
-	         Vec2f(0.5556,    0.8315),
-	         Vec2f(0.9808,   -0.1951),
-	         Vec2f(1.0000,    0.0000),
-	         Vec2f(0.1951,   -0.9808)};
+	for(int yf=yMin;yf<yMax;yf++)
+	{
+		unsigned char* maskRow = candidateMask + yf*w;
+		if(yf<4 || yf>h-4)
+		{
+			memset(maskRow, 0, w);
+			continue;
+		}
+		const float* grad0Row = img_gradient_sqr + yf*w;
+		const float* grad1Row = img_gradient_sqr_1 + (int)(yf*0.5f+0.25f)*w1;
+		const float* grad2Row = img_gradient_sqr_2 + (int)(yf*0.25f+0.125)*w2;
+
+		// the threshold is constant within a block, so the comparisons run over contiguous pixels.
+		for(int bx=0;bx<nbW;bx++)
+		{
+			float pixelTH0 = thsSmoothed[bx + (yf / bH) * thsStep];
+			float pixelTH1 = pixelTH0*down_weight;
+			float pixelTH2 = pixelTH1*down_weight_sqr;
+			float th0 = pixelTH0*thFactor;
+			float th1 = pixelTH1*thFactor;
+			float th2 = pixelTH2*thFactor;
+
+			int xStart = bx*bW;
+			for(int xf=xStart;xf<xStart+bW;xf++)
+			{
+				maskRow[xf] = (unsigned char)((grad0Row[xf] > th0)
+						| ((grad1Row[(int)(xf*0.5f+0.25f)] > th1) << 1)
+						| ((grad2Row[(int)(xf*0.25f+0.125)] > th2) << 2));
+			}
+		}
+		for(int xf=0;xf<4;xf++) maskRow[xf] = 0;
+		for(int xf=w-5;xf<w;xf++) maskRow[xf] = 0;
+	}
+}
+
+void PixelSelector::countCandidateBlocks(int potential, int yMin, int yMax)
+{
+	int w = wG[0];
+	int h = hG[0];
+
+	for(int by=yMin;by<yMax;by++) for(int bx=0;bx<nb4W;bx++)
+	{
+		int x4 = bx*4*potential;
+		int y4 = by*4*potential;
+		int n2 = 0;
+		for(int y2=y4;y2<std::min(y4+4*potential, h);y2+=potential)
+			for(int x2=x4;x2<std::min(x4+4*potential, w);x2+=potential)
+			{
+				bool any = false;
+				for(int y=y2;y<std::min(y2+potential, h) && !any;y++)
+				{
+					const unsigned char* maskRow = candidateMask + y*w;
+					for(int x=x2;x<std::min(x2+potential, w);x++)
+						any |= (maskRow[x] & 1) != 0;
+				}
+				if(any) n2++;
+			}
+		blockN2Start[bx+by*nb4W] = n2;
+	}
+}
+
+void PixelSelector::selectBlockRows(const FrameHessian* const fh, float* map_out, int potential, int yMin, int yMax)
+{
+	for(int by=yMin;by<yMax;by++) for(int bx=0;bx<nb4W;bx++)
+	{
+		int b = bx+by*nb4W;
+		blockNums[b] = selectBlock(fh, map_out, potential, bx*4*potential, by*4*potential, blockN2Start[b]);
+	}
+}
+
+// check https://rancheng.github.io/gradient-pixel-selector/ for better understanding for this complex function!!
+
+Eigen::Vector3i PixelSelector::select(const FrameHessian* const fh,
+		float* map_out, int potential, float thFactor)
+{
+	int w = wG[0];
+	int h = hG[0];
+
+	if(candidateMaskFrame != fh || candidateMaskThFactor != thFactor)
+	{
+		if(threadReduce)
+			threadReduce->reduce([&](int min, int max, Vec10* stats, int tid) { makeCandidateMaskRows(fh, thFactor, min, max); }, 0, h, 0);
+		else
+			makeCandidateMaskRows(fh, thFactor, 0, h);
+		candidateMaskFrame = fh;
+		candidateMaskThFactor = thFactor;
+	}
 
 	memset(map_out,0,w*h*sizeof(PixelSelectorStatus));
 
+	nb4W = (w + 4*potential - 1) / (4*potential);
+	nb4H = (h + 4*potential - 1) / (4*potential);
+	blockN2Start.resize(nb4W*nb4H);
+	blockNums.resize(nb4W*nb4H);
 
+	int n2=0, n3=0, n4=0;
+	if(threadReduce)
+	{
+		// The random directions depend on the number of level 0 points selected before (n2). It is predicted from the
+		// candidate mask, so that all 4-blocks can be selected in parallel.
+		threadReduce->reduce([&](int min, int max, Vec10* stats, int tid) { countCandidateBlocks(potential, min, max); }, 0, nb4H, 0);
+		int sum = 0;
+		for(int& num : blockN2Start)
+		{
+			int blockNum = num;
+			num = sum;
+			sum += blockNum;
+		}
+		threadReduce->reduce([&](int min, int max, Vec10* stats, int tid) { selectBlockRows(fh, map_out, potential, min, max); }, 0, nb4H, 0);
 
-	float down_weight = setting_gradDownweightPerLevel;
-	float down_weight_sqr = down_weight*down_weight;
+		bool predictionCorrect = true;
+		for(int b=0;b<nb4W*nb4H;b++)
+		{
+			int expected = (b+1 < nb4W*nb4H ? blockN2Start[b+1] : sum) - blockN2Start[b];
+			if(blockNums[b][0] != expected) predictionCorrect = false;
+			n2 += blockNums[b][0]; n3 += blockNums[b][1]; n4 += blockNums[b][2];
+		}
+		if(predictionCorrect) return Eigen::Vector3i(n2,n3,n4);
 
+		// only if a candidate gradient was exactly orthogonal to the direction: select again sequentially.
+		memset(map_out,0,w*h*sizeof(PixelSelectorStatus));
+		n2 = n3 = n4 = 0;
+	}
 
-	int n3=0, n2=0, n4=0;
 	for(int y4=0;y4<h;y4+=(4*potential)) for(int x4=0;x4<w;x4+=(4*potential))
+	{
+		Eigen::Vector3i n = selectBlock(fh, map_out, potential, x4, y4, n2);
+		n2 += n[0]; n3 += n[1]; n4 += n[2];
+	}
+
+	return Eigen::Vector3i(n2,n3,n4);
+}
+
+Eigen::Vector3i PixelSelector::selectBlock(const FrameHessian* const fh, float* map_out, int potential, int x4, int y4,
+										   int n2)
+{
+	Eigen::Vector3f const * const map0 = fh->dI;
+
+	float * img_gradient_sqr = fh->absSquaredGrad[0];
+	float * img_gradient_sqr_1 = fh->absSquaredGrad[1];
+	float * img_gradient_sqr_2 = fh->absSquaredGrad[2];
+
+	int w = wG[0];
+	int w1 = wG[1];
+	int w2 = wG[2];
+	int h = hG[0];
+
+	int n2Start=n2, n3=0, n4=0;
 	{
 		int my3 = std::min((4*potential), h-y4);
 		int mx3 = std::min((4*potential), w-x4);
@@ -382,44 +540,37 @@ Eigen::Vector3i PixelSelector::select(const FrameHessian* const fh,
 					int xf = x1+x234;
 					int yf = y1+y234;
 
-					if(xf<4 || xf>=w-5 || yf<4 || yf>h-4) continue;
+					// zero for the border pixels.
+					unsigned char candidate = candidateMask[idx];
+					if(candidate == 0) continue;
 
-
-                    float pixelTH0 = thsSmoothed[xf / bW + (yf / bH) * thsStep];
-					float pixelTH1 = pixelTH0*down_weight;
-					float pixelTH2 = pixelTH1*down_weight_sqr;
-
-
-					float gradient0 = img_gradient_sqr[idx];
-					if(gradient0 > pixelTH0*thFactor)
+					if(candidate & 1)
 					{
 						Vec2f img_gradient = map0[idx].tail<2>();
 						float dirNorm = fabsf((float)(img_gradient.dot(dir2)));
-						if(!setting_selectDirectionDistribution) dirNorm = gradient0; //  this line will NEVER be executed. selectDirectionDistribution is true.
+						if(!setting_selectDirectionDistribution) dirNorm = img_gradient_sqr[idx]; //  this line will NEVER be executed. selectDirectionDistribution is true.
 
 						if(dirNorm > bestVal2)
 						{ bestVal2 = dirNorm; bestIdx2 = idx; bestIdx3 = -2; bestIdx4 = -2;}
 					}
 					if(bestIdx3==-2) continue;
 
-					float gradient1 = img_gradient_sqr_1[(int)(xf*0.5f+0.25f) + (int)(yf*0.5f+0.25f)*w1];
-					if(gradient1 > pixelTH1*thFactor)
+					if(candidate & 2)
 					{
 						Vec2f img_gradient = map0[idx].tail<2>();
 						float dirNorm = fabsf((float)(img_gradient.dot(dir3)));
-						if(!setting_selectDirectionDistribution) dirNorm = gradient1; // this line will NEVER be executed. selectDirectionDistribution is true.
+						if(!setting_selectDirectionDistribution) dirNorm = img_gradient_sqr_1[(int)(xf*0.5f+0.25f) + (int)(yf*0.5f+0.25f)*w1]; // this line will NEVER be executed. selectDirectionDistribution is true.
 
 						if(dirNorm > bestVal3)
 						{ bestVal3 = dirNorm; bestIdx3 = idx; bestIdx4 = -2;}
 					}
 					if(bestIdx4==-2) continue;
 
-					float gradient2 = img_gradient_sqr_2[(int)(xf*0.25f+0.125) + (int)(yf*0.25f+0.125)*w2];
-					if(gradient2 > pixelTH2*thFactor)
+					if(candidate & 4)
 					{
 						Vec2f img_gradient = map0[idx].tail<2>();
 						float dirNorm = fabsf((float)(img_gradient.dot(dir4)));
-						if(!setting_selectDirectionDistribution) dirNorm = gradient2; // this line will NEVER be executed. selectDirectionDistribution is true.
+						if(!setting_selectDirectionDistribution) dirNorm = img_gradient_sqr_2[(int)(xf*0.25f+0.125) + (int)(yf*0.25f+0.125)*w2]; // this line will NEVER be executed. selectDirectionDistribution is true.
 
 						if(dirNorm > bestVal4)
 						{ bestVal4 = dirNorm; bestIdx4 = idx; }
@@ -449,10 +600,8 @@ Eigen::Vector3i PixelSelector::select(const FrameHessian* const fh,
 		}
 	}
 
-
-	return Eigen::Vector3i(n2,n3,n4);
+	return Eigen::Vector3i(n2-n2Start,n3,n4);
 }
 
 
 }
-
@@ -27,6 +27,8 @@
 #pragma once
  
 #include "util/NumType.h"
+#include "util/IndexThreadReduce.h"
+#include <vector>
 
 namespace dso
 {
@@ -50,22 +52,44 @@ public:
 
 
 	bool allowFast;
+	// if set, histograms and selection are computed in parallel (with the same result).
+	IndexThreadReduce<Vec10>* threadReduce;
 	void makeHists(const FrameHessian* const fh);
 private:
 
 	Eigen::Vector3i select(const FrameHessian* const fh,
 			float* map_out, int pot, float thFactor=1);
 
+	void makeHistsRows(const FrameHessian* const fh, int yMin, int yMax);
+	void smoothThsRows(int yMin, int yMax);
+
+	// candidateMask has bit 1 << lvl set if the pixel passes the gradient threshold of pyramid level lvl in select.
+	// It does not depend on the potential, so it is reused when makeMaps re-selects with another potential.
+	void makeCandidateMaskRows(const FrameHessian* const fh, float thFactor, int yMin, int yMax);
+	// number of 2-blocks with a level 0 candidate in the 4-blocks of rows [yMin, yMax), which is also the number of
+	// selected level 0 points unless a candidate is orthogonal to the random direction.
+	void countCandidateBlocks(int potential, int yMin, int yMax);
+	// selects the points of a single 4-block. n2 is the number of level 0 points selected in all previous blocks.
+	Eigen::Vector3i selectBlock(const FrameHessian* const fh, float* map_out, int potential, int x4, int y4, int n2);
+	void selectBlockRows(const FrameHessian* const fh, float* map_out, int potential, int yMin, int yMax);
+
 
 	unsigned char* randomPattern;
 
 
-	int* gradHist;
 	float* ths;
 	float* thsSmoothed;
 	int thsStep;
 	const FrameHessian* gradHistFrame;
 
+	unsigned char* candidateMask;
+	const FrameHessian* candidateMaskFrame;
+	float candidateMaskThFactor;
+	// per 4-block of the current select.
+	int nb4W, nb4H;
+	std::vector<int> blockN2Start;
+	std::vector<Eigen::Vector3i> blockNums;
+
 	// block width, and block height.
 	int bW, bH;
 	// number of blocks in x and y dimension.
@@ -0,0 +1,462 @@
+/**
+* This file is part of DSO, written by Jakob Engel.
+* It has been modified by Lukas von Stumberg for the inclusion in DM-VIO (http://vision.in.tum.de/dm-vio).
+*
+* Copyright 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>
+* Copyright 2016 Technical University of Munich and Intel.
+* Developed by Jakob Engel <engelj at in dot tum dot de>,
+* for more information see <http://vision.in.tum.de/dso>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DSO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DSO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DSO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "FullSystem/ResidualBlockTable.h"
+#include "FullSystem/HessianBlocks.h"
+#include "OptimizationBackend/RawResidualJacobian.h"
+#include <string.h>
+#include <algorithm>
+
+#if !defined(__SSE3__) && !defined(__SSE2__) && !defined(__SSE1__)
+#include "SSE2NEON.h"
+#else
+#include <emmintrin.h>
+#endif
+
+namespace dso
+{
+
+void ResidualBlockTable::build(const std::vector<PointFrameResidual*>& activeResiduals, int numFrames)
+{
+	// counting sort by block, keeping the original (point) order within each block.
+	int numBlocks = numFrames * numFrames;
+	blockStart.assign(numBlocks + 1, 0);
+	for(PointFrameResidual* r : activeResiduals)
+		blockStart[r->host->idx * numFrames + r->target->idx + 1]++;
+	for(int i = 0; i < numBlocks; i++)
+		blockStart[i + 1] += blockStart[i];
+
+	blocks.clear();
+	for(int i = 0; i < numBlocks; i++)
+		if(blockStart[i + 1] > blockStart[i])
+			blocks.push_back(Block{nullptr, nullptr, blockStart[i], blockStart[i + 1]});
+
+	residuals.resize(activeResiduals.size());
+	for(PointFrameResidual* r : activeResiduals)
+		residuals[blockStart[r->host->idx * numFrames + r->target->idx]++] = r;
+
+	int n = residuals.size();
+	points.resize(n);
+	precalc.resize(n);
+	u.resize(n);
+	v.resize(n);
+	idepthScaled.resize(n);
+	idepthZeroScaled.resize(n);
+	color.resize(n * MAX_RES_PER_POINT);
+	weights.resize(n * MAX_RES_PER_POINT);
+
+	for(Block& block : blocks)
+	{
+		block.host = residuals[block.begin]->host;
+		block.target = residuals[block.begin]->target;
+		const FrameFramePrecalc* blockPrecalc = &(block.host->targetPrecalc[block.target->idx]);
+		for(int i = block.begin; i < block.end; i++)
+		{
+			PointHessian* ph = residuals[i]->point;
+			points[i] = ph;
+			precalc[i] = blockPrecalc;
+			u[i] = ph->u;
+			v[i] = ph->v;
+			memcpy(&color[i * MAX_RES_PER_POINT], ph->color, sizeof(float) * MAX_RES_PER_POINT);
+			memcpy(&weights[i * MAX_RES_PER_POINT], ph->weights, sizeof(float) * MAX_RES_PER_POINT);
+		}
+	}
+	updateDepths(0, n);
+}
+
+void ResidualBlockTable::updateDepths(int min, int max)
+{
+	for(int i = min; i < max; i++)
+	{
+		idepthScaled[i] = points[i]->idepth_scaled;
+		idepthZeroScaled[i] = points[i]->idepth_zero_scaled;
+	}
+}
+
+double ResidualBlockTable::linearize(CalibHessian* HCalib, int min, int max)
+{
+	double energy = 0;
+	alignas(16) float energies[4];
+
+	// first block overlapping [min, max).
+	auto block = std::upper_bound(blocks.begin(), blocks.end(), min,
+								  [](int k, const Block& b) {return k < b.end;});
+	for(int k = min; k < max; block++)
+	{
+		int end = std::min(max, block->end);
+		for(; k + 4 <= end; k += 4)
+		{
+			linearize4(HCalib, k, energies);
+			for(int i = 0; i < 4; i++)
+				energy += energies[i];
+		}
+		for(; k < end; k++)
+			energy += residuals[k]->linearize(HCalib, getInput(k));
+	}
+	return energy;
+}
+
+// Same computation as PointFrameResidual::linearize, for the residuals k, ..., k+3 of one block, one in each SSE lane.
+// Lanes which are OOB are masked out, and keep their old energy just like in the scalar version.
+void ResidualBlockTable::linearize4(CalibHessian* HCalib, int k, float* energies)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1);
+	const __m128 two = _mm_set1_ps(2);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 inf = _mm_set1_ps(INFINITY);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	const __m128 minPos = _mm_set1_ps(1.1f);
+	const __m128 maxU = _mm_set1_ps(wM3G);
+	const __m128 maxV = _mm_set1_ps(hM3G);
+
+	PointFrameResidual* const* r = &residuals[k];
+	int oob = 0;	// bitmask of the lanes which are OOB.
+	for(int i = 0; i < 4; i++)
+	{
+		r[i]->state_NewEnergyWithOutlier = -1;
+		if(r[i]->state_state == ResState::OOB) oob |= 1 << i;
+	}
+
+	const FrameFramePrecalc* pc = precalc[k];
+	const Eigen::Vector3f* dIl = r[0]->target->dI;
+	const Mat33f &PRE_KRKiTll = pc->PRE_KRKiTll;
+	const Vec3f &PRE_KtTll = pc->PRE_KtTll;
+	const Mat33f &PRE_RTll_0 = pc->PRE_RTll_0;
+	const Vec3f &PRE_tTll_0 = pc->PRE_tTll_0;
+	const __m128 affLL0 = _mm_set1_ps(pc->PRE_aff_mode[0]);
+	const __m128 affLL1 = _mm_set1_ps(pc->PRE_aff_mode[1]);
+	const __m128 b0 = _mm_set1_ps(pc->PRE_b0_mode);
+
+	const __m128 fxl = _mm_set1_ps(HCalib->fxl()), fyl = _mm_set1_ps(HCalib->fyl());
+	const __m128 cxl = _mm_set1_ps(HCalib->cxl()), cyl = _mm_set1_ps(HCalib->cyl());
+	const __m128 fxli = _mm_set1_ps(HCalib->fxli()), fyli = _mm_set1_ps(HCalib->fyli());
+
+	const __m128 pu = _mm_loadu_ps(&u[k]);
+	const __m128 pv = _mm_loadu_ps(&v[k]);
+	const __m128 idepth = _mm_loadu_ps(&idepthScaled[k]);
+	const __m128 idepthZero = _mm_loadu_ps(&idepthZeroScaled[k]);
+
+	auto set1 = [](float f) {return _mm_set1_ps(f);};
+	auto inImage = [&](__m128 Ku, __m128 Kv)
+	{
+		return _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(Ku, minPos), _mm_cmpgt_ps(Kv, minPos)),
+						  _mm_and_ps(_mm_cmplt_ps(Ku, maxU), _mm_cmplt_ps(Kv, maxV)));
+	};
+
+	// Jacobian of the projected center w.r.t. pose, calibration and depth (at the linearization point).
+	{
+		__m128 KliP0 = _mm_mul_ps(_mm_sub_ps(pu, cxl), fxli);
+		__m128 KliP1 = _mm_mul_ps(_mm_sub_ps(pv, cyl), fyli);
+		__m128 ptp[3];
+		for(int i = 0; i < 3; i++)
+			ptp[i] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(set1(PRE_RTll_0(i, 0)), KliP0),
+													  _mm_mul_ps(set1(PRE_RTll_0(i, 1)), KliP1)), set1(PRE_RTll_0(i, 2))),
+								_mm_mul_ps(set1(PRE_tTll_0[i]), idepthZero));
+		__m128 drescale = _mm_div_ps(one, ptp[2]);
+		__m128 new_idepth = _mm_mul_ps(idepthZero, drescale);
+		__m128 u = _mm_mul_ps(ptp[0], drescale);
+		__m128 v = _mm_mul_ps(ptp[1], drescale);
+		__m128 Ku = _mm_add_ps(_mm_mul_ps(u, fxl), cxl);
+		__m128 Kv = _mm_add_ps(_mm_mul_ps(v, fyl), cyl);
+		oob |= ~_mm_movemask_ps(_mm_and_ps(_mm_cmpgt_ps(drescale, zero), inImage(Ku, Kv))) & 0xF;
+		if(oob == 0xF)
+		{
+			for(int i = 0; i < 4; i++)
+			{
+				r[i]->state_NewState = ResState::OOB;
+				energies[i] = r[i]->state_energy;
+			}
+			return;
+		}
+
+		const __m128 scaleIdepth = set1(SCALE_IDEPTH), scaleF = set1(SCALE_F), scaleC = set1(SCALE_C);
+		__m128 d_d_x = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(drescale, _mm_sub_ps(set1(PRE_tTll_0[0]), _mm_mul_ps(set1(PRE_tTll_0[2]), u))), scaleIdepth), fxl);
+		__m128 d_d_y = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(drescale, _mm_sub_ps(set1(PRE_tTll_0[1]), _mm_mul_ps(set1(PRE_tTll_0[2]), v))), scaleIdepth), fyl);
+
+		__m128 d_C_x[4], d_C_y[4];
+		d_C_x[2] = _mm_mul_ps(drescale, _mm_sub_ps(_mm_mul_ps(set1(PRE_RTll_0(2,0)), u), set1(PRE_RTll_0(0,0))));
+		d_C_x[3] = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(fxl, drescale), _mm_sub_ps(_mm_mul_ps(set1(PRE_RTll_0(2,1)), u), set1(PRE_RTll_0(0,1)))), fyli);
+		d_C_x[0] = _mm_mul_ps(KliP0, d_C_x[2]);
+		d_C_x[1] = _mm_mul_ps(KliP1, d_C_x[3]);
+
+		d_C_y[2] = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(fyl, drescale), _mm_sub_ps(_mm_mul_ps(set1(PRE_RTll_0(2,0)), v), set1(PRE_RTll_0(1,0)))), fxli);
+		d_C_y[3] = _mm_mul_ps(drescale, _mm_sub_ps(_mm_mul_ps(set1(PRE_RTll_0(2,1)), v), set1(PRE_RTll_0(1,1))));
+		d_C_y[0] = _mm_mul_ps(KliP0, d_C_y[2]);
+		d_C_y[1] = _mm_mul_ps(KliP1, d_C_y[3]);
+
+		d_C_x[0] = _mm_mul_ps(_mm_add_ps(d_C_x[0], u), scaleF);
+		d_C_x[1] = _mm_mul_ps(d_C_x[1], scaleF);
+		d_C_x[2] = _mm_mul_ps(_mm_add_ps(d_C_x[2], one), scaleC);
+		d_C_x[3] = _mm_mul_ps(d_C_x[3], scaleC);
+
+		d_C_y[0] = _mm_mul_ps(d_C_y[0], scaleF);
+		d_C_y[1] = _mm_mul_ps(_mm_add_ps(d_C_y[1], v), scaleF);
+		d_C_y[2] = _mm_mul_ps(d_C_y[2], scaleC);
+		d_C_y[3] = _mm_mul_ps(_mm_add_ps(d_C_y[3], one), scaleC);
+
+		__m128 d_xi_x[6], d_xi_y[6];
+		__m128 uv = _mm_mul_ps(u, v);
+		d_xi_x[0] = _mm_mul_ps(new_idepth, fxl);
+		d_xi_x[1] = zero;
+		d_xi_x[2] = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(zero, new_idepth), u), fxl);
+		d_xi_x[3] = _mm_mul_ps(_mm_sub_ps(zero, uv), fxl);
+		d_xi_x[4] = _mm_mul_ps(_mm_add_ps(one, _mm_mul_ps(u, u)), fxl);
+		d_xi_x[5] = _mm_mul_ps(_mm_sub_ps(zero, v), fxl);
+
+		d_xi_y[0] = zero;
+		d_xi_y[1] = _mm_mul_ps(new_idepth, fyl);
+		d_xi_y[2] = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(zero, new_idepth), v), fyl);
+		d_xi_y[3] = _mm_mul_ps(_mm_sub_ps(zero, _mm_add_ps(one, _mm_mul_ps(v, v))), fyl);
+		d_xi_y[4] = _mm_mul_ps(uv, fyl);
+		d_xi_y[5] = _mm_mul_ps(u, fyl);
+
+		// transpose into the Jacobians of the lanes.
+		alignas(16) float out[23][4];
+		_mm_store_ps(out[0], Ku);
+		_mm_store_ps(out[1], Kv);
+		_mm_store_ps(out[2], new_idepth);
+		_mm_store_ps(out[3], d_d_x);
+		_mm_store_ps(out[4], d_d_y);
+		for(int j = 0; j < 4; j++)
+		{
+			_mm_store_ps(out[5 + j], d_C_x[j]);
+			_mm_store_ps(out[9 + j], d_C_y[j]);
+		}
+		for(int j = 0; j < 5; j++)
+		{
+			_mm_store_ps(out[13 + j], d_xi_x[j + 1]);
+			_mm_store_ps(out[18 + j], d_xi_y[j + 1]);
+		}
+		alignas(16) float d_xi_x0[4], d_xi_y0[4];
+		_mm_store_ps(d_xi_x0, d_xi_x[0]);
+		_mm_store_ps(d_xi_y0, d_xi_y[0]);
+		for(int i = 0; i < 4; i++)
+		{
+			if(oob & (1 << i)) continue;
+			RawResidualJacobian* J = r[i]->J;
+			r[i]->centerProjectedTo = Vec3f(out[0][i], out[1][i], out[2][i]);
+			J->Jpdxi[0][0] = d_xi_x0[i];
+			J->Jpdxi[1][0] = d_xi_y0[i];
+			for(int j = 0; j < 5; j++)
+			{
+				J->Jpdxi[0][j + 1] = out[13 + j][i];
+				J->Jpdxi[1][j + 1] = out[18 + j][i];
+			}
+			for(int j = 0; j < 4; j++)
+			{
+				J->Jpdc[0][j] = out[5 + j][i];
+				J->Jpdc[1][j] = out[9 + j][i];
+			}
+			J->Jpdd[0] = out[3][i];
+			J->Jpdd[1] = out[4][i];
+		}
+	}
+
+	__m128 energyLeft = zero;
+	__m128 JIdxJIdx_00 = zero, JIdxJIdx_11 = zero, JIdxJIdx_10 = zero;
+	__m128 JabJIdx_00 = zero, JabJIdx_01 = zero, JabJIdx_10 = zero, JabJIdx_11 = zero;
+	__m128 JabJab_00 = zero, JabJab_01 = zero, JabJab_11 = zero;
+	__m128 wJI2_sum = zero;
+
+	const __m128 huberTH = set1(setting_huberTH);
+	const __m128 outlierTHSumComponent = set1(setting_outlierTHSumComponent);
+	const int wl = wG[0];
+
+	for(int idx = 0; idx < patternNum; idx++)
+	{
+		__m128 pu_idx = _mm_add_ps(pu, set1(patternP[idx][0]));
+		__m128 pv_idx = _mm_add_ps(pv, set1(patternP[idx][1]));
+		__m128 ptp[3];
+		for(int i = 0; i < 3; i++)
+			ptp[i] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(set1(PRE_KRKiTll(i, 0)), pu_idx),
+													  _mm_mul_ps(set1(PRE_KRKiTll(i, 1)), pv_idx)), set1(PRE_KRKiTll(i, 2))),
+								_mm_mul_ps(set1(PRE_KtTll[i]), idepth));
+		__m128 Ku = _mm_div_ps(ptp[0], ptp[2]);
+		__m128 Kv = _mm_div_ps(ptp[1], ptp[2]);
+		oob |= ~_mm_movemask_ps(inImage(Ku, Kv)) & 0xF;
+		if(oob == 0xF) break;
+
+		// bilinear interpolation as in getInterpolatedElement33, gathering the corners of the lanes which are in the image.
+		__m128i ix = _mm_cvttps_epi32(Ku);
+		__m128i iy = _mm_cvttps_epi32(Kv);
+		__m128 dx = _mm_sub_ps(Ku, _mm_cvtepi32_ps(ix));
+		__m128 dy = _mm_sub_ps(Kv, _mm_cvtepi32_ps(iy));
+		__m128 dxdy = _mm_mul_ps(dx, dy);
+
+		alignas(16) float KuLanes[4], KvLanes[4];
+		_mm_store_ps(KuLanes, Ku);
+		_mm_store_ps(KvLanes, Kv);
+		alignas(16) int ixs[4], iys[4];
+		_mm_store_si128((__m128i*)ixs, ix);
+		_mm_store_si128((__m128i*)iys, iy);
+		alignas(16) float c[3][4][4];	// [channel][corner][lane]
+		for(int i = 0; i < 4; i++)
+		{
+			if(oob & (1 << i))
+			{
+				for(int ch = 0; ch < 3; ch++)
+					for(int corner = 0; corner < 4; corner++)
+						c[ch][corner][i] = 0;
+				continue;
+			}
+			r[i]->projectedTo[idx][0] = KuLanes[i];
+			r[i]->projectedTo[idx][1] = KvLanes[i];
+			const Eigen::Vector3f* bp = dIl + ixs[i] + iys[i]*wl;
+			for(int ch = 0; ch < 3; ch++)
+			{
+				c[ch][0][i] = bp[0][ch];
+				c[ch][1][i] = bp[1][ch];
+				c[ch][2][i] = bp[wl][ch];
+				c[ch][3][i] = bp[1+wl][ch];
+			}
+		}
+		__m128 w00 = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(one, dx), dy), dxdy);
+		__m128 w10 = _mm_sub_ps(dx, dxdy);
+		__m128 w01 = _mm_sub_ps(dy, dxdy);
+		__m128 hitColor[3];
+		for(int ch = 0; ch < 3; ch++)
+		{
+			hitColor[ch] = _mm_mul_ps(dxdy, _mm_load_ps(c[ch][3]));
+			hitColor[ch] = _mm_add_ps(hitColor[ch], _mm_mul_ps(w01, _mm_load_ps(c[ch][2])));
+			hitColor[ch] = _mm_add_ps(hitColor[ch], _mm_mul_ps(w10, _mm_load_ps(c[ch][1])));
+			hitColor[ch] = _mm_add_ps(hitColor[ch], _mm_mul_ps(w00, _mm_load_ps(c[ch][0])));
+		}
+
+		alignas(16) float colorLanes[4], weightLanes[4];
+		for(int i = 0; i < 4; i++)
+		{
+			colorLanes[i] = color[(k + i) * MAX_RES_PER_POINT + idx];
+			weightLanes[i] = weights[(k + i) * MAX_RES_PER_POINT + idx];
+		}
+		__m128 colorIdx = _mm_load_ps(colorLanes);
+		__m128 residual = _mm_sub_ps(hitColor[0], _mm_add_ps(_mm_mul_ps(affLL0, colorIdx), affLL1));
+		__m128 drdA = _mm_sub_ps(colorIdx, b0);
+
+		oob |= ~_mm_movemask_ps(_mm_cmplt_ps(_mm_and_ps(hitColor[0], absMask), inf)) & 0xF;
+		if(oob == 0xF) break;
+
+		__m128 gradSquared = _mm_add_ps(_mm_mul_ps(hitColor[1], hitColor[1]), _mm_mul_ps(hitColor[2], hitColor[2]));
+		__m128 w = _mm_sqrt_ps(_mm_div_ps(outlierTHSumComponent, _mm_add_ps(outlierTHSumComponent, gradSquared)));
+		w = _mm_mul_ps(half, _mm_add_ps(w, _mm_load_ps(weightLanes)));
+
+		__m128 absResidual = _mm_and_ps(residual, absMask);
+		__m128 isInlier = _mm_cmplt_ps(absResidual, huberTH);
+		__m128 hw = _mm_or_ps(_mm_and_ps(isInlier, one), _mm_andnot_ps(isInlier, _mm_div_ps(huberTH, absResidual)));
+		energyLeft = _mm_add_ps(energyLeft, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(_mm_mul_ps(_mm_mul_ps(w, w), hw), residual), residual), _mm_sub_ps(two, hw)));
+
+		hw = _mm_or_ps(_mm_and_ps(isInlier, hw), _mm_andnot_ps(isInlier, _mm_sqrt_ps(hw)));
+		hw = _mm_mul_ps(hw, w);
+
+		__m128 gx = _mm_mul_ps(hitColor[1], hw);
+		__m128 gy = _mm_mul_ps(hitColor[2], hw);
+		__m128 JabF0 = _mm_mul_ps(drdA, hw);
+
+		JIdxJIdx_00 = _mm_add_ps(JIdxJIdx_00, _mm_mul_ps(gx, gx));
+		JIdxJIdx_11 = _mm_add_ps(JIdxJIdx_11, _mm_mul_ps(gy, gy));
+		JIdxJIdx_10 = _mm_add_ps(JIdxJIdx_10, _mm_mul_ps(gx, gy));
+
+		JabJIdx_00 = _mm_add_ps(JabJIdx_00, _mm_mul_ps(JabF0, gx));
+		JabJIdx_01 = _mm_add_ps(JabJIdx_01, _mm_mul_ps(JabF0, gy));
+		JabJIdx_10 = _mm_add_ps(JabJIdx_10, _mm_mul_ps(hw, gx));
+		JabJIdx_11 = _mm_add_ps(JabJIdx_11, _mm_mul_ps(hw, gy));
+
+		JabJab_00 = _mm_add_ps(JabJab_00, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(drdA, drdA), hw), hw));
+		JabJab_01 = _mm_add_ps(JabJab_01, _mm_mul_ps(_mm_mul_ps(drdA, hw), hw));
+		JabJab_11 = _mm_add_ps(JabJab_11, _mm_mul_ps(hw, hw));
+
+		wJI2_sum = _mm_add_ps(wJI2_sum, _mm_mul_ps(_mm_mul_ps(hw, hw), _mm_add_ps(_mm_mul_ps(gx, gx), _mm_mul_ps(gy, gy))));
+
+		alignas(16) float out[5][4];
+		_mm_store_ps(out[0], _mm_mul_ps(residual, hw));
+		_mm_store_ps(out[1], gx);
+		_mm_store_ps(out[2], gy);
+		_mm_store_ps(out[3], setting_affineOptModeA < 0 ? zero : JabF0);
+		_mm_store_ps(out[4], setting_affineOptModeB < 0 ? zero : hw);
+		for(int i = 0; i < 4; i++)
+		{
+			if(oob & (1 << i)) continue;
+			RawResidualJacobian* J = r[i]->J;
+			J->resF[idx] = out[0][i];
+			J->JIdx[0][idx] = out[1][i];
+			J->JIdx[1][idx] = out[2][i];
+			J->JabF[0][idx] = out[3][i];
+			J->JabF[1][idx] = out[4][i];
+		}
+	}
+
+	alignas(16) float sums[11][4];
+	__m128 sumVectors[11] = {energyLeft, wJI2_sum, JIdxJIdx_00, JIdxJIdx_10, JIdxJIdx_11,
+							 JabJIdx_00, JabJIdx_01, JabJIdx_10, JabJIdx_11, JabJab_00, JabJab_01};
+	for(int j = 0; j < 11; j++)
+		_mm_store_ps(sums[j], sumVectors[j]);
+	alignas(16) float JabJab_11Lanes[4];
+	_mm_store_ps(JabJab_11Lanes, JabJab_11);
+
+	const float energyTH = std::max<float>(r[0]->host->frameEnergyTH, r[0]->target->frameEnergyTH);
+	for(int i = 0; i < 4; i++)
+	{
+		PointFrameResidual* ri = r[i];
+		if(oob & (1 << i))
+		{
+			ri->state_NewState = ResState::OOB;
+			energies[i] = ri->state_energy;
+			continue;
+		}
+
+		RawResidualJacobian* J = ri->J;
+		J->JIdx2(0,0) = sums[2][i];
+		J->JIdx2(0,1) = sums[3][i];
+		J->JIdx2(1,0) = sums[3][i];
+		J->JIdx2(1,1) = sums[4][i];
+		J->JabJIdx(0,0) = sums[5][i];
+		J->JabJIdx(0,1) = sums[6][i];
+		J->JabJIdx(1,0) = sums[7][i];
+		J->JabJIdx(1,1) = sums[8][i];
+		J->Jab2(0,0) = sums[9][i];
+		J->Jab2(0,1) = sums[10][i];
+		J->Jab2(1,0) = sums[10][i];
+		J->Jab2(1,1) = JabJab_11Lanes[i];
+
+		float energyLeftI = sums[0][i];
+		ri->state_NewEnergyWithOutlier = energyLeftI;
+		if(energyLeftI > energyTH || sums[1][i] < 2)
+		{
+			energyLeftI = energyTH;
+			ri->state_NewState = ResState::OUTLIER;
+		}
+		else
+		{
+			ri->state_NewState = ResState::IN;
+		}
+		ri->state_NewEnergy = energyLeftI;
+		energies[i] = energyLeftI;
+	}
+}
+
+}
+
@@ -0,0 +1,97 @@
+/**
+* This file is part of DSO, written by Jakob Engel.
+* It has been modified by Lukas von Stumberg for the inclusion in DM-VIO (http://vision.in.tum.de/dm-vio).
+*
+* Copyright 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>
+* Copyright 2016 Technical University of Munich and Intel.
+* Developed by Jakob Engel <engelj at in dot tum dot de>,
+* for more information see <http://vision.in.tum.de/dso>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DSO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DSO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DSO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#pragma once
+
+#include "util/NumType.h"
+#include "FullSystem/Residuals.h"
+#include <vector>
+
+namespace dso
+{
+class PointHessian;
+class FrameHessian;
+class CalibHessian;
+
+// The active residuals of an optimization, grouped by (host, target) pair, together with the point data needed by
+// PointFrameResidual::linearize in contiguous arrays. linearizeAll and applyRes iterate the table instead of
+// activeResiduals. As the residuals of a block share precalc and target image, linearize evaluates them four at a
+// time with SSE, reading the point data of the lanes directly from the arrays.
+class ResidualBlockTable
+{
+public:
+	struct Block
+	{
+		FrameHessian* host;
+		FrameHessian* target;
+		int begin, end; // range of residuals.
+	};
+
+	// Sorts residuals by (host->idx, target->idx) (stable) into the table and copies the point data which stays
+	// constant during the optimization. Frame indices have to be up to date (see EnergyFunctional::makeIDX).
+	void build(const std::vector<PointFrameResidual*>& activeResiduals, int numFrames);
+
+	// Copies the current depths of the points of residuals [min, max), which change with every step.
+	void updateDepths(int min, int max);
+
+	// Linearizes the residuals [min, max) like PointFrameResidual::linearize, and returns the sum of their energies.
+	// The depths have to be up to date (updateDepths).
+	double linearize(CalibHessian* HCalib, int min, int max);
+
+	inline PointFrameResidual* residual(int i) const {return residuals[i];}
+
+	inline ResidualLinearizeInput getInput(int i) const
+	{
+		ResidualLinearizeInput in;
+		in.precalc = precalc[i];
+		in.u = u[i];
+		in.v = v[i];
+		in.idepthScaled = idepthScaled[i];
+		in.idepthZeroScaled = idepthZeroScaled[i];
+		in.color = &color[i * MAX_RES_PER_POINT];
+		in.weights = &weights[i * MAX_RES_PER_POINT];
+		return in;
+	}
+
+	inline int size() const {return (int)residuals.size();}
+
+	std::vector<Block> blocks;
+
+private:
+	// residuals k, ..., k+3, which have to be in the same block.
+	void linearize4(CalibHessian* HCalib, int k, float* energies);
+
+	std::vector<PointFrameResidual*> residuals;
+	std::vector<PointHessian*> points;
+	std::vector<const FrameFramePrecalc*> precalc;
+	std::vector<float> u, v, idepthScaled, idepthZeroScaled;
+	std::vector<float, Eigen::aligned_allocator<float>> color, weights;
+
+	std::vector<int> blockStart; // temporary for the counting sort.
+};
+
+}
@@ -56,7 +56,7 @@ long runningResID=0;
 
 PointFrameResidual::PointFrameResidual(){assert(false); instanceCounter++;}
 
-PointFrameResidual::~PointFrameResidual(){assert(efResidual==0); instanceCounter--; delete J;}
+PointFrameResidual::~PointFrameResidual(){assert(efResidual==0); instanceCounter--;}
 
 PointFrameResidual::PointFrameResidual(PointHessian* point_, FrameHessian* host_, FrameHessian* target_) :
 	point(point_),
@@ -66,7 +66,7 @@ PointFrameResidual::PointFrameResidual(PointHessian* point_, FrameHessian* host_
 	efResidual=0;
 	instanceCounter++;
 	resetOOB();
-	J = new RawResidualJacobian();
+	J = &jacobianStorage[0];
 	assert(((long)J)%16==0);
 
 	isNew=true;
@@ -82,13 +82,26 @@ PointFrameResidual::PointFrameResidual(PointHessian* point_, FrameHessian* host_
  */
 
 double PointFrameResidual::linearize(CalibHessian* HCalib)
+{
+	ResidualLinearizeInput in;
+	in.precalc = &(host->targetPrecalc[target->idx]);
+	in.u = point->u;
+	in.v = point->v;
+	in.idepthScaled = point->idepth_scaled;
+	in.idepthZeroScaled = point->idepth_zero_scaled;
+	in.color = point->color;
+	in.weights = point->weights;
+	return linearize(HCalib, in);
+}
+
+double PointFrameResidual::linearize(CalibHessian* HCalib, const ResidualLinearizeInput& in)
 {
 	state_NewEnergyWithOutlier=-1;
 
 	if(state_state == ResState::OOB)
 		{ state_NewState = ResState::OOB; return state_energy; }
 
-	FrameFramePrecalc* precalc = &(host->targetPrecalc[target->idx]);
+	const FrameFramePrecalc* precalc = in.precalc;
 	float energyLeft=0;
 	const Eigen::Vector3f* dIl = target->dI;
 	//const float* const Il = target->I;
@@ -96,8 +109,8 @@ double PointFrameResidual::linearize(CalibHessian* HCalib)
 	const Vec3f &PRE_KtTll = precalc->PRE_KtTll;
 	const Mat33f &PRE_RTll_0 = precalc->PRE_RTll_0;
 	const Vec3f &PRE_tTll_0 = precalc->PRE_tTll_0;
-	const float * const color = point->color;
-	const float * const weights = point->weights;
+	const float * const color = in.color;
+	const float * const weights = in.weights;
 
 	Vec2f affLL = precalc->PRE_aff_mode;
 	float b0 = precalc->PRE_b0_mode;
@@ -111,7 +124,7 @@ double PointFrameResidual::linearize(CalibHessian* HCalib)
 		float Ku, Kv;
 		Vec3f KliP;
 
-		if(!projectPoint(point->u, point->v, point->idepth_zero_scaled, 0, 0,HCalib,
+		if(!projectPoint(in.u, in.v, in.idepthZeroScaled, 0, 0,HCalib,
 				PRE_RTll_0,PRE_tTll_0, drescale, u, v, Ku, Kv, KliP, new_idepth))
 			{ state_NewState = ResState::OOB; return state_energy; }
 
@@ -189,7 +202,7 @@ double PointFrameResidual::linearize(CalibHessian* HCalib)
 	for(int idx=0;idx<patternNum;idx++)
 	{
 		float Ku, Kv;
-		if(!projectPoint(point->u+patternP[idx][0], point->v+patternP[idx][1], point->idepth_scaled, PRE_KRKiTll, PRE_KtTll, Ku, Kv))
+		if(!projectPoint(in.u+patternP[idx][0], in.v+patternP[idx][1], in.idepthScaled, PRE_KRKiTll, PRE_KtTll, Ku, Kv))
 			{ state_NewState = ResState::OOB; return state_energy; }
 
 		projectedTo[idx][0] = Ku;
@@ -320,11 +333,13 @@ void PointFrameResidual::applyRes(bool copyJacobians)
 		}
 		if(state_NewState == ResState::IN)// && )
 		{
+			if(!efResidual->isActiveAndIsGoodNEW) efResidual->changedSinceAccumulation=true;
 			efResidual->isActiveAndIsGoodNEW=true;
 			efResidual->takeDataF();
 		}
 		else
 		{
+			if(efResidual->isActiveAndIsGoodNEW) efResidual->changedSinceAccumulation=true;
 			efResidual->isActiveAndIsGoodNEW=false;
 		}
 	}
@@ -33,6 +33,7 @@
 #include <fstream>
 #include "util/globalFuncs.h"
 #include "OptimizationBackend/RawResidualJacobian.h"
+#include "util/SlabAllocator.h"
 
 namespace dso
 {
@@ -41,6 +42,7 @@ class FrameHessian;
 class CalibHessian;
 
 class EFResidual;
+struct FrameFramePrecalc;
 
 
 enum ResLocation {ACTIVE=0, LINEARIZED, MARGINALIZED, NONE};
@@ -51,10 +53,24 @@ struct FullJacRowT
 	Eigen::Vector2f projectedTo[MAX_RES_PER_POINT];
 };
 
+// Everything PointFrameResidual::linearize reads from the point and the host-target precalc.
+// Taken either directly from the PointHessian or from the arrays of a ResidualBlockTable.
+struct ResidualLinearizeInput
+{
+	const FrameFramePrecalc* precalc;
+	float u, v;
+	float idepthScaled, idepthZeroScaled;
+	const float* color;
+	const float* weights;
+};
+
 class PointFrameResidual
 {
 public:
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+	// allocated from FullSystem::residualAllocator with new (allocator) PointFrameResidual(...).
+	inline void* operator new(size_t size, SlabAllocator<PointFrameResidual>& allocator) {return allocator.allocate(size);}
+	inline void operator delete(void* ptr, SlabAllocator<PointFrameResidual>& allocator) {SlabAllocatorBase::deallocate(ptr);}
+	inline void operator delete(void* ptr) {SlabAllocatorBase::deallocate(ptr);}
 
 	EFResidual* efResidual;
 
@@ -76,6 +92,9 @@ public:
 	FrameHessian* target;
 	RawResidualJacobian* J;
 
+	// storage for J and the J of efResidual, which are swapped in EFResidual::takeDataF.
+	RawResidualJacobian jacobianStorage[2];
+
 
 	bool isNew;
 
@@ -87,6 +106,7 @@ public:
 	PointFrameResidual();
 	PointFrameResidual(PointHessian* point_, FrameHessian* host_, FrameHessian* target_);
 	double linearize(CalibHessian* HCalib);
+	double linearize(CalibHessian* HCalib, const ResidualLinearizeInput& in);
 
 
 	void resetOOB()
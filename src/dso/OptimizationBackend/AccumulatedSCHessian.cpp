@@ -79,7 +79,7 @@ void AccumulatedSCHessianSSE::stitchDoubleInternal(
 		MatXX* H, VecX* b, EnergyFunctional const * const EF,
 		int min, int max, Vec10* stats, int tid)
 {
-	int toAggregate = NUM_THREADS;
+	int toAggregate = numThreadsToAggregate;
 	if(tid == -1) { toAggregate = 1; tid = 0; }	// special case: if we dont do multithreading, dont aggregate.
 	if(min==max) return;
 
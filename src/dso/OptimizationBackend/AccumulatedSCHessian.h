@@ -44,17 +44,18 @@ public:
 	EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
 	inline AccumulatedSCHessianSSE()
 	{
-		for(int i=0;i<NUM_THREADS;i++)
+		for(int i=0;i<MAX_NUM_THREADS;i++)
 		{
 			accE[i]=0;
 			accEB[i]=0;
 			accD[i]=0;
 			nframes[i]=0;
 		}
+		numThreadsToAggregate = 1;
 	};
 	inline ~AccumulatedSCHessianSSE()
 	{
-		for(int i=0;i<NUM_THREADS;i++)
+		for(int i=0;i<MAX_NUM_THREADS;i++)
 		{
 			if(accE[i] != 0) delete[] accE[i];
 			if(accEB[i] != 0) delete[] accEB[i];
@@ -95,9 +96,10 @@ public:
 		// sum up, splitting by bock in square.
 		if(MT)
 		{
-			MatXX Hs[NUM_THREADS];
-			VecX bs[NUM_THREADS];
-			for(int i=0;i<NUM_THREADS;i++)
+			numThreadsToAggregate = red->getNumThreads();
+			std::vector<MatXX> Hs(numThreadsToAggregate);
+			std::vector<VecX> bs(numThreadsToAggregate);
+			for(int i=0;i<numThreadsToAggregate;i++)
 			{
 				assert(nframes[0] == nframes[i]);
 				Hs[i] = MatXX::Zero(nframes[0]*8+CPARS, nframes[0]*8+CPARS);
@@ -105,13 +107,13 @@ public:
 			}
 
 			red->reduce(boost::bind(&AccumulatedSCHessianSSE::stitchDoubleInternal,
-				this,Hs, bs, EF,  _1, _2, _3, _4), 0, nframes[0]*nframes[0], 0);
+				this,Hs.data(), bs.data(), EF,  _1, _2, _3, _4), 0, nframes[0]*nframes[0], 0);
 
 			// sum up results
 			H = Hs[0];
 			b = bs[0];
 
-			for(int i=1;i<NUM_THREADS;i++)
+			for(int i=1;i<numThreadsToAggregate;i++)
 			{
 				H.noalias() += Hs[i];
 				b.noalias() += bs[i];
@@ -133,12 +135,15 @@ public:
 	}
 
 
-	AccumulatorXX<8,CPARS>* accE[NUM_THREADS];
-	AccumulatorX<8>* accEB[NUM_THREADS];
-	AccumulatorXX<8,8>* accD[NUM_THREADS];
-	AccumulatorXX<CPARS,CPARS> accHcc[NUM_THREADS];
-	AccumulatorX<CPARS> accbc[NUM_THREADS];
-	int nframes[NUM_THREADS];
+	AccumulatorXX<8,CPARS>* accE[MAX_NUM_THREADS];
+	AccumulatorX<8>* accEB[MAX_NUM_THREADS];
+	AccumulatorXX<8,8>* accD[MAX_NUM_THREADS];
+	AccumulatorXX<CPARS,CPARS> accHcc[MAX_NUM_THREADS];
+	AccumulatorX<CPARS> accbc[MAX_NUM_THREADS];
+	int nframes[MAX_NUM_THREADS];
+
+	// number of per-thread accumulators filled by the last multithreaded pass.
+	int numThreadsToAggregate;
 
 
 	void addPointsInternal(
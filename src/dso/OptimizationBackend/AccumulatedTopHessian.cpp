@@ -71,6 +71,9 @@ void AccumulatedTopHessianSSE::addPoint(EFPoint* p, EnergyFunctional const * con
 		int htIDX = r->hostIDX + r->targetIDX*nframes[tid];
 		Mat18f dp = ef->adHTdeltaF[htIDX];
 
+		// in incremental mode H of unchanged blocks is taken from the cache, only b and the point part are computed.
+		bool accumulate = !(mode==0 && incrementalActive && !blockDirty[htIDX]);
+
 
 
 		VecNRf resApprox;
@@ -112,29 +115,39 @@ void AccumulatedTopHessianSSE::addPoint(EFPoint* p, EnergyFunctional const * con
 		}
 
 
-		acc[tid][htIDX].update(
-				rJ->Jpdc[0].data(), rJ->Jpdxi[0].data(),
-				rJ->Jpdc[1].data(), rJ->Jpdxi[1].data(),
-				rJ->JIdx2(0,0),rJ->JIdx2(0,1),rJ->JIdx2(1,1));
-
-		acc[tid][htIDX].updateBotRight(
-				rJ->Jab2(0,0), rJ->Jab2(0,1), Jab_r[0],
-				rJ->Jab2(1,1), Jab_r[1],rr);
-
-		acc[tid][htIDX].updateTopRight(
-				rJ->Jpdc[0].data(), rJ->Jpdxi[0].data(),
-				rJ->Jpdc[1].data(), rJ->Jpdxi[1].data(),
-				rJ->JabJIdx(0,0), rJ->JabJIdx(0,1),
-				rJ->JabJIdx(1,0), rJ->JabJIdx(1,1),
-				JI_r[0], JI_r[1]);
+		if(accumulate)
+		{
+			acc[tid][htIDX].update(
+					rJ->Jpdc[0].data(), rJ->Jpdxi[0].data(),
+					rJ->Jpdc[1].data(), rJ->Jpdxi[1].data(),
+					rJ->JIdx2(0,0),rJ->JIdx2(0,1),rJ->JIdx2(1,1));
+
+			acc[tid][htIDX].updateBotRight(
+					rJ->Jab2(0,0), rJ->Jab2(0,1), Jab_r[0],
+					rJ->Jab2(1,1), Jab_r[1],rr);
+
+			acc[tid][htIDX].updateTopRight(
+					rJ->Jpdc[0].data(), rJ->Jpdxi[0].data(),
+					rJ->Jpdc[1].data(), rJ->Jpdxi[1].data(),
+					rJ->JabJIdx(0,0), rJ->JabJIdx(0,1),
+					rJ->JabJIdx(1,0), rJ->JabJIdx(1,1),
+					JI_r[0], JI_r[1]);
+			nres[tid]++;
+		}
+		else
+		{
+			Eigen::Matrix<float,CPARS+8,1> Jr;
+			Jr.head<CPARS>() = rJ->Jpdc[0]*JI_r[0] + rJ->Jpdc[1]*JI_r[1];
+			Jr.segment<6>(CPARS) = rJ->Jpdxi[0]*JI_r[0] + rJ->Jpdxi[1]*JI_r[1];
+			Jr.tail<2>() = Jab_r;
+			bAcc[tid][htIDX].updateNoWeight(Jr);
+		}
 
 
 		Vec2f Ji2_Jpdd = rJ->JIdx2 * rJ->Jpdd;
 		bd_acc +=  JI_r[0]*rJ->Jpdd[0] + JI_r[1]*rJ->Jpdd[1];
 		Hdd_acc += Ji2_Jpdd.dot(rJ->Jpdd);
 		Hcd_acc += rJ->Jpdc[0]*Ji2_Jpdd[0] + rJ->Jpdc[1]*Ji2_Jpdd[1];
-
-		nres[tid]++;
 	}
 
 	if(mode==0)
@@ -162,6 +175,25 @@ template void AccumulatedTopHessianSSE::addPoint<1>(EFPoint* p, EnergyFunctional
 template void AccumulatedTopHessianSSE::addPoint<2>(EFPoint* p, EnergyFunctional const * const ef, int tid);
 
 
+void AccumulatedTopHessianSSE::prepareIncremental(std::vector<EFPoint*>& points, int nFrames)
+{
+	int nf2 = nFrames*nFrames;
+	bool allDirty = !cacheValid || (int)cachedBlocks.size() != nf2;
+	if(allDirty) cachedBlocks.resize(nf2);
+	blockDirty.assign(nf2, allDirty);
+
+	for(EFPoint* p : points)
+		for(EFResidual* r : p->residualsAll)
+		{
+			if(!r->changedSinceAccumulation) continue;
+			blockDirty[r->hostIDX + r->targetIDX*nFrames] = true;
+			r->changedSinceAccumulation = false;
+		}
+
+	incrementalActive = true;
+}
+
+
 
 
 
@@ -242,7 +274,7 @@ void AccumulatedTopHessianSSE::stitchDoubleInternal(
 		MatXX* H, VecX* b, EnergyFunctional const * const EF, bool usePrior,
 		int min, int max, Vec10* stats, int tid)
 {
-	int toAggregate = NUM_THREADS;
+	int toAggregate = numThreadsToAggregate;
 	if(tid == -1) { toAggregate = 1; tid = 0; }	// special case: if we dont do multithreading, dont aggregate.
 	if(min==max) return;
 
@@ -258,15 +290,56 @@ void AccumulatedTopHessianSSE::stitchDoubleInternal(
 
 		assert(aidx == k);
 
+		if(incrementalActive && !blockDirty[aidx])
+		{
+			addStitchedBlock(H[tid], cachedBlocks[aidx], hIdx, tIdx);
+
+			Eigen::Matrix<double,CPARS+8,1> Jr = Eigen::Matrix<double,CPARS+8,1>::Zero();
+			for(int tid2=0;tid2 < toAggregate;tid2++)
+			{
+				bAcc[tid2][aidx].finish();
+				Jr += bAcc[tid2][aidx].A1m.cast<double>();
+			}
+			b[tid].segment<8>(hIdx).noalias() += EF->adHost[aidx] * Jr.tail<8>();
+			b[tid].segment<8>(tIdx).noalias() += EF->adTarget[aidx] * Jr.tail<8>();
+			b[tid].head<CPARS>().noalias() += Jr.head<CPARS>();
+			continue;
+		}
+
 		MatPCPC accH = MatPCPC::Zero();
+		int num = 0;
 
 		for(int tid2=0;tid2 < toAggregate;tid2++)
 		{
 			acc[tid2][aidx].finish();
 			if(acc[tid2][aidx].num==0) continue;
 			accH += acc[tid2][aidx].H.cast<double>();
+			num += acc[tid2][aidx].num;
 		}
 
+		if(incrementalActive)
+		{
+			StitchedBlock& block = cachedBlocks[aidx];
+			block.num = num;
+			if(num > 0)
+			{
+				block.Hhh = EF->adHost[aidx] * accH.block<8,8>(CPARS,CPARS) * EF->adHost[aidx].transpose();
+				block.Htt = EF->adTarget[aidx] * accH.block<8,8>(CPARS,CPARS) * EF->adTarget[aidx].transpose();
+				block.Hht = EF->adHost[aidx] * accH.block<8,8>(CPARS,CPARS) * EF->adTarget[aidx].transpose();
+				block.Hhc = EF->adHost[aidx] * accH.block<8,CPARS>(CPARS,0);
+				block.Htc = EF->adTarget[aidx] * accH.block<8,CPARS>(CPARS,0);
+				block.Hcc = accH.block<CPARS,CPARS>(0,0);
+				b[tid].segment<8>(hIdx).noalias() += EF->adHost[aidx] * accH.block<8,1>(CPARS,CPARS+8);
+				b[tid].segment<8>(tIdx).noalias() += EF->adTarget[aidx] * accH.block<8,1>(CPARS,CPARS+8);
+				b[tid].head<CPARS>().noalias() += accH.block<CPARS,1>(0,CPARS+8);
+			}
+			addStitchedBlock(H[tid], block, hIdx, tIdx);
+			continue;
+		}
+
+		// nothing to add (e.g. host==target).
+		if(num==0) continue;
+
 		H[tid].block<8,8>(hIdx, hIdx).noalias() += EF->adHost[aidx] * accH.block<8,8>(CPARS,CPARS) * EF->adHost[aidx].transpose();
 
 		H[tid].block<8,8>(tIdx, tIdx).noalias() += EF->adTarget[aidx] * accH.block<8,8>(CPARS,CPARS) * EF->adTarget[aidx].transpose();
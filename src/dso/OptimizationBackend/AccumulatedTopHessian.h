@@ -46,19 +46,24 @@ public:
 	EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
 	inline AccumulatedTopHessianSSE()
 	{
-		for(int tid=0;tid < NUM_THREADS; tid++)
+		for(int tid=0;tid < MAX_NUM_THREADS; tid++)
 		{
 			nres[tid]=0;
 			acc[tid]=0;
+			bAcc[tid]=0;
 			nframes[tid]=0;
 		}
+		numThreadsToAggregate = 1;
+		incrementalActive = false;
+		cacheValid = false;
 
 	};
 	inline ~AccumulatedTopHessianSSE()
 	{
-		for(int tid=0;tid < NUM_THREADS; tid++)
+		for(int tid=0;tid < MAX_NUM_THREADS; tid++)
 		{
 			if(acc[tid] != 0) delete[] acc[tid];
+			if(bAcc[tid] != 0) delete[] bAcc[tid];
 		}
 	};
 
@@ -68,15 +73,17 @@ public:
 		if(nFrames != nframes[tid])
 		{
 			if(acc[tid] != 0) delete[] acc[tid];
+			if(bAcc[tid] != 0) delete[] bAcc[tid];
 #if USE_XI_MODEL
 			acc[tid] = new Accumulator14[nFrames*nFrames];
 #else
 			acc[tid] = new AccumulatorApprox[nFrames*nFrames];
 #endif
+			bAcc[tid] = new AccumulatorX<CPARS+8>[nFrames*nFrames];
 		}
 
 		for(int i=0;i<nFrames*nFrames;i++)
-		{ acc[tid][i].initialize(); }
+		{ acc[tid][i].initialize(); bAcc[tid][i].initialize(); }
 
 		nframes[tid]=nFrames;
 		nres[tid]=0;
@@ -86,6 +93,17 @@ public:
 
 	template<int mode> void addPoint(EFPoint* p, EnergyFunctional const * const ef, int tid=0);
 
+	// incremental mode (setting_incrementalTopHessian, only for active residuals):
+	// determines which host-target blocks contain residuals whose Jacobian changed since the last accumulation.
+	// The following addPoint<0> calls and stitchDoubleMT only recompute H of these blocks, the others are taken from
+	// the cache. b is always computed from the current residuals.
+	void prepareIncremental(std::vector<EFPoint*>& points, int nFrames);
+	// has to be called whenever residuals are removed, indices change or the adjoints change.
+	inline void invalidateCache()
+	{
+		cacheValid = false;
+	}
+
 
 
 	void stitchDoubleMT(IndexThreadReduce<Vec10>* red, MatXX &H, VecX &b, EnergyFunctional const * const EF, bool usePrior, bool MT)
@@ -93,9 +111,10 @@ public:
 		// sum up, splitting by bock in square.
 		if(MT)
 		{
-			MatXX Hs[NUM_THREADS];
-			VecX bs[NUM_THREADS];
-			for(int i=0;i<NUM_THREADS;i++)
+			numThreadsToAggregate = red->getNumThreads();
+			std::vector<MatXX> Hs(numThreadsToAggregate);
+			std::vector<VecX> bs(numThreadsToAggregate);
+			for(int i=0;i<numThreadsToAggregate;i++)
 			{
 				assert(nframes[0] == nframes[i]);
 				Hs[i] = MatXX::Zero(nframes[0]*8+CPARS, nframes[0]*8+CPARS);
@@ -103,13 +122,13 @@ public:
 			}
 
 			red->reduce(boost::bind(&AccumulatedTopHessianSSE::stitchDoubleInternal,
-				this,Hs, bs, EF, usePrior,  _1, _2, _3, _4), 0, nframes[0]*nframes[0], 0);
+				this,Hs.data(), bs.data(), EF, usePrior,  _1, _2, _3, _4), 0, nframes[0]*nframes[0], 0);
 
 			// sum up results
 			H = Hs[0];
 			b = bs[0];
 
-			for(int i=1;i<NUM_THREADS;i++)
+			for(int i=1;i<numThreadsToAggregate;i++)
 			{
 				H.noalias() += Hs[i];
 				b.noalias() += bs[i];
@@ -123,6 +142,15 @@ public:
 			stitchDoubleInternal(&H, &b, EF, usePrior,0,nframes[0]*nframes[0],0,-1);
 		}
 
+		if(incrementalActive)
+		{
+			// residuals of cached blocks were not counted during accumulation.
+			for(int k=0;k<nframes[0]*nframes[0];k++)
+				if(!blockDirty[k]) nres[0] += cachedBlocks[k].num;
+			cacheValid = true;
+			incrementalActive = false;
+		}
+
 		// make diagonal by copying over parts.
 		for(int h=0;h<nframes[0];h++)
 		{
@@ -141,12 +169,32 @@ public:
 
 
 
-	int nframes[NUM_THREADS];
+	int nframes[MAX_NUM_THREADS];
+
+	EIGEN_ALIGN16 AccumulatorApprox* acc[MAX_NUM_THREADS];
 
-	EIGEN_ALIGN16 AccumulatorApprox* acc[NUM_THREADS];
+	// incremental mode: J^T r of the blocks whose H is taken from the cache (rows as in the last column of acc).
+	AccumulatorX<CPARS+8>* bAcc[MAX_NUM_THREADS];
 
 
-	int nres[NUM_THREADS];
+	int nres[MAX_NUM_THREADS];
+
+	// number of per-thread accumulators filled by the last multithreaded pass.
+	int numThreadsToAggregate;
+
+	// contribution of one host-target block to H (already multiplied with the adjoints).
+	struct StitchedBlock
+	{
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
+		Mat88 Hhh, Htt, Hht;
+		Mat8C Hhc, Htc;
+		MatCC Hcc;
+		int num;
+	};
+	std::vector<StitchedBlock, Eigen::aligned_allocator<StitchedBlock>> cachedBlocks;
+	std::vector<char> blockDirty;
+	bool incrementalActive;
+	bool cacheValid;
 
 
 	template<int mode> void addPointsInternal(
@@ -160,6 +208,17 @@ public:
 
 private:
 
+	inline void addStitchedBlock(MatXX &H, const StitchedBlock& block, int hIdx, int tIdx)
+	{
+		if(block.num == 0) return;
+		H.block<8,8>(hIdx, hIdx).noalias() += block.Hhh;
+		H.block<8,8>(tIdx, tIdx).noalias() += block.Htt;
+		H.block<8,8>(hIdx, tIdx).noalias() += block.Hht;
+		H.block<8,CPARS>(hIdx,0).noalias() += block.Hhc;
+		H.block<8,CPARS>(tIdx,0).noalias() += block.Htc;
+		H.topLeftCorner<CPARS,CPARS>().noalias() += block.Hcc;
+	}
+
 	void stitchDoubleInternal(
 			MatXX* H, VecX* b, EnergyFunctional const * const EF, bool usePrior,
 			int min, int max, Vec10* stats, int tid);
@@ -52,6 +52,7 @@ void EnergyFunctional::setAdjointsF(CalibHessian* Hcalib)
 	if(adTarget != 0) delete[] adTarget;
 	adHost = new Mat88[nFrames*nFrames];
 	adTarget = new Mat88[nFrames*nFrames];
+	accSSE_top_A->invalidateCache();
 
 	for(int h=0;h<nFrames;h++)
 		for(int t=0;t<nFrames;t++)
@@ -204,6 +205,9 @@ void EnergyFunctional::setDeltaF(CalibHessian* HCalib)
 // accumulates & shifts L.
 void EnergyFunctional::accumulateAF_MT(MatXX &H, VecX &b, bool MT)
 {
+	if(setting_incrementalTopHessian)
+		accSSE_top_A->prepareIncremental(allPoints, nFrames);
+
 	if(MT)
 	{
 		red->reduce(boost::bind(&AccumulatedTopHessianSSE::setZero, accSSE_top_A, nFrames,  _1, _2, _3, _4), 0, 0, 0);
@@ -438,7 +442,7 @@ double EnergyFunctional::calcLEnergyF_MT()
 
 EFResidual* EnergyFunctional::insertResidual(PointFrameResidual* r)
 {
-	EFResidual* efr = new EFResidual(r, r->point->efPoint, r->host->efFrame, r->target->efFrame);
+	EFResidual* efr = new (efResidualAllocator) EFResidual(r, r->point->efPoint, r->host->efFrame, r->target->efFrame);
 	efr->idxInAll = r->point->efPoint->residualsAll.size();
 	r->point->efPoint->residualsAll.push_back(efr);
 
@@ -531,6 +535,7 @@ void EnergyFunctional::dropResidual(EFResidual* r)
 	nResiduals--;
 	r->data->efResidual=0;
 	delete r;
+	accSSE_top_A->invalidateCache();
 }
 
 /**
@@ -990,7 +995,17 @@ void EnergyFunctional::solveSystemF(int iteration, double lambda, CalibHessian*
         {
             VecX SVecI = (HFinal_top.diagonal()+VecX::Constant(HFinal_top.cols(), 10)).cwiseSqrt().cwiseInverse();
             MatXX HFinalScaled = SVecI.asDiagonal() * HFinal_top * SVecI.asDiagonal();
-            x = SVecI.asDiagonal() * HFinalScaled.ldlt().solve(SVecI.asDiagonal() * bFinal_top);
+            bool solved = false;
+            if(setting_solverMode & SOLVER_SPARSE_BLOCK_LDLT)
+            {
+                // blocks: camera parameters, then one block per frame.
+                std::vector<int> blockSizes(nFrames+1, 8);
+                blockSizes[0] = CPARS;
+                solved = sparseSolver.solve(HFinalScaled, SVecI.asDiagonal() * bFinal_top, blockSizes, x);
+                if(solved) x = SVecI.asDiagonal() * x;
+            }
+            if(!solved)
+                x = SVecI.asDiagonal() * HFinalScaled.ldlt().solve(SVecI.asDiagonal() * bFinal_top);
         }
         // Important: x is -step !
     }
@@ -1036,6 +1051,7 @@ void EnergyFunctional::makeIDX()
                 r->targetIDX = r->target->idx;
             }
         }
+    accSSE_top_A->invalidateCache();
 
 
     EFIndicesValid=true;
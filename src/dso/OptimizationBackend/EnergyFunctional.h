@@ -29,6 +29,8 @@
  
 #include "util/NumType.h"
 #include "util/IndexThreadReduce.h"
+#include "util/SlabAllocator.h"
+#include "OptimizationBackend/SparseBlockLDLT.h"
 #include "vector"
 #include <math.h>
 #include "map"
@@ -105,6 +107,8 @@ public:
 	std::vector<EFFrame*> frames;
 	int nPoints, nFrames, nResiduals;
 
+	SlabAllocator<EFResidual> efResidualAllocator; // all EFResiduals are allocated from here.
+
     // HMForGTSAM, bMForGTSAM only contain marginalized points until the next time a keyframe is marginalized.
     // With each keyframe marginalization the information in them is transferred to the GTSAMIntegration.
 	MatXX HM, HMForGTSAM;
@@ -122,6 +126,9 @@ public:
 
 	IndexThreadReduce<Vec10>* red;
 
+	// used if setting_solverMode contains SOLVER_SPARSE_BLOCK_LDLT, keeps the symbolic factorization between iterations.
+	SparseBlockLDLT sparseSolver;
+
 
 	// if 2 frames have viewed same points?
 	std::map<uint64_t,
@@ -36,8 +36,30 @@ namespace dso
 {
 
 
+EFResidual::EFResidual(PointFrameResidual* org, EFPoint* point_, EFFrame* host_, EFFrame* target_) :
+	data(org), point(point_), host(host_), target(target_)
+{
+	isLinearized=false;
+	isActiveAndIsGoodNEW=false;
+	changedSinceAccumulation=true;
+	// J lives in org next to org->J, so it stays valid when they are swapped in takeDataF.
+	J = (org->J == &org->jacobianStorage[0]) ? &org->jacobianStorage[1] : &org->jacobianStorage[0];
+	assert(((long)this)%16==0);
+	assert(((long)J)%16==0);
+}
+
 void EFResidual::takeDataF()
 {
+	// in incremental mode keep the old Jacobian if it did not change (up to the threshold), so that the cached
+	// H of its host-target block can be reused. The residual is always taken over, as b is computed from it.
+	if(setting_incrementalTopHessian && !changedSinceAccumulation &&
+	   data->J->isCloseTo(*J, setting_incrementalTopHessianTH))
+	{
+		J->resF = data->J->resF;
+		return;
+	}
+	changedSinceAccumulation = true;
+
 	std::swap<RawResidualJacobian*>(J, data->J);
 
 	Vec2f JI_JI_Jd = J->JIdx2 * J->Jpdd;
@@ -29,6 +29,7 @@
 #include "vector"
 #include <math.h>
 #include "OptimizationBackend/RawResidualJacobian.h"
+#include "util/SlabAllocator.h"
 
 namespace dso
 {
@@ -51,21 +52,12 @@ class EnergyFunctional;
 class EFResidual
 {
 public:
-	EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
+	// allocated from EnergyFunctional::efResidualAllocator with new (allocator) EFResidual(...).
+	inline void* operator new(size_t size, SlabAllocator<EFResidual>& allocator) {return allocator.allocate(size);}
+	inline void operator delete(void* ptr, SlabAllocator<EFResidual>& allocator) {SlabAllocatorBase::deallocate(ptr);}
+	inline void operator delete(void* ptr) {SlabAllocatorBase::deallocate(ptr);}
 
-	inline EFResidual(PointFrameResidual* org, EFPoint* point_, EFFrame* host_, EFFrame* target_) :
-		data(org), point(point_), host(host_), target(target_)
-	{
-		isLinearized=false;
-		isActiveAndIsGoodNEW=false;
-		J = new RawResidualJacobian();
-		assert(((long)this)%16==0);
-		assert(((long)J)%16==0);
-	}
-	inline ~EFResidual()
-	{
-		delete J;
-	}
+	EFResidual(PointFrameResidual* org, EFPoint* point_, EFFrame* host_, EFFrame* target_);
 
 
 	void takeDataF();
@@ -94,6 +86,9 @@ public:
 	// if residual is not OOB & not OUTLIER & should be used during accumulations
 	bool isActiveAndIsGoodNEW;
 	inline const bool &isActive() const {return isActiveAndIsGoodNEW;}
+
+	// if J or the activity changed since the last (incremental) accumulation of the active Hessian.
+	bool changedSinceAccumulation;
 };
 
 
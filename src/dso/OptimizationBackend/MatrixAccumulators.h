@@ -988,13 +988,17 @@ public:
   Vec9f b;
   size_t num;
 
-  inline void initialize()
+  // lanesIn is the number of floats accumulated per entry: 4 for the SSE updates below,
+  // 8 / 16 for the AVX2 / AVX-512 kernels which write to laneData() directly.
+  inline void initialize(int lanesIn = 4)
   {
+	assert(lanesIn == 4 || lanesIn == 8 || lanesIn == MaxLanes);
+	lanes = lanesIn;
 	H.setZero();
 	b.setZero();
-    memset(SSEData,0, sizeof(float)*4*45);
-    memset(SSEData1k,0, sizeof(float)*4*45);
-    memset(SSEData1m,0, sizeof(float)*4*45);
+    memset(SSEData,0, sizeof(float)*MaxLanes*45);
+    memset(SSEData1k,0, sizeof(float)*MaxLanes*45);
+    memset(SSEData1m,0, sizeof(float)*MaxLanes*45);
     num = numIn1 = numIn1k = numIn1m = 0;
   }
 
@@ -1009,11 +1013,24 @@ public:
 	for(int r=0;r<9;r++)
 		for(int c=r;c<9;c++)
 		{
-			float d = SSEData1m[idx+0] + SSEData1m[idx+1] + SSEData1m[idx+2] + SSEData1m[idx+3];
+			float d = 0;
+			for(int l=0;l<lanes;l++)
+				d += SSEData1m[idx+l];
 			H(r,c) = H(c,r) = d;
-			idx+=4;
+			idx+=lanes;
 		}
-	  assert(idx==4*45);
+	  assert(idx==lanes*45);
+  }
+
+  // Raw accumulation buffer for the wide kernels: entry k of the packed upper triangle occupies
+  // the floats [k*getLanes(), (k+1)*getLanes()). After each wide update laneUpdateDone() has to be called.
+  inline float* laneData() {return SSEData;}
+  inline int getLanes() const {return lanes;}
+  inline void laneUpdateDone()
+  {
+	  num+=lanes;
+	  numIn1++;
+	  shiftUp(false);
   }
 
 
@@ -1024,6 +1041,7 @@ public:
 		  const __m128 J6,const __m128 J7,
 		  const __m128 J8)
   {
+	  assert(lanes==4);
 	  float* pt=SSEData;
 	  _mm_store_ps(pt, _mm_add_ps(_mm_load_ps(pt),_mm_mul_ps(J0,J0))); pt+=4;
 	  _mm_store_ps(pt, _mm_add_ps(_mm_load_ps(pt),_mm_mul_ps(J0,J1))); pt+=4;
@@ -1105,6 +1123,7 @@ public:
 		  const __m128 J6,const __m128 J7,
 		  const __m128 J8, const __m128 w)
   {
+	  assert(lanes==4);
 	  float* pt=SSEData;
 
 	  __m128 J0w = _mm_mul_ps(J0,w);
@@ -1183,6 +1202,7 @@ public:
 		  const float J6,const float J7,
 		  const float J8, int off=0)
   {
+	  assert(lanes==4);
 	  float* pt=SSEData+off;
 	  *pt += J0*J0; pt+=4;
 	  *pt += J1*J0; pt+=4;
@@ -1257,6 +1277,7 @@ public:
 		  float J8, float w,
 		  int off=0)
   {
+	  assert(lanes==4);
 
 	  float* pt=SSEData+off;
 	  *pt += J0*J0*w; pt+=4; J0*=w;
@@ -1325,31 +1346,34 @@ public:
   }
 
 
+  static constexpr int MaxLanes = 16;
+
 private:
-  EIGEN_ALIGN16 float SSEData[4*45];
-  EIGEN_ALIGN16 float SSEData1k[4*45];
-  EIGEN_ALIGN16 float SSEData1m[4*45];
+  EIGEN_ALIGN16 float SSEData[MaxLanes*45];
+  EIGEN_ALIGN16 float SSEData1k[MaxLanes*45];
+  EIGEN_ALIGN16 float SSEData1m[MaxLanes*45];
   float numIn1, numIn1k, numIn1m;
+  int lanes = 4;
 
 
   void shiftUp(bool force)
   {
 	  if(numIn1 > 1000 || force)
 	  {
-		  for(int i=0;i<45;i++)
-			  _mm_store_ps(SSEData1k+4*i, _mm_add_ps(_mm_load_ps(SSEData+4*i),_mm_load_ps(SSEData1k+4*i)));
+		  for(int i=0;i<lanes*45;i+=4)
+			  _mm_store_ps(SSEData1k+i, _mm_add_ps(_mm_load_ps(SSEData+i),_mm_load_ps(SSEData1k+i)));
 		  numIn1k+=numIn1;
 		  numIn1=0;
-		  memset(SSEData,0, sizeof(float)*4*45);
+		  memset(SSEData,0, sizeof(float)*lanes*45);
 	  }
 
 	  if(numIn1k > 1000 || force)
 	  {
-		  for(int i=0;i<45;i++)
-			  _mm_store_ps(SSEData1m+4*i, _mm_add_ps(_mm_load_ps(SSEData1k+4*i),_mm_load_ps(SSEData1m+4*i)));
+		  for(int i=0;i<lanes*45;i+=4)
+			  _mm_store_ps(SSEData1m+i, _mm_add_ps(_mm_load_ps(SSEData1k+i),_mm_load_ps(SSEData1m+i)));
 		  numIn1m+=numIn1k;
 		  numIn1k=0;
-		  memset(SSEData1k,0, sizeof(float)*4*45);
+		  memset(SSEData1k,0, sizeof(float)*lanes*45);
 	  }
   }
 };
@@ -58,6 +58,26 @@ struct RawResidualJacobian
 	// = Jab^T * Jab (inner product). Only as a shorthand.
 	Mat22f Jab2;			// 2x2
 
+
+	// true if no Jacobian entry differs from the one in other by more than relTH times its magnitude
+	// (relTH = 0: identical). resF is not compared.
+	inline bool isCloseTo(const RawResidualJacobian& other, float relTH) const
+	{
+		return isClose(Jpdxi[0], other.Jpdxi[0], relTH) && isClose(Jpdxi[1], other.Jpdxi[1], relTH) &&
+			   isClose(Jpdc[0], other.Jpdc[0], relTH) && isClose(Jpdc[1], other.Jpdc[1], relTH) &&
+			   isClose(Jpdd, other.Jpdd, relTH) &&
+			   isClose(JIdx[0], other.JIdx[0], relTH) && isClose(JIdx[1], other.JIdx[1], relTH) &&
+			   isClose(JabF[0], other.JabF[0], relTH) && isClose(JabF[1], other.JabF[1], relTH) &&
+			   isClose(JIdx2, other.JIdx2, relTH) && isClose(JabJIdx, other.JabJIdx, relTH) &&
+			   isClose(Jab2, other.Jab2, relTH);
+	}
+
+private:
+	template<typename T>
+	static inline bool isClose(const T& a, const T& b, float relTH)
+	{
+		return ((a-b).cwiseAbs().array() <= relTH * b.cwiseAbs().array()).all();
+	}
 };
 }
 
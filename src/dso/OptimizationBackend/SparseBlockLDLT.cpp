@@ -0,0 +1,263 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "SparseBlockLDLT.h"
+#include <cstdio>
+#include <set>
+#include <algorithm>
+
+namespace dso
+{
+
+bool SparseBlockLDLT::solve(const MatXX& H, const VecX& b, const std::vector<int>& newBlockSizes, VecX& x)
+{
+    int nb = newBlockSizes.size();
+    std::vector<int> start(nb + 1, 0);
+    for(int i = 0; i < nb; ++i)
+    {
+        start[i + 1] = start[i] + newBlockSizes[i];
+    }
+    assert(start[nb] == H.rows() && H.rows() == H.cols() && b.size() == H.rows());
+
+    // Find structurally nonzero blocks.
+    std::vector<char> nonZero(nb * nb, 0);
+    for(int i = 0; i < nb; ++i)
+    {
+        for(int j = 0; j < i; ++j)
+        {
+            bool isNonZero = !H.block(start[i], start[j], newBlockSizes[i], newBlockSizes[j]).isZero(0);
+            nonZero[i * nb + j] = nonZero[j * nb + i] = isNonZero;
+        }
+    }
+
+    if(!symbolicValid || !patternCovers(newBlockSizes, nonZero))
+    {
+        analyzePattern(newBlockSizes, nonZero);
+    }
+
+    // Copy values into the block storage (fill-in blocks are zero).
+    for(int k = 0; k < numBlocks; ++k)
+    {
+        int pk = perm[k];
+        diagonal[k] = H.block(blockStart[pk], blockStart[pk], blockSizes[pk], blockSizes[pk]);
+        for(int r : colRows[k])
+        {
+            int pr = perm[r];
+            MatXX& slot = slots[slotIndex[r * numBlocks + k]];
+            if(nonZero[pr * numBlocks + pk])
+            {
+                slot = H.block(blockStart[pr], blockStart[pk], blockSizes[pr], blockSizes[pk]);
+            }else
+            {
+                slot.setZero(blockSizes[pr], blockSizes[pk]);
+            }
+        }
+    }
+
+    // Numeric factorization (right-looking). After this slots contain L, and diagonalLDLT the factorized D.
+    std::vector<MatXX> W;
+    for(int k = 0; k < numBlocks; ++k)
+    {
+        Eigen::LDLT<MatXX>& ldlt = diagonalLDLT[k];
+        ldlt.compute(diagonal[k]);
+        if(ldlt.info() != Eigen::Success || !(ldlt.vectorD().minCoeff() > 0))
+        {
+            printf("WARNING: SparseBlockLDLT: block %d is not positive definite, falling back to dense solve.\n", perm[k]);
+            return false;
+        }
+
+        const std::vector<int>& rows = colRows[k];
+        W.resize(rows.size());
+        for(size_t i = 0; i < rows.size(); ++i)
+        {
+            MatXX& slot = slots[slotIndex[rows[i] * numBlocks + k]];
+            W[i] = slot;
+            slot = ldlt.solve(W[i].transpose()).transpose();
+        }
+
+        // Schur complement update of the remaining blocks.
+        for(size_t i = 0; i < rows.size(); ++i)
+        {
+            const MatXX& L = slots[slotIndex[rows[i] * numBlocks + k]];
+            diagonal[rows[i]].noalias() -= L * W[i].transpose();
+            for(size_t j = 0; j < i; ++j)
+            {
+                slots[slotIndex[rows[i] * numBlocks + rows[j]]].noalias() -= L * W[j].transpose();
+            }
+        }
+    }
+
+    // Forward substitution: L * y = b.
+    std::vector<VecX> y(numBlocks);
+    for(int k = 0; k < numBlocks; ++k)
+    {
+        y[k] = b.segment(blockStart[perm[k]], blockSizes[perm[k]]);
+    }
+    for(int k = 0; k < numBlocks; ++k)
+    {
+        for(int r : colRows[k])
+        {
+            y[r].noalias() -= slots[slotIndex[r * numBlocks + k]] * y[k];
+        }
+    }
+    // D * z = y.
+    for(int k = 0; k < numBlocks; ++k)
+    {
+        y[k] = diagonalLDLT[k].solve(y[k]);
+    }
+    // Backward substitution: L^T * x = z.
+    for(int k = numBlocks - 1; k >= 0; --k)
+    {
+        for(int r : colRows[k])
+        {
+            y[k].noalias() -= slots[slotIndex[r * numBlocks + k]].transpose() * y[r];
+        }
+    }
+
+    VecX result(H.rows());
+    for(int k = 0; k < numBlocks; ++k)
+    {
+        result.segment(blockStart[perm[k]], blockSizes[perm[k]]) = y[k];
+    }
+    if(!result.allFinite())
+    {
+        printf("WARNING: SparseBlockLDLT: solution is not finite, falling back to dense solve.\n");
+        return false;
+    }
+    x = result;
+    return true;
+}
+
+void SparseBlockLDLT::analyzePattern(const std::vector<int>& newBlockSizes, const std::vector<char>& nonZero)
+{
+    numBlocks = newBlockSizes.size();
+    blockSizes = newBlockSizes;
+    blockStart.resize(numBlocks);
+    int current = 0;
+    for(int i = 0; i < numBlocks; ++i)
+    {
+        blockStart[i] = current;
+        current += blockSizes[i];
+    }
+
+    // Greedy minimum degree ordering on the block graph, simulating the fill-in.
+    // Blocks connected to everything (like the camera parameters) are thereby eliminated last.
+    std::vector<std::set<int>> adjacent(numBlocks);
+    for(int i = 0; i < numBlocks; ++i)
+    {
+        for(int j = 0; j < numBlocks; ++j)
+        {
+            if(i != j && nonZero[i * numBlocks + j])
+            {
+                adjacent[i].insert(j);
+            }
+        }
+    }
+
+    perm.clear();
+    std::vector<int> position(numBlocks, -1);
+    std::vector<std::set<int>> neighborsWhenEliminated(numBlocks);
+    for(int k = 0; k < numBlocks; ++k)
+    {
+        int best = -1;
+        for(int i = 0; i < numBlocks; ++i)
+        {
+            if(position[i] == -1 && (best == -1 || adjacent[i].size() < adjacent[best].size()))
+            {
+                best = i;
+            }
+        }
+        position[best] = k;
+        perm.push_back(best);
+
+        // Eliminating best connects all its neighbors.
+        const std::set<int>& neighbors = adjacent[best];
+        for(int n1 : neighbors)
+        {
+            adjacent[n1].erase(best);
+            for(int n2 : neighbors)
+            {
+                if(n1 != n2) adjacent[n1].insert(n2);
+            }
+        }
+        neighborsWhenEliminated[best] = neighbors;
+        adjacent[best].clear();
+    }
+
+    slotIndex.assign(numBlocks * numBlocks, -1);
+    colRows.assign(numBlocks, std::vector<int>());
+    int numSlots = 0;
+    for(int k = 0; k < numBlocks; ++k)
+    {
+        for(int n : neighborsWhenEliminated[perm[k]])
+        {
+            colRows[k].push_back(position[n]);
+        }
+        std::sort(colRows[k].begin(), colRows[k].end());
+        for(int r : colRows[k])
+        {
+            slotIndex[r * numBlocks + k] = numSlots++;
+        }
+    }
+
+    slots.resize(numSlots);
+    diagonal.resize(numBlocks);
+    diagonalLDLT.resize(numBlocks);
+
+    symbolicValid = true;
+    numSymbolic++;
+}
+
+bool SparseBlockLDLT::patternCovers(const std::vector<int>& newBlockSizes, const std::vector<char>& nonZero) const
+{
+    if(newBlockSizes != blockSizes) return false;
+
+    std::vector<int> position(numBlocks);
+    for(int k = 0; k < numBlocks; ++k)
+    {
+        position[perm[k]] = k;
+    }
+    for(int i = 0; i < numBlocks; ++i)
+    {
+        for(int j = 0; j < i; ++j)
+        {
+            if(!nonZero[i * numBlocks + j]) continue;
+            int r = std::max(position[i], position[j]);
+            int c = std::min(position[i], position[j]);
+            if(slotIndex[r * numBlocks + c] == -1) return false;
+        }
+    }
+    return true;
+}
+
+void SparseBlockLDLT::reset()
+{
+    symbolicValid = false;
+}
+
+int SparseBlockLDLT::getNumSymbolicFactorizations() const
+{
+    return numSymbolic;
+}
+
+}
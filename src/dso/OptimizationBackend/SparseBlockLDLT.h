@@ -0,0 +1,77 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef DMVIO_SPARSEBLOCKLDLT_H
+#define DMVIO_SPARSEBLOCKLDLT_H
+
+#include "util/NumType.h"
+#include <Eigen/Cholesky>
+#include <vector>
+
+namespace dso
+{
+
+// Block-sparse LDL^T solver for symmetric positive definite systems with a block structure, e.g. the BA Hessian
+// with one block per keyframe (plus camera parameters and additional IMU variables).
+// Blocks that are exactly zero are treated as structurally zero. The symbolic factorization (block elimination order
+// and fill-in) is cached and reused as long as the block sizes do not change and the nonzero blocks are covered by
+// the cached pattern, so successive GN iterations only perform the numeric factorization.
+// Diagonal blocks are kept dense (supernodes), so the numeric part runs on dense block operations.
+class SparseBlockLDLT
+{
+public:
+    // Solve H * x = b, where H is partitioned into blocks of the given sizes (which must sum up to H.rows()).
+    // Returns false (and prints a warning) if the factorization failed (e.g. because H is not positive definite); x is
+    // not modified then and the caller is expected to fall back to a dense solve.
+    bool solve(const MatXX& H, const VecX& b, const std::vector<int>& blockSizes, VecX& x);
+
+    // Force recomputation of the symbolic factorization on the next call.
+    void reset();
+
+    // Number of symbolic factorizations computed so far (for logging).
+    int getNumSymbolicFactorizations() const;
+
+private:
+    // Computes the elimination order (greedy minimum degree on the block graph) and the fill-in pattern.
+    void analyzePattern(const std::vector<int>& newBlockSizes, const std::vector<char>& nonZero);
+    bool patternCovers(const std::vector<int>& newBlockSizes, const std::vector<char>& nonZero) const;
+
+    // Symbolic part.
+    int numBlocks{0};
+    std::vector<int> blockSizes; // In the original order.
+    std::vector<int> blockStart; // In the original order.
+    std::vector<int> perm; // perm[k] is the original block eliminated at position k.
+    std::vector<int> slotIndex; // numBlocks*numBlocks; slot of L block (row, col) in elimination positions, or -1.
+    std::vector<std::vector<int>> colRows; // For every elimination position the (sorted) positions below it in L.
+    bool symbolicValid{false};
+    int numSymbolic{0};
+
+    // Numeric part, storage is reused between calls.
+    std::vector<MatXX> slots; // Off-diagonal blocks of L.
+    std::vector<MatXX> diagonal; // Diagonal blocks, factorized with a dense LDL^T.
+    std::vector<Eigen::LDLT<MatXX>> diagonalLDLT;
+};
+
+}
+
+#endif //DMVIO_SPARSEBLOCKLDLT_H
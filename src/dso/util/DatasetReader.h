@@ -30,6 +30,7 @@
 #include "util/globalCalib.h"
 
 #include "util/GTData.hpp"
+#include "util/BinaryDataset.h"
 #include "IMU/IMUTypes.h"
 
 #include <sstream>
@@ -115,16 +116,31 @@ public:
 
 #if HAS_ZIPLIB
 		ziparchive=0;
-		databuffer=0;
 #endif
 
 		isZipped = (path.length()>4 && path.substr(path.length()-4) == ".zip");
+		isBinary = (path.length()>7 && path.substr(path.length()-7) == ".dmvbin");
 
 
 
 
 
-		if(isZipped)
+		if(isBinary)
+		{
+			binaryDataset.reset(new dmvio::BinaryDataset(path));
+			if(!binaryDataset->isValid())
+			{
+				printf("ERROR reading binary dataset %s!\n", path.c_str());
+				exit(1);
+			}
+			if(use16Bit != (binaryDataset->getBytesPerPixel() == 2))
+			{
+				printf("Binary dataset contains %d bit images, ignoring use16Bit setting.\n", binaryDataset->getBytesPerPixel() * 8);
+				use16Bit = binaryDataset->getBytesPerPixel() == 2;
+			}
+			files.clear();
+		}
+		else if(isZipped)
 		{
 #if HAS_ZIPLIB
 			int ziperror=0;
@@ -164,17 +180,23 @@ public:
 		width=undistort->getSize()[0];
 		height=undistort->getSize()[1];
 
+		if(isBinary && (binaryDataset->getWidth() != widthOrg || binaryDataset->getHeight() != heightOrg))
+		{
+			printf("ERROR: binary dataset has resolution %d x %d, but calibration expects %d x %d!\n",
+				   binaryDataset->getWidth(), binaryDataset->getHeight(), widthOrg, heightOrg);
+			exit(1);
+		}
+
 
 		// load timestamps if possible.
 		loadTimestamps();
-		printf("ImageFolderReader: got %d files in %s!\n", (int)files.size(), path.c_str());
+		printf("ImageFolderReader: got %d files in %s!\n", getNumImages(), path.c_str());
 
 	}
 	~ImageFolderReader()
 	{
 #if HAS_ZIPLIB
 		if(ziparchive!=0) zip_close(ziparchive);
-		if(databuffer!=0) delete databuffer;
 #endif
 
 
@@ -207,6 +229,7 @@ public:
 
 	int getNumImages()
 	{
+		if(isBinary) return binaryDataset->getNumFrames();
 		return files.size();
 	}
 
@@ -220,6 +243,7 @@ public:
 
     std::string getFilename(int id)
     {
+        if(isBinary) return path + ":" + std::to_string(id);
         return files[id];
     }
 
@@ -292,6 +316,12 @@ public:
     {
         std::string defaultFile = path.substr(0, path.find_last_of('/')) + "/../state_groundtruth_estimate0/data.csv";
         std::cout << "Loading gt data" << std::endl;
+
+        if(isBinary && gtFile == "")
+        {
+            gtData = binaryDataset->getGTData();
+            return !gtData.empty();
+        }
         
         if(gtFile == "")
         {
@@ -348,6 +378,19 @@ public:
         // Important: This IMU loading method expects that for each image there is an IMU 'measurement' with exactly the same timestamp (the VI-sensor does this).
         // If the sensor does not output this, a fake measurement with this timestamp has to be interpolated in advance.
         // The DM-VIO Python tools have a script to do this.
+        if(isBinary && imuFile == "")
+        {
+            imuDataAllFrames.clear();
+            for(int i = 0; i < binaryDataset->getNumIMUFrames(); ++i)
+            {
+                imuDataAllFrames.push_back(binaryDataset->getIMUData(i));
+            }
+            if(imuDataAllFrames.empty())
+            {
+                std::cout << "Found no IMU-data." << std::endl;
+            }
+            return;
+        }
         if(imuFile == "")
         {
             imuFile = path.substr(0,path.find_last_of('/')) + "/imu.txt";
@@ -447,6 +490,64 @@ public:
 
     }
 
+    // Converts the dataset (raw images, timestamps, exposures and the IMU and GT data loaded so far) to a
+    // dmvio::BinaryDataset, which can be passed as files=<filename> afterwards.
+    bool saveBinaryDataset(std::string filename)
+    {
+        dmvio::BinaryDatasetWriter writer(filename, widthOrg, heightOrg, use16Bit ? 2 : 1);
+        if(!writer.isValid())
+        {
+            printf("ERROR: could not open %s for writing!\n", filename.c_str());
+            return false;
+        }
+
+        int numImages = getNumImages();
+        for(int i = 0; i < numImages; ++i)
+        {
+            long long id = (int) ids.size() == numImages ? ids[i] : i;
+            double timestamp = timestamps.empty() ? 0.0 : timestamps[i];
+            float exposure = exposures.empty() ? 0.0f : exposures[i];
+            if(use16Bit)
+            {
+                MinimalImage<unsigned short>* img;
+                if(isBinary)
+                {
+                    MinimalImage<unsigned short> view(widthOrg, heightOrg, (unsigned short*) binaryDataset->getImageData(i));
+                    img = view.getClone();
+                }else
+                {
+                    img = IOWrap::readImageBW_16U(files[i]);
+                }
+                if(img == nullptr || img->w != widthOrg || img->h != heightOrg)
+                {
+                    printf("ERROR: could not read image %d for conversion!\n", i);
+                    delete img;
+                    return false;
+                }
+                writer.addFrame(id, timestamp, exposure, img->data);
+                delete img;
+            }else
+            {
+                MinimalImageB* img = getImageRaw_internal(i, 0);
+                if(img == nullptr || img->w != widthOrg || img->h != heightOrg)
+                {
+                    printf("ERROR: could not read image %d for conversion!\n", i);
+                    delete img;
+                    return false;
+                }
+                writer.addFrame(id, timestamp, exposure, img->data);
+                delete img;
+            }
+        }
+
+        writer.setIMUData(imuDataAllFrames);
+        writer.setGTData(gtData);
+        bool success = writer.finish(!timestamps.empty(), !exposures.empty());
+        printf("Saved %d images, %d frames of IMU data and %d GT poses to %s.\n", numImages,
+               (int) imuDataAllFrames.size(), (int) gtData.size(), filename.c_str());
+        return success;
+    }
+
 	// undistorter. [0] always exists, [1-2] only when MT is enabled.
 	Undistort* undistort;
 private:
@@ -455,7 +556,12 @@ private:
 	MinimalImageB* getImageRaw_internal(int id, int unused)
 	{
 	    assert(!use16Bit);
-		if(!isZipped)
+		if(isBinary)
+		{
+			MinimalImageB view(widthOrg, heightOrg, (unsigned char*) binaryDataset->getImageData(id));
+			return view.getClone();
+		}
+		else if(!isZipped)
 		{
 			// CHANGE FOR ZIP FILE
 			return IOWrap::readImageBW_8U(files[id]);
@@ -463,26 +569,33 @@ private:
 		else
 		{
 #if HAS_ZIPLIB
-			if(databuffer==0) databuffer = new char[widthOrg*heightOrg*6+10000];
-			zip_file_t* fle = zip_fopen(ziparchive, files[id].c_str(), 0);
-			long readbytes = zip_fread(fle, databuffer, (long)widthOrg*heightOrg*6+10000);
-
-			if(readbytes > (long)widthOrg*heightOrg*6)
+			// the archive handle is shared, so only reading the compressed file is serialized.
+			// Decoding happens outside the lock, so getImage can be called from several threads (see ImagePrefetcher).
+			std::vector<char> databuffer((long)widthOrg*heightOrg*6+10000);
+			long readbytes;
 			{
-				printf("read %ld/%ld bytes for file %s. increase buffer!!\n", readbytes,(long)widthOrg*heightOrg*6+10000, files[id].c_str());
-				delete[] databuffer;
-				databuffer = new char[(long)widthOrg*heightOrg*30];
-				fle = zip_fopen(ziparchive, files[id].c_str(), 0);
-				readbytes = zip_fread(fle, databuffer, (long)widthOrg*heightOrg*30+10000);
+				boost::unique_lock<boost::mutex> lock(zipMutex);
+				zip_file_t* fle = zip_fopen(ziparchive, files[id].c_str(), 0);
+				readbytes = zip_fread(fle, databuffer.data(), (long)databuffer.size());
+				zip_fclose(fle);
 
-				if(readbytes > (long)widthOrg*heightOrg*30)
+				if(readbytes > (long)widthOrg*heightOrg*6)
 				{
-					printf("buffer still to small (read %ld/%ld). abort.\n", readbytes,(long)widthOrg*heightOrg*30+10000);
-					exit(1);
+					printf("read %ld/%ld bytes for file %s. increase buffer!!\n", readbytes,(long)widthOrg*heightOrg*6+10000, files[id].c_str());
+					databuffer.resize((long)widthOrg*heightOrg*30+10000);
+					fle = zip_fopen(ziparchive, files[id].c_str(), 0);
+					readbytes = zip_fread(fle, databuffer.data(), (long)databuffer.size());
+					zip_fclose(fle);
+
+					if(readbytes > (long)widthOrg*heightOrg*30)
+					{
+						printf("buffer still to small (read %ld/%ld). abort.\n", readbytes,(long)widthOrg*heightOrg*30+10000);
+						exit(1);
+					}
 				}
 			}
 
-			return IOWrap::readStreamBW_8U(databuffer, readbytes);
+			return IOWrap::readStreamBW_8U(databuffer.data(), readbytes);
 #else
 			printf("ERROR: cannot read .zip archive, as compile without ziplib!\n");
 			exit(1);
@@ -493,6 +606,20 @@ private:
 
 	ImageAndExposure* getImage_internal(int id, int unused)
 	{
+	    if(isBinary)
+        {
+            // undistort directly from the mapped file.
+            float exposure = exposures.size() == 0 ? 1.0f : exposures[id];
+            double timestamp = timestamps.size() == 0 ? 0.0 : timestamps[id];
+            if(use16Bit)
+            {
+                MinimalImage<unsigned short> view(widthOrg, heightOrg, (unsigned short*) binaryDataset->getImageData(id));
+                return undistort->undistort<unsigned short>(&view, exposure, timestamp, 1.0f / 256.0f);
+            }
+            MinimalImageB view(widthOrg, heightOrg, (unsigned char*) binaryDataset->getImageData(id));
+            return undistort->undistort<unsigned char>(&view, exposure, timestamp);
+        }
+
 	    if(use16Bit)
         {
             MinimalImage<unsigned short>* minimg = IOWrap::readImageBW_16U(files[id]);
@@ -516,7 +643,7 @@ private:
         }
 	}
 
-	inline void loadTimestamps()
+	inline void loadTimestampsFromFile()
 	{
 		std::ifstream tr;
 		std::string timesFile = path.substr(0,path.find_last_of('/')) + "/times.txt";
@@ -545,6 +672,24 @@ private:
 			}
 		}
 		tr.close();
+	}
+
+	inline void loadTimestamps()
+	{
+		if(isBinary)
+		{
+			for(int i=0;i<binaryDataset->getNumFrames() && binaryDataset->hasTimestamps();i++)
+			{
+				const dmvio::BinaryFrameInfo& info = binaryDataset->getFrameInfo(i);
+				ids.push_back(info.id);
+				timestamps.push_back(info.timestamp);
+				exposures.push_back(info.exposure);
+			}
+		}
+		else
+		{
+			loadTimestampsFromFile();
+		}
 
 		// check if exposures are correct, (possibly skip)
 		bool exposuresGood = ((int)exposures.size()==(int)getNumImages()) ;
@@ -598,11 +743,14 @@ private:
 	std::string calibfile;
 
 	bool isZipped;
+	bool isBinary;
 	bool use16Bit;
 
+	std::unique_ptr<dmvio::BinaryDataset> binaryDataset;
+
 #if HAS_ZIPLIB
 	zip_t* ziparchive;
-	char* databuffer;
+	boost::mutex zipMutex;
 #endif
 };
 
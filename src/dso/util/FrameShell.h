@@ -57,6 +57,10 @@ public:
 
 	int keyframeId = -1; // Id of the KF or -1 for non-KFs.
 
+	// number of users outside of FullSystem (the IMU initializer) holding a pointer to this shell. While > 0 the shell
+	// and its tracking reference are not released by FullSystem::spillFinalFrameShells. [shellPoseMutex]
+	mutable int numExternalRefs = 0;
+
 	// statisitcs
 	int statistics_outlierResOnThis;
 	int statistics_goodResOnThis;
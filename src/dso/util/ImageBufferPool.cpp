@@ -0,0 +1,74 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "ImageBufferPool.h"
+#include <Eigen/Core>
+
+namespace dso
+{
+
+ImageBufferPool::~ImageBufferPool()
+{
+    for(auto&& pair : freeBuffers)
+    {
+        for(void* buffer : pair.second)
+        {
+            Eigen::internal::aligned_free(buffer);
+        }
+    }
+}
+
+void* ImageBufferPool::getBytes(size_t bytes)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        auto it = freeBuffers.find(bytes);
+        if(it != freeBuffers.end() && !it->second.empty())
+        {
+            void* buffer = it->second.back();
+            it->second.pop_back();
+            stats.numReused++;
+            return buffer;
+        }
+        stats.numAllocated++;
+        stats.bytesAllocated += bytes;
+    }
+    return Eigen::internal::aligned_malloc(bytes);
+}
+
+void ImageBufferPool::releaseBytes(void* buffer, size_t bytes)
+{
+    if(buffer == nullptr) return;
+    boost::unique_lock<boost::mutex> lock(mutex);
+    freeBuffers[bytes].push_back(buffer);
+    stats.numReleased++;
+}
+
+ImageBufferPool::Stats ImageBufferPool::getStats()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return stats;
+}
+
+}
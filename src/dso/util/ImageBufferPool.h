@@ -0,0 +1,88 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef DMVIO_IMAGEBUFFERPOOL_H
+#define DMVIO_IMAGEBUFFERPOOL_H
+
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+#include <type_traits>
+#include <boost/thread/mutex.hpp>
+
+namespace dso
+{
+
+// Recycles the (aligned) image buffers of frames, e.g. the pyramids created in FrameHessian::makeImages, so that
+// not every frame allocates and frees several MB. Buffers are keyed by their size, so all pyramid levels share the
+// pool. Thread-safe, as frames are released by both the tracking and the mapping thread.
+// The pool never shrinks: released buffers are kept until the pool is destroyed, so its memory is the peak number of
+// frames alive at the same time times the size of their pyramids (see Stats::bytesAllocated).
+class ImageBufferPool
+{
+public:
+    struct Stats
+    {
+        long long numAllocated = 0; // buffers allocated from the system.
+        long long numReused = 0; // requests served with a recycled buffer.
+        long long numReleased = 0; // buffers given back to the pool.
+        size_t bytesAllocated = 0; // total size of all buffers owned by the pool (in use or free).
+    };
+
+    ImageBufferPool() = default;
+    ImageBufferPool(const ImageBufferPool&) = delete;
+    ImageBufferPool& operator=(const ImageBufferPool&) = delete;
+    ~ImageBufferPool();
+
+    // Returns an aligned buffer for num elements of T. This is raw memory, no constructors are run: T has to be a type
+    // which new[] would also leave uninitialized (float, Eigen::Vector3f, ...), and the caller has to write every
+    // element before reading it. Note that a recycled buffer contains the data of its previous user.
+    template<typename T>
+    T* get(int num)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "ImageBufferPool does not run destructors.");
+        return static_cast<T*>(getBytes(sizeof(T) * num));
+    }
+
+    // Gives a buffer obtained with get (and the same num) back to the pool.
+    template<typename T>
+    void release(T* buffer, int num)
+    {
+        releaseBytes(buffer, sizeof(T) * num);
+    }
+
+    Stats getStats();
+
+private:
+    void* getBytes(size_t bytes);
+    void releaseBytes(void* buffer, size_t bytes);
+
+    boost::mutex mutex;
+    std::unordered_map<size_t, std::vector<void*>> freeBuffers;
+    Stats stats;
+};
+
+}
+
+#endif //DMVIO_IMAGEBUFFERPOOL_H
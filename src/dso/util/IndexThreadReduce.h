@@ -24,18 +24,30 @@
 */
 
 
-
 #pragma once
 #include "util/settings.h"
+#include "util/NumType.h"
 #include "boost/thread.hpp"
 #include <stdio.h>
 #include <iostream>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <stdint.h>
 
 
 
 namespace dso
 {
 using namespace boost::placeholders;
+
+// Thread pool which splits the index range of a reduce call among a runtime-configurable number of threads.
+// The range is cut into chunks of stepSize and every thread initially owns a contiguous block of chunks, stored as a
+// lock-free [begin, end) pair. A thread works through its own block from the front, and once it is empty it steals
+// the back half of the block of another thread. The thread calling reduce participates as worker 0.
+// As before, every worker is called at least once per reduce (with an empty range if it got no work), and each worker
+// sums into its own Running, so per-thread accumulators indexed by tid (e.g. setZero) keep working.
+// Only one reduce call may be active at a time for each instance.
 template<typename Running>
 class IndexThreadReduce
 {
@@ -43,20 +55,27 @@ class IndexThreadReduce
 public:
         EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
 
-	inline IndexThreadReduce()
+	inline IndexThreadReduce(int numThreadsPassed = setting_numThreads)
 	{
+		if(numThreadsPassed <= 0) numThreadsPassed = boost::thread::hardware_concurrency();
+		numThreads = std::max(1, std::min(numThreadsPassed, MAX_NUM_THREADS));
+
 		nextIndex = 0;
 		maxIndex = 0;
 		stepSize = 1;
 		callPerIndex = boost::bind(&IndexThreadReduce::callPerIndexDefault, this, _1, _2, _3, _4);
 
+		chunkRanges.reset(new ChunkRange[numThreads]);
+		threadStats.resize(numThreads);
+		for(int i=0;i<numThreads;i++)
+			chunkRanges[i].range.store(0);
+
 		running = true;
-		for(int i=0;i<NUM_THREADS;i++)
-		{
-			isDone[i] = false;
-			gotOne[i] = true;
-			workerThreads[i] = boost::thread(&IndexThreadReduce::workerLoop, this, i);
-		}
+		generation = 0;
+		numDone = 0;
+		// worker 0 is the calling thread.
+		for(int i=1;i<numThreads;i++)
+			workerThreads.emplace_back(&IndexThreadReduce::workerLoop, this, i);
 
 	}
 	inline ~IndexThreadReduce()
@@ -67,8 +86,8 @@ public:
 		todo_signal.notify_all();
 		exMutex.unlock();
 
-		for(int i=0;i<NUM_THREADS;i++)
-			workerThreads[i].join();
+		for(auto&& thread : workerThreads)
+			thread.join();
 
 
 		printf("destroyed ThreadReduce\n");
@@ -80,21 +99,13 @@ public:
 
 		memset(&stats, 0, sizeof(Running));
 
-//		if(!multiThreading)
-//		{
-//			callPerIndex(first, end, &stats, 0);
-//			return;
-//		}
-
-
-
+		// without explicit step size, make a few chunks per thread so that stealing can balance the load.
 		if(stepSize == 0)
-			stepSize = ((end-first)+NUM_THREADS-1)/NUM_THREADS;
-
+			stepSize = ((end-first)+numThreads*CHUNKS_PER_THREAD-1)/(numThreads*CHUNKS_PER_THREAD);
+		if(stepSize < 1)
+			stepSize = 1;
 
-		//printf("reduce called\n");
-
-		boost::unique_lock<boost::mutex> lock(exMutex);
+		int numChunks = end > first ? ((end-first)+stepSize-1)/stepSize : 0;
 
 		// save
 		this->callPerIndex = callPerIndex;
@@ -102,58 +113,88 @@ public:
 		maxIndex = end;
 		this->stepSize = stepSize;
 
+		// distribute chunks.
+		for(int i=0;i<numThreads;i++)
+		{
+			uint32_t begin = (uint32_t)(((int64_t)numChunks * i) / numThreads);
+			uint32_t finish = (uint32_t)(((int64_t)numChunks * (i+1)) / numThreads);
+			chunkRanges[i].range.store(packRange(begin, finish), std::memory_order_relaxed);
+		}
+		numDone.store(0, std::memory_order_relaxed);
+
 		// go worker threads!
-		for(int i=0;i<NUM_THREADS;i++)
+		if(numThreads > 1)
 		{
-			isDone[i] = false;
-			gotOne[i] = false;
+			boost::unique_lock<boost::mutex> lock(exMutex);
+			generation.fetch_add(1, std::memory_order_release);
+			todo_signal.notify_all();
 		}
 
-		// let them start!
-		todo_signal.notify_all();
+		// work on chunks ourselves.
+		processChunks(0);
 
+		// wait for all worker threads to signal they are done. They are busy, so we don't sleep here.
+		while(numDone.load(std::memory_order_acquire) < numThreads-1)
+			boost::this_thread::yield();
 
-		//printf("reduce waiting for threads to finish\n");
-		// wait for all worker threads to signal they are done.
-		while(true)
-		{
-			// wait for at least one to finish
-			done_signal.wait(lock);
-			//printf("thread finished!\n");
-
-			// check if actually all are finished.
-			bool allDone = true;
-			for(int i=0;i<NUM_THREADS;i++)
-				allDone = allDone && isDone[i];
-
-			// all are finished! exit.
-			if(allDone)
-				break;
-		}
+		for(int i=0;i<numThreads;i++)
+			stats += threadStats[i];
 
 		nextIndex = 0;
 		maxIndex = 0;
 		this->callPerIndex = boost::bind(&IndexThreadReduce::callPerIndexDefault, this, _1, _2, _3, _4);
+	}
 
-		//printf("reduce done (all threads finished)\n");
+	// Number of threads (including the calling one) a reduce is split into, i.e. the range of tid.
+	inline int getNumThreads() const
+	{
+		return numThreads;
 	}
 
 	Running stats;
 
 private:
-	boost::thread workerThreads[NUM_THREADS];
-	bool isDone[NUM_THREADS];
-	bool gotOne[NUM_THREADS];
+	// Number of chunks per thread when reduce is called without stepSize.
+	static constexpr int CHUNKS_PER_THREAD = 4;
+	// Number of times an idle worker yields before going to sleep.
+	static constexpr int SPINS_BEFORE_SLEEP = 1000;
+
+	// [begin, end) of the chunks owned by a thread, packed into one word so that it can be modified with a single CAS.
+	// Padded to a cache line to avoid false sharing.
+	struct ChunkRange
+	{
+		std::atomic<uint64_t> range;
+		char padding[64 - sizeof(std::atomic<uint64_t>)];
+	};
+
+	static inline uint64_t packRange(uint32_t begin, uint32_t end)
+	{
+		return ((uint64_t)end << 32) | begin;
+	}
+	static inline uint32_t rangeBegin(uint64_t range)
+	{
+		return (uint32_t)(range & 0xffffffffu);
+	}
+	static inline uint32_t rangeEnd(uint64_t range)
+	{
+		return (uint32_t)(range >> 32);
+	}
+
+	int numThreads;
+	std::vector<boost::thread> workerThreads;
+	std::unique_ptr<ChunkRange[]> chunkRanges;
+	std::vector<Running, Eigen::aligned_allocator<Running>> threadStats;
 
 	boost::mutex exMutex;
 	boost::condition_variable todo_signal;
-	boost::condition_variable done_signal;
+	std::atomic<int> generation; // incremented for every reduce call.
+	std::atomic<int> numDone; // number of worker threads (excluding the calling thread) done with the current call.
 
 	int nextIndex;
 	int maxIndex;
 	int stepSize;
 
-	bool running;
+	std::atomic<bool> running;
 
 	boost::function<void(int,int,Running*,int)> callPerIndex;
 
@@ -163,55 +204,90 @@ private:
 		assert(false);
 	}
 
-	void workerLoop(int idx)
+	// take the first chunk of the own range.
+	inline bool popChunk(int idx, uint32_t& chunk)
 	{
-		boost::unique_lock<boost::mutex> lock(exMutex);
-
-		while(running)
+		std::atomic<uint64_t>& own = chunkRanges[idx].range;
+		uint64_t range = own.load(std::memory_order_acquire);
+		while(rangeBegin(range) < rangeEnd(range))
 		{
-			// try to get something to do.
-			int todo = 0;
-			bool gotSomething = false;
-			if(nextIndex < maxIndex)
+			if(own.compare_exchange_weak(range, packRange(rangeBegin(range)+1, rangeEnd(range)),
+										 std::memory_order_acq_rel))
 			{
-				// got something!
-				todo = nextIndex;
-				nextIndex+=stepSize;
-				gotSomething = true;
+				chunk = rangeBegin(range);
+				return true;
 			}
+		}
+		return false;
+	}
 
-			// if got something: do it (unlock in the meantime)
-			if(gotSomething)
+	// steal the back half of the range of another thread, return its first chunk and keep the rest as own range.
+	// Must only be called when the own range is empty.
+	inline bool stealChunk(int idx, uint32_t& chunk)
+	{
+		for(int k=1;k<numThreads;k++)
+		{
+			std::atomic<uint64_t>& victim = chunkRanges[(idx+k)%numThreads].range;
+			uint64_t range = victim.load(std::memory_order_acquire);
+			while(rangeBegin(range) < rangeEnd(range))
 			{
-				lock.unlock();
+				uint32_t begin = rangeBegin(range);
+				uint32_t end = rangeEnd(range);
+				uint32_t newEnd = end - (end-begin+1)/2;
+				if(victim.compare_exchange_weak(range, packRange(begin, newEnd), std::memory_order_acq_rel))
+				{
+					chunk = newEnd;
+					chunkRanges[idx].range.store(packRange(newEnd+1, end), std::memory_order_release);
+					return true;
+				}
+			}
+		}
+		return false;
+	}
 
-				assert(callPerIndex != 0);
+	void processChunks(int idx)
+	{
+		Running& s = threadStats[idx];
+		memset(&s, 0, sizeof(Running));
+		assert(callPerIndex != 0);
 
-				Running s; memset(&s, 0, sizeof(Running));
-				callPerIndex(todo, std::min(todo+stepSize, maxIndex), &s, idx);
-				gotOne[idx] = true;
-				lock.lock();
-				stats += s;
-			}
+		bool gotOne = false;
+		uint32_t chunk;
+		while(popChunk(idx, chunk) || stealChunk(idx, chunk))
+		{
+			int todo = nextIndex + (int)chunk*stepSize;
+			callPerIndex(todo, std::min(todo+stepSize, maxIndex), &s, idx);
+			gotOne = true;
+		}
+
+		// every thread is called at least once.
+		if(!gotOne)
+			callPerIndex(0, 0, &s, idx);
+	}
 
-			// otherwise wait on signal, releasing lock in the meantime.
-			else
+	void workerLoop(int idx)
+	{
+		int lastGeneration = 0;
+		while(true)
+		{
+			// spin shortly, as reduce calls often come in quick succession. Otherwise wait on signal.
+			int spins = 0;
+			while(running && generation.load(std::memory_order_acquire) == lastGeneration)
 			{
-				if(!gotOne[idx])
+				if(spins++ < SPINS_BEFORE_SLEEP)
 				{
-					lock.unlock();
-					assert(callPerIndex != 0);
-					Running s; memset(&s, 0, sizeof(Running));
-					callPerIndex(0, 0, &s, idx);
-					gotOne[idx] = true;
-					lock.lock();
-					stats += s;
+					boost::this_thread::yield();
+					continue;
 				}
-				isDone[idx] = true;
-				//printf("worker %d waiting..\n", idx);
-				done_signal.notify_all();
-				todo_signal.wait(lock);
+				boost::unique_lock<boost::mutex> lock(exMutex);
+				while(running && generation.load(std::memory_order_acquire) == lastGeneration)
+					todo_signal.wait(lock);
 			}
+			if(!running) return;
+
+			lastGeneration = generation.load(std::memory_order_acquire);
+			processChunks(idx);
+			numDone.fetch_add(1, std::memory_order_release);
 		}
 	}
 };
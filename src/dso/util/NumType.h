@@ -39,7 +39,8 @@ namespace dso
 
 
 #define MAX_RES_PER_POINT 8
-#define NUM_THREADS 6
+#define NUM_THREADS 6 // default number of threads, can be changed at runtime with setting_numThreads.
+#define MAX_NUM_THREADS 64 // upper bound for setting_numThreads, used to size per-thread buffers.
 
 
 #define todouble(x) (x).cast<double>()
@@ -0,0 +1,175 @@
+/**
+* This file is part of DSO, written by Jakob Engel.
+* It has been modified by Lukas von Stumberg for the inclusion in DM-VIO (http://vision.in.tum.de/dm-vio).
+*
+* Copyright 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>
+* Copyright 2016 Technical University of Munich and Intel.
+* Developed by Jakob Engel <engelj at in dot tum dot de>,
+* for more information see <http://vision.in.tum.de/dso>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DSO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DSO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DSO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+
+#pragma once
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/condition_variable.hpp"
+#include <atomic>
+#include <assert.h>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+
+namespace dso
+{
+
+// Bounded lock-free queue with exactly one producer and one consumer thread.
+// tryPush/tryPop only touch the two indices, the mutex is taken only to wake a consumer that is sleeping in waitPop
+// or a producer sleeping in waitForSpace (like a futex: the waiting side announces that it is going to sleep,
+// and the other side only signals if it did).
+template<typename T>
+class SPSCQueue
+{
+public:
+	// capacity is rounded up to a power of two.
+	inline explicit SPSCQueue(size_t minCapacity)
+	{
+		size_t capacity = 1;
+		while(capacity < minCapacity) capacity *= 2;
+		buffer.resize(capacity);
+		mask = capacity - 1;
+	}
+
+	SPSCQueue(const SPSCQueue&) = delete;
+	SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+	// producer only. returns false if the queue is full.
+	inline bool tryPush(const T& value)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if(t - head.load(std::memory_order_acquire) > mask) return false;
+		buffer[t & mask] = value;
+		// seq_cst, so that either the consumer sees the new element or we see that it is waiting.
+		tail.store(t + 1, std::memory_order_seq_cst);
+		if(consumerWaiting.load(std::memory_order_seq_cst))
+			wakeConsumer();
+		return true;
+	}
+
+	// producer only. Blocks until there is space for at least one element, or interrupt() is called.
+	// As only the producer adds elements, a following tryPush is guaranteed to succeed unless it was interrupted.
+	// Don't hold a lock here which the consumer needs to make progress.
+	inline void waitForSpace()
+	{
+		if(!full()) return;
+
+		boost::unique_lock<boost::mutex> lock(wakeMutex);
+		producerWaiting.store(true, std::memory_order_seq_cst);
+		while(!interrupted && tail.load(std::memory_order_relaxed) - head.load(std::memory_order_seq_cst) > mask)
+			spaceSignal.wait(lock);
+		producerWaiting.store(false, std::memory_order_relaxed);
+	}
+
+	// producer only. If the queue is full this blocks until the consumer made space.
+	// returns false only if the queue is still full after interrupt() has been called.
+	inline bool push(const T& value)
+	{
+		waitForSpace();
+		return tryPush(value);
+	}
+
+	// consumer only. returns false if the queue is empty.
+	inline bool tryPop(T& value)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if(h == tail.load(std::memory_order_acquire)) return false;
+		value = buffer[h & mask];
+		// seq_cst, so that either the producer sees the free slot or we see that it is waiting.
+		head.store(h + 1, std::memory_order_seq_cst);
+		if(producerWaiting.load(std::memory_order_seq_cst))
+			wakeProducer();
+		return true;
+	}
+
+	// consumer only. Blocks until an element is available, returns false if interrupt() is called while waiting.
+	inline bool waitPop(T& value)
+	{
+		if(tryPop(value)) return true;
+
+		boost::unique_lock<boost::mutex> lock(wakeMutex);
+		consumerWaiting.store(true, std::memory_order_seq_cst);
+		while(!interrupted && head.load(std::memory_order_relaxed) == tail.load(std::memory_order_seq_cst))
+			wakeSignal.wait(lock);
+		consumerWaiting.store(false, std::memory_order_relaxed);
+		lock.unlock();
+
+		return tryPop(value);
+	}
+
+	// wakes up the consumer and the producer, all following calls to waitPop and waitForSpace return immediately.
+	inline void interrupt()
+	{
+		boost::unique_lock<boost::mutex> lock(wakeMutex);
+		interrupted = true;
+		wakeSignal.notify_all();
+		spaceSignal.notify_all();
+	}
+
+	// exact if called by the producer or consumer while the other one is idle, otherwise a snapshot.
+	inline size_t size() const
+	{
+		size_t h = head.load(std::memory_order_acquire);
+		return tail.load(std::memory_order_acquire) - h;
+	}
+	inline bool empty() const {return size() == 0;}
+	inline bool full() const {return size() > mask;}
+	inline size_t capacity() const {return mask + 1;}
+
+private:
+	inline void wakeConsumer()
+	{
+		// taking the mutex ensures the consumer is either before its check or already waiting.
+		boost::unique_lock<boost::mutex> lock(wakeMutex);
+		wakeSignal.notify_one();
+	}
+
+	inline void wakeProducer()
+	{
+		boost::unique_lock<boost::mutex> lock(wakeMutex);
+		spaceSignal.notify_one();
+	}
+
+	// head is written by the consumer, tail by the producer, keep them on different cache lines.
+	alignas(64) std::atomic<size_t> head{0};
+	alignas(64) std::atomic<size_t> tail{0};
+	alignas(64) std::atomic<bool> consumerWaiting{false};
+	alignas(64) std::atomic<bool> producerWaiting{false};
+
+	std::vector<T> buffer;
+	size_t mask;
+
+	boost::mutex wakeMutex;
+	boost::condition_variable wakeSignal; // consumer waits for an element.
+	boost::condition_variable spaceSignal; // producer waits for space.
+	bool interrupted = false;
+};
+
+}
+
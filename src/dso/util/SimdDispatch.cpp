@@ -0,0 +1,92 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "SimdDispatch.h"
+#include "settings.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace dso
+{
+
+SimdLevel detectSimdLevel()
+{
+#if DSO_WIDE_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+    {
+        return SimdLevel::AVX512;
+    }
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return SimdLevel::AVX2;
+    }
+#endif
+    return SimdLevel::SSE;
+}
+
+SimdLevel getSimdLevel()
+{
+    static const SimdLevel level = []()
+    {
+        int detected = static_cast<int>(detectSimdLevel());
+        int chosen = setting_simdLevel < 0 ? detected : std::min(setting_simdLevel, detected);
+        SimdLevel ret = static_cast<SimdLevel>(chosen);
+        if(!setting_debugout_runquiet)
+        {
+            printf("Using %s kernels (CPU supports %s).\n", simdLevelName(ret),
+                   simdLevelName(static_cast<SimdLevel>(detected)));
+        }
+        return ret;
+    }();
+    return level;
+}
+
+int simdWidth(SimdLevel level)
+{
+    switch(level)
+    {
+        case SimdLevel::AVX2:
+            return 8;
+        case SimdLevel::AVX512:
+            return 16;
+        default:
+            return 4;
+    }
+}
+
+const char* simdLevelName(SimdLevel level)
+{
+    switch(level)
+    {
+        case SimdLevel::AVX2:
+            return "AVX2";
+        case SimdLevel::AVX512:
+            return "AVX-512";
+        default:
+            return "SSE";
+    }
+}
+
+}
@@ -0,0 +1,60 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef DMVIO_SIMDDISPATCH_H
+#define DMVIO_SIMDDISPATCH_H
+
+// Wide (AVX2 / AVX-512) kernels are compiled with function-level target attributes, so the rest of the code
+// keeps the baseline SSE flags and the kernels are only entered when the CPU supports them.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define DSO_WIDE_SIMD 1
+#define DSO_TARGET_AVX2 __attribute__((target("avx2")))
+#define DSO_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define DSO_WIDE_SIMD 0
+#endif
+
+namespace dso
+{
+
+enum class SimdLevel
+{
+    SSE = 0, AVX2 = 1, AVX512 = 2
+};
+
+// Widest instruction set supported by this CPU (and this build), determined with CPUID.
+SimdLevel detectSimdLevel();
+
+// Instruction set used by the dispatched kernels: detectSimdLevel(), capped by setting_simdLevel.
+// Determined on the first call and cached afterwards.
+SimdLevel getSimdLevel();
+
+// Number of floats processed per instruction.
+int simdWidth(SimdLevel level);
+
+const char* simdLevelName(SimdLevel level);
+
+}
+
+#endif //DMVIO_SIMDDISPATCH_H
@@ -0,0 +1,155 @@
+/**
+* This file is part of DSO, written by Jakob Engel.
+* It has been modified by Lukas von Stumberg for the inclusion in DM-VIO (http://vision.in.tum.de/dm-vio).
+*
+* Copyright 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>
+* Copyright 2016 Technical University of Munich and Intel.
+* Developed by Jakob Engel <engelj at in dot tum dot de>,
+* for more information see <http://vision.in.tum.de/dso>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DSO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DSO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DSO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#pragma once
+#include "boost/thread/mutex.hpp"
+#include <algorithm>
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+#include <vector>
+
+
+namespace dso
+{
+
+// Base of SlabAllocator, non-templated so that objects can be returned without knowing their allocator.
+// Memory is handed out from large slabs aligned to SlabSize, each starting with a header that points to the owning
+// allocator. Freed objects are kept in an intrusive free list and reused, slabs are only released with the allocator.
+class SlabAllocatorBase
+{
+public:
+	static constexpr size_t SlabSize = 1 << 18;
+
+	// returns ptr to the allocator it was obtained from (thread-safe, like allocate).
+	static inline void deallocate(void* ptr)
+	{
+		if(ptr == nullptr) return;
+		SlabHeader* slab = reinterpret_cast<SlabHeader*>(reinterpret_cast<uintptr_t>(ptr) & ~(uintptr_t)(SlabSize - 1));
+		slab->owner->free(ptr);
+	}
+
+	// number of objects currently allocated.
+	inline size_t numAllocated() const {return numLive;}
+	inline size_t numSlabs() const {return slabs.size();}
+
+protected:
+	inline SlabAllocatorBase(size_t objectSizePassed, size_t alignmentPassed)
+	{
+		alignment = alignmentPassed;
+		objectSize = ((std::max(objectSizePassed, sizeof(FreeNode)) + alignment - 1) / alignment) * alignment;
+		firstOffset = ((sizeof(SlabHeader) + alignment - 1) / alignment) * alignment;
+		assert(firstOffset + objectSize <= SlabSize);
+	}
+
+	inline ~SlabAllocatorBase()
+	{
+		// If objects are still alive (they would be deleted later), keep their memory rather than leaving them dangling.
+		if(numLive != 0) return;
+		for(void* slab : slabs)
+			::free(slab);
+	}
+
+	inline void* allocate()
+	{
+		boost::unique_lock<boost::mutex> lock(mutex);
+		if(freeList == nullptr) addSlab();
+		FreeNode* node = freeList;
+		freeList = node->next;
+		numLive++;
+		return node;
+	}
+
+private:
+	struct SlabHeader
+	{
+		SlabAllocatorBase* owner;
+	};
+	struct FreeNode
+	{
+		FreeNode* next;
+	};
+
+	inline void free(void* ptr)
+	{
+		boost::unique_lock<boost::mutex> lock(mutex);
+		FreeNode* node = static_cast<FreeNode*>(ptr);
+		node->next = freeList;
+		freeList = node;
+		assert(numLive > 0);
+		numLive--;
+	}
+
+	inline void addSlab()
+	{
+		void* mem = aligned_alloc(SlabSize, SlabSize);
+		if(mem == nullptr) throw std::bad_alloc();
+		slabs.push_back(mem);
+		static_cast<SlabHeader*>(mem)->owner = this;
+
+		// push in reverse order, so that consecutive allocations are consecutive in memory.
+		char* begin = static_cast<char*>(mem) + firstOffset;
+		size_t num = (SlabSize - firstOffset) / objectSize;
+		for(size_t i = num; i > 0; i--)
+		{
+			FreeNode* node = reinterpret_cast<FreeNode*>(begin + (i - 1) * objectSize);
+			node->next = freeList;
+			freeList = node;
+		}
+	}
+
+	size_t alignment, objectSize, firstOffset;
+	std::vector<void*> slabs;
+	FreeNode* freeList = nullptr;
+	size_t numLive = 0;
+	boost::mutex mutex;
+};
+
+
+// Pool for objects of type T, which are allocated with new (allocator) T(...) and freed with a normal delete.
+// For this T declares
+//   void* operator new(size_t size, SlabAllocator<T>& allocator) {return allocator.allocate(size);}
+//   void operator delete(void* ptr, SlabAllocator<T>& allocator) {SlabAllocatorBase::deallocate(ptr);}
+//   void operator delete(void* ptr) {SlabAllocatorBase::deallocate(ptr);}
+// instead of EIGEN_MAKE_ALIGNED_OPERATOR_NEW. All objects have to be deleted before the allocator.
+template<typename T, size_t Alignment = 32>
+class SlabAllocator : public SlabAllocatorBase
+{
+public:
+	inline SlabAllocator() : SlabAllocatorBase(sizeof(T), Alignment) {}
+	SlabAllocator(const SlabAllocator&) = delete;
+	SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+	inline void* allocate(size_t size)
+	{
+		assert(size <= sizeof(T));
+		return SlabAllocatorBase::allocate();
+	}
+};
+
+}
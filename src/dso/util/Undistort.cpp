@@ -35,6 +35,12 @@
 #include "IOWrapper/ImageDisplay.h"
 #include "IOWrapper/ImageRW.h"
 #include "util/Undistort.h"
+#include "util/IndexThreadReduce.h"
+#include "util/SimdDispatch.h"
+
+#if DSO_WIDE_SIMD
+#include <immintrin.h>
+#endif
 
 
 namespace dso
@@ -212,10 +218,16 @@ void PhotometricUndistorter::unMapFloatImage(float* image)
 
 template<typename T>
 void PhotometricUndistorter::processFrame(T* image_in, float exposure_time, float factor)
+{
+	processFrame<T>(image_in, exposure_time, factor, output);
+}
+
+template<typename T>
+void PhotometricUndistorter::processFrame(T* image_in, float exposure_time, float factor, ImageAndExposure* out) const
 {
 	int wh=w*h;
-    float* data = output->image;
-	assert(output->w == w && output->h == h);
+    float* data = out->image;
+	assert(out->w == w && out->h == h);
 	assert(data != 0);
 
 
@@ -225,8 +237,8 @@ void PhotometricUndistorter::processFrame(T* image_in, float exposure_time, floa
 		{
 			data[i] = factor*image_in[i];
 		}
-		output->exposure_time = exposure_time;
-		output->timestamp = 0;
+		out->exposure_time = exposure_time;
+		out->timestamp = 0;
 	}
 	else
 	{
@@ -241,17 +253,175 @@ void PhotometricUndistorter::processFrame(T* image_in, float exposure_time, floa
 				data[i] *= vignetteMapInv[i];
 		}
 
-		output->exposure_time = exposure_time;
-		output->timestamp = 0;
+		out->exposure_time = exposure_time;
+		out->timestamp = 0;
 	}
 
 
 	if(!setting_useExposure)
-		output->exposure_time = 1;
+		out->exposure_time = 1;
 
 }
 template void PhotometricUndistorter::processFrame<unsigned char>(unsigned char* image_in, float exposure_time, float factor);
 template void PhotometricUndistorter::processFrame<unsigned short>(unsigned short* image_in, float exposure_time, float factor);
+template void PhotometricUndistorter::processFrame<unsigned char>(unsigned char* image_in, float exposure_time, float factor, ImageAndExposure* out) const;
+template void PhotometricUndistorter::processFrame<unsigned short>(unsigned short* image_in, float exposure_time, float factor, ImageAndExposure* out) const;
+
+int PhotometricUndistorter::getProcessMode(float exposure_time) const
+{
+	if(!valid || exposure_time <= 0 || setting_photometricCalibration==0)
+		return 0;
+	return setting_photometricCalibration==2 ? 2 : 1;
+}
+
+
+
+namespace
+{
+// inputs of the fused remap + photometric correction.
+struct RemapParams
+{
+	const int* offset;
+	const uint32_t* weights;
+	float* out;
+	const float* G;
+	const float* vignetteMapInv;
+	float factor;
+	int wOrg;
+	int simdMaxOffset;	// 8 output pixels are only done with SIMD if no source offset is larger (gathers read 4 bytes).
+};
+
+template<typename T, int mode>
+inline float photometricValue(const T* in, const RemapParams& p, int i)
+{
+	if(mode == 0) return p.factor * in[i];
+	else if(mode == 1) return p.G[in[i]];
+	else return p.G[in[i]] * p.vignetteMapInv[i];
+}
+
+template<typename T, int mode>
+void remapScalar(const T* in, const RemapParams& p, int first, int end)
+{
+	const float weightScale = 1.0f / 65536.0f;
+	for(int idx=first;idx<end;idx++)
+	{
+		int off = p.offset[idx];
+		if(off < 0)
+		{
+			p.out[idx] = 0;
+			continue;
+		}
+
+		float xx = (p.weights[idx] & 0xffff) * weightScale;
+		float yy = (p.weights[idx] >> 16) * weightScale;
+		float xxyy = xx*yy;
+
+		// interpolate (bilinear)
+		p.out[idx] = xxyy * photometricValue<T,mode>(in, p, off+1+p.wOrg)
+					 + (yy-xxyy) * photometricValue<T,mode>(in, p, off+p.wOrg)
+					 + (xx-xxyy) * photometricValue<T,mode>(in, p, off+1)
+					 + (1-xx-yy+xxyy) * photometricValue<T,mode>(in, p, off);
+	}
+}
+
+#if DSO_WIDE_SIMD
+template<typename T, int mode>
+DSO_TARGET_AVX2 inline __m256 photometricValueAVX2(const T* in, const RemapParams& p, __m256i idx)
+{
+	// gather 4 bytes at the (byte) address of every pixel, and keep the lowest sizeof(T) of them.
+	__m256i raw = _mm256_i32gather_epi32((const int*)in, idx, sizeof(T));
+	raw = _mm256_and_si256(raw, _mm256_set1_epi32(sizeof(T) == 1 ? 0xff : 0xffff));
+
+	if(mode == 0)
+		return _mm256_mul_ps(_mm256_set1_ps(p.factor), _mm256_cvtepi32_ps(raw));
+
+	__m256 val = _mm256_i32gather_ps(p.G, raw, 4);
+	if(mode == 2)
+		val = _mm256_mul_ps(val, _mm256_i32gather_ps(p.vignetteMapInv, idx, 4));
+	return val;
+}
+
+template<typename T, int mode>
+DSO_TARGET_AVX2 void remapAVX2(const T* in, const RemapParams& p, int first, int end)
+{
+	const __m256i limit = _mm256_set1_epi32(p.simdMaxOffset);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i wOrg = _mm256_set1_epi32(p.wOrg);
+	const __m256i lowMask = _mm256_set1_epi32(0xffff);
+	const __m256 weightScale = _mm256_set1_ps(1.0f / 65536.0f);
+	const __m256 onef = _mm256_set1_ps(1.0f);
+
+	int idx = first;
+	for(;idx+8<=end;idx+=8)
+	{
+		__m256i off = _mm256_loadu_si256((const __m256i*)(p.offset+idx));
+		if(_mm256_movemask_epi8(_mm256_cmpgt_epi32(off, limit)) != 0)
+		{
+			remapScalar<T,mode>(in, p, idx, idx+8);
+			continue;
+		}
+
+		// invalid pixels read pixel 0 and are masked out at the end.
+		__m256i valid = _mm256_cmpgt_epi32(off, _mm256_set1_epi32(-1));
+		off = _mm256_max_epi32(off, _mm256_setzero_si256());
+
+		__m256i wts = _mm256_loadu_si256((const __m256i*)(p.weights+idx));
+		__m256 xx = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(wts, lowMask)), weightScale);
+		__m256 yy = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(wts, 16)), weightScale);
+		__m256 xxyy = _mm256_mul_ps(xx, yy);
+
+		__m256i offDown = _mm256_add_epi32(off, wOrg);
+		__m256 v00 = photometricValueAVX2<T,mode>(in, p, off);
+		__m256 v10 = photometricValueAVX2<T,mode>(in, p, _mm256_add_epi32(off, one));
+		__m256 v01 = photometricValueAVX2<T,mode>(in, p, offDown);
+		__m256 v11 = photometricValueAVX2<T,mode>(in, p, _mm256_add_epi32(offDown, one));
+
+		__m256 w00 = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(onef, xx), yy), xxyy);
+		__m256 res = _mm256_mul_ps(xxyy, v11);
+		res = _mm256_add_ps(res, _mm256_mul_ps(_mm256_sub_ps(yy, xxyy), v01));
+		res = _mm256_add_ps(res, _mm256_mul_ps(_mm256_sub_ps(xx, xxyy), v10));
+		res = _mm256_add_ps(res, _mm256_mul_ps(w00, v00));
+
+		_mm256_storeu_ps(p.out+idx, _mm256_and_ps(res, _mm256_castsi256_ps(valid)));
+	}
+	remapScalar<T,mode>(in, p, idx, end);
+}
+#endif
+
+template<typename T, int mode>
+void remapDispatch(SimdLevel level, const T* in, const RemapParams& p, int first, int end)
+{
+#if DSO_WIDE_SIMD
+	if(level != SimdLevel::SSE)
+	{
+		remapAVX2<T,mode>(in, p, first, end);
+		return;
+	}
+#endif
+	remapScalar<T,mode>(in, p, first, end);
+}
+}
+
+template<typename T>
+void Undistort::remapAndCorrect(const T* image_in, float* out, int mode, float factor, int first, int end,
+								SimdLevel level) const
+{
+	RemapParams p;
+	p.offset = remapOffset;
+	p.weights = remapWeights;
+	p.out = out;
+	p.G = photometricUndist->getGLookup();
+	p.vignetteMapInv = photometricUndist->getVignetteMapInv();
+	p.factor = factor;
+	p.wOrg = wOrg;
+	p.simdMaxOffset = wOrg*hOrg - wOrg - 1 - 4;
+
+	if(mode == 0) remapDispatch<T,0>(level, image_in, p, first, end);
+	else if(mode == 1) remapDispatch<T,1>(level, image_in, p, first, end);
+	else remapDispatch<T,2>(level, image_in, p, first, end);
+}
+template void Undistort::remapAndCorrect<unsigned char>(const unsigned char* image_in, float* out, int mode, float factor, int first, int end, SimdLevel level) const;
+template void Undistort::remapAndCorrect<unsigned short>(const unsigned short* image_in, float* out, int mode, float factor, int first, int end, SimdLevel level) const;
 
 
 
@@ -261,6 +431,8 @@ Undistort::~Undistort()
 {
 	if(remapX != 0) delete[] remapX;
 	if(remapY != 0) delete[] remapY;
+	if(remapOffset != 0) delete[] remapOffset;
+	if(remapWeights != 0) delete[] remapWeights;
 }
 
 Undistort* Undistort::getUndistorterForFile(std::string configFilename, std::string gammaFilename, std::string vignetteFilename)
@@ -391,14 +563,48 @@ ImageAndExposure* Undistort::undistort(const MinimalImage<T>* image_raw, float e
 		exit(1);
 	}
 
-	photometricUndist->processFrame<T>(image_raw->data, exposure, factor);
+	if(!passthrough && benchmark_varNoise<=0)
+	{
+		// photometric correction is fused into the remap, so the raw image is only read once.
+		ImageAndExposure* result = new ImageAndExposure(w, h, timestamp);
+		result->exposure_time = setting_useExposure ? exposure : 1;
+
+		const T* in_data = image_raw->data;
+		float* out_data = result->image;
+		int mode = photometricUndist->getProcessMode(exposure);
+		SimdLevel level = getSimdLevel();
+
+		boost::unique_lock<boost::mutex> lock(remapThreadsMutex, boost::try_to_lock);
+		if(multiThreading && lock.owns_lock() && !remapThreads)
+			remapThreads.reset(new IndexThreadReduce<Vec10>());
+
+		if(multiThreading && lock.owns_lock() && remapThreads->getNumThreads() > 1)
+		{
+			remapThreads->reduce([&](int min, int max, Vec10*, int)
+			{
+				remapAndCorrect<T>(in_data, out_data, mode, factor, min*w, max*w, level);
+			}, 0, h, 0);
+		}
+		else
+		{
+			remapAndCorrect<T>(in_data, out_data, mode, factor, 0, w*h, level);
+		}
+
+		applyBlurNoise(result->image);
+		return result;
+	}
+
+	// photometric correction goes to a buffer owned by this call (not photometricUndist->output),
+	// so that multiple images can be undistorted in parallel.
+	ImageAndExposure photometricOutput(wOrg, hOrg);
+	photometricUndist->processFrame<T>(image_raw->data, exposure, factor, &photometricOutput);
 	ImageAndExposure* result = new ImageAndExposure(w, h, timestamp);
-	photometricUndist->output->copyMetaTo(*result);
+	photometricOutput.copyMetaTo(*result);
 
 	if (!passthrough)
 	{
 		float* out_data = result->image;
-		float* in_data = photometricUndist->output->image;
+		float* in_data = photometricOutput.image;
 
 		float* noiseMapX=0;
 		float* noiseMapY=0;
@@ -473,7 +679,7 @@ ImageAndExposure* Undistort::undistort(const MinimalImage<T>* image_raw, float e
 	}
 	else
 	{
-		memcpy(result->image, photometricUndist->output->image, sizeof(float)*w*h);
+		memcpy(result->image, photometricOutput.image, sizeof(float)*w*h);
 	}
 
 	applyBlurNoise(result->image);
@@ -585,6 +791,33 @@ void Undistort::applyBlurNoise(float* img) const
 	delete[] noiseMapY;
 }
 
+void Undistort::makeRemapLUT()
+{
+	if(remapOffset != 0) delete[] remapOffset;
+	if(remapWeights != 0) delete[] remapWeights;
+	remapOffset = new int[w*h];
+	remapWeights = new uint32_t[w*h];
+
+	for(int idx=0;idx<w*h;idx++)
+	{
+		float xx = remapX[idx];
+		float yy = remapY[idx];
+		if(xx < 0)
+		{
+			remapOffset[idx] = -1;
+			remapWeights[idx] = 0;
+			continue;
+		}
+
+		int xxi = xx;
+		int yyi = yy;
+		uint32_t wx = std::min(65535, (int)lroundf((xx-xxi)*65536.0f));
+		uint32_t wy = std::min(65535, (int)lroundf((yy-yyi)*65536.0f));
+		remapOffset[idx] = xxi + yyi * wOrg;
+		remapWeights[idx] = wx | (wy << 16);
+	}
+}
+
 void Undistort::makeOptimalK_crop()
 {
 	printf("finding CROP optimal new model!\n");
@@ -942,6 +1175,8 @@ void Undistort::readFromFile(const char* configFileName, int nPars, std::string
 			}
 		}
 
+	makeRemapLUT();
+
 	valid = true;
 
 
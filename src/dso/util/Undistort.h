@@ -27,7 +27,11 @@
 #include "util/ImageAndExposure.h"
 #include "util/MinimalImage.h"
 #include "util/NumType.h"
+#include "util/SimdDispatch.h"
 #include "Eigen/Core"
+#include "boost/thread/mutex.hpp"
+#include <memory>
+#include <stdint.h>
 
 
 
@@ -36,6 +40,7 @@
 namespace dso
 {
 
+template<typename Running> class IndexThreadReduce;
 
 class PhotometricUndistorter
 {
@@ -49,8 +54,16 @@ public:
 	// raw irradiance = a*I + b.
 	// output will be written in [output].
 	template<typename T> void processFrame(T* image_in, float exposure_time, float factor=1);
+	// same, but output will be written in [out] (of size w x h), so it can be called from multiple threads.
+	template<typename T> void processFrame(T* image_in, float exposure_time, float factor, ImageAndExposure* out) const;
 	void unMapFloatImage(float* image);
 
+	// per-pixel mapping applied by processFrame for the given exposure, so that it can be fused into other passes:
+	// 0: factor*I, 1: G[I], 2: G[I]*vignetteMapInv.
+	int getProcessMode(float exposure_time) const;
+	const float* getVignetteMapInv() const {return vignetteMapInv;};
+	const float* getGLookup() const {return G;};
+
 	ImageAndExposure* output;
 
 	float* getG() {if(!valid) return 0; else return G;};
@@ -98,6 +111,24 @@ protected:
 	float* remapX;
 	float* remapY;
 
+	// fixed-point version of remapX / remapY used by undistort: remapOffset is the index of the top-left source pixel
+	// (-1 if invalid), remapWeights packs the sub-pixel x (low 16 bit) and y (high 16 bit) position in units of 1/65536.
+	int* remapOffset = nullptr;
+	uint32_t* remapWeights = nullptr;
+
+	// rows of the remap are split among these threads (created on first use).
+	// Only one undistort call can use them at a time, concurrent calls run single-threaded.
+	mutable std::unique_ptr<IndexThreadReduce<Vec10>> remapThreads;
+	mutable boost::mutex remapThreadsMutex;
+
+	void makeRemapLUT();
+
+	// remaps (and photometrically corrects) the output pixels [first, end) from the raw input image.
+	// level selects the kernel (AVX2 for all wide levels), undistort uses getSimdLevel().
+	template<typename T>
+	void remapAndCorrect(const T* image_in, float* out, int mode, float factor, int first, int end,
+						 SimdLevel level) const;
+
 	void applyBlurNoise(float* img) const;
 
 	void makeOptimalK_crop();
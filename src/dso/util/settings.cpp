@@ -77,9 +77,14 @@ float setting_initialCalibHessian = 5e9;
 
 
 /* some modes for solving the resulting linear system (e.g. orthogonalize wrt. unobservable dimensions) */
+// SOLVER_SPARSE_BLOCK_LDLT solves the final system with a block-sparse LDL^T (SparseBlockLDLT) instead of a dense one.
 //int setting_solverMode = SOLVER_FIX_LAMBDA | SOLVER_ORTHOGONALIZE_X_LATER;
 int setting_solverMode = SOLVER_ORTHOGONALIZE_X_LATER;
 double setting_solverModeDelta = 0.00001;
+// if true, H of the active part of the Hessian is only re-accumulated for host-target blocks with changed Jacobians.
+bool setting_incrementalTopHessian = false;
+// relative change of a residual Jacobian below which it counts as unchanged (0 = only identical ones).
+float setting_incrementalTopHessianTH = 0;
 bool setting_forceAceptStep = false;
 
 
@@ -102,6 +107,9 @@ int   setting_minFrameAge = 1;
 int   setting_maxOptIterations=6; // max GN iterations.
 int   setting_minOptIterations=1; // min GN iterations.
 float setting_thOptIterations=1.2; // factor on break threshold for GN iteration (larger = break earlier)
+float setting_optBudgetMs=0; // time budget for the GN iterations of one KF (0 = none, < 0 = derived from frame rate and mapper lag in realtime mode).
+float setting_optBudgetFrames=2; // derived budget: number of frame intervals the GN iterations may take (minus the mapper lag).
+float setting_optMinRelEnergyDecrease=0; // stop GN once an accepted step decreases the energy by less than this fraction (0 = off).
 
 
 
@@ -209,6 +217,14 @@ float freeDebugParam5 = 1;
 
 bool debugSaveImages = false;
 bool multiThreading = true;
+int setting_numThreads = 6; // number of threads used for multithreaded reductions (0 = number of hardware threads).
+int setting_simdLevel = -1; // widest vector kernels to use: 0 = SSE, 1 = AVX2, 2 = AVX-512, -1 = best supported by the CPU.
+bool setting_coarseTrackingParallelTries = false; // track the initialization hypotheses of the coarse tracker in parallel (not used while the IMU coarse graph is active).
+int setting_mappingBackpressure = 0; // realtime mode: 0 = stop tracing queued frames once more than 3 are waiting (original DSO), 1 = degrade mapping gradually with the lag (see MappingBackpressure).
+int setting_backpressureFramesPerLevel = 2; // queued frames per backpressure level.
+float setting_backpressureMsPerLevel = 100; // mapper lag (in ms of sensor time) per backpressure level.
+float setting_backpressureOptItsFactor = 0.5; // factor on the max GN iterations from backpressure level 1.
+float setting_backpressureDensityFactor = 0.6; // factor on the number of new and active points from backpressure level 3.
 bool disableAllDisplay = false;
 bool setting_logStuff = true;
 
@@ -46,6 +46,7 @@ namespace dso
 #define SOLVER_MOMENTUM (int)512
 #define SOLVER_STEPMOMENTUM (int)1024
 #define SOLVER_ORTHOGONALIZE_X_LATER (int)2048
+#define SOLVER_SPARSE_BLOCK_LDLT (int)4096
 
 
 // ============== PARAMETERS TO BE DECIDED ON COMPILE TIME =================
@@ -84,6 +85,8 @@ extern float setting_initialCalibHessian;
 
 extern int setting_solverMode;
 extern double setting_solverModeDelta;
+extern bool setting_incrementalTopHessian;
+extern float setting_incrementalTopHessianTH;
 
 
 extern float setting_minIdepthH_act;
@@ -103,6 +106,9 @@ extern int setting_minFrameAge;
 extern int setting_maxOptIterations;
 extern int setting_minOptIterations;
 extern float setting_thOptIterations;
+extern float setting_optBudgetMs;
+extern float setting_optBudgetFrames;
+extern float setting_optMinRelEnergyDecrease;
 extern float setting_outlierTH;
 extern float setting_outlierTHSumComponent;
 
@@ -199,6 +205,14 @@ extern int sparsityFactor;
 extern bool goStepByStep;
 extern bool plotStereoImages;
 extern bool multiThreading;
+extern int setting_numThreads;
+extern int setting_simdLevel;
+extern bool setting_coarseTrackingParallelTries;
+extern int setting_mappingBackpressure;
+extern int setting_backpressureFramesPerLevel;
+extern float setting_backpressureMsPerLevel;
+extern float setting_backpressureOptItsFactor;
+extern float setting_backpressureDensityFactor;
 
 extern float freeDebugParam1;
 extern float freeDebugParam2;
@@ -43,6 +43,7 @@
 #include "dso/util/DatasetReader.h"
 #include "dso/util/globalCalib.h"
 #include "util/TimeMeasurement.h"
+#include "util/ImagePrefetcher.h"
 
 #include "dso/util/NumType.h"
 #include "FullSystem/FullSystem.h"
@@ -57,6 +58,7 @@
 std::string gtFile = "";
 std::string source = "";
 std::string imuFile = "";
+std::string saveBinary = ""; // If set, the dataset is converted to a binary dataset with this filename, then we exit.
 
 bool reverse = false;
 int start = 0;
@@ -93,8 +95,18 @@ void exitThread()
 
 
 
+void addResultStreams(FullSystem* fullSystem)
+{
+    if(mainSettings.streamResults)
+    {
+        fullSystem->addResultStream(imuSettings.resultsPrefix + "result.txt", false, true);
+        fullSystem->addResultStream(imuSettings.resultsPrefix + "resultKFs.txt", true, false);
+    }
+}
+
 void run(ImageFolderReader* reader, IOWrap::PangolinDSOViewer* viewer)
 {
+    dmvio::TimeMeasurement::setThreadName("tracking");
 
     if(setting_photometricCalibration > 0 && reader->getPhotometricGamma() == 0)
     {
@@ -129,6 +141,7 @@ void run(ImageFolderReader* reader, IOWrap::PangolinDSOViewer* viewer)
 
     FullSystem* fullSystem = new FullSystem(linearizeOperation, imuCalibration, imuSettings);
     fullSystem->setGammaFunction(reader->getPhotometricGamma());
+    addResultStreams(fullSystem);
 
 
     if(viewer != 0)
@@ -179,6 +192,18 @@ void run(ImageFolderReader* reader, IOWrap::PangolinDSOViewer* viewer)
         }
     }
 
+    // Decode and undistort the next images in background threads while the current one is tracked.
+    std::unique_ptr<dmvio::ImagePrefetcher> prefetcher;
+    if(!mainSettings.preload && mainSettings.prefetch > 0)
+    {
+        size_t bytesPerImage = sizeof(float) * wG[0] * hG[0];
+        prefetcher = std::make_unique<dmvio::ImagePrefetcher>([reader](int id)
+                                                              { return reader->getImage(id); }, idsToPlay,
+                                                              mainSettings.prefetchThreads, mainSettings.prefetch,
+                                                              bytesPerImage,
+                                                              (size_t) mainSettings.prefetchMaxMB * 1024 * 1024);
+    }
+
     struct timeval tv_start;
     gettimeofday(&tv_start, NULL);
     clock_t started = clock();
@@ -203,6 +228,8 @@ void run(ImageFolderReader* reader, IOWrap::PangolinDSOViewer* viewer)
         ImageAndExposure* img;
         if(mainSettings.preload)
             img = preloadedImages[ii];
+        else if(prefetcher)
+            img = prefetcher->getImage(ii);
         else
             img = reader->getImage(i); // get next image
 
@@ -270,6 +297,7 @@ void run(ImageFolderReader* reader, IOWrap::PangolinDSOViewer* viewer)
                 fullSystem = new FullSystem(linearizeOperation, imuCalibration, imuSettings);
                 fullSystem->setGammaFunction(reader->getPhotometricGamma());
                 fullSystem->outputWrapper = wraps;
+                addResultStreams(fullSystem);
 
                 setting_fullResetRequested = false;
             }
@@ -288,17 +316,28 @@ void run(ImageFolderReader* reader, IOWrap::PangolinDSOViewer* viewer)
         }
 
     }
+    prefetcher.reset();
     fullSystem->blockUntilMappingIsFinished();
     clock_t ended = clock();
     struct timeval tv_end;
     gettimeofday(&tv_end, NULL);
 
 
-    fullSystem->printResult(imuSettings.resultsPrefix + "result.txt", false, false, true);
-    fullSystem->printResult(imuSettings.resultsPrefix + "resultKFs.txt", true, false, false);
-    fullSystem->printResult(imuSettings.resultsPrefix + "resultScaled.txt", false, true, true);
+    if(mainSettings.streamResults)
+    {
+        fullSystem->finishResultStreams();
+    }else
+    {
+        fullSystem->printResult(imuSettings.resultsPrefix + "result.txt", false, false, true);
+        fullSystem->printResult(imuSettings.resultsPrefix + "resultKFs.txt", true, false, false);
+        fullSystem->printResult(imuSettings.resultsPrefix + "resultScaled.txt", false, true, true);
+    }
 
     dmvio::TimeMeasurement::saveResults(imuSettings.resultsPrefix + "timings.txt");
+    if(dmvio::TimeMeasurement::isTracing())
+    {
+        dmvio::TimeMeasurement::saveTrace(imuSettings.resultsPrefix + "trace.json");
+    }
 
 
     int numFramesProcessed = abs(idsToPlay[0] - idsToPlay.back());
@@ -373,6 +412,7 @@ int main(int argc, char** argv)
     settingsUtil->registerArg("reverse", reverse);
     settingsUtil->registerArg("use16Bit", use16Bit);
     settingsUtil->registerArg("maxPreloadImages", maxPreloadImages);
+    settingsUtil->registerArg("saveBinary", saveBinary);
 
     // This call will parse all commandline arguments and potentially also read a settings yaml file if passed.
     mainSettings.parseArguments(argc, argv, *settingsUtil);
@@ -390,6 +430,7 @@ int main(int argc, char** argv)
         settingsStream.open(imuSettings.resultsPrefix + "usedSettingsdso.txt");
         settingsUtil->printAllSettings(settingsStream);
     }
+    dmvio::TimeMeasurement::enableTracing(mainSettings.traceEvents);
 
     // hook crtl+C.
     boost::thread exThread = boost::thread(exitThread);
@@ -398,6 +439,14 @@ int main(int argc, char** argv)
     reader->loadIMUData(imuFile);
     reader->setGlobalCalibration();
 
+    if(saveBinary != "")
+    {
+        reader->loadGTData(gtFile);
+        bool success = reader->saveBinaryDataset(saveBinary);
+        delete reader;
+        return success ? 0 : 1;
+    }
+
     if(!disableAllDisplay)
     {
         IOWrap::PangolinDSOViewer* viewer = new IOWrap::PangolinDSOViewer(wG[0], hG[0], false, settingsUtil,
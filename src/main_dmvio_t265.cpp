@@ -65,6 +65,7 @@ std::string calibSavePath = "./factoryCalibrationT265Camera.txt"; // Factory cal
 std::string camchainSavePath = ""; // Factory camchain will be saved here if set.
 
 int start = 2;
+int printTimingsEvery = 0; // If > 0, rolling timing statistics are printed every this many frames.
 
 
 using namespace dso;
@@ -95,8 +96,17 @@ void exitThread()
 }
 
 
+void addResultStreams(FullSystem* fullSystem)
+{
+    if(mainSettings.streamResults)
+    {
+        fullSystem->addResultStream(imuSettings.resultsPrefix + "result.txt", false, true);
+    }
+}
+
 void run(IOWrap::PangolinDSOViewer* viewer, Undistort* undistorter)
 {
+    dmvio::TimeMeasurement::setThreadName("tracking");
     bool linearizeOperation = false;
     auto fullSystem = std::make_unique<FullSystem>(linearizeOperation, imuCalibration, imuSettings);
 
@@ -110,6 +120,7 @@ void run(IOWrap::PangolinDSOViewer* viewer, Undistort* undistorter)
     {
         fullSystem->setGammaFunction(undistorter->photometricUndist->getG());
     }
+    addResultStreams(fullSystem.get());
 
     if(viewer != 0)
     {
@@ -154,6 +165,7 @@ void run(IOWrap::PangolinDSOViewer* viewer, Undistort* undistorter)
                     fullSystem->setGammaFunction(undistorter->photometricUndist->getG());
                 }
                 fullSystem->outputWrapper = wraps;
+                addResultStreams(fullSystem.get());
 
                 setting_fullResetRequested = false;
                 lastResetIndex = ii;
@@ -172,15 +184,31 @@ void run(IOWrap::PangolinDSOViewer* viewer, Undistort* undistorter)
             break;
         }
 
+        if(printTimingsEvery > 0 && ii % printTimingsEvery == 0)
+        {
+            dmvio::TimeMeasurement::printWindowSnapshot(std::cout, {"addActiveFrame", "fullCoarseTracking",
+                                                                    "makeKeyframe", "FullSystemOptimize"});
+        }
+
         ++ii;
 
     }
 
     fullSystem->blockUntilMappingIsFinished();
 
-    fullSystem->printResult(imuSettings.resultsPrefix + "result.txt", false, false, true);
+    if(mainSettings.streamResults)
+    {
+        fullSystem->finishResultStreams();
+    }else
+    {
+        fullSystem->printResult(imuSettings.resultsPrefix + "result.txt", false, false, true);
+    }
 
     dmvio::TimeMeasurement::saveResults(imuSettings.resultsPrefix + "timings.txt");
+    if(dmvio::TimeMeasurement::isTracing())
+    {
+        dmvio::TimeMeasurement::saveTrace(imuSettings.resultsPrefix + "trace.json");
+    }
 
     for(IOWrap::Output3DWrapper* ow : fullSystem->outputWrapper)
     {
@@ -213,6 +241,7 @@ int main(int argc, char** argv)
     frameSkippingSettings.registerArgs(*settingsUtil);
 
     settingsUtil->registerArg("start", start);
+    settingsUtil->registerArg("printTimingsEvery", printTimingsEvery);
     settingsUtil->registerArg("calibSavePath", calibSavePath);
     settingsUtil->registerArg("camchainSavePath", camchainSavePath);
     settingsUtil->registerArg("saveDatasetPath", saveDatasetPath);
@@ -231,6 +260,7 @@ int main(int argc, char** argv)
         settingsStream.open(imuSettings.resultsPrefix + "usedSettingsdso.txt");
         settingsUtil->printAllSettings(settingsStream);
     }
+    dmvio::TimeMeasurement::enableTracing(mainSettings.traceEvents);
 
     // hook crtl+C.
     boost::thread exThread = boost::thread(exitThread);
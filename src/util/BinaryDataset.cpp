@@ -0,0 +1,324 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "BinaryDataset.h"
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace dmvio;
+
+constexpr char dmvio::BinaryDataset::Magic[9];
+constexpr uint32_t dmvio::BinaryDataset::Version;
+constexpr uint64_t dmvio::BinaryDataset::ImageAlignment;
+constexpr uint32_t dmvio::BinaryDataset::FlagHasTimestamps;
+constexpr uint32_t dmvio::BinaryDataset::FlagHasExposures;
+
+dmvio::BinaryDataset::BinaryDataset(const std::string& filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        std::cerr << "BinaryDataset: Could not open " << filename << std::endl;
+        return;
+    }
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0 || (size_t) fileStat.st_size < sizeof(BinaryDatasetHeader))
+    {
+        std::cerr << "BinaryDataset: " << filename << " is too small." << std::endl;
+        close(fd);
+        return;
+    }
+    mappedSize = fileStat.st_size;
+    void* mapped = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping stays valid.
+    if(mapped == MAP_FAILED)
+    {
+        std::cerr << "BinaryDataset: mmap failed for " << filename << std::endl;
+        mappedSize = 0;
+        return;
+    }
+    mappedData = static_cast<const char*>(mapped);
+    // Frames are usually read in order, which lets the kernel read ahead.
+    posix_madvise(mapped, mappedSize, POSIX_MADV_SEQUENTIAL);
+
+    header = reinterpret_cast<const BinaryDatasetHeader*>(mappedData);
+    if(memcmp(header->magic, Magic, sizeof(header->magic)) != 0 || header->version != Version)
+    {
+        std::cerr << "BinaryDataset: " << filename << " is not a binary dataset of version " << Version << std::endl;
+        return;
+    }
+
+    // Check that all sections are inside the file.
+    uint64_t imageSize = (uint64_t) header->width * header->height * header->bytesPerPixel;
+    auto sectionFits = [this](uint64_t offset, uint64_t size)
+    {
+        return offset <= mappedSize && size <= mappedSize - offset;
+    };
+    if(!sectionFits(header->frameIndexOffset, header->numFrames * sizeof(BinaryFrameInfo)) ||
+       !sectionFits(header->imuOffset, header->numIMUMeasurements * sizeof(BinaryIMUMeasurement)) ||
+       !sectionFits(header->gtOffset, header->numGT * sizeof(BinaryGTEntry)) ||
+       header->numIMUFrames > header->numFrames || (header->bytesPerPixel != 1 && header->bytesPerPixel != 2))
+    {
+        std::cerr << "BinaryDataset: " << filename << " is truncated or corrupt." << std::endl;
+        return;
+    }
+    frames = reinterpret_cast<const BinaryFrameInfo*>(mappedData + header->frameIndexOffset);
+    imu = reinterpret_cast<const BinaryIMUMeasurement*>(mappedData + header->imuOffset);
+    gt = reinterpret_cast<const BinaryGTEntry*>(mappedData + header->gtOffset);
+
+    for(uint32_t i = 0; i < header->numFrames; ++i)
+    {
+        if(!sectionFits(frames[i].imageOffset, imageSize) ||
+           (i < header->numIMUFrames &&
+            (frames[i].imuBegin > frames[i].imuEnd || frames[i].imuEnd > header->numIMUMeasurements)))
+        {
+            std::cerr << "BinaryDataset: invalid index entry for frame " << i << " in " << filename << std::endl;
+            return;
+        }
+    }
+
+    valid = true;
+}
+
+dmvio::BinaryDataset::~BinaryDataset()
+{
+    if(mappedData)
+    {
+        munmap(const_cast<char*>(mappedData), mappedSize);
+    }
+}
+
+bool dmvio::BinaryDataset::isValid() const
+{
+    return valid;
+}
+
+int dmvio::BinaryDataset::getWidth() const
+{
+    return header->width;
+}
+
+int dmvio::BinaryDataset::getHeight() const
+{
+    return header->height;
+}
+
+int dmvio::BinaryDataset::getBytesPerPixel() const
+{
+    return header->bytesPerPixel;
+}
+
+int dmvio::BinaryDataset::getNumFrames() const
+{
+    return header->numFrames;
+}
+
+bool dmvio::BinaryDataset::hasTimestamps() const
+{
+    return header->flags & FlagHasTimestamps;
+}
+
+bool dmvio::BinaryDataset::hasExposures() const
+{
+    return header->flags & FlagHasExposures;
+}
+
+const BinaryFrameInfo& dmvio::BinaryDataset::getFrameInfo(int id) const
+{
+    return frames[id];
+}
+
+const void* dmvio::BinaryDataset::getImageData(int id) const
+{
+    return mappedData + frames[id].imageOffset;
+}
+
+int dmvio::BinaryDataset::getNumIMUFrames() const
+{
+    return header->numIMUFrames;
+}
+
+IMUData dmvio::BinaryDataset::getIMUData(int i) const
+{
+    IMUData imuData;
+    imuData.reserve(frames[i].imuEnd - frames[i].imuBegin);
+    for(uint64_t j = frames[i].imuBegin; j < frames[i].imuEnd; ++j)
+    {
+        const BinaryIMUMeasurement& meas = imu[j];
+        imuData.push_back(IMUMeasurement(Eigen::Vector3d(meas.acc[0], meas.acc[1], meas.acc[2]),
+                                         Eigen::Vector3d(meas.gyr[0], meas.gyr[1], meas.gyr[2]),
+                                         meas.integrationTime));
+    }
+    return imuData;
+}
+
+std::map<long long, GTData> dmvio::BinaryDataset::getGTData() const
+{
+    std::map<long long, GTData> gtData;
+    for(uint32_t i = 0; i < header->numGT; ++i)
+    {
+        const BinaryGTEntry& entry = gt[i];
+        Eigen::Quaterniond quat(entry.quaternion[3], entry.quaternion[0], entry.quaternion[1], entry.quaternion[2]);
+        Eigen::Vector3d translation(entry.translation[0], entry.translation[1], entry.translation[2]);
+        gtData[entry.id] = GTData(Sophus::SE3d(quat, translation),
+                                  Eigen::Vector3d(entry.velocity[0], entry.velocity[1], entry.velocity[2]),
+                                  Eigen::Vector3d(entry.biasRotation[0], entry.biasRotation[1],
+                                                  entry.biasRotation[2]),
+                                  Eigen::Vector3d(entry.biasTranslation[0], entry.biasTranslation[1],
+                                                  entry.biasTranslation[2]));
+    }
+    return gtData;
+}
+
+dmvio::BinaryDatasetWriter::BinaryDatasetWriter(const std::string& filename, int width, int height,
+                                                int bytesPerPixel)
+        : file(filename, std::ios::binary | std::ios::trunc)
+{
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BinaryDataset::Magic, sizeof(header.magic));
+    header.version = BinaryDataset::Version;
+    header.width = width;
+    header.height = height;
+    header.bytesPerPixel = bytesPerPixel;
+
+    // Placeholder, the real header is written in finish.
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    position = sizeof(header);
+}
+
+bool dmvio::BinaryDatasetWriter::isValid() const
+{
+    return file.good();
+}
+
+void dmvio::BinaryDatasetWriter::alignTo(uint64_t alignment)
+{
+    static const char zeros[64] = {};
+    uint64_t padding = (alignment - position % alignment) % alignment;
+    while(padding > 0)
+    {
+        uint64_t num = std::min(padding, (uint64_t) sizeof(zeros));
+        file.write(zeros, num);
+        position += num;
+        padding -= num;
+    }
+}
+
+void dmvio::BinaryDatasetWriter::addFrame(long long id, double timestamp, float exposure, const void* data)
+{
+    alignTo(BinaryDataset::ImageAlignment);
+
+    BinaryFrameInfo info;
+    memset(&info, 0, sizeof(info));
+    info.id = id;
+    info.timestamp = timestamp;
+    info.exposure = exposure;
+    info.imageOffset = position;
+    frames.push_back(info);
+
+    uint64_t imageSize = (uint64_t) header.width * header.height * header.bytesPerPixel;
+    file.write(static_cast<const char*>(data), imageSize);
+    position += imageSize;
+}
+
+void dmvio::BinaryDatasetWriter::setIMUData(const std::vector<IMUData>& imuDataAllFrames)
+{
+    imu.clear();
+    imuFrameEnds.clear();
+    for(const auto& imuData : imuDataAllFrames)
+    {
+        for(const auto& meas : imuData)
+        {
+            BinaryIMUMeasurement binMeas;
+            for(int k = 0; k < 3; ++k)
+            {
+                binMeas.acc[k] = meas.getAccData()[k];
+                binMeas.gyr[k] = meas.getGyrData()[k];
+            }
+            binMeas.integrationTime = meas.getIntegrationTime();
+            imu.push_back(binMeas);
+        }
+        imuFrameEnds.push_back(imu.size());
+    }
+}
+
+void dmvio::BinaryDatasetWriter::setGTData(const std::map<long long, GTData>& gtData)
+{
+    gt.clear();
+    for(const auto& pair : gtData)
+    {
+        const GTData& data = pair.second;
+        BinaryGTEntry entry;
+        entry.id = pair.first;
+        Eigen::Quaterniond quat = data.pose.unit_quaternion();
+        double quatCoeffs[4] = {quat.x(), quat.y(), quat.z(), quat.w()};
+        for(int k = 0; k < 4; ++k) entry.quaternion[k] = quatCoeffs[k];
+        for(int k = 0; k < 3; ++k)
+        {
+            entry.translation[k] = data.pose.translation()[k];
+            entry.velocity[k] = data.velocity[k];
+            entry.biasRotation[k] = data.biasRotation[k];
+            entry.biasTranslation[k] = data.biasTranslation[k];
+        }
+        gt.push_back(entry);
+    }
+}
+
+bool dmvio::BinaryDatasetWriter::finish(bool hasTimestamps, bool hasExposures)
+{
+    header.numFrames = frames.size();
+    header.numIMUFrames = std::min(imuFrameEnds.size(), frames.size());
+    header.numIMUMeasurements = imu.size();
+    header.numGT = gt.size();
+    header.flags = (hasTimestamps ? BinaryDataset::FlagHasTimestamps : 0) |
+                   (hasExposures ? BinaryDataset::FlagHasExposures : 0);
+
+    for(uint32_t i = 0; i < header.numIMUFrames; ++i)
+    {
+        frames[i].imuBegin = i > 0 ? imuFrameEnds[i - 1] : 0;
+        frames[i].imuEnd = imuFrameEnds[i];
+    }
+
+    alignTo(8);
+    header.frameIndexOffset = position;
+    file.write(reinterpret_cast<const char*>(frames.data()), frames.size() * sizeof(BinaryFrameInfo));
+    position += frames.size() * sizeof(BinaryFrameInfo);
+
+    header.imuOffset = position;
+    file.write(reinterpret_cast<const char*>(imu.data()), imu.size() * sizeof(BinaryIMUMeasurement));
+    position += imu.size() * sizeof(BinaryIMUMeasurement);
+
+    header.gtOffset = position;
+    file.write(reinterpret_cast<const char*>(gt.data()), gt.size() * sizeof(BinaryGTEntry));
+    position += gt.size() * sizeof(BinaryGTEntry);
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+    return !file.fail();
+}
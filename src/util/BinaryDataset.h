@@ -0,0 +1,166 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef DMVIO_BINARYDATASET_H
+#define DMVIO_BINARYDATASET_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <cstdint>
+#include "IMU/IMUTypes.h"
+#include "util/GTData.hpp"
+
+namespace dmvio
+{
+
+// A whole dataset sequence (raw 8 or 16 bit images, timestamps, exposures, IMU data and groundtruth) in one binary
+// file, which is memory-mapped for reading. Images are stored uncompressed in the original resolution, so they can be
+// handed to the undistorter without copying or decoding anything.
+//
+// File layout (all little-endian): BinaryDatasetHeader, image data (each image aligned to ImageAlignment bytes),
+// then numFrames BinaryFrameInfo, numIMUMeasurements BinaryIMUMeasurement and numGT BinaryGTEntry at the offsets
+// given in the header.
+struct BinaryDatasetHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t width, height;
+    uint32_t bytesPerPixel;
+    uint32_t numFrames;
+    uint32_t numIMUFrames; // number of frames with IMU data (see BinaryFrameInfo::imuBegin).
+    uint32_t numGT;
+    uint64_t numIMUMeasurements;
+    uint64_t frameIndexOffset;
+    uint64_t imuOffset;
+    uint64_t gtOffset;
+};
+
+struct BinaryFrameInfo
+{
+    int64_t id; // e.g. the timestamp in nanoseconds used by EuRoC.
+    double timestamp; // in seconds.
+    float exposure; // in milliseconds, 0 if unknown.
+    uint32_t reserved;
+    uint64_t imageOffset;
+    // IMU measurements between this frame and the next one are [imuBegin, imuEnd) (only for frames < numIMUFrames).
+    uint64_t imuBegin, imuEnd;
+};
+
+struct BinaryIMUMeasurement
+{
+    double acc[3];
+    double gyr[3];
+    double integrationTime;
+};
+
+struct BinaryGTEntry
+{
+    int64_t id;
+    double translation[3];
+    double quaternion[4]; // x, y, z, w.
+    double velocity[3];
+    double biasRotation[3];
+    double biasTranslation[3];
+};
+
+class BinaryDataset
+{
+public:
+    static constexpr char Magic[9] = "DMVIOBIN";
+    static constexpr uint32_t Version = 1;
+    static constexpr uint64_t ImageAlignment = 64;
+    static constexpr uint32_t FlagHasTimestamps = 1;
+    static constexpr uint32_t FlagHasExposures = 2;
+
+    // Maps the given file. Check isValid afterwards.
+    explicit BinaryDataset(const std::string& filename);
+    ~BinaryDataset();
+    BinaryDataset(const BinaryDataset&) = delete;
+    BinaryDataset& operator=(const BinaryDataset&) = delete;
+
+    bool isValid() const;
+
+    int getWidth() const;
+    int getHeight() const;
+    int getBytesPerPixel() const;
+    int getNumFrames() const;
+    bool hasTimestamps() const;
+    bool hasExposures() const;
+
+    const BinaryFrameInfo& getFrameInfo(int id) const;
+    // Raw image data (width*height pixels of bytesPerPixel), valid as long as this object exists.
+    const void* getImageData(int id) const;
+
+    // IMU data between frame i and frame i+1, in the same format as ImageFolderReader::imuDataAllFrames.
+    int getNumIMUFrames() const;
+    IMUData getIMUData(int i) const;
+
+    std::map<long long, GTData> getGTData() const;
+
+private:
+    const BinaryDatasetHeader* header = nullptr;
+    const BinaryFrameInfo* frames = nullptr;
+    const BinaryIMUMeasurement* imu = nullptr;
+    const BinaryGTEntry* gt = nullptr;
+
+    const char* mappedData = nullptr;
+    size_t mappedSize = 0;
+    bool valid = false;
+};
+
+// Writes a BinaryDataset. Images are streamed to the file in addFrame, everything else is written in finish.
+class BinaryDatasetWriter
+{
+public:
+    BinaryDatasetWriter(const std::string& filename, int width, int height, int bytesPerPixel);
+
+    bool isValid() const;
+
+    // data has to contain width*height pixels.
+    void addFrame(long long id, double timestamp, float exposure, const void* data);
+
+    // imuDataAllFrames[i] contains the IMU data between frame i and frame i+1.
+    void setIMUData(const std::vector<IMUData>& imuDataAllFrames);
+    void setGTData(const std::map<long long, GTData>& gtData);
+
+    // Writes index, IMU and GT data, and the header. Returns false if writing failed.
+    bool finish(bool hasTimestamps, bool hasExposures);
+
+private:
+    void alignTo(uint64_t alignment);
+
+    std::ofstream file;
+    BinaryDatasetHeader header;
+    std::vector<BinaryFrameInfo> frames;
+    std::vector<BinaryIMUMeasurement> imu;
+    std::vector<uint64_t> imuFrameEnds;
+    std::vector<BinaryGTEntry> gt;
+    uint64_t position = 0;
+};
+
+}
+
+#endif //DMVIO_BINARYDATASET_H
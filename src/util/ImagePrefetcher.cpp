@@ -0,0 +1,137 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "ImagePrefetcher.h"
+#include "dso/util/NumType.h"
+#include "dso/util/ImageAndExposure.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+using namespace dmvio;
+
+dmvio::ImagePrefetcher::ImagePrefetcher(LoadFunction load, std::vector<int> ids, int numThreads, int maxFramesAhead,
+                                        size_t bytesPerImage, size_t maxBytes)
+        : load(std::move(load)), ids(std::move(ids))
+{
+    int ringSize = std::max(1, maxFramesAhead);
+    if(bytesPerImage > 0)
+    {
+        ringSize = std::max(1, std::min<int>(ringSize, maxBytes / bytesPerImage));
+    }
+    ring.resize(ringSize);
+
+    numThreads = std::max(1, std::min(numThreads, ringSize));
+    for(int i = 0; i < numThreads; ++i)
+    {
+        threads.emplace_back(&ImagePrefetcher::threadRun, this);
+    }
+    std::cout << "Prefetching up to " << ringSize << " images with " << numThreads << " threads." << std::endl;
+}
+
+dmvio::ImagePrefetcher::~ImagePrefetcher()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        running = false;
+    }
+    slotFreedCond.notify_all();
+    for(auto&& thread : threads)
+    {
+        thread.join();
+    }
+    for(auto&& slot : ring)
+    {
+        delete slot.image;
+    }
+}
+
+void dmvio::ImagePrefetcher::threadRun()
+{
+    while(true)
+    {
+        int index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while(true)
+            {
+                if(!running || nextToLoad >= (int) ids.size()) return;
+                // The slot of nextToLoad is free once the image ring.size() frames before it has been delivered.
+                if(nextToLoad - nextToDeliver < (int) ring.size()) break;
+                slotFreedCond.wait(lock);
+            }
+            index = nextToLoad++;
+        }
+
+        // An exception must not leave the thread (it would terminate the program), the consumer gets it instead.
+        dso::ImageAndExposure* img = nullptr;
+        std::exception_ptr error;
+        try
+        {
+            img = load(ids[index]);
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto& slot = ring[index % ring.size()];
+            assert(!slot.loaded);
+            slot.loaded = true;
+            slot.image = img;
+            slot.error = error;
+        }
+        imageLoadedCond.notify_all();
+    }
+}
+
+dso::ImageAndExposure* dmvio::ImagePrefetcher::getImage(int index)
+{
+    Slot slot;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        assert(index == nextToDeliver);
+        auto& ringSlot = ring[index % ring.size()];
+        while(!ringSlot.loaded)
+        {
+            imageLoadedCond.wait(lock);
+        }
+        slot = ringSlot;
+        ringSlot = Slot();
+        nextToDeliver++;
+    }
+    slotFreedCond.notify_all();
+    if(slot.error)
+    {
+        std::rethrow_exception(slot.error);
+    }
+    return slot.image;
+}
+
+int dmvio::ImagePrefetcher::getRingSize() const
+{
+    return ring.size();
+}
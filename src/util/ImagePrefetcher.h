@@ -0,0 +1,91 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef DMVIO_IMAGEPREFETCHER_H
+#define DMVIO_IMAGEPREFETCHER_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+namespace dso
+{
+class ImageAndExposure;
+}
+
+namespace dmvio
+{
+
+// Loads (decodes and undistorts) dataset images in background threads ahead of the consumer.
+// Images are delivered in order through a ring buffer, which bounds both the number of frames loaded ahead and the
+// memory used. This is an alternative to preloading the whole sequence for non-realtime runs.
+class ImagePrefetcher
+{
+public:
+    using LoadFunction = std::function<dso::ImageAndExposure*(int id)>;
+
+    // load has to be thread-safe. ids are the image ids in the order in which they will be requested.
+    // Exceptions thrown by load are passed on to the caller of getImage for the respective index.
+    // At most maxFramesAhead images (and at most maxBytes, given the size of one image) are kept in memory.
+    ImagePrefetcher(LoadFunction load, std::vector<int> ids, int numThreads, int maxFramesAhead,
+                    size_t bytesPerImage, size_t maxBytes);
+
+    // Stops the threads and deletes all images which have not been requested yet.
+    ~ImagePrefetcher();
+
+    // Returns the image for ids[index], blocking until it is loaded. Has to be called with increasing consecutive
+    // indices starting at 0. The caller takes ownership of the image. Rethrows the exception if loading it failed.
+    dso::ImageAndExposure* getImage(int index);
+
+    int getRingSize() const;
+
+private:
+    void threadRun();
+
+    LoadFunction load;
+    std::vector<int> ids;
+
+    // Protects all members below.
+    std::mutex mutex;
+    std::condition_variable slotFreedCond, imageLoadedCond;
+    struct Slot
+    {
+        bool loaded = false;
+        dso::ImageAndExposure* image = nullptr;
+        std::exception_ptr error; // set if load threw.
+    };
+    std::vector<Slot> ring; // image for index i is in ring[i % ring.size()].
+    int nextToLoad = 0;
+    int nextToDeliver = 0;
+    bool running = true;
+
+    std::vector<std::thread> threads;
+};
+
+}
+
+#endif //DMVIO_IMAGEPREFETCHER_H
@@ -188,18 +188,36 @@ void MainSettings::registerArgs(SettingsUtil& set)
     set.registerArg("imuCalib", imuCalibFile);
     set.registerArg("speed", playbackSpeed);
     set.registerArg("preload", preload);
+    set.registerArg("prefetch", prefetch);
+    set.registerArg("prefetchThreads", prefetchThreads);
+    set.registerArg("prefetchMaxMB", prefetchMaxMB);
+    set.registerArg("traceEvents", traceEvents);
+    set.registerArg("streamResults", streamResults);
 
     // We don't register preset and mode as they will be handled in parseArgument.
 
     // Register global settings.
     set.registerArg("setting_minOptIterations", setting_minOptIterations);
     set.registerArg("setting_maxOptIterations", setting_maxOptIterations);
+    set.registerArg("setting_optBudgetMs", setting_optBudgetMs);
+    set.registerArg("setting_optBudgetFrames", setting_optBudgetFrames);
+    set.registerArg("setting_optMinRelEnergyDecrease", setting_optMinRelEnergyDecrease);
     set.registerArg("setting_minIdepth", setting_minIdepth);
     set.registerArg("setting_solverMode", setting_solverMode);
     set.registerArg("setting_weightZeroPriorDSOInitY", setting_weightZeroPriorDSOInitY);
     set.registerArg("setting_weightZeroPriorDSOInitX", setting_weightZeroPriorDSOInitX);
     set.registerArg("setting_forceNoKFTranslationThresh", setting_forceNoKFTranslationThresh);
     set.registerArg("setting_minFramesBetweenKeyframes", setting_minFramesBetweenKeyframes);
+    set.registerArg("setting_numThreads", setting_numThreads);
+    set.registerArg("setting_simdLevel", setting_simdLevel);
+    set.registerArg("setting_coarseTrackingParallelTries", setting_coarseTrackingParallelTries);
+    set.registerArg("setting_mappingBackpressure", setting_mappingBackpressure);
+    set.registerArg("setting_backpressureFramesPerLevel", setting_backpressureFramesPerLevel);
+    set.registerArg("setting_backpressureMsPerLevel", setting_backpressureMsPerLevel);
+    set.registerArg("setting_backpressureOptItsFactor", setting_backpressureOptItsFactor);
+    set.registerArg("setting_backpressureDensityFactor", setting_backpressureDensityFactor);
+    set.registerArg("setting_incrementalTopHessian", setting_incrementalTopHessian);
+    set.registerArg("setting_incrementalTopHessianTH", setting_incrementalTopHessianTH);
 
 }
 
@@ -51,6 +51,19 @@ public:
     // only relevant for datasets.
     float playbackSpeed = 0;    // 0 for linearize (play as fast as possible, while sequentializing tracking & mapping). otherwise, factor on timestamps.
     bool preload = false;
+    // If > 0 and preload is off, images are loaded by prefetchThreads background threads up to this many frames ahead
+    // (but using at most prefetchMaxMB of memory).
+    int prefetch = 0;
+    int prefetchThreads = 2;
+    int prefetchMaxMB = 1024;
+
+    // If > 0, every TimeMeasurement is also recorded as a trace event (keeping at most this many per thread) and
+    // saved in the Chrome trace-event format to resultsPrefix + "trace.json".
+    int traceEvents = 0;
+
+    // If true, the poses are written to the result files as soon as they are final and the corresponding frames are
+    // released, which bounds the memory for long sequences. resultScaled.txt is not written in this mode.
+    bool streamResults = false;
 
     // 0 means photometric calibration (exposure times, vignette and response calibration) is available, 1 means no
     // photometric calibration there.
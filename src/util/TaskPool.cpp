@@ -0,0 +1,114 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "TaskPool.h"
+#include "TimeMeasurement.h"
+
+using namespace dmvio;
+
+dmvio::TaskPool::TaskPool(std::string threadName)
+        : threadName(std::move(threadName))
+{}
+
+dmvio::TaskPool::~TaskPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        running = false;
+    }
+    taskAddedCond.notify_all();
+    for(auto&& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+std::future<void> dmvio::TaskPool::addTask(std::function<void()> task)
+{
+    std::promise<void> promise;
+    std::future<void> future = promise.get_future();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        tasks.emplace_back(std::move(task), std::move(promise));
+        if((int) threads.size() - numBusyThreads < (int) tasks.size())
+        {
+            // All threads are busy (or will be with the tasks already queued), so add a new one.
+            threads.emplace_back(&TaskPool::threadRun, this, (int) threads.size());
+        }
+    }
+    taskAddedCond.notify_one();
+    return future;
+}
+
+int dmvio::TaskPool::getNumThreads()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return threads.size();
+}
+
+void dmvio::TaskPool::threadRun(int threadIndex)
+{
+    dmvio::TimeMeasurement::setThreadName(threadName + std::to_string(threadIndex));
+    while(true)
+    {
+        std::function<void()> task;
+        std::promise<void> promise;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // Remaining tasks are still executed after running has been set to false.
+            while(running && tasks.empty())
+            {
+                taskAddedCond.wait(lock);
+            }
+            if(tasks.empty()) return;
+            task = std::move(tasks.front().first);
+            promise = std::move(tasks.front().second);
+            tasks.pop_front();
+            numBusyThreads++;
+        }
+
+        std::exception_ptr exception;
+        try
+        {
+            task();
+        }catch(...)
+        {
+            exception = std::current_exception();
+        }
+
+        // The thread is marked as idle before the future becomes ready, so that a task added after waiting for
+        // the future can reuse it.
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            numBusyThreads--;
+        }
+        if(exception)
+        {
+            promise.set_exception(exception);
+        }else
+        {
+            promise.set_value();
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef DMVIO_TASKPOOL_H
+#define DMVIO_TASKPOOL_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+
+namespace dmvio
+{
+
+// Executes tasks in background threads and returns a future for each of them.
+// Threads are persistent and only created when a task is added while all existing threads are busy, so the pool grows
+// to the number of tasks which are actually executed concurrently. In contrast to std::async this avoids creating a
+// new thread (and new thread-local state, e.g. the trace buffer of TimeMeasurement) for each task.
+class TaskPool
+{
+public:
+    // threadName is passed to TimeMeasurement::setThreadName (with the thread index appended).
+    explicit TaskPool(std::string threadName);
+
+    // Finishes all tasks which have already been added, then stops the threads.
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    // Exceptions thrown by the task are rethrown by the get() method of the returned future.
+    std::future<void> addTask(std::function<void()> task);
+
+    int getNumThreads();
+
+private:
+    void threadRun(int threadIndex);
+
+    std::string threadName;
+
+    // Protects all members below.
+    std::mutex mutex;
+    std::condition_variable taskAddedCond;
+    std::deque<std::pair<std::function<void()>, std::promise<void>>> tasks;
+    int numBusyThreads = 0; // Number of threads currently executing a task.
+    bool running = true;
+
+    std::vector<std::thread> threads;
+};
+
+}
+
+#endif //DMVIO_TASKPOOL_H
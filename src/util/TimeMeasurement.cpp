@@ -22,6 +22,10 @@
 
 #include "TimeMeasurement.h"
 #include <iostream>
+#include <cstring>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
 
 using namespace dmvio;
 using namespace std::chrono;
@@ -29,6 +33,20 @@ using namespace std::chrono;
 
 std::map<std::string, dmvio::MeasurementLog> dmvio::TimeMeasurement::logs = std::map<std::string, MeasurementLog>();
 bool dmvio::TimeMeasurement::saveFileOpen = false;
+constexpr int dmvio::MeasurementLog::windowSize;
+std::mutex dmvio::TimeMeasurement::logsMutex;
+
+std::atomic<size_t> dmvio::TimeMeasurement::traceEventsPerThread{0};
+high_resolution_clock::time_point dmvio::TimeMeasurement::traceStart;
+std::mutex dmvio::TimeMeasurement::traceBuffersMutex;
+std::vector<std::shared_ptr<TraceBuffer>> dmvio::TimeMeasurement::traceBuffers;
+
+namespace
+{
+thread_local int currentFrameId = -1;
+// Kept alive by TimeMeasurement::traceBuffers after the thread has finished.
+thread_local std::shared_ptr<TraceBuffer> threadTraceBuffer;
+}
 
 dmvio::TimeMeasurement::TimeMeasurement(std::string name)
         : name(name)
@@ -51,7 +69,22 @@ double dmvio::TimeMeasurement::end()
     auto end = high_resolution_clock::now();
     double duration = duration_cast<std::chrono::duration<double>>(end - begin).count();
 
-    logs[name].addMeasurement(duration);
+    {
+        std::unique_lock<std::mutex> lock(logsMutex);
+        logs[name].addMeasurement(duration);
+    }
+
+    if(traceEventsPerThread.load(std::memory_order_relaxed) > 0)
+    {
+        TraceEvent event;
+        strncpy(event.name, name.c_str(), sizeof(event.name) - 1);
+        event.name[sizeof(event.name) - 1] = '\0';
+        event.beginNs = duration_cast<nanoseconds>(begin - traceStart).count();
+        event.durationNs = duration_cast<nanoseconds>(end - begin).count();
+        event.counterValue = 0;
+        event.frameId = currentFrameId;
+        getThreadTraceBuffer().add(event);
+    }
 
     ended = true;
 
@@ -63,6 +96,7 @@ void dmvio::TimeMeasurement::saveResults(std::string filename)
     std::ofstream saveFile;
     saveFile.open(filename);
 
+    std::unique_lock<std::mutex> lock(logsMutex);
     for(const auto& pair : logs)
     {
         saveFile << pair.first << ' ' << pair.second << '\n';
@@ -75,6 +109,194 @@ void dmvio::TimeMeasurement::cancel()
     ended = true;
 }
 
+std::map<std::string, LatencyStats> dmvio::TimeMeasurement::getWindowSnapshot()
+{
+    std::map<std::string, LatencyStats> snapshot;
+    std::unique_lock<std::mutex> lock(logsMutex);
+    for(const auto& pair : logs)
+    {
+        snapshot[pair.first] = pair.second.getWindowStats();
+    }
+    return snapshot;
+}
+
+LatencyStats dmvio::TimeMeasurement::getWindowStats(const std::string& name)
+{
+    std::unique_lock<std::mutex> lock(logsMutex);
+    auto it = logs.find(name);
+    if(it == logs.end())
+    {
+        return LatencyStats{};
+    }
+    return it->second.getWindowStats();
+}
+
+void dmvio::TimeMeasurement::printWindowSnapshot(std::ostream& stream, const std::vector<std::string>& names)
+{
+    auto snapshot = getWindowSnapshot();
+    stream << "Timings over the last " << MeasurementLog::windowSize
+           << " measurements (num mean max p50 p95 p99 p99.9):\n";
+    for(const auto& pair : snapshot)
+    {
+        if(names.empty() || std::find(names.begin(), names.end(), pair.first) != names.end())
+        {
+            stream << pair.first << ' ' << pair.second << '\n';
+        }
+    }
+}
+
+void dmvio::TimeMeasurement::enableTracing(size_t eventsPerThread)
+{
+    if(eventsPerThread > 0 && traceEventsPerThread.load() == 0)
+    {
+        traceStart = high_resolution_clock::now();
+    }
+    traceEventsPerThread = eventsPerThread;
+}
+
+bool dmvio::TimeMeasurement::isTracing()
+{
+    return traceEventsPerThread.load(std::memory_order_relaxed) > 0;
+}
+
+void dmvio::TimeMeasurement::setFrameId(int frameId)
+{
+    currentFrameId = frameId;
+}
+
+void dmvio::TimeMeasurement::setThreadName(std::string threadName)
+{
+    if(!isTracing()) return;
+    TraceBuffer& buffer = getThreadTraceBuffer();
+    std::unique_lock<std::mutex> lock(traceBuffersMutex);
+    buffer.threadName = threadName;
+}
+
+void dmvio::TimeMeasurement::recordCounter(const char* counterName, double value)
+{
+    if(!isTracing()) return;
+    TraceEvent event;
+    strncpy(event.name, counterName, sizeof(event.name) - 1);
+    event.name[sizeof(event.name) - 1] = '\0';
+    event.beginNs = duration_cast<nanoseconds>(high_resolution_clock::now() - traceStart).count();
+    event.durationNs = -1;
+    event.counterValue = value;
+    event.frameId = currentFrameId;
+    getThreadTraceBuffer().add(event);
+}
+
+TraceBuffer& dmvio::TimeMeasurement::getThreadTraceBuffer()
+{
+    if(!threadTraceBuffer)
+    {
+        // Only happens once per thread, so the lock is not on the hot path.
+        std::unique_lock<std::mutex> lock(traceBuffersMutex);
+        threadTraceBuffer = std::make_shared<TraceBuffer>(traceBuffers.size(), traceEventsPerThread.load());
+        traceBuffers.push_back(threadTraceBuffer);
+    }
+    return *threadTraceBuffer;
+}
+
+namespace
+{
+void writeJsonString(std::ostream& stream, const std::string& str)
+{
+    stream << '"';
+    for(char c : str)
+    {
+        if(c == '"' || c == '\\') stream << '\\';
+        if(static_cast<unsigned char>(c) >= 0x20) stream << c;
+    }
+    stream << '"';
+}
+}
+
+void dmvio::TimeMeasurement::saveTrace(std::string filename)
+{
+    std::ofstream traceFile;
+    traceFile.open(filename);
+    traceFile << std::fixed << std::setprecision(3);
+    traceFile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    std::unique_lock<std::mutex> lock(traceBuffersMutex);
+    bool first = true;
+    for(const auto& buffer : traceBuffers)
+    {
+        if(!buffer->threadName.empty())
+        {
+            traceFile << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":"
+                      << buffer->threadId << ",\"args\":{\"name\":";
+            writeJsonString(traceFile, buffer->threadName);
+            traceFile << "}}";
+            first = false;
+        }
+
+        // Complete events ("X") contain begin and duration, timestamps are in microseconds.
+        for(const auto& event : buffer->getEvents())
+        {
+            if(event.durationNs < 0)
+            {
+                // Counter events ("C") are shown as a graph over time (all args are plotted, so no frame id).
+                traceFile << (first ? "" : ",\n") << "{\"name\":";
+                writeJsonString(traceFile, event.name);
+                traceFile << ",\"ph\":\"C\",\"pid\":0,\"tid\":" << buffer->threadId
+                          << ",\"ts\":" << event.beginNs * 1e-3 << ",\"args\":{\"value\":" << event.counterValue << "}}";
+                first = false;
+                continue;
+            }
+            traceFile << (first ? "" : ",\n") << "{\"name\":";
+            writeJsonString(traceFile, event.name);
+            traceFile << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->threadId
+                      << ",\"ts\":" << event.beginNs * 1e-3 << ",\"dur\":" << event.durationNs * 1e-3;
+            if(event.frameId >= 0)
+            {
+                traceFile << ",\"args\":{\"frame\":" << event.frameId << '}';
+            }
+            traceFile << '}';
+            first = false;
+        }
+    }
+    traceFile << "\n]}\n";
+    traceFile.close();
+}
+
+dmvio::TraceBuffer::TraceBuffer(int threadId, size_t capacity)
+        : threadId(threadId), capacity(capacity)
+{
+    // Grown on demand, as most threads only record few events.
+    events.reserve(std::min(capacity, (size_t) 1024));
+}
+
+void dmvio::TraceBuffer::add(const TraceEvent& event)
+{
+    size_t written = numWritten.load(std::memory_order_relaxed);
+    if(events.size() < capacity)
+    {
+        events.push_back(event);
+    }else
+    {
+        events[written % capacity] = event;
+    }
+    numWritten.store(written + 1, std::memory_order_release);
+}
+
+std::vector<TraceEvent> dmvio::TraceBuffer::getEvents() const
+{
+    size_t written = numWritten.load(std::memory_order_acquire);
+    std::vector<TraceEvent> ret;
+    if(written <= capacity)
+    {
+        ret.assign(events.begin(), events.begin() + written);
+    }else
+    {
+        // Oldest event is the one which will be overwritten next.
+        size_t oldest = written % capacity;
+        ret.assign(events.begin() + oldest, events.end());
+        ret.insert(ret.end(), events.begin(), events.begin() + oldest);
+    }
+    return ret;
+}
+
 void dmvio::MeasurementLog::addMeasurement(double time)
 {
     if(num == 0)
@@ -92,6 +314,22 @@ void dmvio::MeasurementLog::addMeasurement(double time)
     {
         max = time;
     }
+
+    if(histogram.empty())
+    {
+        histogram.resize((HistogramMaxExponent - HistogramSubBucketBits + 2) << HistogramSubBucketBits, 0);
+        window.reserve(windowSize);
+    }
+    histogram[histogramIndex(time)]++;
+
+    if((int) window.size() < windowSize)
+    {
+        window.push_back(time);
+    }else
+    {
+        window[windowPos] = time;
+        windowPos = (windowPos + 1) % windowSize;
+    }
 }
 
 void dmvio::MeasurementLog::writeLogLine(std::ostream& stream) const
@@ -100,9 +338,98 @@ void dmvio::MeasurementLog::writeLogLine(std::ostream& stream) const
     double variance = getVariance();
 
     stream << mean << ' ' << variance << ' ' << max << ' ' << num;
+    stream << ' ' << getPercentile(50) << ' ' << getPercentile(95) << ' ' << getPercentile(99) << ' '
+           << getPercentile(99.9);
 
 }
 
+int dmvio::MeasurementLog::histogramIndex(double time)
+{
+    // Values below 2^HistogramSubBucketBits ns get one bucket each, above that each power of two is split into
+    // 2^HistogramSubBucketBits buckets.
+    uint64_t ns = time > 0 ? (uint64_t) std::llround(time * 1e9) : 0;
+    ns = std::min(ns, ((uint64_t) 1 << (HistogramMaxExponent + 1)) - 1);
+    if(ns < ((uint64_t) 1 << HistogramSubBucketBits))
+    {
+        return (int) ns;
+    }
+    int exponent = 63 - __builtin_clzll(ns);
+    int shift = exponent - HistogramSubBucketBits;
+    int subBucket = (int) (ns >> shift) - (1 << HistogramSubBucketBits);
+    return ((shift + 1) << HistogramSubBucketBits) + subBucket;
+}
+
+double dmvio::MeasurementLog::histogramValue(int index)
+{
+    int shift = (index >> HistogramSubBucketBits) - 1;
+    if(shift < 0)
+    {
+        return index * 1e-9;
+    }
+    int subBucket = index & ((1 << HistogramSubBucketBits) - 1);
+    uint64_t lower = ((uint64_t) ((1 << HistogramSubBucketBits) + subBucket)) << shift;
+    // Middle of the bucket.
+    return (lower + (((uint64_t) 1 << shift) - 1) / 2.0) * 1e-9;
+}
+
+double dmvio::MeasurementLog::getPercentile(double percentile) const
+{
+    if(num == 0) return 0;
+    // Nearest-rank percentile.
+    uint64_t rank = std::max((uint64_t) 1, (uint64_t) std::ceil(percentile / 100.0 * num));
+    uint64_t count = 0;
+    for(size_t i = 0; i < histogram.size(); ++i)
+    {
+        count += histogram[i];
+        if(count >= rank)
+        {
+            return std::min(histogramValue(i), max);
+        }
+    }
+    return max;
+}
+
+LatencyStats dmvio::MeasurementLog::getStats() const
+{
+    LatencyStats stats;
+    stats.num = num;
+    stats.mean = num > 0 ? getMean() : 0;
+    stats.max = max;
+    stats.p50 = getPercentile(50);
+    stats.p95 = getPercentile(95);
+    stats.p99 = getPercentile(99);
+    stats.p999 = getPercentile(99.9);
+    return stats;
+}
+
+LatencyStats dmvio::MeasurementLog::getWindowStats() const
+{
+    LatencyStats stats;
+    if(window.empty()) return stats;
+
+    std::vector<double> sorted = window;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p)
+    {
+        size_t rank = std::max((size_t) 1, (size_t) std::ceil(p / 100.0 * sorted.size()));
+        return sorted[rank - 1];
+    };
+
+    stats.num = sorted.size();
+    double windowSum = 0;
+    for(double time : sorted)
+    {
+        windowSum += time;
+    }
+    stats.mean = windowSum / sorted.size();
+    stats.max = sorted.back();
+    stats.p50 = percentile(50);
+    stats.p95 = percentile(95);
+    stats.p99 = percentile(99);
+    stats.p999 = percentile(99.9);
+    return stats;
+}
+
 double dmvio::MeasurementLog::getVariance() const
 {
     double variance = (sumSquared - (sumShifted * sumShifted) / num) / (num - 1);
@@ -130,3 +457,10 @@ std::ostream& operator<<(std::ostream& os, const dmvio::MeasurementLog& obj)
     obj.writeLogLine(os);
     return os;
 }
+
+std::ostream& operator<<(std::ostream& os, const dmvio::LatencyStats& obj)
+{
+    os << obj.num << ' ' << obj.mean << ' ' << obj.max << ' ' << obj.p50 << ' ' << obj.p95 << ' ' << obj.p99 << ' '
+       << obj.p999;
+    return os;
+}
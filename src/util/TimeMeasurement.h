@@ -28,11 +28,29 @@
 #include <chrono>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstdint>
 
 
 namespace dmvio
 {
+// Summary of a latency distribution (all times in seconds).
+struct LatencyStats
+{
+    int num{0};
+    double mean{0};
+    double max{0};
+    double p50{0};
+    double p95{0};
+    double p99{0};
+    double p999{0};
+};
+
 // Saves mean, maximum, and variance.
+// Additionally, all measurements are counted in a log-bucketed (HDR-style) histogram for percentile queries,
+// and the last windowSize measurements are kept for rolling statistics.
 class MeasurementLog
 {
 public:
@@ -46,7 +64,22 @@ public:
     double getMax() const;
     double getMean() const;
     double getVariance() const;
+
+    // Percentile in (0, 100] over all measurements. Relative error is below 2^-HistogramSubBucketBits.
+    double getPercentile(double percentile) const;
+    LatencyStats getStats() const;
+    // Statistics over the last windowSize measurements (exact percentiles).
+    LatencyStats getWindowStats() const;
+
+    static constexpr int windowSize = 1000;
+    // Every power of two is split into 2^HistogramSubBucketBits buckets.
+    static constexpr int HistogramSubBucketBits = 7;
+    // Measurements are binned in nanoseconds, longer ones than 2^HistogramMaxExponent ns (~18 min) are clamped.
+    static constexpr int HistogramMaxExponent = 40;
 private:
+    static int histogramIndex(double time);
+    static double histogramValue(int index);
+
     double sum{0};
     double max{0};
     int num{0};
@@ -56,11 +89,46 @@ private:
     double sumShifted{0};
     double sumSquared{0};
 
+    std::vector<uint32_t> histogram; // allocated with the first measurement.
+    std::vector<double> window; // ring buffer of the last windowSize measurements.
+    int windowPos{0};
+};
+
+// One finished measurement (or counter value) recorded in trace mode.
+struct TraceEvent
+{
+    char name[48];
+    int64_t beginNs; // relative to the start of tracing.
+    int64_t durationNs; // -1 for counter events.
+    double counterValue;
+    int frameId;
+};
+
+// Ring buffer of trace events written by a single thread. Once it is full the oldest events are overwritten.
+class TraceBuffer
+{
+public:
+    TraceBuffer(int threadId, size_t capacity);
+
+    // Only called by the owning thread, so no locking is needed.
+    void add(const TraceEvent& event);
+
+    // Copies the events in the order they were recorded.
+    // Should only be called when the owning thread is not recording at the same time (e.g. at the end of the run).
+    std::vector<TraceEvent> getEvents() const;
+
+    const int threadId;
+    std::string threadName;
+private:
+    size_t capacity;
+    std::vector<TraceEvent> events;
+    std::atomic<size_t> numWritten{0};
 };
 
 // Used to measure and log wall time for different code parts.
-// Note that this class is only partially thread-safe, meaning there should not be measurements with the same name
-// in different threads, otherwise there can be an endless loop / segfault in the first call!
+// Aggregated statistics are saved with saveResults. If tracing is enabled, every single measurement is additionally
+// recorded with thread and frame id, and can be saved with saveTrace as a Chrome trace-event JSON file
+// (which can be opened with chrome://tracing or https://ui.perfetto.dev).
 class TimeMeasurement final
 {
 public:
@@ -76,10 +144,36 @@ public:
 
     static void saveResults(std::string filename);
 
+    // Rolling statistics of all measurement names, can be called while the system is running.
+    static std::map<std::string, LatencyStats> getWindowSnapshot();
+    // Rolling statistics of a single measurement name (num is 0 if there was no measurement yet).
+    static LatencyStats getWindowStats(const std::string& name);
+    // Prints the rolling statistics of the given measurement names (or all if empty).
+    static void printWindowSnapshot(std::ostream& stream, const std::vector<std::string>& names = {});
+
+    // Enable tracing, keeping at most eventsPerThread events for each thread (0 disables it).
+    static void enableTracing(size_t eventsPerThread);
+    static bool isTracing();
+    // Frame id attached to the trace events of the calling thread from now on (-1 for none).
+    static void setFrameId(int frameId);
+    // Name shown for the calling thread in the trace.
+    static void setThreadName(std::string threadName);
+    // Record the current value of a counter (e.g. a queue depth), only saved in the trace.
+    static void recordCounter(const char* counterName, double value);
+    // Save all recorded events in the Chrome trace-event format. Should be called after processing has finished.
+    static void saveTrace(std::string filename);
+
 private:
     static bool saveFileOpen;
     static std::ofstream saveFile;
     static std::map<std::string, MeasurementLog> logs;
+    static std::mutex logsMutex;
+
+    static TraceBuffer& getThreadTraceBuffer();
+    static std::atomic<size_t> traceEventsPerThread;
+    static std::chrono::high_resolution_clock::time_point traceStart;
+    static std::mutex traceBuffersMutex;
+    static std::vector<std::shared_ptr<TraceBuffer>> traceBuffers;
 
     std::string name;
     std::chrono::high_resolution_clock::time_point begin;
@@ -88,6 +182,7 @@ private:
 }
 
 std::ostream& operator<<(std::ostream& os, const dmvio::MeasurementLog& obj);
+std::ostream& operator<<(std::ostream& os, const dmvio::LatencyStats& obj);
 
 
 #endif //DMVIO_TIMEMEASUREMENT_H
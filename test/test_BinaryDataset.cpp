@@ -0,0 +1,93 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include "util/BinaryDataset.h"
+
+using namespace dmvio;
+
+TEST(TestBinaryDataset, RoundTrip)
+{
+    std::string filename = "test_roundtrip.dmvbin";
+    int w = 7, h = 5; // odd size to check image alignment.
+    std::vector<std::vector<unsigned short>> images(3, std::vector<unsigned short>(w * h));
+    for(int i = 0; i < 3; ++i)
+        for(int j = 0; j < w * h; ++j)
+            images[i][j] = i * 1000 + j;
+
+    std::vector<IMUData> imuData(2);
+    imuData[0].push_back(IMUMeasurement({1, 2, 3}, {4, 5, 6}, 0.005));
+    imuData[1].push_back(IMUMeasurement({7, 8, 9}, {10, 11, 12}, 0.005));
+    imuData[1].push_back(IMUMeasurement({13, 14, 15}, {16, 17, 18}, 0.004));
+
+    std::map<long long, GTData> gtData;
+    Sophus::SE3d pose(Eigen::Quaterniond(0.5, 0.5, -0.5, 0.5), Eigen::Vector3d(1, 2, 3));
+    gtData[100] = GTData(pose, Eigen::Vector3d(0.1, 0.2, 0.3), Eigen::Vector3d::Zero(), Eigen::Vector3d::Ones());
+
+    {
+        BinaryDatasetWriter writer(filename, w, h, 2);
+        ASSERT_TRUE(writer.isValid());
+        for(int i = 0; i < 3; ++i)
+        {
+            writer.addFrame(100 + i, 0.1 * i, 10.0f + i, images[i].data());
+        }
+        writer.setIMUData(imuData);
+        writer.setGTData(gtData);
+        ASSERT_TRUE(writer.finish(true, true));
+    }
+
+    {
+        BinaryDataset dataset(filename);
+        ASSERT_TRUE(dataset.isValid());
+        EXPECT_EQ(dataset.getWidth(), w);
+        EXPECT_EQ(dataset.getHeight(), h);
+        EXPECT_EQ(dataset.getBytesPerPixel(), 2);
+        ASSERT_EQ(dataset.getNumFrames(), 3);
+        EXPECT_TRUE(dataset.hasTimestamps());
+        EXPECT_TRUE(dataset.hasExposures());
+        for(int i = 0; i < 3; ++i)
+        {
+            EXPECT_EQ(dataset.getFrameInfo(i).id, 100 + i);
+            EXPECT_DOUBLE_EQ(dataset.getFrameInfo(i).timestamp, 0.1 * i);
+            EXPECT_FLOAT_EQ(dataset.getFrameInfo(i).exposure, 10.0f + i);
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(dataset.getImageData(i)) % BinaryDataset::ImageAlignment, 0);
+            const unsigned short* data = static_cast<const unsigned short*>(dataset.getImageData(i));
+            EXPECT_TRUE(std::equal(images[i].begin(), images[i].end(), data));
+        }
+
+        ASSERT_EQ(dataset.getNumIMUFrames(), 2);
+        IMUData second = dataset.getIMUData(1);
+        ASSERT_EQ(second.size(), 2);
+        EXPECT_EQ(second[1].getAccData(), Eigen::Vector3d(13, 14, 15));
+        EXPECT_EQ(second[1].getGyrData(), Eigen::Vector3d(16, 17, 18));
+        EXPECT_DOUBLE_EQ(second[1].getIntegrationTime(), 0.004);
+
+        auto readGT = dataset.getGTData();
+        ASSERT_EQ(readGT.size(), 1);
+        EXPECT_TRUE(readGT[100].pose.matrix().isApprox(pose.matrix()));
+        EXPECT_EQ(readGT[100].biasTranslation, Eigen::Vector3d::Ones());
+    }
+    std::remove(filename.c_str());
+}
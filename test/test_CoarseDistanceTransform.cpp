@@ -0,0 +1,94 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "FullSystem/CoarseDistanceTransform.h"
+
+using namespace dso;
+
+namespace
+{
+// Reference: the BFS of CoarseDistanceMap::growDistBFS.
+std::vector<float> distanceBFS(int w, int h, const std::vector<std::pair<int, int>>& seeds)
+{
+    std::vector<float> dist(w * h, 1000);
+    std::vector<std::pair<int, int>> list, next;
+    for(auto&& seed : seeds)
+    {
+        dist[seed.first + seed.second * w] = 0;
+        list.push_back(seed);
+    }
+    for(int k = 1; k < 40; k++)
+    {
+        next.clear();
+        for(auto&& p : list)
+        {
+            int x = p.first, y = p.second;
+            if(x == 0 || y == 0 || x == w - 1 || y == h - 1) continue;
+            for(int dy = -1; dy <= 1; dy++)
+                for(int dx = -1; dx <= 1; dx++)
+                {
+                    if((dx == 0 && dy == 0) || (k % 2 == 0 && dx != 0 && dy != 0)) continue;
+                    int idx = x + dx + (y + dy) * w;
+                    if(dist[idx] > k)
+                    {
+                        dist[idx] = k;
+                        next.emplace_back(x + dx, y + dy);
+                    }
+                }
+        }
+        std::swap(list, next);
+    }
+    return dist;
+}
+}
+
+TEST(CoarseDistanceTransformTest, SameAsBFS)
+{
+    std::mt19937 rng(3);
+    const int w = 97, h = 61;
+    CoarseDistanceTransform transform(w, h);
+    std::vector<float> out(w * h);
+
+    for(int numSeeds : {0, 1, 3, 20, 200, 2000})
+    {
+        std::uniform_int_distribution<int> uDist(1, w - 1), vDist(1, h - 1);
+        std::vector<std::pair<int, int>> seeds;
+        transform.clearSeeds();
+        for(int i = 0; i < numSeeds; i++)
+        {
+            seeds.emplace_back(uDist(rng), vDist(rng));
+            transform.addSeed(seeds.back().first, seeds.back().second);
+        }
+
+        std::vector<float> expected = distanceBFS(w, h, seeds);
+        transform.compute(out.data());
+        for(int i = 0; i < w * h; i++)
+        {
+            ASSERT_EQ(out[i], expected[i]) << "numSeeds " << numSeeds << " pixel " << i % w << ", " << i / w;
+        }
+    }
+}
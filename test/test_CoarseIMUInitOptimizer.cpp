@@ -0,0 +1,155 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <deque>
+#include <memory>
+#include <gtsam/navigation/ImuFactor.h>
+#include "IMUInitialization/CoarseIMUInitOptimizer.h"
+#include "GTSAMIntegration/PoseTransformationIMU.h"
+#include "dso/util/FrameShell.h"
+
+using namespace dmvio;
+
+// Adds shells to the CoarseIMUInitOptimizer and releases the front of the frame history like
+// FullSystem::spillFinalFrameShells does (all shells are final here).
+class CoarseIMUInitShellsTest : public ::testing::Test
+{
+protected:
+    IMUCalibration imuCalibration;
+    CoarseIMUInitOptimizerSettings settings;
+    std::shared_ptr<TransformDSOToIMU> transform;
+    std::unique_ptr<gtsam::PreintegratedImuMeasurements> imuMeasurements;
+
+    std::deque<dso::FrameShell*> history;
+    int nextId = 1;
+
+    void SetUp() override
+    {
+        settings.maxNumPoses = 10;
+        transform = std::make_shared<TransformDSOToIMU>(gtsam::Pose3(imuCalibration.T_cam_imu.matrix()),
+                                                        std::make_shared<bool>(true), std::make_shared<bool>(true),
+                                                        std::make_shared<bool>(false), true, 0);
+        imuMeasurements = std::make_unique<gtsam::PreintegratedImuMeasurements>(
+                gtsam::PreintegrationParams::MakeSharedU(9.81));
+        imuMeasurements->integrateMeasurement(gtsam::Vector3(0, 0, 9.81), gtsam::Vector3::Zero(), 0.05);
+    }
+
+    void TearDown() override
+    {
+        for(dso::FrameShell* shell : history)
+        {
+            delete shell;
+        }
+    }
+
+    void addFrame(CoarseIMUInitOptimizer& optimizer)
+    {
+        auto* shell = new dso::FrameShell();
+        shell->id = nextId;
+        shell->camToWorld = Sophus::SE3d(Sophus::SO3d(), Eigen::Vector3d(0.1 * nextId, 0, 0));
+        history.push_back(shell);
+        optimizer.addPose(*shell, nextId == 1 ? nullptr : imuMeasurements.get());
+        nextId++;
+        spill();
+    }
+
+    void spill()
+    {
+        boost::unique_lock<boost::mutex> lock(dso::FrameShell::shellPoseMutex);
+        while(history.size() > 3 && history.front()->numExternalRefs == 0)
+        {
+            delete history.front();
+            history.pop_front();
+        }
+    }
+};
+
+TEST_F(CoarseIMUInitShellsTest, ShellsRemovedFromGraphAreReleased)
+{
+    CoarseIMUInitOptimizer optimizer(transform, imuCalibration, settings);
+    for(int i = 0; i < 100; i++)
+    {
+        addFrame(optimizer);
+        EXPECT_LE(history.size(), (size_t) settings.maxNumPoses);
+    }
+    EXPECT_EQ(history.size(), (size_t) settings.maxNumPoses);
+    for(dso::FrameShell* shell : history)
+    {
+        EXPECT_EQ(shell->numExternalRefs, 1);
+    }
+}
+
+TEST_F(CoarseIMUInitShellsTest, HistoryIsBoundedAfterRelease)
+{
+    CoarseIMUInitOptimizer optimizer(transform, imuCalibration, settings);
+    for(int i = 0; i < 20; i++)
+    {
+        addFrame(optimizer);
+    }
+
+    // Once the initializer goes inactive the optimizer does not get any new poses, so it has to release all shells.
+    optimizer.releaseShells();
+    spill();
+    EXPECT_EQ(history.size(), 3);
+
+    // DSO keeps tracking, the history must not grow.
+    for(int i = 0; i < 100; i++)
+    {
+        auto* shell = new dso::FrameShell();
+        shell->id = nextId++;
+        history.push_back(shell);
+        spill();
+        EXPECT_EQ(history.size(), 3);
+    }
+}
+
+TEST_F(CoarseIMUInitShellsTest, DestructorReleasesShells)
+{
+    {
+        CoarseIMUInitOptimizer optimizer(transform, imuCalibration, settings);
+        for(int i = 0; i < 5; i++)
+        {
+            addFrame(optimizer);
+        }
+        EXPECT_EQ(history.size(), 5);
+    }
+    for(dso::FrameShell* shell : history)
+    {
+        EXPECT_EQ(shell->numExternalRefs, 0);
+    }
+    spill();
+    EXPECT_EQ(history.size(), 3);
+}
+
+TEST_F(CoarseIMUInitShellsTest, NoReferencesWithoutUpdatePoses)
+{
+    settings.updatePoses = false;
+    CoarseIMUInitOptimizer optimizer(transform, imuCalibration, settings);
+    for(int i = 0; i < 20; i++)
+    {
+        addFrame(optimizer);
+        EXPECT_LE(history.size(), 3);
+    }
+}
@@ -0,0 +1,158 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "FullSystem/CoarseTrackerKernels.h"
+
+using namespace dso;
+
+namespace
+{
+
+// Synthetic data for the coarse tracker kernels: a smooth image with gradients and a set of reference points.
+struct KernelTestData
+{
+    KernelTestData(int numPoints, int w, int h) : w(w), h(h)
+    {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> uDist(-10, w + 10), vDist(-10, h + 10), idDist(0.05, 2);
+        std::uniform_real_distribution<float> colorDist(0, 255);
+
+        image.resize(w * h);
+        for(int y = 0; y < h; y++)
+            for(int x = 0; x < w; x++)
+            {
+                float c = 128 + 60 * std::sin(0.05f * x) * std::cos(0.07f * y) + 0.2f * x;
+                image[x + y * w] = Eigen::Vector3f(c, 60 * 0.05f * std::cos(0.05f * x) * std::cos(0.07f * y) + 0.2f,
+                                                   -60 * 0.07f * std::sin(0.05f * x) * std::sin(0.07f * y));
+            }
+
+        for(int i = 0; i < numPoints; i++)
+        {
+            pcU.push_back(uDist(rng));
+            pcV.push_back(vDist(rng));
+            pcIdepth.push_back(idDist(rng));
+            pcColor.push_back(colorDist(rng));
+        }
+    }
+
+    CoarseResInput makeInput()
+    {
+        Mat33f K;
+        K << 300, 0, w / 2.0f, 0, 300, h / 2.0f, 0, 0, 1;
+        Mat33f R = Eigen::AngleAxisf(0.02f, Vec3f(0.3f, 1.0f, 0.2f).normalized()).toRotationMatrix();
+
+        CoarseResInput in;
+        in.pcU = pcU.data();
+        in.pcV = pcV.data();
+        in.pcIdepth = pcIdepth.data();
+        in.pcColor = pcColor.data();
+        in.numPoints = pcU.size();
+        in.dINew = image.data();
+        in.w = w;
+        in.h = h;
+        in.RKi = R * K.inverse();
+        in.t = Vec3f(0.05f, -0.02f, 0.03f);
+        in.fx = K(0, 0);
+        in.fy = K(1, 1);
+        in.cx = K(0, 2);
+        in.cy = K(1, 2);
+        in.affLL = Vec2f(1.1f, -5.0f);
+        in.huberTH = 9;
+        in.cutoffTH = 40;
+        in.maxEnergy = 2 * in.huberTH * in.cutoffTH - in.huberTH * in.huberTH;
+        return in;
+    }
+
+    int w, h;
+    std::vector<Eigen::Vector3f> image;
+    std::vector<float> pcU, pcV, pcIdepth, pcColor;
+};
+
+struct WarpedBuffers
+{
+    explicit WarpedBuffers(int n) : data(8, std::vector<float>(n + 16))
+    {
+        buf = {data[0].data(), data[1].data(), data[2].data(), data[3].data(),
+               data[4].data(), data[5].data(), data[6].data(), data[7].data(), 0};
+    }
+
+    std::vector<std::vector<float>> data;
+    CoarseWarpedBuffers buf;
+};
+
+void compareWithSSE(SimdLevel level)
+{
+    if(detectSimdLevel() < level)
+    {
+        GTEST_SKIP() << simdLevelName(level) << " is not supported on this CPU.";
+    }
+
+    // Not a multiple of 16 to test the remainder handling.
+    KernelTestData data(10003, 320, 240);
+    CoarseResInput in = data.makeInput();
+
+    WarpedBuffers sse(in.numPoints), wide(in.numPoints);
+    CoarseResOutput resSSE = calcResKernel(SimdLevel::SSE, in, sse.buf);
+    CoarseResOutput resWide = calcResKernel(level, in, wide.buf);
+
+    ASSERT_GT(sse.buf.n, 1000);
+    EXPECT_GT(resSSE.numSaturated, 0);
+    EXPECT_EQ(resSSE.numTermsInE, resWide.numTermsInE);
+    EXPECT_EQ(resSSE.numSaturated, resWide.numSaturated);
+    EXPECT_NEAR(resSSE.E, resWide.E, 1e-4 * std::abs(resSSE.E));
+    ASSERT_EQ(sse.buf.n, wide.buf.n);
+    for(int b = 0; b < 8; b++)
+    {
+        for(int i = 0; i < sse.buf.n; i++)
+        {
+            ASSERT_NEAR(sse.data[b][i], wide.data[b][i], 1e-4 * (1 + std::abs(sse.data[b][i])));
+        }
+    }
+
+    Accumulator9 accSSE, accWide;
+    calcGSKernel(SimdLevel::SSE, sse.buf, in.fx, in.fy, 1.1f, 3.0f, accSSE);
+    calcGSKernel(level, sse.buf, in.fx, in.fy, 1.1f, 3.0f, accWide);
+    for(int r = 0; r < 9; r++)
+    {
+        for(int c = 0; c < 9; c++)
+        {
+            EXPECT_NEAR(accSSE.H(r, c), accWide.H(r, c), 1e-4 * (1 + std::abs(accSSE.H(r, c))));
+        }
+    }
+}
+
+}
+
+TEST(TestCoarseTrackerKernels, AVX2MatchesSSE)
+{
+    compareWithSSE(SimdLevel::AVX2);
+}
+
+TEST(TestCoarseTrackerKernels, AVX512MatchesSSE)
+{
+    compareWithSSE(SimdLevel::AVX512);
+}
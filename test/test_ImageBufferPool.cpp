@@ -0,0 +1,153 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "util/ImageBufferPool.h"
+#include "util/globalCalib.h"
+#include "FullSystem/HessianBlocks.h"
+
+using namespace dso;
+
+TEST(ImageBufferPoolTest, RoundTripAndReuse)
+{
+    ImageBufferPool pool;
+    const int num = 640 * 480;
+
+    Eigen::Vector3f* a = pool.get<Eigen::Vector3f>(num);
+    float* b = pool.get<float>(num);
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % EIGEN_MAX_ALIGN_BYTES, 0);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % EIGEN_MAX_ALIGN_BYTES, 0);
+
+    // the buffers are usable in their full size.
+    for(int i = 0; i < num; i++)
+    {
+        a[i] = Eigen::Vector3f(i, 2 * i, 3 * i);
+        b[i] = i;
+    }
+    EXPECT_EQ(a[num - 1], Eigen::Vector3f(num - 1, 2 * (num - 1), 3 * (num - 1)));
+    EXPECT_EQ(b[num - 1], num - 1);
+
+    ImageBufferPool::Stats stats = pool.getStats();
+    EXPECT_EQ(stats.numAllocated, 2);
+    EXPECT_EQ(stats.numReused, 0);
+    EXPECT_EQ(stats.bytesAllocated, num * (sizeof(Eigen::Vector3f) + sizeof(float)));
+
+    pool.release(a, num);
+    pool.release(b, num);
+    EXPECT_EQ(pool.getStats().numReleased, 2);
+
+    // the same sizes are served from the pool.
+    EXPECT_EQ(pool.get<float>(num), b);
+    EXPECT_EQ(pool.get<Eigen::Vector3f>(num), a);
+    stats = pool.getStats();
+    EXPECT_EQ(stats.numAllocated, 2);
+    EXPECT_EQ(stats.numReused, 2);
+
+    pool.release(a, num);
+    pool.release(b, num);
+}
+
+TEST(ImageBufferPoolTest, DoesNotShrink)
+{
+    ImageBufferPool pool;
+    std::vector<float*> buffers;
+    for(int i = 0; i < 5; i++)
+    {
+        buffers.push_back(pool.get<float>(1000));
+    }
+    for(float* buffer : buffers)
+    {
+        pool.release(buffer, 1000);
+    }
+    // released buffers stay allocated.
+    EXPECT_EQ(pool.getStats().bytesAllocated, 5 * 1000 * sizeof(float));
+
+    // other sizes are not served from them.
+    float* other = pool.get<float>(500);
+    EXPECT_EQ(std::count(buffers.begin(), buffers.end(), other), 0);
+    EXPECT_EQ(pool.getStats().numAllocated, 6);
+    EXPECT_EQ(pool.getStats().bytesAllocated, 5500 * sizeof(float));
+    pool.release(other, 500);
+
+    // later peaks up to the previous one do not allocate anything.
+    for(int i = 0; i < 5; i++)
+    {
+        pool.get<float>(1000);
+    }
+    EXPECT_EQ(pool.getStats().numAllocated, 6);
+    EXPECT_EQ(pool.getStats().numReused, 5);
+    for(float* buffer : buffers)
+    {
+        pool.release(buffer, 1000);
+    }
+}
+
+TEST(ImageBufferPoolTest, FramePyramidsAreRecycled)
+{
+    const int w = 64, h = 48;
+    setGlobalCalib(w, h, Eigen::Matrix3f::Identity() * 50);
+    std::vector<float> image(w * h);
+    for(int i = 0; i < w * h; i++)
+    {
+        image[i] = (i * 37) % 255;
+    }
+
+    auto pool = std::make_shared<ImageBufferPool>();
+    std::unique_ptr<FrameHessian> unpooled(new FrameHessian());
+    unpooled->makeImages(image.data(), nullptr);
+
+    for(int frame = 0; frame < 3; frame++)
+    {
+        std::unique_ptr<FrameHessian> fh(new FrameHessian());
+        fh->makeImages(image.data(), nullptr, pool);
+
+        ImageBufferPool::Stats stats = pool->getStats();
+        EXPECT_EQ(stats.numAllocated, 2 * pyrLevelsUsed);
+        EXPECT_EQ(stats.numReused, 2 * pyrLevelsUsed * frame);
+
+        // same pyramid as without the pool, also if the buffers contain the data of the previous frame.
+        for(int lvl = 0; lvl < pyrLevelsUsed; lvl++)
+        {
+            int wl = wG[lvl], hl = hG[lvl];
+            for(int idx = 0; idx < wl * hl; idx++)
+            {
+                ASSERT_EQ(fh->dIp[lvl][idx][0], unpooled->dIp[lvl][idx][0]);
+            }
+            for(int idx = wl; idx < wl * (hl - 1); idx++)
+            {
+                ASSERT_EQ(fh->dIp[lvl][idx], unpooled->dIp[lvl][idx]);
+                ASSERT_EQ(fh->absSquaredGrad[lvl][idx], unpooled->absSquaredGrad[lvl][idx]);
+            }
+        }
+
+        // the destructor gives all buffers back.
+        fh.reset();
+        EXPECT_EQ(pool->getStats().numReleased, 2 * pyrLevelsUsed * (frame + 1));
+    }
+}
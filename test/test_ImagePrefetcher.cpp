@@ -0,0 +1,172 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "util/ImagePrefetcher.h"
+#include "dso/util/NumType.h"
+#include "dso/util/ImageAndExposure.h"
+
+using namespace dmvio;
+
+namespace
+{
+// Fake loader which creates a tiny image with the id as timestamp, optionally slowly.
+class FakeLoader
+{
+public:
+    explicit FakeLoader(int delayMs = 0, int failingId = -1) : delayMs(delayMs), failingId(failingId)
+    {}
+
+    ImagePrefetcher::LoadFunction function()
+    {
+        return [this](int id)
+        {
+            numStarted++;
+            if(delayMs > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+            }
+            if(id == failingId)
+            {
+                throw std::runtime_error("cannot load image");
+            }
+            numLoaded++;
+            return new dso::ImageAndExposure(4, 3, id);
+        };
+    }
+
+    int delayMs;
+    int failingId;
+    std::atomic<int> numStarted{0};
+    std::atomic<int> numLoaded{0};
+};
+
+// waits until the value reaches expected (or a timeout is reached).
+bool waitFor(const std::atomic<int>& value, int expected)
+{
+    for(int i = 0; i < 2000 && value < expected; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return value >= expected;
+}
+}
+
+TEST(ImagePrefetcherTest, DeliversInOrder)
+{
+    FakeLoader loader(1);
+    std::vector<int> ids;
+    for(int i = 0; i < 50; i++)
+    {
+        ids.push_back((i * 7) % 50 + 100);
+    }
+    ImagePrefetcher prefetcher(loader.function(), ids, 4, 8, 0, 0);
+    for(int i = 0; i < (int) ids.size(); i++)
+    {
+        std::unique_ptr<dso::ImageAndExposure> img(prefetcher.getImage(i));
+        ASSERT_NE(img, nullptr);
+        EXPECT_EQ(img->timestamp, ids[i]);
+    }
+    EXPECT_EQ(loader.numLoaded, 50);
+}
+
+TEST(ImagePrefetcherTest, RingSize)
+{
+    FakeLoader loader;
+    std::vector<int> ids(20);
+    // limited by the number of frames...
+    EXPECT_EQ(ImagePrefetcher(loader.function(), ids, 2, 5, 100, 10000).getRingSize(), 5);
+    // ... or by the memory.
+    EXPECT_EQ(ImagePrefetcher(loader.function(), ids, 2, 5, 100, 350).getRingSize(), 3);
+    // at least one image is always loaded.
+    EXPECT_EQ(ImagePrefetcher(loader.function(), ids, 2, 5, 100, 10).getRingSize(), 1);
+    EXPECT_EQ(ImagePrefetcher(loader.function(), ids, 2, 0, 0, 0).getRingSize(), 1);
+}
+
+TEST(ImagePrefetcherTest, LoadsOnlyRingSizeAhead)
+{
+    FakeLoader loader;
+    std::vector<int> ids;
+    for(int i = 0; i < 20; i++)
+    {
+        ids.push_back(i);
+    }
+    ImagePrefetcher prefetcher(loader.function(), ids, 4, 10, 100, 350);
+    ASSERT_EQ(prefetcher.getRingSize(), 3);
+
+    ASSERT_TRUE(waitFor(loader.numLoaded, 3));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(loader.numStarted, 3);
+
+    // every delivered image frees a slot for the next one.
+    delete prefetcher.getImage(0);
+    delete prefetcher.getImage(1);
+    ASSERT_TRUE(waitFor(loader.numLoaded, 5));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(loader.numStarted, 5);
+
+    for(int i = 2; i < (int) ids.size(); i++)
+    {
+        std::unique_ptr<dso::ImageAndExposure> img(prefetcher.getImage(i));
+        EXPECT_EQ(img->timestamp, i);
+    }
+}
+
+TEST(ImagePrefetcherTest, LoaderExceptionIsPassedToConsumer)
+{
+    FakeLoader loader(0, 2);
+    std::vector<int> ids = {0, 1, 2, 3, 4};
+    ImagePrefetcher prefetcher(loader.function(), ids, 2, 3, 0, 0);
+
+    delete prefetcher.getImage(0);
+    delete prefetcher.getImage(1);
+    EXPECT_THROW(prefetcher.getImage(2), std::runtime_error);
+
+    // the following images are still delivered.
+    std::unique_ptr<dso::ImageAndExposure> img(prefetcher.getImage(3));
+    EXPECT_EQ(img->timestamp, 3);
+    img.reset(prefetcher.getImage(4));
+    EXPECT_EQ(img->timestamp, 4);
+}
+
+TEST(ImagePrefetcherTest, ShutdownWithLoadsInFlight)
+{
+    FakeLoader loader(20);
+    std::vector<int> ids(100);
+    {
+        ImagePrefetcher prefetcher(loader.function(), ids, 3, 6, 0, 0);
+        ASSERT_TRUE(waitFor(loader.numStarted, 3));
+        delete prefetcher.getImage(0);
+        // destroyed while loads are running and without requesting the remaining images.
+    }
+    // running loads are finished, but no new ones are started.
+    EXPECT_EQ(loader.numLoaded, loader.numStarted);
+    EXPECT_LE(loader.numStarted, 6 + 1);
+}
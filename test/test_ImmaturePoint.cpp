@@ -0,0 +1,167 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "FullSystem/ImmaturePoint.h"
+#include "util/globalFuncs.h"
+
+using namespace dso;
+
+namespace
+{
+// The scalar search of ImmaturePoint::traceOn before it was batched.
+float traceErrorScalar(const Eigen::Vector3f* dI, int width, float ptx, float pty, const Vec2f* rotatedPattern,
+                       const float* refColor)
+{
+    float energy = 0;
+    for(int idx = 0; idx < patternNum; idx++)
+    {
+        float hitColor = getInterpolatedElement31(dI, (float) (ptx + rotatedPattern[idx][0]),
+                                                  (float) (pty + rotatedPattern[idx][1]), width);
+
+        if(!std::isfinite(hitColor))
+        {
+            energy += 1e5;
+            continue;
+        }
+        float residual = hitColor - refColor[idx];
+        float huber_weight = fabs(residual) < setting_huberTH ? 1 : setting_huberTH / fabs(residual);
+        energy += huber_weight * residual * residual * (2 - huber_weight);
+    }
+    return energy;
+}
+}
+
+class ImmaturePointTraceTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        std::uniform_real_distribution<float> colorDist(0, 255);
+        image.resize(w * h);
+        for(auto&& pixel : image)
+        {
+            pixel = Eigen::Vector3f(colorDist(rng), 0, 0);
+        }
+
+        // rotated pattern as in traceOn.
+        std::uniform_real_distribution<float> angleDist(0, 2 * M_PI);
+        Eigen::Rotation2Df rot(angleDist(rng));
+        for(int idx = 0; idx < patternNum; idx++)
+        {
+            rotatedPattern[idx] = rot * Vec2f(patternP[idx][0], patternP[idx][1]);
+            refColor[idx] = colorDist(rng);
+        }
+    }
+
+    // Random search line padded like in traceOn: the positions after numSteps repeat the last one.
+    void makeSearchLine(int numSteps, float* posU, float* posV)
+    {
+        std::uniform_real_distribution<float> startU(6, w - 40), startV(6, h - 40), step(-0.3, 0.3);
+        float ptx = startU(rng), pty = startV(rng);
+        float dx = 0.25f + step(rng), dy = 0.25f + step(rng);
+        for(int i = 0; i < 100; i++)
+        {
+            posU[i] = ptx;
+            posV[i] = pty;
+            if(i + 1 < numSteps)
+            {
+                ptx += dx;
+                pty += dy;
+            }
+        }
+    }
+
+    // Tolerance for the case the compiler contracts the scalar code into FMAs.
+    static void expectErrorNear(float expected, float actual)
+    {
+        EXPECT_NEAR(expected, actual, 1e-5f * std::max(1.0f, std::abs(expected)));
+    }
+
+    const int w = 128, h = 96;
+    std::mt19937 rng{7};
+    std::vector<Eigen::Vector3f> image;
+    Vec2f rotatedPattern[MAX_RES_PER_POINT];
+    float refColor[MAX_RES_PER_POINT];
+};
+
+TEST_F(ImmaturePointTraceTest, SameAsScalar)
+{
+    float posU[100], posV[100];
+    for(int numSteps : {1, 2, 3, 4, 5, 6, 7, 8, 13, 50, 98, 99})
+    {
+        makeSearchLine(numSteps, posU, posV);
+
+        // errors is written up to the next multiple of 4 and not beyond.
+        float errors[104];
+        std::fill(errors, errors + 104, -1.0f);
+        computeTraceErrors(image.data(), w, posU, posV, numSteps, rotatedPattern, refColor, errors);
+
+        int padded = (numSteps + 3) / 4 * 4;
+        for(int i = 0; i < padded; i++)
+        {
+            SCOPED_TRACE(::testing::Message() << "numSteps " << numSteps << " step " << i);
+            expectErrorNear(traceErrorScalar(image.data(), w, posU[i], posV[i], rotatedPattern, refColor), errors[i]);
+        }
+        for(int i = padded; i < 104; i++)
+        {
+            EXPECT_EQ(errors[i], -1.0f);
+        }
+    }
+}
+
+TEST_F(ImmaturePointTraceTest, NonFiniteSamples)
+{
+    // Make some pixels NaN or infinite, so that some pattern samples are not finite.
+    std::uniform_int_distribution<int> pixelDist(0, w * h - 1);
+    for(int i = 0; i < 200; i++)
+    {
+        image[pixelDist(rng)][0] = NAN;
+        image[pixelDist(rng)][0] = INFINITY;
+        image[pixelDist(rng)][0] = -INFINITY;
+    }
+
+    float posU[100], posV[100];
+    int numInvalid = 0;
+    for(int run = 0; run < 20; run++)
+    {
+        int numSteps = 99;
+        makeSearchLine(numSteps, posU, posV);
+        float errors[100];
+        computeTraceErrors(image.data(), w, posU, posV, numSteps, rotatedPattern, refColor, errors);
+
+        for(int i = 0; i < numSteps; i++)
+        {
+            float expected = traceErrorScalar(image.data(), w, posU[i], posV[i], rotatedPattern, refColor);
+            SCOPED_TRACE(::testing::Message() << "run " << run << " step " << i);
+            ASSERT_TRUE(std::isfinite(errors[i]));
+            expectErrorNear(expected, errors[i]);
+            if(expected >= 1e5) numInvalid++;
+        }
+    }
+    // make sure the invalid samples were actually hit.
+    EXPECT_GT(numInvalid, 0);
+}
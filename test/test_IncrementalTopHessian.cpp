@@ -0,0 +1,400 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include "FullSystem/Residuals.h"
+#include "OptimizationBackend/EnergyFunctionalStructs.h"
+#include "OptimizationBackend/RawResidualJacobian.h"
+#include "util/settings.h"
+#include "util/globalCalib.h"
+#include "FullSystem/HessianBlocks.h"
+#include "FullSystem/ImmaturePoint.h"
+#include "OptimizationBackend/AccumulatedTopHessian.h"
+#include "OptimizationBackend/EnergyFunctional.h"
+#include "GTSAMIntegration/BAGTSAMIntegration.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace dso;
+
+namespace
+{
+void setRandom(RawResidualJacobian& J)
+{
+    J.resF.setRandom();
+    for(int i = 0; i < 2; i++)
+    {
+        J.Jpdxi[i].setRandom();
+        J.Jpdc[i].setRandom();
+        J.JIdx[i].setRandom();
+        J.JabF[i].setRandom();
+    }
+    J.Jpdd.setRandom();
+    J.JIdx2.setRandom();
+    J.JabJIdx.setRandom();
+    J.Jab2.setRandom();
+}
+}
+
+// A PointFrameResidual with its EFResidual, as created by FullSystem and EnergyFunctional.
+class IncrementalTopHessianTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        oldIncremental = setting_incrementalTopHessian;
+        oldTH = setting_incrementalTopHessianTH;
+        setting_incrementalTopHessian = true;
+        setting_incrementalTopHessianTH = 0;
+
+        residual = new(residualAllocator) PointFrameResidual(nullptr, nullptr, nullptr);
+        efResidual = new(efResidualAllocator) EFResidual(residual, nullptr, nullptr, nullptr);
+        residual->efResidual = efResidual;
+    }
+
+    void TearDown() override
+    {
+        residual->efResidual = nullptr;
+        delete efResidual;
+        delete residual;
+        setting_incrementalTopHessian = oldIncremental;
+        setting_incrementalTopHessianTH = oldTH;
+    }
+
+    // linearize writes the new Jacobian to residual->J, then applyRes hands it to the EFResidual.
+    void linearizeAndApply(const RawResidualJacobian& newJ, ResState newState = ResState::IN)
+    {
+        *residual->J = newJ;
+        residual->state_NewState = newState;
+        residual->applyRes(true);
+    }
+
+    // what AccumulatedTopHessianSSE::prepareIncremental does once the block of the residual is marked.
+    void accumulate()
+    {
+        efResidual->changedSinceAccumulation = false;
+    }
+
+    bool oldIncremental;
+    float oldTH;
+    SlabAllocator<PointFrameResidual> residualAllocator;
+    SlabAllocator<EFResidual> efResidualAllocator;
+    PointFrameResidual* residual;
+    EFResidual* efResidual;
+};
+
+TEST_F(IncrementalTopHessianTest, IsCloseTo)
+{
+    RawResidualJacobian J1, J2;
+    setRandom(J1);
+    J2 = J1;
+    EXPECT_TRUE(J1.isCloseTo(J2, 0));
+
+    J2.Jpdxi[1][3] *= 1.0001f;
+    EXPECT_FALSE(J1.isCloseTo(J2, 0));
+    EXPECT_TRUE(J1.isCloseTo(J2, 1e-3));
+    EXPECT_FALSE(J1.isCloseTo(J2, 1e-5));
+
+    // every member of the Jacobian is compared.
+    J2 = J1;
+    J2.Jab2(1, 0) += 1;
+    EXPECT_FALSE(J1.isCloseTo(J2, 1e-3));
+
+    // the residual is not part of it.
+    J2 = J1;
+    J2.resF[MAX_RES_PER_POINT - 1] += 1;
+    EXPECT_TRUE(J1.isCloseTo(J2, 0));
+}
+
+TEST_F(IncrementalTopHessianTest, KeepsUnchangedJacobian)
+{
+    RawResidualJacobian J;
+    setRandom(J);
+
+    // a new residual is always changed.
+    EXPECT_TRUE(efResidual->changedSinceAccumulation);
+    linearizeAndApply(J);
+    EXPECT_TRUE(efResidual->isActive());
+    EXPECT_TRUE(efResidual->J->isCloseTo(J, 0));
+    accumulate();
+
+    // the same Jacobian again: the old one is kept, so the cached block stays valid.
+    RawResidualJacobian* oldJ = efResidual->J;
+    Vec8f oldJpJdF = efResidual->JpJdF;
+    linearizeAndApply(J);
+    EXPECT_FALSE(efResidual->changedSinceAccumulation);
+    EXPECT_EQ(efResidual->J, oldJ);
+    EXPECT_EQ(efResidual->JpJdF, oldJpJdF);
+
+    // a new residual with the same Jacobian is taken over, as b is always computed from it.
+    RawResidualJacobian JNewRes = J;
+    JNewRes.resF.setRandom();
+    linearizeAndApply(JNewRes);
+    EXPECT_FALSE(efResidual->changedSinceAccumulation);
+    EXPECT_EQ(efResidual->J, oldJ);
+    EXPECT_EQ(efResidual->J->resF, JNewRes.resF);
+
+    // a different Jacobian is taken over and marks the residual.
+    RawResidualJacobian J2 = J;
+    J2.Jpdd[0] *= 1.01f;
+    linearizeAndApply(J2);
+    EXPECT_TRUE(efResidual->changedSinceAccumulation);
+    EXPECT_TRUE(efResidual->J->isCloseTo(J2, 0));
+}
+
+TEST_F(IncrementalTopHessianTest, Threshold)
+{
+    setting_incrementalTopHessianTH = 1e-2;
+    RawResidualJacobian J;
+    setRandom(J);
+    linearizeAndApply(J);
+    accumulate();
+
+    // below the threshold the old Jacobian is kept.
+    RawResidualJacobian J2 = J;
+    J2.Jpdd[0] *= 1.001f;
+    linearizeAndApply(J2);
+    EXPECT_FALSE(efResidual->changedSinceAccumulation);
+    EXPECT_TRUE(efResidual->J->isCloseTo(J, 0));
+
+    // above it the new one is used.
+    J2.Jpdd[0] *= 1.1f;
+    linearizeAndApply(J2);
+    EXPECT_TRUE(efResidual->changedSinceAccumulation);
+    EXPECT_TRUE(efResidual->J->isCloseTo(J2, 0));
+}
+
+TEST_F(IncrementalTopHessianTest, ActivityChangeMarksResidual)
+{
+    RawResidualJacobian J;
+    setRandom(J);
+    linearizeAndApply(J);
+    accumulate();
+
+    // becoming an outlier removes the residual from its block.
+    linearizeAndApply(J, ResState::OUTLIER);
+    EXPECT_FALSE(efResidual->isActive());
+    EXPECT_TRUE(efResidual->changedSinceAccumulation);
+    accumulate();
+
+    // staying inactive does not change the block.
+    linearizeAndApply(J, ResState::OUTLIER);
+    EXPECT_FALSE(efResidual->changedSinceAccumulation);
+
+    // becoming active again with the same Jacobian adds it back.
+    linearizeAndApply(J);
+    EXPECT_TRUE(efResidual->isActive());
+    EXPECT_TRUE(efResidual->changedSinceAccumulation);
+}
+
+TEST_F(IncrementalTopHessianTest, DisabledAlwaysTakesJacobian)
+{
+    setting_incrementalTopHessian = false;
+    RawResidualJacobian J;
+    setRandom(J);
+    linearizeAndApply(J);
+    accumulate();
+
+    RawResidualJacobian* oldJ = efResidual->J;
+    linearizeAndApply(J);
+    EXPECT_NE(efResidual->J, oldJ);
+    EXPECT_TRUE(efResidual->J->isCloseTo(J, 0));
+}
+
+// Points with residuals to all other frames and random Jacobians, accumulated like EnergyFunctional::accumulateAF_MT.
+class IncrementalStitchingTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        oldIncremental = setting_incrementalTopHessian;
+        oldTH = setting_incrementalTopHessianTH;
+        setting_incrementalTopHessian = true;
+        setting_incrementalTopHessianTH = 0;
+        std::srand(3);
+
+        setGlobalCalib(w, h, (Eigen::Matrix3f() << 200, 0, 160, 0, 200, 120, 0, 0, 1).finished());
+        HCalib.reset(new CalibHessian());
+        gtsamIntegration.reset(new dmvio::BAGTSAMIntegration(nullptr, nullptr, integrationSettings, HCalib.get()));
+        ef.reset(new EnergyFunctional(*gtsamIntegration));
+
+        std::vector<float> image(w * h, 100);
+        for(int i = 0; i < nFrames; i++)
+        {
+            frames.emplace_back(new FrameHessian());
+            FrameHessian* fh = frames.back().get();
+            fh->makeImages(image.data(), HCalib.get());
+            fh->frameID = i;
+            fh->ab_exposure = 1;
+            SE3d pose(Sophus::SO3d::exp(Vec3(0, 0.01 * i, 0)), Vec3(0.1 * i, 0.05 * i, 0));
+            fh->setEvalPT_scaled(pose, AffLight(0, 0));
+            ef->insertFrame(fh, HCalib.get());
+        }
+
+        for(int i = 0; i < numPoints; i++)
+        {
+            FrameHessian* host = frames[i % nFrames].get();
+            ImmaturePoint ip(10 + i, 20, host, 1, HCalib.get());
+            ip.idepth_min = ip.idepth_max = 0.5;
+            pointHessians.emplace_back(new PointHessian(&ip, HCalib.get()));
+            PointHessian* ph = pointHessians.back().get();
+            points.push_back(ef->insertPoint(ph));
+            for(auto&& target : frames)
+            {
+                if(target.get() == host) continue;
+                PointFrameResidual* r = new(residualAllocator) PointFrameResidual(ph, host, target.get());
+                ef->insertResidual(r);
+                residuals.push_back(r);
+
+                RawResidualJacobian J;
+                setRandom(J);
+                linearizeAndApply(r, J);
+            }
+        }
+        ef->makeIDX();
+        ef->setDeltaF(HCalib.get());
+    }
+
+    void TearDown() override
+    {
+        // deletes the EFResiduals, EFPoints and EFFrames.
+        ef.reset();
+        for(PointFrameResidual* r : residuals)
+        {
+            delete r;
+        }
+        setting_incrementalTopHessian = oldIncremental;
+        setting_incrementalTopHessianTH = oldTH;
+    }
+
+    static void linearizeAndApply(PointFrameResidual* r, const RawResidualJacobian& newJ)
+    {
+        *r->J = newJ;
+        r->state_NewState = ResState::IN;
+        r->applyRes(true);
+    }
+
+    void accumulate(AccumulatedTopHessianSSE& acc, bool incremental, MatXX& H, VecX& b)
+    {
+        if(incremental) acc.prepareIncremental(points, nFrames);
+        acc.setZero(nFrames);
+        for(EFPoint* p : points)
+        {
+            acc.addPoint<0>(p, ef.get());
+        }
+        acc.stitchDoubleMT(nullptr, H, b, ef.get(), false, false);
+    }
+
+    // accumulates incrementally with acc and compares with a full accumulation of the current residuals.
+    void expectSameAsFull(AccumulatedTopHessianSSE& acc)
+    {
+        MatXX H, HFull;
+        VecX b, bFull;
+        accumulate(acc, true, H, b);
+        AccumulatedTopHessianSSE full;
+        accumulate(full, false, HFull, bFull);
+
+        EXPECT_LT((H - HFull).norm(), 1e-5 * HFull.norm());
+        EXPECT_LT((b - bFull).norm(), 1e-5 * bFull.norm());
+        EXPECT_EQ(acc.nres[0], full.nres[0]);
+    }
+
+    const int w = 320, h = 240;
+    const int nFrames = 4;
+    const int numPoints = 40;
+
+    bool oldIncremental;
+    float oldTH;
+    std::unique_ptr<CalibHessian> HCalib;
+    dmvio::GTSAMIntegrationSettings integrationSettings;
+    std::unique_ptr<dmvio::BAGTSAMIntegration> gtsamIntegration;
+    std::unique_ptr<EnergyFunctional> ef;
+    std::vector<std::unique_ptr<FrameHessian>> frames;
+    std::vector<std::unique_ptr<PointHessian>> pointHessians;
+    std::vector<EFPoint*> points;
+    SlabAllocator<PointFrameResidual> residualAllocator;
+    std::vector<PointFrameResidual*> residuals;
+};
+
+TEST_F(IncrementalStitchingTest, SameAsFullAccumulation)
+{
+    AccumulatedTopHessianSSE acc;
+    expectSameAsFull(acc);
+
+    // the residuals of block (0, 1) change, but not their Jacobians. One Jacobian of block (1, 2) changes.
+    bool changedJacobian = false;
+    for(PointFrameResidual* r : residuals)
+    {
+        EFResidual* efResidual = r->efResidual;
+        RawResidualJacobian J = *efResidual->J;
+        if(efResidual->hostIDX == 0 && efResidual->targetIDX == 1)
+        {
+            J.resF.setRandom();
+        }
+        else if(efResidual->hostIDX == 1 && efResidual->targetIDX == 2 && !changedJacobian)
+        {
+            J.Jpdxi[0] *= 1.5f;
+            changedJacobian = true;
+        }
+        linearizeAndApply(r, J);
+    }
+    expectSameAsFull(acc);
+    EXPECT_FALSE(acc.blockDirty[0 + 1 * nFrames]);
+    EXPECT_TRUE(acc.blockDirty[1 + 2 * nFrames]);
+    EXPECT_EQ(std::count(acc.blockDirty.begin(), acc.blockDirty.end(), true), 1);
+
+    // nothing changed: all blocks are taken from the cache.
+    expectSameAsFull(acc);
+    EXPECT_EQ(std::count(acc.blockDirty.begin(), acc.blockDirty.end(), true), 0);
+}
+
+TEST_F(IncrementalStitchingTest, ResidualsChangeBelowThreshold)
+{
+    setting_incrementalTopHessianTH = 1e-2;
+    AccumulatedTopHessianSSE acc;
+    expectSameAsFull(acc);
+    MatXX HBefore;
+    VecX bBefore;
+    AccumulatedTopHessianSSE before;
+    accumulate(before, false, HBefore, bBefore);
+
+    // all Jacobians stay below the threshold, so H is taken from the cache. The residuals still have to be used for b.
+    for(PointFrameResidual* r : residuals)
+    {
+        RawResidualJacobian J = *r->efResidual->J;
+        J.resF *= 1.005f;
+        J.Jpdd *= 1.001f;
+        linearizeAndApply(r, J);
+        EXPECT_EQ(r->efResidual->J->resF, J.resF);
+    }
+    expectSameAsFull(acc);
+    EXPECT_EQ(std::count(acc.blockDirty.begin(), acc.blockDirty.end(), true), 0);
+
+    MatXX H;
+    VecX b;
+    accumulate(acc, true, H, b);
+    EXPECT_EQ(H, HBefore);
+    EXPECT_GT((b - bBefore).norm(), 1e-3 * bBefore.norm());
+}
@@ -0,0 +1,150 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "util/IndexThreadReduce.h"
+
+using namespace dso;
+
+namespace
+{
+// Reduces [first, end) with the given number of threads and step size, checking that every index is visited exactly
+// once and that the reduced stats match the sequential sum.
+void expectCorrectReduce(IndexThreadReduce<Vec10>& red, int first, int end, int stepSize)
+{
+    int numThreads = red.getNumThreads();
+    std::unique_ptr<std::atomic<int>[]> visits(new std::atomic<int>[std::max(end, 1)]);
+    for(int i = 0; i < end; i++)
+    {
+        visits[i] = 0;
+    }
+    std::unique_ptr<std::atomic<int>[]> callsPerThread(new std::atomic<int>[numThreads]);
+    for(int i = 0; i < numThreads; i++)
+    {
+        callsPerThread[i] = 0;
+    }
+    std::atomic<bool> invalidCall(false);
+
+    red.reduce([&](int min, int max, Vec10* stats, int tid)
+               {
+                   if(tid < 0 || tid >= numThreads || min > max || (min < max && (min < first || max > end)))
+                   {
+                       invalidCall = true;
+                       return;
+                   }
+                   callsPerThread[tid]++;
+                   for(int i = min; i < max; i++)
+                   {
+                       visits[i]++;
+                       (*stats)[0] += 1;
+                       (*stats)[1] += i;
+                       (*stats)[2] += 0.5 * i * i;
+                   }
+               }, first, end, stepSize);
+
+    EXPECT_FALSE(invalidCall);
+    int wrongVisits = 0;
+    for(int i = 0; i < end; i++)
+    {
+        if(visits[i] != (i >= first ? 1 : 0)) wrongVisits++;
+    }
+    EXPECT_EQ(wrongVisits, 0) << "range [" << first << ", " << end << "), step " << stepSize;
+
+    Vec10 expected = Vec10::Zero();
+    for(int i = first; i < end; i++)
+    {
+        expected[0] += 1;
+        expected[1] += i;
+        expected[2] += 0.5 * i * i;
+    }
+    EXPECT_EQ(red.stats, expected) << "range [" << first << ", " << end << "), step " << stepSize;
+
+    // every thread is called at least once.
+    for(int i = 0; i < numThreads; i++)
+    {
+        EXPECT_GE(callsPerThread[i], 1) << "thread " << i;
+    }
+}
+}
+
+TEST(IndexThreadReduceTest, VisitsEveryIndexOnce)
+{
+    for(int numThreads : {1, 2, 3, 8})
+    {
+        IndexThreadReduce<Vec10> red(numThreads);
+        EXPECT_EQ(red.getNumThreads(), numThreads);
+        for(int stepSize : {0, 1, 7, 50})
+        {
+            expectCorrectReduce(red, 0, 1000, stepSize);
+            expectCorrectReduce(red, 13, 10007, stepSize);
+        }
+    }
+}
+
+TEST(IndexThreadReduceTest, TinyRanges)
+{
+    for(int numThreads : {1, 2, 8})
+    {
+        IndexThreadReduce<Vec10> red(numThreads);
+        for(int stepSize : {0, 1, 3})
+        {
+            expectCorrectReduce(red, 0, 0, stepSize);
+            expectCorrectReduce(red, 5, 5, stepSize);
+            expectCorrectReduce(red, 0, 1, stepSize);
+            expectCorrectReduce(red, 4, 6, stepSize);
+        }
+    }
+}
+
+TEST(IndexThreadReduceTest, MoreThreadsThanChunks)
+{
+    IndexThreadReduce<Vec10> red(16);
+    // 3 chunks for 16 threads.
+    expectCorrectReduce(red, 0, 3, 1);
+    expectCorrectReduce(red, 0, 30, 10);
+    expectCorrectReduce(red, 2, 9, 0);
+}
+
+TEST(IndexThreadReduceTest, ManyCallsOnOneInstance)
+{
+    IndexThreadReduce<Vec10> red(4);
+    for(int i = 0; i < 200; i++)
+    {
+        expectCorrectReduce(red, i % 7, 100 + 37 * i, (i % 3) * 5);
+    }
+}
+
+TEST(IndexThreadReduceTest, ThreadCountIsClamped)
+{
+    IndexThreadReduce<Vec10> tooMany(MAX_NUM_THREADS + 10);
+    EXPECT_EQ(tooMany.getNumThreads(), MAX_NUM_THREADS);
+    expectCorrectReduce(tooMany, 0, 500, 0);
+
+    IndexThreadReduce<Vec10> automatic(0);
+    EXPECT_GE(automatic.getNumThreads(), 1);
+    expectCorrectReduce(automatic, 0, 500, 0);
+}
@@ -0,0 +1,133 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/slam/PriorFactor.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/geometry/Pose3.h>
+#include "GTSAMIntegration/LinearizationCache.h"
+
+using namespace gtsam;
+using namespace dmvio;
+using symbol_shorthand::P;
+
+class LinearizationCacheTest : public ::testing::Test
+{
+protected:
+    NonlinearFactorGraph graph;
+    Values values;
+    Ordering ordering;
+    std::map<Key, size_t> keyDimMap;
+
+    SharedNoiseModel model = noiseModel::Isotropic::Sigma(6, 0.1);
+
+    void SetUp() override
+    {
+        for(int i = 0; i < 4; i++)
+        {
+            values.insert(P(i), Pose3(Rot3::Ypr(0.1 * i, 0.05, -0.02 * i), Point3(i, 0.3 * i, 0.1)));
+            ordering.push_back(P(i));
+            keyDimMap[P(i)] = 6;
+        }
+        graph.emplace_shared<PriorFactor<Pose3>>(P(0), Pose3(), model);
+        for(int i = 0; i < 3; i++)
+        {
+            graph.emplace_shared<BetweenFactor<Pose3>>(P(i), P(i + 1), Pose3(Rot3(), Point3(1, 0, 0)), model);
+        }
+    }
+
+    std::pair<Matrix, Vector> directHAndB()
+    {
+        auto gfg = graph.linearize(values);
+        AugmentedScatter scatter(*gfg, ordering, keyDimMap);
+        return scatter.computeHessian(*gfg);
+    }
+
+    std::pair<Matrix, Vector> cachedHAndB(LinearizationCache& cache)
+    {
+        auto gfg = cache.linearize(graph, values, nullptr);
+        return cache.getScatter(*gfg, ordering, keyDimMap).computeHessian(*gfg);
+    }
+};
+
+TEST_F(LinearizationCacheTest, ReusesUnchangedFactors)
+{
+    LinearizationCache cache;
+    auto first = cachedHAndB(cache);
+    EXPECT_EQ(cache.getNumRelinearized(), 4);
+
+    auto second = cachedHAndB(cache);
+    EXPECT_EQ(cache.getNumRelinearized(), 0);
+    EXPECT_EQ(cache.getNumReused(), 4);
+
+    auto direct = directHAndB();
+    EXPECT_TRUE(first.first == direct.first);
+    EXPECT_TRUE(second.first == direct.first);
+    EXPECT_TRUE(second.second == direct.second);
+}
+
+TEST_F(LinearizationCacheTest, RelinearizesFactorsOfChangedVariables)
+{
+    LinearizationCache cache;
+    cachedHAndB(cache);
+
+    values.update(P(3), values.at<Pose3>(P(3)).retract((Vector(6) << 0.01, 0, 0, 0.1, 0, 0).finished()));
+    auto cached = cachedHAndB(cache);
+    // Only the between factor P2-P3 is connected to P3.
+    EXPECT_EQ(cache.getNumRelinearized(), 1);
+
+    auto direct = directHAndB();
+    EXPECT_TRUE(cached.first == direct.first);
+    EXPECT_TRUE(cached.second == direct.second);
+}
+
+TEST_F(LinearizationCacheTest, RelinearizeThreshold)
+{
+    LinearizationCache cache(1e-3);
+    cachedHAndB(cache);
+
+    values.update(P(1), values.at<Pose3>(P(1)).retract((Vector(6) << 0, 0, 0, 1e-5, 0, 0).finished()));
+    cachedHAndB(cache);
+    EXPECT_EQ(cache.getNumRelinearized(), 0);
+
+    values.update(P(1), values.at<Pose3>(P(1)).retract((Vector(6) << 0, 0, 0, 1e-2, 0, 0).finished()));
+    cachedHAndB(cache);
+    EXPECT_EQ(cache.getNumRelinearized(), 2);
+}
+
+TEST_F(LinearizationCacheTest, HandlesChangedGraph)
+{
+    LinearizationCache cache;
+    cachedHAndB(cache);
+
+    graph.erase(graph.begin() + 3);
+    graph.emplace_shared<PriorFactor<Pose3>>(P(3), Pose3(), model);
+    auto cached = cachedHAndB(cache);
+    EXPECT_EQ(cache.getNumRelinearized(), 1);
+
+    auto direct = directHAndB();
+    EXPECT_TRUE(cached.first == direct.first);
+    EXPECT_TRUE(cached.second == direct.second);
+}
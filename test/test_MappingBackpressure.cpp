@@ -0,0 +1,173 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include "FullSystem/MappingBackpressure.h"
+#include "util/settings.h"
+
+using namespace dso;
+
+namespace
+{
+// Sets the backpressure settings used by the tests and restores the previous values afterwards.
+class MappingBackpressureTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        oldMode = setting_mappingBackpressure;
+        oldFramesPerLevel = setting_backpressureFramesPerLevel;
+        oldMsPerLevel = setting_backpressureMsPerLevel;
+        oldOptItsFactor = setting_backpressureOptItsFactor;
+        oldDensityFactor = setting_backpressureDensityFactor;
+        oldRealTimeMaxKF = setting_realTimeMaxKF;
+        oldRunQuiet = setting_debugout_runquiet;
+
+        setting_mappingBackpressure = 1;
+        setting_backpressureFramesPerLevel = 2;
+        setting_backpressureMsPerLevel = 100;
+        setting_backpressureOptItsFactor = 0.5;
+        setting_backpressureDensityFactor = 0.6;
+        setting_realTimeMaxKF = false;
+        setting_debugout_runquiet = true;
+    }
+
+    void TearDown() override
+    {
+        setting_mappingBackpressure = oldMode;
+        setting_backpressureFramesPerLevel = oldFramesPerLevel;
+        setting_backpressureMsPerLevel = oldMsPerLevel;
+        setting_backpressureOptItsFactor = oldOptItsFactor;
+        setting_backpressureDensityFactor = oldDensityFactor;
+        setting_realTimeMaxKF = oldRealTimeMaxKF;
+        setting_debugout_runquiet = oldRunQuiet;
+    }
+
+    int oldMode, oldFramesPerLevel;
+    float oldMsPerLevel, oldOptItsFactor, oldDensityFactor;
+    bool oldRealTimeMaxKF, oldRunQuiet;
+};
+}
+
+TEST_F(MappingBackpressureTest, DisabledByDefault)
+{
+    setting_mappingBackpressure = oldMode;
+    EXPECT_EQ(setting_mappingBackpressure, 0);
+
+    MappingBackpressure backpressure;
+    backpressure.frameDelivered(10.0);
+    EXPECT_EQ(backpressure.update(1.0, 50), 0);
+    EXPECT_EQ(backpressure.getLevel(), 0);
+    EXPECT_NEAR(backpressure.getLagMs(), 9000.0, 1e-6);
+    EXPECT_EQ(backpressure.maxOptIterations(6), 6);
+    EXPECT_TRUE(backpressure.allowExtraKeyframes());
+    EXPECT_TRUE(backpressure.traceNonKeyframes());
+    EXPECT_EQ(backpressure.pointDensityFactor(), 1.0f);
+}
+
+TEST_F(MappingBackpressureTest, LevelRisesImmediatelyAndFallsByOne)
+{
+    MappingBackpressure backpressure;
+    backpressure.frameDelivered(1.0);
+
+    // No lag.
+    EXPECT_EQ(backpressure.update(1.0, 0), 0);
+
+    // 6 queued frames with 2 frames per level -> level 3 at once.
+    EXPECT_EQ(backpressure.update(1.0, 6), 3);
+
+    // Without lag the level only falls by one per mapped frame.
+    EXPECT_EQ(backpressure.update(1.0, 0), 2);
+    EXPECT_EQ(backpressure.update(1.0, 0), 1);
+    EXPECT_EQ(backpressure.update(1.0, 0), 0);
+    EXPECT_EQ(backpressure.update(1.0, 0), 0);
+
+    // Rises again directly to the target.
+    EXPECT_EQ(backpressure.update(1.0, 2), 1);
+    EXPECT_EQ(backpressure.update(1.0, 4), 2);
+
+    // The level is capped.
+    EXPECT_EQ(backpressure.update(1.0, 100), MappingBackpressure::MaxLevel);
+}
+
+TEST_F(MappingBackpressureTest, LevelFromSensorTimeLag)
+{
+    MappingBackpressure backpressure;
+    backpressure.frameDelivered(2.0);
+
+    // The mapped frame is 250 ms older than the newest delivered one -> level 2 (100 ms per level).
+    EXPECT_EQ(backpressure.update(1.75, 0), 2);
+    EXPECT_NEAR(backpressure.getLagMs(), 250.0, 1e-6);
+
+    // The larger of the two lag measures is used.
+    EXPECT_EQ(backpressure.update(1.75, 6), 3);
+}
+
+TEST_F(MappingBackpressureTest, DegradationPerLevel)
+{
+    MappingBackpressure backpressure;
+    backpressure.frameDelivered(1.0);
+
+    backpressure.update(1.0, 2);
+    ASSERT_EQ(backpressure.getLevel(), 1);
+    EXPECT_EQ(backpressure.maxOptIterations(6), 3);
+    EXPECT_EQ(backpressure.maxOptIterations(1), 1);
+    EXPECT_FALSE(backpressure.allowExtraKeyframes());
+    EXPECT_TRUE(backpressure.traceNonKeyframes());
+    EXPECT_EQ(backpressure.pointDensityFactor(), 1.0f);
+
+    backpressure.update(1.0, 4);
+    ASSERT_EQ(backpressure.getLevel(), 2);
+    EXPECT_FALSE(backpressure.traceNonKeyframes());
+    EXPECT_EQ(backpressure.pointDensityFactor(), 1.0f);
+
+    backpressure.update(1.0, 6);
+    ASSERT_EQ(backpressure.getLevel(), 3);
+    EXPECT_FALSE(backpressure.traceNonKeyframes());
+    EXPECT_FLOAT_EQ(backpressure.pointDensityFactor(), 0.6f);
+}
+
+TEST_F(MappingBackpressureTest, KeyframeDecision)
+{
+    MappingBackpressure backpressure;
+
+    // Queued frames are mapped first and the requested KF is coalesced to the newest one.
+    EXPECT_FALSE(backpressure.makeKeyframe(3, false, true));
+    EXPECT_TRUE(backpressure.makeKeyframe(0, false, true));
+    EXPECT_FALSE(backpressure.makeKeyframe(0, false, false));
+
+    // A prepared IMU keyframe is created even if newer frames are queued (this used to be assert(false)).
+    EXPECT_TRUE(backpressure.makeKeyframe(3, true, true));
+    EXPECT_TRUE(backpressure.makeKeyframe(0, true, true));
+
+    // setting_realTimeMaxKF creates a KF whenever the queue is empty, but not under backpressure.
+    setting_realTimeMaxKF = true;
+    EXPECT_TRUE(backpressure.makeKeyframe(0, false, false));
+    EXPECT_FALSE(backpressure.makeKeyframe(1, false, false));
+    backpressure.frameDelivered(1.0);
+    backpressure.update(1.0, 2);
+    ASSERT_EQ(backpressure.getLevel(), 1);
+    EXPECT_FALSE(backpressure.makeKeyframe(0, false, false));
+    EXPECT_TRUE(backpressure.makeKeyframe(0, false, true));
+}
@@ -0,0 +1,82 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include "GTSAMIntegration/Marginalization.h"
+
+using namespace dmvio;
+
+namespace
+{
+// Random augmented Hessian [H b; b^T 0] with n variables.
+gtsam::Matrix randomAugmentedHessian(int n, bool rankDeficient)
+{
+    std::srand(42);
+    gtsam::Matrix J = gtsam::Matrix::Random(2 * n, n);
+    if(rankDeficient)
+    {
+        J.col(3) = J.col(1) + J.col(2);
+    }
+    gtsam::Matrix H = J.transpose() * J;
+    gtsam::Vector b = J.transpose() * gtsam::Vector::Random(2 * n);
+    gtsam::Matrix augmented = gtsam::Matrix::Zero(n + 1, n + 1);
+    augmented.topLeftCorner(n, n) = H;
+    augmented.topRightCorner(n, 1) = b;
+    augmented.bottomLeftCorner(1, n) = b.transpose();
+    return augmented;
+}
+}
+
+TEST(SchurComplement, LDLTMatchesPseudoInverse)
+{
+    for(int mSize : {15, 17})
+    {
+        int aSize = 40;
+        gtsam::Matrix augmented = randomAugmentedHessian(mSize + aSize, false);
+
+        SchurComplementInfo info, infoPseudoInverse;
+        gtsam::Matrix ldlt = computeSchurComplement(augmented, mSize, aSize, &info);
+        gtsam::Matrix pseudoInverse = computeSchurComplement(augmented, mSize, aSize, &infoPseudoInverse, true);
+
+        EXPECT_FALSE(info.usedPseudoInverse);
+        EXPECT_TRUE(infoPseudoInverse.usedPseudoInverse);
+        EXPECT_GT(info.conditioning, 0.0);
+        ASSERT_EQ(ldlt.rows(), aSize + 1);
+        EXPECT_LT((ldlt - pseudoInverse).norm(), 1e-9 * pseudoInverse.norm());
+        EXPECT_TRUE(ldlt.isApprox(ldlt.transpose()));
+    }
+}
+
+TEST(SchurComplement, RankDeficientUsesPseudoInverse)
+{
+    int mSize = 15, aSize = 20;
+    gtsam::Matrix augmented = randomAugmentedHessian(mSize + aSize, true);
+
+    SchurComplementInfo info;
+    gtsam::Matrix result = computeSchurComplement(augmented, mSize, aSize, &info);
+    gtsam::Matrix pseudoInverse = computeSchurComplement(augmented, mSize, aSize, nullptr, true);
+
+    EXPECT_TRUE(info.usedPseudoInverse);
+    EXPECT_TRUE(result == pseudoInverse);
+}
@@ -0,0 +1,123 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "FullSystem/PixelSelector2.h"
+#include "FullSystem/HessianBlocks.h"
+#include "util/globalCalib.h"
+
+using namespace dso;
+
+namespace
+{
+// Frame with random gradients. The pyramid is filled directly (instead of with makeImages), so that absSquaredGrad
+// can be chosen independently of the gradients in dIp.
+std::unique_ptr<FrameHessian> makeRandomFrame(std::mt19937& rng, bool orthogonalCandidates)
+{
+    std::unique_ptr<FrameHessian> fh(new FrameHessian());
+    std::uniform_real_distribution<float> gradDist(-30, 30);
+    for(int lvl = 0; lvl < pyrLevelsUsed; lvl++)
+    {
+        int w = wG[lvl], h = hG[lvl];
+        fh->dIp[lvl] = new Eigen::Vector3f[w * h];
+        fh->absSquaredGrad[lvl] = new float[w * h];
+        for(int i = 0; i < w * h; i++)
+        {
+            Eigen::Vector3f val(0, gradDist(rng), gradDist(rng));
+            // stripes with weak gradients, so that the thresholds differ between the blocks.
+            if((i % w) % 50 < 10) val.tail<2>() *= 0.05;
+            if(rng() % 97 == 0) val.tail<2>().setZero();
+            fh->dIp[lvl][i] = val;
+            fh->absSquaredGrad[lvl][i] = val.tail<2>().squaredNorm();
+        }
+    }
+    fh->dI = fh->dIp[0];
+
+    if(orthogonalCandidates)
+    {
+        // Pixels which pass the gradient threshold, but whose gradient is orthogonal to every random direction. The
+        // parallel selection predicts one point for their 2-blocks, so it has to fall back to the sequential one.
+        int w = wG[0];
+        for(int y = 100; y < 140; y++)
+            for(int x = 0; x < w; x++)
+            {
+                fh->dIp[0][x + y * w].tail<2>().setZero();
+                fh->absSquaredGrad[0][x + y * w] = 1e6;
+            }
+    }
+    return fh;
+}
+}
+
+class PixelSelectorTest : public ::testing::TestWithParam<bool>
+{
+protected:
+    void SetUp() override
+    {
+        Eigen::Matrix3f K = Eigen::Matrix3f::Identity() * 300;
+        K(0, 2) = w / 2;
+        K(1, 2) = h / 2;
+        setGlobalCalib(w, h, K);
+    }
+
+    const int w = 640, h = 480;
+};
+
+TEST_P(PixelSelectorTest, ParallelSameAsSequential)
+{
+    bool orthogonalCandidates = GetParam();
+    IndexThreadReduce<Vec10> threadReduce;
+    std::mt19937 rng(42);
+
+    std::vector<float> mapSequential(w * h), mapParallel(w * h);
+    for(int frame = 0; frame < 3; frame++)
+    {
+        auto fh = makeRandomFrame(rng, orthogonalCandidates);
+        for(float density : {500.f, 2000.f, 8000.f, 20000.f})
+        {
+            // new selectors each time, so that the parallel one also computes its histograms and candidate masks.
+            PixelSelector sequential(w, h);
+            PixelSelector parallel(w, h);
+            parallel.threadReduce = &threadReduce;
+
+            int numSequential = sequential.makeMaps(fh.get(), mapSequential.data(), density);
+            int numParallel = parallel.makeMaps(fh.get(), mapParallel.data(), density);
+
+            ASSERT_GT(numSequential, 0);
+            EXPECT_EQ(numSequential, numParallel) << "density " << density;
+            EXPECT_EQ(sequential.currentPotential, parallel.currentPotential);
+            EXPECT_TRUE(mapSequential == mapParallel) << "density " << density;
+
+            // Reselecting on the same frame reuses the cached candidate mask.
+            numParallel = parallel.makeMaps(fh.get(), mapParallel.data(), density * 0.5f);
+            numSequential = sequential.makeMaps(fh.get(), mapSequential.data(), density * 0.5f);
+            EXPECT_EQ(numSequential, numParallel);
+            EXPECT_TRUE(mapSequential == mapParallel);
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(PixelSelectorTests, PixelSelectorTest, ::testing::Values(false, true));
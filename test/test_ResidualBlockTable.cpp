@@ -0,0 +1,295 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+#include "FullSystem/ResidualBlockTable.h"
+#include "FullSystem/HessianBlocks.h"
+#include "FullSystem/ImmaturePoint.h"
+#include "util/globalCalib.h"
+#include "OptimizationBackend/RawResidualJacobian.h"
+
+using namespace dso;
+
+// A few frames with points and residuals between all of them, collected in the order of FullSystem::optimize.
+class ResidualBlockTableTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        setGlobalCalib(w, h, (Eigen::Matrix3f() << 200, 0, 160, 0, 200, 120, 0, 0, 1).finished());
+        HCalib.reset(new CalibHessian());
+
+        // smooth texture, so that the residuals are mostly inliers.
+        std::vector<float> image(w * h);
+        for(int y = 0; y < h; y++)
+        {
+            for(int x = 0; x < w; x++)
+            {
+                image[x + y * w] = 128 + 60 * std::sin(x * 0.3f) + 60 * std::cos(y * 0.2f + x * 0.05f);
+            }
+        }
+
+        for(int i = 0; i < numFrames; i++)
+        {
+            frames.emplace_back(new FrameHessian());
+            FrameHessian* fh = frames.back().get();
+            fh->makeImages(image.data(), HCalib.get());
+            fh->idx = i;
+            fh->ab_exposure = 1;
+            fh->frameEnergyTH = 1e6;
+            SE3d pose(Sophus::SO3d::exp(Vec3(0, 0.002 * i, 0)), Vec3(0.01 * i, 0.005 * i, 0));
+            fh->setEvalPT_scaled(pose, AffLight(0, 0));
+        }
+        for(auto&& host : frames)
+        {
+            host->targetPrecalc.resize(numFrames);
+            for(auto&& target : frames)
+            {
+                host->targetPrecalc[target->idx].set(host.get(), target.get(), HCalib.get());
+            }
+        }
+
+        std::uniform_int_distribution<int> du(10, w - 10), dv(10, h - 10);
+        std::uniform_real_distribution<float> depthDist(0.2, 1);
+        for(auto&& host : frames)
+        {
+            for(int i = 0; i < pointsPerFrame; i++)
+            {
+                ImmaturePoint ip(du(rng), dv(rng), host.get(), 1, HCalib.get());
+                ip.idepth_min = ip.idepth_max = depthDist(rng);
+                points.emplace_back(new PointHessian(&ip, HCalib.get()));
+                PointHessian* ph = points.back().get();
+                for(auto&& target : frames)
+                {
+                    if(target == host) continue;
+                    activeResiduals.push_back(new(residualAllocator) PointFrameResidual(ph, host.get(), target.get()));
+                }
+            }
+        }
+        allResiduals = activeResiduals;
+    }
+
+    void TearDown() override
+    {
+        for(PointFrameResidual* r : allResiduals)
+        {
+            delete r;
+        }
+        // PointHessian asserts that it has been removed from the energy functional.
+        for(auto&& point : points)
+        {
+            point->efPoint = 0;
+        }
+    }
+
+    // ResidualBlockTable::linearize (four residuals at a time) against PointFrameResidual::linearize.
+    // The table is linearized in the given chunks, like by the reductors.
+    void expectSameLinearization(ResidualBlockTable& table, std::vector<int> chunks = {},
+                                 float minInFraction = 0.5, int oobEvery = 0)
+    {
+        // residuals which are OOB before the linearization keep their old energy.
+        auto resetState = [&](int k, PointFrameResidual* r)
+        {
+            r->resetOOB();
+            if(oobEvery > 0 && k % oobEvery == 0)
+            {
+                r->setState(ResState::OOB);
+                r->state_energy = k;
+            }
+        };
+
+        std::vector<double> energies;
+        std::vector<ResState> states;
+        std::vector<RawResidualJacobian> jacobians;
+        std::vector<Vec3f> centers;
+        double energySum = 0;
+        for(int k = 0; k < table.size(); k++)
+        {
+            PointFrameResidual* r = table.residual(k);
+            resetState(k, r);
+            energies.push_back(r->linearize(HCalib.get()));
+            energySum += energies.back();
+            states.push_back(r->state_NewState);
+            jacobians.push_back(*r->J);
+            centers.push_back(r->centerProjectedTo);
+            resetState(k, r);
+        }
+
+        chunks.insert(chunks.begin(), 0);
+        chunks.push_back(table.size());
+        double energy = 0;
+        for(int i = 0; i + 1 < (int) chunks.size(); i++)
+        {
+            energy += table.linearize(HCalib.get(), chunks[i], chunks[i + 1]);
+        }
+        EXPECT_NEAR(energy, energySum, 1e-5 * energySum);
+
+        int numIn = 0;
+        for(int k = 0; k < table.size(); k++)
+        {
+            PointFrameResidual* r = table.residual(k);
+            ASSERT_EQ(r->state_NewState, states[k]) << "residual " << k;
+            if(states[k] == ResState::OOB)
+            {
+                ASSERT_EQ(r->state_NewEnergyWithOutlier, -1);
+                continue;
+            }
+            if(states[k] == ResState::IN) numIn++;
+
+            const RawResidualJacobian& expected = jacobians[k];
+            EXPECT_NEAR(r->state_NewEnergy, energies[k], 1e-5 * energies[k]);
+            EXPECT_TRUE(r->centerProjectedTo.isApprox(centers[k], 1e-5));
+            EXPECT_TRUE(r->J->resF.isApprox(expected.resF, 1e-4));
+            for(int i = 0; i < 2; i++)
+            {
+                EXPECT_TRUE(r->J->Jpdxi[i].isApprox(expected.Jpdxi[i], 1e-5));
+                EXPECT_TRUE(r->J->Jpdc[i].isApprox(expected.Jpdc[i], 1e-5));
+                EXPECT_TRUE(r->J->JIdx[i].isApprox(expected.JIdx[i], 1e-4));
+                EXPECT_TRUE(r->J->JabF[i].isApprox(expected.JabF[i], 1e-4));
+            }
+            EXPECT_TRUE(r->J->Jpdd.isApprox(expected.Jpdd, 1e-5));
+            EXPECT_TRUE(r->J->JIdx2.isApprox(expected.JIdx2, 1e-4));
+            EXPECT_TRUE(r->J->JabJIdx.isApprox(expected.JabJIdx, 1e-4));
+            EXPECT_TRUE(r->J->Jab2.isApprox(expected.Jab2, 1e-4));
+        }
+        // otherwise the comparison would be meaningless.
+        EXPECT_GT(numIn, table.size() * minInFraction);
+    }
+
+    const int w = 320, h = 240;
+    const int numFrames = 4;
+    const int pointsPerFrame = 30;
+    std::mt19937 rng{3};
+    std::unique_ptr<CalibHessian> HCalib;
+    std::vector<std::unique_ptr<FrameHessian>> frames;
+    std::vector<std::unique_ptr<PointHessian>> points;
+    SlabAllocator<PointFrameResidual> residualAllocator;
+    std::vector<PointFrameResidual*> activeResiduals;
+    std::vector<PointFrameResidual*> allResiduals;
+};
+
+TEST_F(ResidualBlockTableTest, GroupsByHostAndTarget)
+{
+    ResidualBlockTable table;
+    table.build(activeResiduals, numFrames);
+    ASSERT_EQ(table.size(), (int) activeResiduals.size());
+    ASSERT_EQ(table.blocks.size(), numFrames * (numFrames - 1));
+
+    int next = 0;
+    int lastBlockIdx = -1;
+    for(const ResidualBlockTable::Block& block : table.blocks)
+    {
+        EXPECT_EQ(block.begin, next);
+        EXPECT_GT(block.end, block.begin);
+        next = block.end;
+
+        int blockIdx = block.host->idx * numFrames + block.target->idx;
+        EXPECT_GT(blockIdx, lastBlockIdx);
+        lastBlockIdx = blockIdx;
+
+        // the residuals of a block are the ones of its pair, in their original order.
+        auto original = activeResiduals.begin();
+        for(int k = block.begin; k < block.end; k++)
+        {
+            PointFrameResidual* r = table.residual(k);
+            EXPECT_EQ(r->host, block.host);
+            EXPECT_EQ(r->target, block.target);
+            auto found = std::find(original, activeResiduals.end(), r);
+            ASSERT_NE(found, activeResiduals.end());
+            original = found + 1;
+        }
+    }
+    EXPECT_EQ(next, table.size());
+}
+
+TEST_F(ResidualBlockTableTest, LinearizeSameAsScalar)
+{
+    ResidualBlockTable table;
+    table.build(activeResiduals, numFrames);
+    expectSameLinearization(table);
+
+    // the depths are gathered again before each linearization.
+    std::uniform_real_distribution<float> depthDist(0.2, 1);
+    for(auto&& point : points)
+    {
+        point->setIdepthScaled(depthDist(rng));
+    }
+    table.updateDepths(0, table.size());
+    expectSameLinearization(table);
+}
+
+TEST_F(ResidualBlockTableTest, Rebuild)
+{
+    ResidualBlockTable table;
+    table.build(activeResiduals, numFrames);
+
+    // like the next optimize() after residuals have been removed.
+    activeResiduals.erase(activeResiduals.begin(), activeResiduals.begin() + activeResiduals.size() / 2);
+    table.build(activeResiduals, numFrames);
+    ASSERT_EQ(table.size(), (int) activeResiduals.size());
+    for(const ResidualBlockTable::Block& block : table.blocks)
+    {
+        for(int k = block.begin; k < block.end; k++)
+        {
+            EXPECT_EQ(table.residual(k)->host, block.host);
+            EXPECT_EQ(table.residual(k)->target, block.target);
+        }
+    }
+    expectSameLinearization(table);
+}
+
+TEST_F(ResidualBlockTableTest, OutOfBoundsLanes)
+{
+    // large parallax for every third point, so that single lanes of a batch project out of the image.
+    for(int i = 0; i < (int) points.size(); i += 3)
+    {
+        points[i]->setIdepthScaled(30);
+    }
+    ResidualBlockTable table;
+    table.build(activeResiduals, numFrames);
+
+    int numOOB = 0;
+    for(int k = 0; k < table.size(); k++)
+    {
+        PointFrameResidual* r = table.residual(k);
+        r->resetOOB();
+        r->linearize(HCalib.get());
+        if(r->state_NewState == ResState::OOB) numOOB++;
+    }
+    ASSERT_GT(numOOB, table.size() / 10);
+
+    expectSameLinearization(table, {}, 0.3);
+}
+
+TEST_F(ResidualBlockTableTest, ChunksAndOOBResiduals)
+{
+    ResidualBlockTable table;
+    table.build(activeResiduals, numFrames);
+    // chunks which split blocks and batches, and residuals which are OOB already.
+    expectSameLinearization(table, {1, 13, 50, 51, 130}, 0.4, 5);
+}
@@ -0,0 +1,148 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <future>
+#include <mutex>
+#include "util/SPSCQueue.h"
+
+using namespace dso;
+
+TEST(SPSCQueueTest, FIFOAndCapacity)
+{
+    SPSCQueue<int> queue(5);
+    EXPECT_EQ(queue.capacity(), 8);
+    EXPECT_TRUE(queue.empty());
+
+    for(int i = 0; i < 8; i++)
+    {
+        EXPECT_TRUE(queue.tryPush(i));
+    }
+    EXPECT_FALSE(queue.tryPush(8));
+    EXPECT_EQ(queue.size(), 8);
+
+    int value;
+    for(int i = 0; i < 8; i++)
+    {
+        ASSERT_TRUE(queue.tryPop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.tryPop(value));
+}
+
+TEST(SPSCQueueTest, ConcurrentProducerConsumer)
+{
+    SPSCQueue<int> queue(4);
+    const int num = 200000;
+
+    std::thread producer([&]()
+                         {
+                             for(int i = 0; i < num; i++)
+                             {
+                                 queue.push(i);
+                             }
+                         });
+
+    int value;
+    for(int i = 0; i < num; i++)
+    {
+        ASSERT_TRUE(queue.waitPop(value));
+        ASSERT_EQ(value, i);
+    }
+    producer.join();
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SPSCQueueTest, InterruptWakesConsumer)
+{
+    SPSCQueue<int> queue(4);
+    std::thread interrupter([&]()
+                            {
+                                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                                queue.interrupt();
+                            });
+    int value;
+    EXPECT_FALSE(queue.waitPop(value));
+    interrupter.join();
+}
+
+// Same synchronization as FullSystem::deliverTrackedFrame and FullSystem::mappingLoop: the producer pushes while
+// holding a mutex which the consumer needs to finish each element. The consumer is slow for one element, so the
+// queue becomes full while it is busy. This must not deadlock.
+TEST(SPSCQueueTest, FillsUpDuringSlowConsumerStep)
+{
+    SPSCQueue<int> queue(4);
+    std::mutex syncMutex;
+    const int num = 100;
+
+    auto producer = std::async(std::launch::async, [&]()
+    {
+        for(int i = 0; i < num; i++)
+        {
+            queue.waitForSpace();
+            std::unique_lock<std::mutex> lock(syncMutex);
+            ASSERT_TRUE(queue.tryPush(i));
+        }
+    });
+    auto consumer = std::async(std::launch::async, [&]()
+    {
+        int value;
+        for(int i = 0; i < num; i++)
+        {
+            ASSERT_TRUE(queue.waitPop(value));
+            ASSERT_EQ(value, i);
+            if(i == 0)
+            {
+                // Slow step, e.g. a keyframe. The producer fills the queue meanwhile.
+                while(!queue.full())
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+            std::unique_lock<std::mutex> lock(syncMutex);
+        }
+    });
+
+    ASSERT_EQ(producer.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    ASSERT_EQ(consumer.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    producer.get();
+    consumer.get();
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SPSCQueueTest, InterruptWakesProducer)
+{
+    SPSCQueue<int> queue(2);
+    EXPECT_TRUE(queue.push(0));
+    EXPECT_TRUE(queue.push(1));
+    EXPECT_TRUE(queue.full());
+    std::thread interrupter([&]()
+                            {
+                                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                                queue.interrupt();
+                            });
+    EXPECT_FALSE(queue.push(2));
+    interrupter.join();
+}
@@ -0,0 +1,166 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "OptimizationBackend/SparseBlockLDLT.h"
+
+using namespace dso;
+
+namespace
+{
+// Random SPD matrix where block i is only coupled to blocks i-bandwidth..i+bandwidth, and additionally every block to
+// block 0 (like the camera parameters in the BA Hessian).
+MatXX makeBandedSPD(const std::vector<int>& blockSizes, int bandwidth, std::mt19937& rng)
+{
+    int nb = blockSizes.size();
+    std::vector<int> start(nb + 1, 0);
+    for(int i = 0; i < nb; ++i)
+    {
+        start[i + 1] = start[i] + blockSizes[i];
+    }
+    int n = start[nb];
+
+    // sum of random J^T J terms, each coupling a pair of blocks.
+    std::normal_distribution<double> dist(0, 1);
+    MatXX H = MatXX::Zero(n, n);
+    for(int i = 0; i < nb; ++i)
+    {
+        for(int j = 0; j <= i; ++j)
+        {
+            if(i - j > bandwidth && j != 0) continue;
+            MatXX A = MatXX::Zero(3, blockSizes[i] + blockSizes[j]);
+            for(int r = 0; r < A.rows(); ++r)
+                for(int c = 0; c < A.cols(); ++c)
+                {
+                    A(r, c) = dist(rng);
+                }
+            MatXX AtA = A.transpose() * A;
+            H.block(start[i], start[i], blockSizes[i], blockSizes[i]) += AtA.topLeftCorner(blockSizes[i], blockSizes[i]);
+            if(i != j)
+            {
+                H.block(start[j], start[j], blockSizes[j], blockSizes[j]) +=
+                        AtA.bottomRightCorner(blockSizes[j], blockSizes[j]);
+                H.block(start[i], start[j], blockSizes[i], blockSizes[j]) +=
+                        AtA.topRightCorner(blockSizes[i], blockSizes[j]);
+                H.block(start[j], start[i], blockSizes[j], blockSizes[i]) +=
+                        AtA.bottomLeftCorner(blockSizes[j], blockSizes[i]);
+            }
+        }
+    }
+    H.diagonal().array() += 0.1;
+    return H;
+}
+
+VecX makeRandomVector(int n, std::mt19937& rng)
+{
+    std::normal_distribution<double> dist(0, 1);
+    VecX b(n);
+    for(int i = 0; i < n; ++i)
+    {
+        b[i] = dist(rng);
+    }
+    return b;
+}
+}
+
+TEST(SparseBlockLDLTTest, BandedSameAsDense)
+{
+    std::mt19937 rng(1);
+    // camera parameters, then one block per frame.
+    std::vector<int> blockSizes(9, 8);
+    blockSizes[0] = 4;
+    SparseBlockLDLT solver;
+
+    for(int bandwidth : {1, 2, 8})
+    {
+        MatXX H = makeBandedSPD(blockSizes, bandwidth, rng);
+        VecX b = makeRandomVector(H.rows(), rng);
+
+        VecX x;
+        ASSERT_TRUE(solver.solve(H, b, blockSizes, x));
+        VecX xDense = H.ldlt().solve(b);
+        EXPECT_TRUE(x.isApprox(xDense, 1e-8)) << "bandwidth " << bandwidth;
+        EXPECT_LT((H * x - b).norm(), 1e-8 * b.norm());
+    }
+}
+
+TEST(SparseBlockLDLTTest, ReusesSymbolicFactorization)
+{
+    std::mt19937 rng(2);
+    std::vector<int> blockSizes{4, 8, 8, 8, 8, 8, 8};
+    SparseBlockLDLT solver;
+
+    MatXX H = makeBandedSPD(blockSizes, 1, rng);
+    VecX b = makeRandomVector(H.rows(), rng);
+    VecX x;
+    ASSERT_TRUE(solver.solve(H, b, blockSizes, x));
+    EXPECT_EQ(solver.getNumSymbolicFactorizations(), 1);
+
+    // new values with the same pattern (like the next GN iteration).
+    MatXX H2 = makeBandedSPD(blockSizes, 1, rng);
+    ASSERT_TRUE(solver.solve(H2, b, blockSizes, x));
+    EXPECT_EQ(solver.getNumSymbolicFactorizations(), 1);
+    EXPECT_TRUE(x.isApprox(H2.ldlt().solve(b), 1e-8));
+
+    // a wider band is not covered by the cached fill pattern.
+    MatXX H3 = makeBandedSPD(blockSizes, 3, rng);
+    ASSERT_TRUE(solver.solve(H3, b, blockSizes, x));
+    EXPECT_EQ(solver.getNumSymbolicFactorizations(), 2);
+    EXPECT_TRUE(x.isApprox(H3.ldlt().solve(b), 1e-8));
+
+    // different block sizes.
+    std::vector<int> otherSizes{4, 8, 8, 8, 8, 8, 6, 2};
+    MatXX H4 = makeBandedSPD(otherSizes, 1, rng);
+    ASSERT_TRUE(solver.solve(H4, b, otherSizes, x));
+    EXPECT_EQ(solver.getNumSymbolicFactorizations(), 3);
+    EXPECT_TRUE(x.isApprox(H4.ldlt().solve(b), 1e-8));
+}
+
+TEST(SparseBlockLDLTTest, IndefiniteFails)
+{
+    std::mt19937 rng(3);
+    std::vector<int> blockSizes(6, 8);
+    blockSizes[0] = 4;
+    MatXX H = makeBandedSPD(blockSizes, 1, rng);
+    // make the system indefinite.
+    H(20, 20) = -100;
+    VecX b = makeRandomVector(H.rows(), rng);
+
+    SparseBlockLDLT solver;
+    VecX x = VecX::Constant(H.rows(), 42);
+    EXPECT_FALSE(solver.solve(H, b, blockSizes, x));
+    // x is not modified, so that the caller can fall back to the dense solve.
+    EXPECT_EQ(x, VecX::Constant(H.rows(), 42));
+
+    // the dense fallback used by the callers still solves it.
+    VecX xDense = H.ldlt().solve(b);
+    EXPECT_LT((H * xDense - b).norm(), 1e-6 * b.norm());
+
+    // a later positive definite system is solved again.
+    MatXX H2 = makeBandedSPD(blockSizes, 1, rng);
+    ASSERT_TRUE(solver.solve(H2, b, blockSizes, x));
+    EXPECT_TRUE(x.isApprox(H2.ldlt().solve(b), 1e-8));
+}
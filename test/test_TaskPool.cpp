@@ -0,0 +1,104 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include "util/TaskPool.h"
+
+using namespace dmvio;
+
+TEST(TaskPoolTest, ExecutesAllTasks)
+{
+    std::atomic<int> sum{0};
+    std::vector<std::future<void>> futures;
+    {
+        TaskPool pool("TestPool");
+        for(int i = 1; i <= 100; ++i)
+        {
+            futures.push_back(pool.addTask([&sum, i]()
+                                           { sum += i; }));
+        }
+        for(auto&& future : futures)
+        {
+            future.get();
+        }
+        EXPECT_EQ(sum, 5050);
+        EXPECT_GE(pool.getNumThreads(), 1);
+    }
+}
+
+TEST(TaskPoolTest, ReusesIdleThreads)
+{
+    TaskPool pool("TestPool");
+    for(int i = 0; i < 10; ++i)
+    {
+        pool.addTask([]()
+                     {}).get();
+    }
+    // As each task was awaited before adding the next one, a single thread suffices.
+    EXPECT_EQ(pool.getNumThreads(), 1);
+}
+
+TEST(TaskPoolTest, RunsTasksConcurrently)
+{
+    TaskPool pool("TestPool");
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    // The first task blocks until the second one has run, which is only possible with a second thread.
+    auto first = pool.addTask([released]()
+                              { released.wait(); });
+    auto second = pool.addTask([&release]()
+                               { release.set_value(); });
+    second.get();
+    first.get();
+    EXPECT_EQ(pool.getNumThreads(), 2);
+}
+
+TEST(TaskPoolTest, PropagatesExceptions)
+{
+    TaskPool pool("TestPool");
+    auto future = pool.addTask([]()
+                               { throw std::runtime_error("Task failed"); });
+    EXPECT_THROW(future.get(), std::runtime_error);
+    // The pool is still usable afterwards.
+    bool executed = false;
+    pool.addTask([&executed]()
+                 { executed = true; }).get();
+    EXPECT_TRUE(executed);
+}
+
+TEST(TaskPoolTest, DestructorFinishesQueuedTasks)
+{
+    std::atomic<int> numExecuted{0};
+    {
+        TaskPool pool("TestPool");
+        for(int i = 0; i < 20; ++i)
+        {
+            pool.addTask([&numExecuted]()
+                         { numExecuted++; });
+        }
+    }
+    EXPECT_EQ(numExecuted, 20);
+}
@@ -0,0 +1,63 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include "util/TimeMeasurement.h"
+
+using namespace dmvio;
+
+TEST(TestMeasurementLog, HistogramPercentiles)
+{
+    MeasurementLog log;
+    std::mt19937 generator(42);
+    std::lognormal_distribution<double> distribution(-5.0, 1.0);
+    std::vector<double> samples;
+    for(int i = 0; i < 20000; ++i)
+    {
+        double time = distribution(generator);
+        samples.push_back(time);
+        log.addMeasurement(time);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    for(double percentile : {50.0, 95.0, 99.0, 99.9})
+    {
+        double exact = samples[(size_t) std::ceil(percentile / 100.0 * samples.size()) - 1];
+        EXPECT_NEAR(log.getPercentile(percentile), exact, exact / (1 << MeasurementLog::HistogramSubBucketBits));
+    }
+    EXPECT_LE(log.getPercentile(100), log.getMax());
+
+    // Rolling statistics only contain the last measurements.
+    for(int i = 0; i < MeasurementLog::windowSize; ++i)
+    {
+        log.addMeasurement(1.0);
+    }
+    LatencyStats window = log.getWindowStats();
+    EXPECT_EQ(window.num, MeasurementLog::windowSize);
+    EXPECT_DOUBLE_EQ(window.p50, 1.0);
+    EXPECT_DOUBLE_EQ(window.mean, 1.0);
+}
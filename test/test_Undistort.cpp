@@ -0,0 +1,216 @@
+/**
+* This file is part of DM-VIO.
+*
+* Copyright (c) 2022 Lukas von Stumberg <lukas dot stumberg at tum dot de>.
+* for more information see <http://vision.in.tum.de/dm-vio>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DM-VIO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DM-VIO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DM-VIO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+#include "util/NumType.h"
+#include "util/Undistort.h"
+#include "util/settings.h"
+#include "IOWrapper/ImageRW.h"
+
+using namespace dso;
+
+namespace
+{
+const int wOrg = 160, hOrg = 120;
+const std::string calibFile = "test_undistort_camera.txt";
+const std::string gammaFile = "test_undistort_pcalib.txt";
+const std::string vignetteFile = "test_undistort_vignette.png";
+
+// Gives access to the remap of the undistorter.
+class TestUndistort : public UndistortRadTan
+{
+public:
+    explicit TestUndistort(const char* configFileName) : UndistortRadTan(configFileName, false)
+    {}
+
+    int width() const
+    { return w; }
+
+    int height() const
+    { return h; }
+
+    // The previous implementation: photometric correction of the full raw image, then bilinear remap with the
+    // float maps.
+    std::vector<float> undistortFloat(MinimalImageB* image, float exposure, float factor) const
+    {
+        ImageAndExposure photometricOutput(wOrg, hOrg);
+        photometricUndist->processFrame<unsigned char>(image->data, exposure, factor, &photometricOutput);
+        const float* in = photometricOutput.image;
+
+        std::vector<float> out(w * h);
+        for(int idx = 0; idx < w * h; idx++)
+        {
+            float xx = remapX[idx];
+            float yy = remapY[idx];
+            if(xx < 0)
+            {
+                out[idx] = 0;
+                continue;
+            }
+            int xxi = xx;
+            int yyi = yy;
+            xx -= xxi;
+            yy -= yyi;
+            float xxyy = xx * yy;
+            const float* src = in + xxi + yyi * wOrg;
+            out[idx] = xxyy * src[1 + wOrg] + (yy - xxyy) * src[wOrg] + (xx - xxyy) * src[1] +
+                       (1 - xx - yy + xxyy) * src[0];
+        }
+        return out;
+    }
+
+    std::vector<float> undistortFixedPoint(const MinimalImageB* image, float exposure, float factor,
+                                           SimdLevel level) const
+    {
+        std::vector<float> out(w * h);
+        int mode = photometricUndist->getProcessMode(exposure);
+        remapAndCorrect<unsigned char>(image->data, out.data(), mode, factor, 0, w * h, level);
+        return out;
+    }
+};
+}
+
+class UndistortRemapTest : public ::testing::TestWithParam<SimdLevel>
+{
+protected:
+    void SetUp() override
+    {
+        oldPhotometricCalibration = setting_photometricCalibration;
+
+        std::ofstream calib(calibFile);
+        calib << "RadTan 0.55 0.73 0.5 0.5 -0.28 0.07 0.0002 0.00002\n" << wOrg << " " << hOrg << "\ncrop\n"
+              << wOrg << " " << hOrg << "\n";
+        calib.close();
+
+        // strictly increasing, non-linear response.
+        std::ofstream gamma(gammaFile);
+        for(int i = 0; i < 256; i++)
+        {
+            gamma << i + 0.003 * i * i << " ";
+        }
+        gamma << "\n";
+        gamma.close();
+
+        MinimalImageB vignette(wOrg, hOrg);
+        for(int y = 0; y < hOrg; y++)
+            for(int x = 0; x < wOrg; x++)
+            {
+                float dx = (x - wOrg / 2) / (float) wOrg, dy = (y - hOrg / 2) / (float) hOrg;
+                vignette.at(x, y) = 255 * (1 - (dx * dx + dy * dy));
+            }
+        IOWrap::writeImage(vignetteFile, &vignette);
+
+        undistort.reset(new TestUndistort(calibFile.c_str()));
+        undistort->loadPhotometricCalibration(gammaFile, "", vignetteFile);
+
+        image.reset(new MinimalImageB(wOrg, hOrg));
+        std::mt19937 rng(5);
+        std::uniform_int_distribution<int> noise(-20, 20);
+        for(int y = 0; y < hOrg; y++)
+            for(int x = 0; x < wOrg; x++)
+            {
+                int val = 128 + 80 * sinf(x * 0.21f) * cosf(y * 0.13f) + noise(rng);
+                image->at(x, y) = std::max(0, std::min(255, val));
+            }
+    }
+
+    void TearDown() override
+    {
+        setting_photometricCalibration = oldPhotometricCalibration;
+        std::remove(calibFile.c_str());
+        std::remove(gammaFile.c_str());
+        std::remove(vignetteFile.c_str());
+    }
+
+    // Compares the fixed-point remap with the float implementation for the photometric mode selected by the settings.
+    void compareWithFloat(float exposure, float factor)
+    {
+        SimdLevel level = GetParam();
+        if(detectSimdLevel() < level)
+        {
+            GTEST_SKIP() << simdLevelName(level) << " is not supported on this CPU.";
+        }
+
+        std::vector<float> expected = undistort->undistortFloat(image.get(), exposure, factor);
+        std::vector<float> actual = undistort->undistortFixedPoint(image.get(), exposure, factor, level);
+        ASSERT_EQ(expected.size(), actual.size());
+        int numValid = 0;
+        for(size_t i = 0; i < expected.size(); i++)
+        {
+            // the sub-pixel weights are quantized to 1/65536.
+            ASSERT_NEAR(expected[i], actual[i], 0.01) << "pixel " << i;
+            if(expected[i] != 0) numValid++;
+        }
+        EXPECT_GT(numValid, undistort->width() * undistort->height() / 2);
+    }
+
+    // The photometric calibration cannot be read if built without OpenCV.
+    bool photometricCalibrationLoaded() const
+    {
+        return undistort->photometricUndist->getProcessMode(1) != 0;
+    }
+
+    int oldPhotometricCalibration;
+    std::unique_ptr<TestUndistort> undistort;
+    std::unique_ptr<MinimalImageB> image;
+};
+
+TEST_P(UndistortRemapTest, NoPhotometricCalibration)
+{
+    setting_photometricCalibration = 0;
+    compareWithFloat(1.0f, 0.7f);
+    // without exposure the photometric calibration is not used either.
+    setting_photometricCalibration = 2;
+    compareWithFloat(0.0f, 1.3f);
+}
+
+TEST_P(UndistortRemapTest, ResponseFunction)
+{
+    setting_photometricCalibration = 1;
+    if(!photometricCalibrationLoaded())
+    {
+        GTEST_SKIP() << "photometric calibration could not be loaded.";
+    }
+    ASSERT_EQ(undistort->photometricUndist->getProcessMode(1), 1);
+    compareWithFloat(1.0f, 1.0f);
+}
+
+TEST_P(UndistortRemapTest, ResponseFunctionAndVignette)
+{
+    setting_photometricCalibration = 2;
+    if(!photometricCalibrationLoaded())
+    {
+        GTEST_SKIP() << "photometric calibration could not be loaded.";
+    }
+    ASSERT_EQ(undistort->photometricUndist->getProcessMode(1), 2);
+    compareWithFloat(1.0f, 1.0f);
+}
+
+INSTANTIATE_TEST_SUITE_P(UndistortRemapTests, UndistortRemapTest, ::testing::Values(SimdLevel::SSE, SimdLevel::AVX2),
+                         [](const ::testing::TestParamInfo<SimdLevel>& info)
+                         { return std::string(simdLevelName(info.param)); });